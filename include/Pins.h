@@ -21,6 +21,11 @@
 #define NFC_CS          16      // RC522 Chip Select (NSS)
 #define NFC_RST         18      // RC522 Reset
 
+// PN5180 (-D NFC_READER_PN5180) uses NFC_CS as NSS and NFC_RST as RST,
+// plus these two
+#define NFC_BUSY        17      // PN5180 BUSY
+#define NFC_IRQ         14      // PN5180 IRQ (for LPCD; not used yet)
+
 // =========================
 //   VS1053B AUDIO DECODER
 //   Uses SPI1 bus (11, 12, 13)
@@ -3,20 +3,41 @@
 #include <Wire.h>
 #include <FT6236.h>
 #include "pins.h"
+#include "utils/NfcSession.h"
+#if defined(NFC_READER_PN5180)
+#include "utils/PN5180_Module.h"
+#elif defined(NFC_READER_RC522)
+#include "utils/RC522_Module.h"
+#else
 #include "utils/PN532_Module.h"
+#endif
 #include "utils/VS1053_Module.h"
 #include "utils/TFT_Module.h"
 #include "utils/TouchCalibration.h"
 #include "managers/ScreenManager.h"
 #include "utils/SD_Module.h"
 #include "managers/MP3Player.h"
+#include "managers/Playlist.h"
 #include "utils/SPIBusLock.h"
 #include <WiFi.h>
 #include <time.h>
 #include "utils/Settings.h"
+#include "ui/GlyphAtlas.h"
+#include "utils/AlbumArtPrefetcher.h"
+#include "utils/VS1053_Plugins.h"
+#include "utils/PowerManager.h"
+#include "utils/LibraryIndex.h"
+#include "utils/SearchIndex.h"
 
 // Hardware modules
-PN532_Module nfcModule;
+#if defined(NFC_READER_PN5180)
+PN5180_Module nfcReader(NFC_CS, NFC_BUSY, NFC_RST);
+#elif defined(NFC_READER_RC522)
+RC522_Module nfcReader(NFC_CS, NFC_RST);
+#else
+PN532_Module nfcReader;
+#endif
+NfcSession nfcModule(nfcReader);
 VS1053_Module audioModule(VS1053_CS, VS1053_DCS, VS1053_DREQ, VS1053_RST);
 TFT_Module tftModule(TFT_CS, TFT_DC, TFT_RST, TFT_BL, SPI2_SCK, SPI2_MOSI, SPI2_MISO);
 SD_Module sdModule(SD_CS);
@@ -118,10 +139,11 @@ void setupWiFi() {
 // Task function running on Core 0
 void mp3StreamTask(void* parameter) {
     MP3Player* player = (MP3Player*)parameter;
-    
+    player->beginFeeder();
+
     while (true) {
         player->update();
-        vTaskDelay(1);  // Yield 1ms
+        player->waitForWork();  // sleeps until a command or DREQ needs it
     }
 }
 
@@ -185,7 +207,7 @@ if (!testSd.begin(SdSpiConfig(SD_CS, SHARED_SPI, SD_SCK_MHZ(4)))) {
   
   Serial.println("\nInitializing VS1053 Audio...");
   audioModule.begin();
-  audioModule.setVolume(55);
+  audioModule.setVolumeImmediate(55);
   
   // TEST: Verify audio output works
   Serial.println("Testing audio output...");
@@ -215,10 +237,20 @@ if (!sdModule.begin()) {
   }
   delay(100);
 
+    // VLSI patches/plugins from /Plugins (FLAC etc.) - parsed once into
+    // PSRAM, then re-applied from there after every decoder reset.
+    VS1053_Plugins::getInstance().loadFromSD("/Plugins");
+    audioModule.applyPlugins();
+
     // Load settings AFTER SD card init
     Settings& settings = Settings::getInstance();
     settings.load();
 
+    // Start indexing the library for search - after the plugins, since
+    // they decide which files count as playable (FLAC). loop() does the
+    // actual scanning, a few ms at a time.
+    LibraryIndex::getInstance().begin(&sdModule, &audioModule);
+
     Serial.printf("Free heap before WiFi: %d bytes\n", ESP.getFreeHeap());
     // Connect to WiFi
     setupWiFi();
@@ -237,6 +269,10 @@ if (!sdModule.begin()) {
   );
   Serial.println("MP3 task created");
 
+  // Background album art decoder for MP3AlbumList (Core 1, idles on a
+  // task notification until a page asks for covers).
+  AlbumArtPrefetcher::getInstance().begin();
+
 
 
   
@@ -244,6 +280,10 @@ if (!sdModule.begin()) {
   Serial.println("\nInitializing TFT Display...");
   tftModule.begin();
   delay(100);
+
+  // Rasterize the UI fonts once, up front - RAM only, no panel writes.
+  // If it fails every caller just falls back to LovyanGFX drawString().
+  GlyphAtlas::getInstance().begin();
   
   // Restore SPI1 after TFT init
   SPI.begin(SPI1_SCK, SPI1_MISO, SPI1_MOSI);
@@ -268,7 +308,7 @@ if (!sdModule.begin()) {
   Serial.println("Touch: ✓ Ready!");
 
   // After touchScreen.begin() and before attachInterrupt:
-  Serial.println("\nInitializing PN532 NFC...");
+  Serial.println("\nInitializing NFC...");
   nfcModule.begin();
 
 
@@ -283,7 +323,8 @@ if (!sdModule.begin()) {
   Serial.println("\nInitializing Screen Manager...");
   screenManager.begin();
 
-
+  // Idle dimming and shelf-mode light sleep
+  PowerManager::getInstance().begin(&tftModule, &nfcModule);
   
   Serial.println("\n=== System Ready ===\n");
 }
@@ -291,28 +332,40 @@ if (!sdModule.begin()) {
 void loop() {
   // DO NOT call mp3Player.update() - it runs on Core 0
 
-  // consumeNaturalEnd() (not the old isPlaying()-transition + debounce
-  // approach) - that older approach fired whenever isPlaying() went
-  // from true to false, which is also true during ANY deliberate
-  // stop-then-restart (e.g. KidScreen::showAlbum()'s own
-  // requestStop()+softReset() sequence when a new album/NFC tag loads
-  // while something was already playing). The 1-second debounce only
-  // covered manual touch-driven advances, not NFC-triggered ones, so
-  // an NFC tag placed mid-playback could catch that transient window
-  // and call handleSongEnd() before the new album's first track had
-  // even started - observed as "skips straight to track 2".
-  // consumeNaturalEnd() only reports true for a genuine end-of-file,
-  // and is cleared by any play()/requestStop() in between, so a
-  // deliberate interruption can never be mistaken for a real end here.
-  if (mp3Player.consumeNaturalEnd()) {
-      screenManager.handleSongEnd();
+  // Drain player events. Only genuine end-of-file (or an explicit
+  // skip) produces a NaturalEnd, and pollEvent() drops events for any
+  // track that a later play()/requestStop()/skip() has superseded - so
+  // an NFC tag placed mid-playback can't have the old track's end
+  // auto-advance the new album ("skips straight to track 2").
+  PlayerEvent ev;
+  while (mp3Player.pollEvent(ev)) {
+      if (ev.type == PlayerEvent::Started) {
+          // value 1 = the player chained into Playlist's queued next
+          // track by itself - bring the playlist's cursor along.
+          if (ev.value == 1) Playlist::getInstance().onGaplessAdvance();
+          PowerManager::getInstance().notePlaybackStarted();
+      } else if (ev.type == PlayerEvent::NaturalEnd) {
+          screenManager.handleSongEnd();
+      } else if (ev.type == PlayerEvent::Error) {
+          Serial.printf("Player: ✗ Track failed (error %lu)\n", (unsigned long)ev.value);
+      }
   }
 
+  // Background library scan, and the search index following it
+  LibraryIndex::getInstance().step();
+  SearchIndex::getInstance().sync();
+
   // Update screen animations
   screenManager.update();
   
-  // Monitor NFC tags
-  nfcModule.monitorForTags(screenManager);
+  // Monitor NFC tags (not while a screen is using the reader itself)
+  if (!screenManager.isOnSettingsScreen() && !screenManager.isOnWriteTagScreen()) {
+    nfcModule.poll();
+  }
+  NfcEvent nfcEvent;
+  while (nfcModule.nextEvent(nfcEvent)) {
+    screenManager.handleNfcEvent(nfcEvent);
+  }
   
   // Handle touch events
   if (touchDetected) {
@@ -320,8 +373,15 @@ void loop() {
     delay(50);  // Debounce
     
     TS_Point p = touchScreen.getPoint();
-    if (p.x != 0 && p.y != 0) {
+    // A touch on a dimmed screen only brings it back - it doesn't
+    // also press whatever happened to be under the finger.
+    if (p.x != 0 && p.y != 0 && !PowerManager::getInstance().noteTouch()) {
       screenManager.handleTouch(p.x, p.y);
     }
   }
+
+  // Dim / shelf when nothing is happening. Entering the shelf stage
+  // blocks right here until a card or touch wakes the device.
+  PowerManager::getInstance().update(mp3Player.isPlaying() ||
+                                     !screenManager.allowsIdleSleep());
 }
@@ -6,13 +6,32 @@
 #include "MP3Player.h"
 #include "../utils/SD_Module.h"
 #include "../utils/VS1053_Module.h"
+#include "../utils/PlaybackPosition.h"
 #include "pins.h"
+#include <esp_timer.h>
 
 MP3Player::MP3Player(SD_Module& sd, VS1053_Module& audio)
-    : sdModule(sd), audioModule(audio), state(IDLE), needsOpen(false),
+    : sdModule(sd), audioModule(audio), state(IDLE),
+      nextSeq(0), latestSeq(0), activeSeq(0), droppedEvents(0),
+      pausePending(false), feederTask(nullptr),
+      statsWindowStartUs(0), statsSleptUs(0), statsWakeups(0),
+      dutyPercent(100), wakeupsPerSec(0), feederAsleep(false),
       queueHead(0), queueTail(0), queueCount(0), eofReached(false),
-      naturalEnd(false)
+      currentFileSize(0), bytesFed(0),
+      lastDecodeSec(0), lastByteRate(0)
 {
+    currentPath[0] = '\0';
+    chainPath[0] = '\0';
+}
+
+void MP3Player::publishPosition() {
+    PlaybackSnapshot s;
+    s.trackSeq = activeSeq;
+    s.fileSize = currentFileSize;
+    s.bytesFed = bytesFed;
+    s.decodeSec = lastDecodeSec;
+    s.byteRate = lastByteRate;
+    PlaybackPosition::getInstance().publish(s);
 }
 
 void MP3Player::resetQueue() {
@@ -22,50 +41,339 @@ void MP3Player::resetQueue() {
     eofReached = false;
 }
 
-bool MP3Player::play(const char* path) {
-    // A fresh play() call always supersedes any stop that hasn't been
-    // serviced yet. Without this, a stopRequested left over from
-    // whatever was happening a moment ago (e.g. leaving a different
-    // screen) can land in the same update() tick as this new track's
-    // needsOpen, producing a transient stop+reopen right as playback
-    // starts - long enough for anything polling end-of-track state to
-    // misread it as "already finished" and skip straight to the next
-    // track before this one ever really began.
-    stopRequested = false;
-    naturalEnd = false;
-
-    strncpy(pendingPath, path, sizeof(pendingPath));
-    needsOpen = true;
+// ---------------------------------------------------------------------
+//  UI side (Core 1)
+// ---------------------------------------------------------------------
+
+bool MP3Player::sendCommand(PlayerCommand::Type type, uint32_t value, bool newTrack, const char* path) {
+    PlayerCommand cmd;
+    cmd.type = type;
+    cmd.value = value;
+    cmd.seq = newTrack ? nextSeq + 1 : latestSeq;
+    if (path) {
+        strncpy(cmd.path, path, sizeof(cmd.path) - 1);
+        cmd.path[sizeof(cmd.path) - 1] = '\0';
+    } else {
+        cmd.path[0] = '\0';
+    }
+
+    if (!commands.push(cmd)) {
+        Serial.printf("MP3Player: Command queue full, dropped command %d\n", (int)type);
+        return false;
+    }
+
+    // Only committed once it's actually queued, so a dropped command
+    // can't make events for the still-current track look stale.
+    if (newTrack) {
+        nextSeq = cmd.seq;
+        latestSeq = cmd.seq;
+    }
+
+    wakeFeeder();
     return true;
 }
 
+uint32_t MP3Player::play(const char* path) {
+    // A later play() simply queues behind any stop that hasn't been
+    // serviced yet - commands run in order on Core 0, so a leftover
+    // stop can no longer land "in the same tick" as the open and get
+    // mistaken for the new track ending.
+    return sendCommand(PlayerCommand::Play, 0, true, path) ? latestSeq : 0;
+}
+
+void MP3Player::requestStop(bool resetDecoder) {
+    sendCommand(PlayerCommand::Stop, resetDecoder ? 1 : 0, true);
+}
+
 void MP3Player::pause() {
-    if (state == PLAYING) {
-        state = PAUSED;
-        Serial.println("MP3Player: Paused");
-    }
+    sendCommand(PlayerCommand::Pause, 0, false);
 }
 
 void MP3Player::resume() {
-    if (state == PAUSED) {
-        state = PLAYING;
-        Serial.println("MP3Player: Resumed");
+    sendCommand(PlayerCommand::Resume, 0, false);
+}
+
+void MP3Player::seek(uint32_t byteOffset) {
+    sendCommand(PlayerCommand::Seek, byteOffset, false);
+}
+
+void MP3Player::skip() {
+    sendCommand(PlayerCommand::Next, 0, true);
+}
+
+void MP3Player::queueNext(const char* path) {
+    sendCommand(PlayerCommand::QueueNext, 0, false, path);
+}
+
+void MP3Player::setVolume(uint8_t volume) {
+    audioModule.setVolume(volume);
+    wakeFeeder();   // an idle feeder still has to run the ramp
+}
+
+void MP3Player::wakeFeeder() {
+    TaskHandle_t feeder = feederTask.load();
+    if (feeder) xTaskNotifyGive(feeder);
+}
+
+bool MP3Player::pollEvent(PlayerEvent& ev) {
+    while (events.pop(ev)) {
+        if (ev.seq == latestSeq) return true;
+        // Superseded by a newer play/stop/skip - whatever it says is
+        // about a track the UI has already moved on from.
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------
+//  Core 0 side
+// ---------------------------------------------------------------------
+
+void MP3Player::postEvent(PlayerEvent::Type type, uint32_t value) {
+    PlayerEvent ev;
+    ev.type = type;
+    ev.seq = activeSeq;
+    ev.value = value;
+    if (!events.push(ev)) {
+        droppedEvents++;
+        Serial.printf("MP3Player: Event queue full (%lu dropped)\n", (unsigned long)droppedEvents);
     }
 }
 
+static bool isMP3Path(const char* path) {
+    size_t n = strlen(path);
+    return n > 4 && strcasecmp(path + n - 4, ".mp3") == 0;
+}
+
 void MP3Player::stop() {
+    pausePending = false;
+    chainPath[0] = '\0';
     if (state != IDLE) {
+        // Fade out over what's still in the VS1053's FIFO before the
+        // reset cuts it off - that cut is the click you used to hear on
+        // every stop and track change.
+        audioModule.setSoftMute(true);
+        audioModule.fadeToTarget(50);
+
         sdModule.closeFile();
         audioModule.resetForNextTrack();
         state = IDLE;
         resetQueue();
+
+        currentFileSize = 0;
+        bytesFed = 0;
+        publishPosition();
         Serial.println("MP3Player: Stopped");
     }
 }
 
-void MP3Player::requestStop() {
-    naturalEnd = false;
-    stopRequested = true;
+void MP3Player::finishPause() {
+    // Silent now. For MP3, end-fill lets the decoder finish the partial
+    // frame it's holding rather than underrun mid-frame (the noise the
+    // old pause made); on resume it resyncs on the next frame header,
+    // still muted until the ramp comes back up. Every other format reads
+    // end-fill as end of stream, so those just stay muted and unfed.
+    if (isMP3Path(currentPath)) audioModule.sendEndFill(PAUSE_END_FILL_BYTES);
+    pausePending = false;
+    state = PAUSED;
+    Serial.println("MP3Player: Paused");
+}
+
+void MP3Player::beginFeeder() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    feederTask.store(self);
+    audioModule.enableDREQInterrupt(self);
+    statsWindowStartUs = esp_timer_get_time();
+}
+
+void MP3Player::waitForWork() {
+    PlaybackState s = state;
+    int64_t t0 = esp_timer_get_time();
+
+    if ((s == IDLE || s == PAUSED) && commands.empty() && audioModule.isVolumeSettled()) {
+        // Nothing to do until the UI sends something. Anything sent
+        // after the empty() check leaves a pending notification, so this
+        // returns straight away for it.
+        feederAsleep = true;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        feederAsleep = false;
+        statsSleptUs += (uint32_t)(esp_timer_get_time() - t0);
+        statsWakeups++;
+    } else if (s == PLAYING && !audioModule.isReadyForData()) {
+        // FIFO full - nothing to send until DREQ rises again. Counts its
+        // own sleep into the VS1053 stats.
+        audioModule.waitForDREQ(5);
+    } else {
+        vTaskDelay(1);  // Yield 1ms
+        statsSleptUs += (uint32_t)(esp_timer_get_time() - t0);
+        statsWakeups++;
+    }
+
+    updateFeederStats();
+}
+
+void MP3Player::updateFeederStats() {
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - statsWindowStartUs;
+    if (elapsed < 1000000) return;
+
+    uint32_t dreqSleptUs, dreqWakeups;
+    audioModule.takeSleepStats(&dreqSleptUs, &dreqWakeups);
+
+    int64_t slept = (int64_t)statsSleptUs + dreqSleptUs;
+    if (slept > elapsed) slept = elapsed;
+    dutyPercent = (uint8_t)(100 - (slept * 100) / elapsed);
+    wakeupsPerSec = (uint16_t)(((int64_t)(statsWakeups + dreqWakeups) * 1000000) / elapsed);
+
+    statsWindowStartUs = now;
+    statsSleptUs = 0;
+    statsWakeups = 0;
+}
+
+void MP3Player::startTrack(const PlayerCommand& cmd) {
+    // Whatever was playing goes through the full stop path first
+    // (decoder reset included), so the new file never lands on top of
+    // a half-decoded frame from the old one.
+    stop();
+    activeSeq = cmd.seq;
+
+    if (!sdModule.openFile(cmd.path)) {
+        postEvent(PlayerEvent::Error, PLAYER_ERR_OPEN_FAILED);
+        return;
+    }
+    strncpy(currentPath, cmd.path, sizeof(currentPath) - 1);
+    currentPath[sizeof(currentPath) - 1] = '\0';
+
+    Serial.printf("MP3Player: Starting playback\n");
+    audioModule.setSampleRate(44100);
+    audioModule.resetDecodeTime();
+    audioModule.setSoftMute(false);   // ramps back up as the first packets go out
+    SPI.begin(SPI1_SCK, SPI1_MISO, SPI1_MOSI);
+    delay(5);
+    state = PLAYING;
+
+    currentFileSize = sdModule.fileSize();
+    bytesFed = 0;
+    lastDecodeSec = 0;
+    lastByteRate = 0;
+    publishPosition();
+
+    // Prime with a couple of chunks before the first send, so we
+    // start with a small cushion rather than from completely empty.
+    fillQueue();
+    postEvent(PlayerEvent::Started);
+}
+
+void MP3Player::handleCommand(const PlayerCommand& cmd) {
+    switch (cmd.type) {
+        case PlayerCommand::Play:
+            startTrack(cmd);
+            break;
+
+        case PlayerCommand::Stop:
+            activeSeq = cmd.seq;
+            if (state != IDLE) {
+                stop();   // resetForNextTrack() already resets the decoder
+            } else if (cmd.value) {
+                audioModule.softReset();
+            }
+            break;
+
+        case PlayerCommand::Pause:
+            if (state == PLAYING && !pausePending) {
+                // Keep feeding while the volume ramps down - stopping the
+                // data first would let the FIFO run dry at full volume.
+                pausePending = true;
+                audioModule.setSoftMute(true);
+            }
+            break;
+
+        case PlayerCommand::Resume:
+            if (pausePending) {
+                // Resumed mid-fade - just turn the ramp around.
+                pausePending = false;
+                audioModule.setSoftMute(false);
+            } else if (state == PAUSED) {
+                // File position and the banked chunks are untouched, so
+                // the first send goes out on this very tick.
+                audioModule.setSoftMute(false);
+                state = PLAYING;
+                Serial.println("MP3Player: Resumed");
+            }
+            break;
+
+        case PlayerCommand::Seek:
+            if (state != IDLE && cmd.seq == activeSeq) {
+                // Only MP3 can be entered at an arbitrary byte: the VS1053
+                // resyncs on the next frame header by itself. The other
+                // formats' container and decoder state would be garbage.
+                if (!isMP3Path(currentPath)) {
+                    postEvent(PlayerEvent::Error, PLAYER_ERR_SEEK_FAILED);
+                    break;
+                }
+                // Drop what's banked from the old position
+                resetQueue();
+                if (sdModule.seek(cmd.value)) {
+                    bytesFed = cmd.value;
+                    publishPosition();
+                } else {
+                    postEvent(PlayerEvent::Error, PLAYER_ERR_SEEK_FAILED);
+                }
+            }
+            break;
+
+        case PlayerCommand::QueueNext:
+            // Only for the track it was queued behind - a queueNext()
+            // that raced a newer play() is about a stale playlist.
+            if (cmd.seq == activeSeq) {
+                strncpy(chainPath, cmd.path, sizeof(chainPath) - 1);
+                chainPath[sizeof(chainPath) - 1] = '\0';
+            }
+            break;
+
+        case PlayerCommand::Next:
+            activeSeq = cmd.seq;
+            if (state != IDLE) {
+                stop();
+                postEvent(PlayerEvent::NaturalEnd, 1);
+            }
+            break;
+    }
+}
+
+bool MP3Player::chainNextTrack() {
+    // MP3 frames are self-synchronising, so the next file's data can
+    // follow the last frame of this one straight into the decoder. Other
+    // formats have container headers and per-stream decoder state that
+    // need the end-fill/reset a normal track change does.
+    if (!chainPath[0] || !isMP3Path(currentPath) || !isMP3Path(chainPath)) return false;
+
+    sdModule.closeFile();
+    if (!sdModule.openFile(chainPath)) {
+        // Let the current track end normally - the UI then tries the
+        // next one itself and gets the open error there.
+        chainPath[0] = '\0';
+        return false;
+    }
+
+    strncpy(currentPath, chainPath, sizeof(currentPath));
+    chainPath[0] = '\0';
+
+    // Position restarts now, a few banked chunks (~50 ms) before the new
+    // track is actually audible.
+    currentFileSize = sdModule.fileSize();
+    bytesFed = 0;
+    lastDecodeSec = 0;
+    lastByteRate = 0;
+    audioModule.resetDecodeTime();
+    publishPosition();
+
+    Serial.println("MP3Player: Gapless chain to next track");
+    postEvent(PlayerEvent::Started, 1);
+    return true;
+}
+
+void MP3Player::onReadEOF() {
+    if (!chainNextTrack()) eofReached = true;
 }
 
 void MP3Player::fillQueue() {
@@ -76,7 +384,7 @@ void MP3Player::fillQueue() {
         size_t bytesRead = sdModule.readChunk(chunkBuf[queueTail], CHUNK_SIZE);
 
         if (bytesRead == 0) {
-            eofReached = true;
+            onReadEOF();
             break;
         }
 
@@ -92,6 +400,13 @@ bool MP3Player::sendNextQueued() {
     }
 
     audioModule.sendMP3Data(chunkBuf[queueHead], chunkLen[queueHead]);
+    bytesFed += chunkLen[queueHead];
+
+    // sendMP3Data() refreshes decode time/byte rate on its own schedule;
+    // publish only when it has.
+    if (audioModule.takePositionSample(&lastDecodeSec, &lastByteRate)) {
+        publishPosition();
+    }
 
     queueHead = (queueHead + 1) % QUEUE_DEPTH;
     queueCount--;
@@ -99,41 +414,21 @@ bool MP3Player::sendNextQueued() {
 }
 
 void MP3Player::update() {
-    if (stopRequested) {
-        stopRequested = false;
-        stop();
-        // Don't return - fall through to check needsOpen
-    }
-    
-    if (needsOpen) {
-        // needsOpen is cleared at the END of this block now, not the
-        // start. Clearing it first left a real window - however brief -
-        // where needsOpen was already false but state hadn't been set
-        // to PLAYING yet (openFile()/setSampleRate() take actual time:
-        // an SD open plus a VS1053 register write with its own DREQ
-        // wait). hasEnded() is state==IDLE && !needsOpen - during that
-        // window both were true, with no track having actually ended.
-        // Usually too narrow to matter, but MP3SongList polls
-        // hasEnded() every loop tick on the other core, so occasionally
-        // the timing lined up and it read "ended" moments after a track
-        // had just started, skipping straight to the next one.
-        resetQueue();
-        if (sdModule.openFile(pendingPath)) {
-            Serial.printf("MP3Player: Starting playback\n");
-            audioModule.setSampleRate(44100);
-            SPI.begin(SPI1_SCK, SPI1_MISO, SPI1_MOSI);
-            delay(5);
-            state = PLAYING;
-
-            // Prime with a couple of chunks before the first send, so we
-            // start with a small cushion rather than from completely empty.
-            fillQueue();
-        }
-        needsOpen = false;
+    // Commands first, in the order the UI issued them. Each one is
+    // handled to completion here on Core 0 - there is no window in which
+    // the UI can observe a half-applied request.
+    PlayerCommand cmd;
+    while (commands.pop(cmd)) {
+        handleCommand(cmd);
+    }
+
+    if (state != PLAYING) {
+        // While streaming, sendMP3Data() steps the volume ramp between
+        // packets; otherwise nobody would, so a slider moved while
+        // stopped would only take effect at the next track.
+        audioModule.serviceVolume();
         return;
     }
-    
-    if (state != PLAYING) return;
 
     // Interleave one fill-attempt and one send per iteration, same
     // cadence as the original read-then-send code - NOT a batch of reads
@@ -149,7 +444,7 @@ void MP3Player::update() {
         if (queueCount < QUEUE_DEPTH && !eofReached) {
             size_t bytesRead = sdModule.readChunk(chunkBuf[queueTail], CHUNK_SIZE);
             if (bytesRead == 0) {
-                eofReached = true;
+                onReadEOF();
             } else {
                 chunkLen[queueTail] = bytesRead;
                 queueTail = (queueTail + 1) % QUEUE_DEPTH;
@@ -164,19 +459,15 @@ void MP3Player::update() {
                 // genuinely returned 0, nothing left to send. Distinct
                 // from state just being IDLE, which is also true during
                 // any deliberate stop-then-restart.
-                naturalEnd = true;
                 stop();
+                postEvent(PlayerEvent::NaturalEnd, 0);
             }
             break;
         }
         if (state != PLAYING) break;
     }
-}
 
-bool MP3Player::consumeNaturalEnd() {
-    if (naturalEnd) {
-        naturalEnd = false;
-        return true;
+    if (pausePending && audioModule.isVolumeSettled()) {
+        finishPause();
     }
-    return false;
 }
@@ -2,12 +2,35 @@
 //  MP3Player.h - Non-blocking MP3 playback state machine
 //  Now with a small read-ahead ring buffer instead of a single chunk
 //  buffer, to absorb occasional slow SD reads without an audible gap.
+//
+//  Cross-core contract: the UI (Core 1) never touches player state
+//  directly. Every request - play, stop, pause, seek, skip -
+//  is a PlayerCommand pushed onto a lock-free SPSC queue and executed
+//  by update() on Core 0, in order. Everything the player has to say
+//  back (track started, track ended, open failed) is a PlayerEvent on
+//  a second SPSC queue that main.cpp's loop() drains via pollEvent().
+//
+//  This replaces the old volatile stopRequested / needsOpen /
+//  pendingPath / naturalEnd handshake, whose races (stop and open
+//  landing in the same tick, a transient IDLE read as "track ended",
+//  pendingPath rewritten mid-open) each needed its own patch and a
+//  delay() on the UI side to let Core 0 catch up.
+//
+//  Every play()/requestStop()/skip() gets a new sequence number, and
+//  events carry the sequence number of the track they're about.
+//  pollEvent() silently drops events from anything but the latest
+//  request - so a NaturalEnd for a track the user has already moved
+//  away from can never trigger an auto-advance.
 // =====================================================================
 
 #ifndef MP3_PLAYER_H
 #define MP3_PLAYER_H
 
 #include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "../utils/SPSCQueue.h"
 
 class SD_Module;
 class VS1053_Module;
@@ -19,58 +42,155 @@ enum PlaybackState {
     STOPPED
 };
 
+struct PlayerCommand {
+    enum Type : uint8_t {
+        Play,       // path
+        Stop,       // value = 1 to also soft-reset the decoder
+        Pause,
+        Resume,
+        Seek,       // value = byte offset into the file
+        Next,       // end the current track now, as if it had finished
+        QueueNext   // path to chain to at EOF (empty = none)
+    };
+
+    Type type;
+    uint32_t seq;
+    uint32_t value;
+    char path[256];
+};
+
+struct PlayerEvent {
+    enum Type : uint8_t {
+        Started,        // file opened, streaming (value = 1: chained gaplessly from a queueNext())
+        NaturalEnd,     // reached EOF (value = 1 if ended early by a Next command)
+        Error           // value = PlayerError
+    };
+
+    Type type;
+    uint32_t seq;   // sequence number of the command that started this track
+    uint32_t value;
+};
+
+enum PlayerError : uint32_t {
+    PLAYER_ERR_OPEN_FAILED = 1,
+    PLAYER_ERR_SEEK_FAILED = 2
+};
+
 class MP3Player {
 public:
     MP3Player(SD_Module& sd, VS1053_Module& audio);
-    
-    // Start playing a file
-    bool play(const char* path);
-    volatile bool stopRequested = false;
-    
-    // Control
+
+    // --- UI side (Core 1) - all of these just queue a command ---
+
+    // Start playing a file. Returns the request's sequence number, 0 if
+    // the command queue was full.
+    uint32_t play(const char* path);
+
+    // Stop playback. resetDecoder also soft-resets the VS1053 even if
+    // nothing was playing (clears leftover WMA decoder state etc.) -
+    // done on Core 0, so the caller never has to wait for it.
+    void requestStop(bool resetDecoder = false);
+
     void pause();
     void resume();
-    void stop();
-    
-    // Update (call from main loop)
+    void seek(uint32_t byteOffset);  // MP3 only - others post PLAYER_ERR_SEEK_FAILED
+    void skip();                    // Next - current track ends now, NaturalEnd follows
+
+    // The track to go straight on to when the current one hits EOF
+    // (nullptr clears it). The feeder opens it while the last banked
+    // chunks of the current file are still going out, so there's no
+    // stop/reset/reopen gap - reported as Started with value 1 instead
+    // of a NaturalEnd. Only MP3 -> MP3 chains; anything else ends
+    // normally and the UI plays the next track itself.
+    void queueNext(const char* path);
+
+    // 0-100. Not a queued command: it just updates VS1053_Module's
+    // volume target, which the feeder ramps toward - a slider drag
+    // coalesces into whatever the latest value is.
+    void setVolume(uint8_t volume);
+
+    // Next event for the latest request, if any. Stale events (for a
+    // track superseded by a later play/stop/skip) are consumed and
+    // dropped here.
+    bool pollEvent(PlayerEvent& ev);
+
+    // --- Core 0 side ---
+
+    // Drain commands, then stream. Call from mp3StreamTask only.
     void update();
-    void requestStop();
-
-    
-    // Status
-    bool isPlaying() const { return state == PLAYING; }
-    bool hasEnded() const { return state == IDLE && !needsOpen; } 
-    bool isPaused() const { return state == PAUSED; }
-    PlaybackState getState() const { return state; }
-
-    // True exactly once, only when playback reached the real end of
-    // the file (readChunk() returned 0) - as opposed to state merely
-    // being IDLE, which is also briefly true during ANY deliberate
-    // stop-then-restart (Back button, screen switch, NFC tag, manual
-    // track change). Auto-advance logic should gate on this, not on
-    // isPlaying()/hasEnded() - both of those go through the same
-    // transient IDLE window a deliberate interruption produces, and
-    // anything polling continuously (main loop(), a screen's update())
-    // can catch that window and misfire mid-transition. Clears itself
-    // on read, and is also cleared by play()/requestStop(), so a
-    // deliberate interruption can never be mistaken for a real end.
-    bool consumeNaturalEnd();
+
+    // Call once at the top of mp3StreamTask: records the task for
+    // command wakeups and routes the VS1053's DREQ interrupt to it.
+    void beginFeeder();
+
+    // mp3StreamTask's wait between update() calls. Idle or paused (and
+    // no volume ramp in progress) it blocks on a task notification until
+    // the UI sends the next command; while streaming it sleeps until
+    // DREQ asks for data. Only when there's data to send AND the chip
+    // wants it does it fall back to a plain 1 ms yield.
+    void waitForWork();
+
+    // Feeder task load over the last ~1 s window: percentage of time
+    // awake, and wakeups per second. Readable from any core. A feeder
+    // blocked indefinitely (idle) reads as 0%.
+    uint8_t feederDutyPercent() const { return feederAsleep.load() ? 0 : dutyPercent.load(); }
+    uint16_t feederWakeupsPerSec() const { return feederAsleep.load() ? 0 : wakeupsPerSec.load(); }
+
+    // Status - readable from any core.
+    bool isPlaying() const { return state.load() == PLAYING; }
+    bool isPaused() const { return state.load() == PAUSED; }
+    PlaybackState getState() const { return state.load(); }
 
 private:
     static const size_t CHUNK_SIZE = 2048;
     static const int QUEUE_DEPTH = 4;   // ~4 x 2048 bytes = ~46ms of audio banked ahead
+    static const size_t PAUSE_END_FILL_BYTES = 2052;   // datasheet's end-of-stream flush length
 
-    char pendingPath[128];
-    volatile bool needsOpen;
     SD_Module& sdModule;
     VS1053_Module& audioModule;
-    
-    // Both read on Core 1 (main loop(), MP3SongList::update() polling
-    // hasEnded()) and written on Core 0 (mp3StreamTask calling
-    // update()) - same cross-core relationship stopRequested already
-    // needed volatile for.
-    volatile PlaybackState state;
-    volatile bool naturalEnd;   // see consumeNaturalEnd() above
+
+    std::atomic<PlaybackState> state;
+
+    // Command/event plumbing. Producer/consumer roles are fixed:
+    // commands UI -> Core 0, events Core 0 -> UI.
+    SPSCQueue<PlayerCommand, 16> commands;
+    SPSCQueue<PlayerEvent, 16> events;
+    uint32_t nextSeq;       // UI side - last sequence number handed out
+    uint32_t latestSeq;     // UI side - seq of the newest play/stop/skip
+    uint32_t activeSeq;     // Core 0 side - seq of the track being streamed
+    uint32_t droppedEvents; // Core 0 side - event queue overflowed
+
+    bool sendCommand(PlayerCommand::Type type, uint32_t value, bool newTrack, const char* path = nullptr);
+    void handleCommand(const PlayerCommand& cmd);
+    void postEvent(PlayerEvent::Type type, uint32_t value = 0);
+    void startTrack(const PlayerCommand& cmd);
+    void stop();
+    void finishPause();
+
+    // Core 0 side of queueNext(). Cleared by anything that starts or
+    // ends a track.
+    char currentPath[256];
+    char chainPath[256];
+    bool chainNextTrack();  // at EOF: open chainPath in place of the current file
+
+    // Pause fades out while still streaming, and only becomes PAUSED
+    // once the ramp has reached silence (see finishPause()).
+    bool pausePending;
+
+    // Set by beginFeeder(); sendCommand() and setVolume() notify it so
+    // a sleeping feeder wakes as soon as there's work.
+    std::atomic<TaskHandle_t> feederTask;
+    void wakeFeeder();
+
+    // Duty-cycle bookkeeping - feeder task writes, anyone reads the
+    // published figures.
+    int64_t statsWindowStartUs;
+    uint32_t statsSleptUs;
+    uint32_t statsWakeups;
+    std::atomic<uint8_t> dutyPercent;
+    std::atomic<uint16_t> wakeupsPerSec;
+    std::atomic<bool> feederAsleep;
+    void updateFeederStats();
 
     // Ring buffer of pre-read chunks
     uint8_t chunkBuf[QUEUE_DEPTH][CHUNK_SIZE];
@@ -80,6 +200,15 @@ private:
     int     queueCount;   // how many filled, unsent chunks are queued
     bool    eofReached;   // true once readChunk() has returned 0 for this file
 
+    // Position bookkeeping, published through PlaybackPosition. Touched
+    // only by the feeder task. The snapshot's trackSeq is activeSeq.
+    uint32_t currentFileSize;
+    uint32_t bytesFed;
+    uint16_t lastDecodeSec;
+    uint16_t lastByteRate;
+    void publishPosition();
+
+    void onReadEOF();        // readChunk() returned 0 - chain or mark eofReached
     void fillQueue();        // top up the ring buffer from SD, up to QUEUE_DEPTH
     bool sendNextQueued();   // send the oldest queued chunk, if any; false if queue was empty
     void resetQueue();       // called on play() / stop()
@@ -0,0 +1,324 @@
+// =====================================================================
+//  Playlist.cpp - Track sequencing implementation
+// =====================================================================
+
+#include "Playlist.h"
+#include "MP3Player.h"
+#include "../utils/LibraryIndex.h"
+#include <esp_heap_caps.h>
+
+Playlist& Playlist::getInstance() {
+    static Playlist instance;
+    return instance;
+}
+
+Playlist::Playlist()
+    : _album(-1), _generation(0), _count(0), _order(nullptr), _orderCapacity(0),
+      _pos(0), _current(-1), _queueHead(0), _queueCount(0),
+      _shuffle(false), _repeat(RepeatAll), _changes(0)
+{
+    _folder[0] = '\0';
+    _currentFile[0] = '\0';
+}
+
+void Playlist::load(int album) {
+    LibraryIndex& library = LibraryIndex::getInstance();
+    snprintf(_folder, sizeof(_folder), "/Music/%s", library.albumName(album));
+    _album = album;
+    _generation = library.generation();
+    _count = library.albumTrackCount(album);
+    _current = -1;
+    _currentFile[0] = '\0';
+    _pos = 0;
+    _queueHead = 0;
+    _queueCount = 0;
+    _shuffle = false;
+
+    reserveOrder();
+    rebuildOrder();
+    _changes++;
+}
+
+void Playlist::reserveOrder() {
+    if (_count <= _orderCapacity) return;
+
+    // PSRAM first, like every other buffer that isn't touched from
+    // an ISR; grows only, so a big album is allocated once.
+    free(_order);
+    _order = (int16_t*)heap_caps_malloc(_count * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    if (!_order) _order = (int16_t*)malloc(_count * sizeof(int16_t));
+    _orderCapacity = _order ? _count : 0;
+    if (!_order) {
+        Serial.println("Playlist: ✗ Order alloc failed");
+        _count = 0;
+    }
+}
+
+bool Playlist::stale() const {
+    // A rescan renumbers everything; refreshAlbum() (an upload changed
+    // the folder) retires just this album and indexes it again under a
+    // new number, without a new generation.
+    LibraryIndex& library = LibraryIndex::getInstance();
+    return library.generation() != _generation || library.albumRemoved(_album);
+}
+
+bool Playlist::resync() {
+    LibraryIndex& library = LibraryIndex::getInstance();
+    if (_album < 0) return false;
+    if (!stale()) return true;
+
+    // Find the album again by folder name, and the current track by file
+    // name. Queued tracks were old numbers, so the queue goes.
+    int album = library.requireAlbum(_folder + sizeof("/Music/") - 1);
+    if (album < 0) {
+        Serial.printf("Playlist: ✗ %s is gone\n", _folder);
+        clear();
+        extern MP3Player mp3Player;
+        mp3Player.queueNext(nullptr);
+        return false;
+    }
+
+    _album = album;
+    _generation = library.generation();
+    _count = library.albumTrackCount(album);
+    _current = -1;
+    _queueHead = 0;
+    _queueCount = 0;
+    reserveOrder();
+
+    if (_currentFile[0]) {
+        for (int i = 0; i < _count; i++) {
+            if (strcasecmp(library.trackFile(library.albumTrack(album, i)), _currentFile) == 0) {
+                _current = i;
+                break;
+            }
+        }
+    }
+    rebuildOrder();
+    _changes++;
+    Serial.printf("Playlist: Resynced %s after a library change (%d tracks)\n", _folder, _count);
+
+    // Track numbers behind the gapless path may have moved under shuffle
+    queueUpcoming();
+    return true;
+}
+
+void Playlist::setCurrent(int trackIndex) {
+    _current = trackIndex;
+    // Kept by name for resync() - the index means nothing after a rescan
+    const char* name = currentName();
+    strncpy(_currentFile, name, sizeof(_currentFile) - 1);
+    _currentFile[sizeof(_currentFile) - 1] = '\0';
+}
+
+void Playlist::clear() {
+    _album = -1;
+    _count = 0;
+    _current = -1;
+    _currentFile[0] = '\0';
+    _pos = 0;
+    _queueCount = 0;
+    _folder[0] = '\0';
+    _changes++;
+}
+
+void Playlist::rebuildOrder() {
+    for (int i = 0; i < _count; i++) _order[i] = i;
+
+    if (_shuffle && _count > 1) {
+        // Fisher-Yates
+        for (int i = _count - 1; i > 0; i--) {
+            int j = esp_random() % (i + 1);
+            int16_t t = _order[i];
+            _order[i] = _order[j];
+            _order[j] = t;
+        }
+    }
+
+    // Keep the playing track where the cursor is, so a rebuild never
+    // changes what's playing - it only changes what follows.
+    _pos = 0;
+    if (_current >= 0) {
+        for (int i = 0; i < _count; i++) {
+            if (_order[i] == _current) {
+                if (_shuffle) {
+                    _order[i] = _order[0];
+                    _order[0] = _current;
+                } else {
+                    _pos = i;
+                }
+                break;
+            }
+        }
+    }
+}
+
+const char* Playlist::currentName() const {
+    if (_current < 0 || stale()) return "";
+    return LibraryIndex::getInstance().trackFile(LibraryIndex::getInstance().albumTrack(_album, _current));
+}
+
+bool Playlist::trackPath(int trackIndex, char* out, size_t len) const {
+    // Numbers from before a rescan or refresh - nothing until resync(),
+    // rather than the wrong file
+    LibraryIndex& library = LibraryIndex::getInstance();
+    if (_album < 0 || trackIndex < 0 || trackIndex >= _count || stale()) {
+        return false;
+    }
+    return snprintf(out, len, "%s/%s", _folder, library.trackFile(library.albumTrack(_album, trackIndex))) < (int)len;
+}
+
+int Playlist::peek(bool userSkip, int* orderPos, bool* fromQueue) const {
+    *orderPos = _pos;
+    *fromQueue = false;
+    if (_count == 0) return -1;
+
+    if (_queueCount > 0) {
+        *fromQueue = true;
+        return _queue[_queueHead];
+    }
+
+    // A finished track under RepeatOne goes round again; >> doesn't.
+    if (!userSkip && _repeat == RepeatOne && _current >= 0) return _current;
+
+    int p = _pos + 1;
+    if (p >= _count) {
+        if (!userSkip && _repeat == RepeatOff) return -1;
+        p = 0;
+    }
+    *orderPos = p;
+    return _order[p];
+}
+
+bool Playlist::moveTo(int orderPos, bool fromQueue) {
+    if (fromQueue) {
+        // Queued tracks don't move the cursor - the order resumes from
+        // where it was once the queue is empty.
+        setCurrent(_queue[_queueHead]);
+        _queueHead = (_queueHead + 1) % MAX_QUEUE;
+        _queueCount--;
+    } else {
+        _pos = orderPos;
+        setCurrent(_order[_pos]);
+    }
+    _changes++;
+    return true;
+}
+
+void Playlist::startCurrent() {
+    char path[256];
+    if (!trackPath(_current, path, sizeof(path))) return;
+
+    Serial.printf("Playlist: Playing %s\n", path);
+    extern MP3Player mp3Player;
+    mp3Player.play(path);
+    queueUpcoming();
+}
+
+bool Playlist::upcomingPath(char* out, size_t len) const {
+    if (_current < 0) return false;
+    int orderPos;
+    bool fromQueue;
+    int upcoming = peek(false, &orderPos, &fromQueue);
+    return upcoming >= 0 && trackPath(upcoming, out, len);
+}
+
+void Playlist::queueUpcoming() {
+    extern MP3Player mp3Player;
+
+    char path[256];
+    if (upcomingPath(path, sizeof(path))) {
+        mp3Player.queueNext(path);
+    } else {
+        mp3Player.queueNext(nullptr);
+    }
+    _changes++;     // what's up next is watched too (upload protection)
+}
+
+bool Playlist::play(int trackIndex) {
+    resync();
+    if (trackIndex < 0 || trackIndex >= _count) return false;
+
+    // Put the cursor on it, so next/previous carry on from here.
+    for (int i = 0; i < _count; i++) {
+        if (_order[i] == trackIndex) {
+            _pos = i;
+            break;
+        }
+    }
+    setCurrent(trackIndex);
+    _changes++;
+    startCurrent();
+    return true;
+}
+
+bool Playlist::next() {
+    resync();
+    int orderPos;
+    bool fromQueue;
+    if (peek(true, &orderPos, &fromQueue) < 0) return false;
+    moveTo(orderPos, fromQueue);
+    startCurrent();
+    return true;
+}
+
+bool Playlist::previous() {
+    resync();
+    if (_count == 0) return false;
+    _pos = (_pos > 0) ? _pos - 1 : _count - 1;
+    setCurrent(_order[_pos]);
+    _changes++;
+    startCurrent();
+    return true;
+}
+
+bool Playlist::advance() {
+    resync();
+    int orderPos;
+    bool fromQueue;
+    if (peek(false, &orderPos, &fromQueue) < 0) {
+        Serial.println("Playlist: End of playlist");
+        return false;
+    }
+    moveTo(orderPos, fromQueue);
+    startCurrent();
+    return true;
+}
+
+void Playlist::onGaplessAdvance() {
+    // The player already opened exactly what queueUpcoming() last told
+    // it - the same thing peek() picks, since every change since then
+    // has re-queued. Just catch up and queue the one after.
+    resync();
+    int orderPos;
+    bool fromQueue;
+    if (peek(false, &orderPos, &fromQueue) < 0) return;
+    moveTo(orderPos, fromQueue);
+    Serial.printf("Playlist: Gapless -> %s\n", currentName());
+    queueUpcoming();
+}
+
+void Playlist::setShuffle(bool on) {
+    if (on == _shuffle) return;
+    resync();
+    _shuffle = on;
+    rebuildOrder();
+    Serial.printf("Playlist: Shuffle %s\n", on ? "on" : "off");
+    if (_current >= 0) queueUpcoming();
+}
+
+void Playlist::setRepeat(Repeat mode) {
+    if (mode == _repeat) return;
+    resync();
+    _repeat = mode;
+    if (_current >= 0) queueUpcoming();
+}
+
+bool Playlist::enqueue(int trackIndex) {
+    resync();
+    if (trackIndex < 0 || trackIndex >= _count || _queueCount >= MAX_QUEUE) return false;
+    _queue[(_queueHead + _queueCount) % MAX_QUEUE] = trackIndex;
+    _queueCount++;
+    if (_current >= 0) queueUpcoming();
+    return true;
+}
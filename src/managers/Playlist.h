@@ -0,0 +1,133 @@
+// =====================================================================
+//  Playlist.h - Track order, shuffle, repeat and up-next queue
+//
+//  KidScreen, MP3Screen and MP3SongList each used to keep their own
+//  "current index, wrap at the end, snprintf a path, play()" copy of
+//  track sequencing - and none of them had shuffle, repeat or a queue.
+//  All three now load their album into this one engine and drive it.
+//  The album is a LibraryIndex album: track names are read from the
+//  index when a path is needed, so there's no per-album name table.
+//
+//  Order is a precomputed permutation of the album's track indices
+//  (identity, or Fisher-Yates when shuffled, with the playing track
+//  moved to the front so toggling shuffle never jumps). next/previous
+//  are a cursor step through it - O(1). Tracks enqueue()d play after
+//  the current one, ahead of the order, which then carries on where it
+//  was.
+//
+//  Gapless: whenever the current track changes (or anything that
+//  decides what comes after it), the path of the track advance() would
+//  pick is handed to MP3Player::queueNext(). The player opens it the
+//  moment the current file hits EOF - while its read-ahead chunks are
+//  still going out - and reports that with a gapless Started event,
+//  which loop() passes to onGaplessAdvance().
+//
+//  A LibraryIndex rescan renumbers every album and track, and a
+//  refreshAlbum() after an upload renumbers the one album. Everything
+//  that moves through the album resync()s first: the album is looked
+//  up again by folder name and the current track by file name.
+//
+//  UI side (Core 1) only. Screens watch changeCount() to know when to
+//  redraw their now-playing state.
+// =====================================================================
+
+#ifndef PLAYLIST_H
+#define PLAYLIST_H
+
+#include <Arduino.h>
+
+class Playlist {
+public:
+    static Playlist& getInstance();
+
+    enum Repeat : uint8_t {
+        RepeatOff,      // stop after the last track
+        RepeatAll,      // wrap - what every screen has always done
+        RepeatOne       // a finished track plays again; >> still moves on
+    };
+
+    static const int MAX_QUEUE = 16;
+
+    // Adopt a LibraryIndex album (LibraryIndex::requireAlbum()). Track
+    // indices below are 0-based within it, in the index's play order.
+    // Shuffle starts off with every album - only a KidScreen tag asks
+    // for it, after loading. Repeat carries over.
+    void load(int album);
+    void clear();
+
+    // Play a track by album index, e.g. a tapped row.
+    bool play(int trackIndex);
+
+    bool next();            // >> : always moves on, wraps
+    bool previous();        // << : one step back through the order, wraps
+    bool advance();         // track ended: honours repeat. false = playlist finished
+    void onGaplessAdvance();
+
+    void setShuffle(bool on);
+    void setRepeat(Repeat mode);
+    bool enqueue(int trackIndex);
+
+    bool shuffle() const { return _shuffle; }
+    Repeat repeat() const { return _repeat; }
+    int size() const { return _count; }
+    int current() const { return _current; }       // album index, -1 = nothing
+    int album() const { return _album; }            // LibraryIndex album, -1 = none
+    const char* currentName() const;                // file name
+    const char* folder() const { return _folder; }
+    uint32_t changeCount() const { return _changes; }  // current or upcoming track changed
+
+    // Re-resolve the album after LibraryIndex::rescan() or
+    // refreshAlbum(). Every call above does this itself; call it
+    // straight after either so the gapless track is re-queued before
+    // the current one ends. false = nothing loaded, or the album folder
+    // is gone (playlist cleared).
+    bool resync();
+
+    // false after a rescan or refresh until resync()
+    bool trackPath(int trackIndex, char* out, size_t len) const;
+
+    // The track queued behind the current one for gapless (what
+    // advance() would play). false if there's none.
+    bool upcomingPath(char* out, size_t len) const;
+
+private:
+    Playlist();
+    Playlist(const Playlist&) = delete;
+    Playlist& operator=(const Playlist&) = delete;
+
+    // _album's numbers no longer hold - the library was rescanned or
+    // the album refreshed
+    bool stale() const;
+
+    // What advance() (userSkip = false) or next() (true) would move to,
+    // without moving. Returns the album index, -1 if nothing;
+    // *orderPos gets the new cursor, *fromQueue whether it's the queue.
+    int peek(bool userSkip, int* orderPos, bool* fromQueue) const;
+    bool moveTo(int orderPos, bool fromQueue);  // commit a peek() and start it
+    void reserveOrder();    // _order room for _count
+    void rebuildOrder();
+    void setCurrent(int trackIndex);
+    void startCurrent();
+    void queueUpcoming();
+
+    char _folder[256];
+    int _album;
+    uint32_t _generation;   // LibraryIndex generation _album belongs to
+    int _count;
+
+    int16_t* _order;        // permutation of 0.._count-1
+    int _orderCapacity;
+    int _pos;               // cursor into _order
+    int _current;
+    char _currentFile[256]; // its file name, for resync()
+
+    int16_t _queue[MAX_QUEUE];
+    int _queueHead;
+    int _queueCount;
+
+    bool _shuffle;
+    Repeat _repeat;
+    uint32_t _changes;
+};
+
+#endif // PLAYLIST_H
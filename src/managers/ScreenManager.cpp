@@ -8,9 +8,11 @@
 #include "../screens/KidScreen.h"
 #include "../screens/CalibrationScreen.h"
 #include "../utils/TouchCalibration.h"
-#include "../utils/PN532_Module.h"
+#include "../utils/NfcSession.h"
+#include "../utils/TagAlbumCache.h"
+#include "Playlist.h"
 
-ScreenManager::ScreenManager(TFT_Module& tftRef, VS1053_Module& audio, SD_Module& sd, PN532_Module& nfc)
+ScreenManager::ScreenManager(TFT_Module& tftRef, VS1053_Module& audio, SD_Module& sd, NfcSession& nfc)
     : tft(tftRef),
       audioModule(audio),
       sdModule(sd),
@@ -25,7 +27,8 @@ ScreenManager::ScreenManager(TFT_Module& tftRef, VS1053_Module& audio, SD_Module
       bluetoothScreen(nullptr),
       ftpUploadScreen(nullptr),
       mp3AlbumListScreen(nullptr),
-      mp3SongListScreen(nullptr)
+      mp3SongListScreen(nullptr),
+      searchScreen(nullptr)
 {
 }
 
@@ -40,6 +43,7 @@ ScreenManager::~ScreenManager() {
     delete bluetoothScreen;
     delete mp3AlbumListScreen;
     delete mp3SongListScreen;
+    delete searchScreen;
 }
 
 void ScreenManager::begin() {
@@ -53,6 +57,7 @@ void ScreenManager::begin() {
     bluetoothScreen = new BluetoothScreen(*this, tft);    
     mp3AlbumListScreen = new MP3AlbumList(*this, tft, sdModule);
     mp3SongListScreen = new MP3SongList(*this, tft, sdModule, audioModule);
+    searchScreen = new SearchScreen(*this, tft);
     // Start with splash screen
     //calibrationScreen = new CalibrationScreen(*this, tft);
     //switchTo(calibrationScreen);
@@ -83,6 +88,10 @@ void ScreenManager::showSongList() {
     switchTo(mp3SongListScreen);
 }
 
+void ScreenManager::showSearch() {
+    switchTo(searchScreen);
+}
+
 void ScreenManager::showKids() {
     switchTo(kidScreen);
 }
@@ -113,6 +122,35 @@ void ScreenManager::update() {
     }
 }
 
+void ScreenManager::handleNfcEvent(const NfcEvent& ev) {
+    switch (ev.type) {
+        case NfcEvent::TagArrived:
+            showKids();
+            kidScreen->showAlbum(ev.content.album, ev.content.startTrack, ev.content.shuffle);
+            if (!kidScreen->isAlbumLoaded()) {
+                // Stay on the kid screen - card removal clears it
+                Serial.println("NFC: Album not found on SD card");
+
+                // Only albums that resolve stay cached. If this answer
+                // came from the cache the tag may have been rewritten
+                // elsewhere - end the session so the next poll reads it.
+                TagAlbumCache::getInstance().forget(ev.tag);
+                if (ev.fromCache) nfcModule.forgetSession();
+            }
+            break;
+
+        case NfcEvent::ReadFailed:
+            // Nothing to show; wait for the card to come off
+            break;
+
+        case NfcEvent::TagRemoved:
+            // Always clear and return to splash on removal
+            kidScreen->clearAlbum();
+            showSplash();
+            break;
+    }
+}
+
 bool ScreenManager::isOnSettingsScreen() const {
     return (currentScreen == settingsScreen);
 }
@@ -121,6 +159,14 @@ bool ScreenManager::isOnWriteTagScreen() const {
     return (currentScreen == writeTagScreen);
 }
 
+bool ScreenManager::allowsIdleSleep() const {
+    return currentScreen != ftpUploadScreen &&
+           currentScreen != bluetoothScreen &&
+           currentScreen != writeTagScreen &&
+           currentScreen != settingsScreen &&
+           currentScreen != calibrationScreen;
+}
+
 void ScreenManager::handleTouch(int x, int y) {
     if (currentScreen) {
         int screenX = x;
@@ -140,11 +186,10 @@ bool ScreenManager::isOnCalibrationScreen() const {
 }
 
 void ScreenManager::handleSongEnd() {
-    if (currentScreen == kidScreen) {
-        kidScreen->nextTrack();
-    } else if (currentScreen == mp3screen) {
-        mp3screen->nextTrack();
-    } else if (currentScreen == mp3SongListScreen) {
-        mp3SongListScreen->advanceToNextTrack();
+    // Track order lives in Playlist; the playback screens pick the
+    // change up from its changeCount() in their update().
+    if (currentScreen == kidScreen || currentScreen == mp3screen ||
+        currentScreen == mp3SongListScreen) {
+        Playlist::getInstance().advance();
     }
 }
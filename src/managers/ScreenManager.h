@@ -10,6 +10,7 @@
 #include "../screens/BluetoothScreen.h"
 #include "../screens/MP3AlbumList.h"
 #include "../screens/MP3SongList.h"
+#include "../screens/SearchScreen.h"
 
 class TFT_Module;
 class BaseScreen;
@@ -19,11 +20,13 @@ class KidScreen;
 class CalibrationScreen;
 class VS1053_Module;
 class SD_Module;  // Add this forward declaration
+class NfcSession;
+struct NfcEvent;
 
 class ScreenManager {
 public:
     void showBluetooth();
-    ScreenManager(TFT_Module& tft, VS1053_Module& audio, SD_Module& sd, PN532_Module& nfc);
+    ScreenManager(TFT_Module& tft, VS1053_Module& audio, SD_Module& sd, NfcSession& nfc);
     ~ScreenManager();
 
     void begin();
@@ -38,14 +41,24 @@ public:
     void showMP3();
     void showAlbumList();   // new paginated album list (UI prototype)
     void showSongList();    // new Now Playing / song list screen
+    void showSearch();      // library-wide search, from the album list
     void showKids();
     void showCalibration();
     void handleSongEnd(); 
+
+    // Card placed / unreadable / removed - drained from NfcSession by
+    // loop(). Not called on the settings and write-tag screens.
+    void handleNfcEvent(const NfcEvent& ev);
     void showSettings();
     void showWriteTag();
     void showFTPUpload();
     bool isOnSettingsScreen() const;
     bool isOnWriteTagScreen() const;
+
+    // False on screens that must stay up (FTP transfer, Bluetooth,
+    // tag writing, settings, calibration) - PowerManager won't dim or
+    // shelve the device while one of these is showing.
+    bool allowsIdleSleep() const;
     
     // Access to screens (for inter-screen communication)
     KidScreen* getKidScreen() { return kidScreen; }
@@ -64,12 +77,13 @@ private:
     FTPUploadScreen* ftpUploadScreen;
     MP3AlbumList* mp3AlbumListScreen;
     MP3SongList* mp3SongListScreen;
+    SearchScreen* searchScreen;
 
     
     TFT_Module& tft;
     VS1053_Module& audioModule;
     SD_Module& sdModule; 
-    PN532_Module& nfcModule;
+    NfcSession& nfcModule;
     
     BaseScreen* currentScreen;
     SplashScreen* splashScreen;
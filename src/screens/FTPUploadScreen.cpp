@@ -1,21 +1,25 @@
 // =====================================================================
-//  FTPUploadScreen.cpp - FTP Server in AP Mode
+//  FTPUploadScreen.cpp - FTP and HTTP upload servers in AP Mode
 // =====================================================================
 
 #include "FTPUploadScreen.h"
 #include "../managers/ScreenManager.h"
 #include "../utils/TFT_Module.h"
+#include "../managers/Playlist.h"
+#include "../managers/MP3Player.h"
+#include "../utils/LibraryJournal.h"
+#include "../utils/UploadFtpServer.h"
+#include "../utils/UploadHttpServer.h"
 #include <LovyanGFX.hpp>
-#include <SdFat.h>
-#include "pins.h"
 
 FTPUploadScreen::FTPUploadScreen(ScreenManager& manager, TFT_Module& tftModule, SD_Module& sd)
     : BaseScreen(manager, tftModule),
       sdModule(sd),
-      ftpServer(nullptr),
       doneButton(160, 260, 160, 50, "Done"),
       serverActive(false),
-      lastUpdate(0)
+      lastUpdate(0),
+      protectedChange(0),
+      protectedOpen(false)
 {
     doneButton.setColors(TFT_RED, TFT_WHITE, TFT_WHITE);
 }
@@ -28,7 +32,7 @@ void FTPUploadScreen::begin() {
     display->setTextColor(TFT_WHITE);
     display->setTextDatum(top_center);
     display->setTextSize(3);
-    display->drawString("FTP Upload", 240, 20);
+    display->drawString("Upload", 240, 20);
     
     // Instructions - Step 1
     display->setTextSize(1);
@@ -49,15 +53,17 @@ void FTPUploadScreen::begin() {
     // Step 3
     display->setTextSize(1);
     display->setTextColor(TFT_CYAN);
-    display->drawString("3. Open FileZilla (or any FTP client)", 240, 180);
+    display->drawString("3. Open in a browser:", 240, 180);
+    display->setTextColor(TFT_YELLOW);
+    display->drawString("http://192.168.4.1", 240, 193);
+    display->setTextColor(TFT_CYAN);
+    display->drawString("or FileZilla (any FTP client):", 240, 210);
     
     // FTP connection details
     display->setTextSize(1);
     display->setTextColor(TFT_WHITE);
-    display->drawString("Host: 192.168.4.1", 240, 205);
-    display->drawString("Username: esp32", 240, 220);
-    display->drawString("Password: esp32", 240, 235);
-    display->drawString("Port: 21", 240, 250);
+    display->drawString("Host: 192.168.4.1  Port: 21", 240, 225);
+    display->drawString("Username: esp32  Password: esp32", 240, 240);
     
     doneButton.draw(tft);
     
@@ -67,16 +73,10 @@ void FTPUploadScreen::begin() {
 
 void FTPUploadScreen::startFTPServer() {
     Serial.println("Starting FTP server in AP mode...");
-    
-    // Stop MP3 task
-    extern TaskHandle_t mp3TaskHandle;
-    if (mp3TaskHandle) {
-        vTaskDelete(mp3TaskHandle);
-        mp3TaskHandle = nullptr;
-    }
-    
-    delay(500);
-    
+
+    // Playback carries on - the server shares the card through SdFat
+    // and the SPI1 bus guard like everything else
+
     // Start AP mode
     WiFi.mode(WIFI_AP);
     WiFi.softAP("MP3Player", "12345678");
@@ -85,47 +85,43 @@ void FTPUploadScreen::startFTPServer() {
     IPAddress IP = WiFi.softAPIP();
     Serial.printf("AP Started! IP: %s\n", IP.toString().c_str());
     
-    // Initialize SD (library expects Arduino SD)
-    if (SD.begin(SD_CS)) {  // Use your SD_CS pin
-        Serial.println("SD opened for FTP");
-
-        // List root directory contents
-        File root = SD.open("/");
-        Serial.println("Contents of root:");
-        File file = root.openNextFile();
-        while (file) {
-            Serial.print(file.isDirectory() ? "DIR: " : "FILE: ");
-            Serial.println(file.name());
-            file = root.openNextFile();
-        }
-        
-        ftpServer = new FtpServer();
-        ftpServer->begin("esp32", "esp32");
-        
-        serverActive = true;
-        Serial.println("FTP server started");
+    // Protected before either server takes its first request
+    protectedChange = Playlist::getInstance().changeCount() - 1;
+    updateProtection();
+
+    serverActive = UploadFtpServer::getInstance().begin("esp32", "esp32");
+    serverActive = UploadHttpServer::getInstance().begin() || serverActive;
+    if (serverActive) {
+        Serial.println("Upload servers started");
     } else {
-        Serial.println("SD init failed for FTP");
+        Serial.println("Upload servers failed to start");
     }
 }
 
 void FTPUploadScreen::stopFTPServer() {
-    if (ftpServer) {
-        delete ftpServer;
-        ftpServer = nullptr;
-    }
+    UploadFtpServer::getInstance().end();
+    UploadHttpServer::getInstance().end();
     
     // Return to station mode
     WiFi.mode(WIFI_STA);
     
     serverActive = false;
-    Serial.println("FTP server stopped");
+    Serial.println("Upload servers stopped");
+
+    // Bring the library up to date with whatever was uploaded - only the
+    // albums that changed, not the whole card. A refreshed album gets a
+    // new number, and too many changes mean a full rescan that renumbers
+    // them all - either way the playing album may have moved.
+    LibraryJournal::getInstance().apply();
+    Playlist::getInstance().resync();
 }
 
 void FTPUploadScreen::update() {
-    if (serverActive && ftpServer) {
-        ftpServer->handleFTP();
-        
+    if (serverActive) {
+        // Library listings are rendered here, on loop()
+        UploadHttpServer::getInstance().service();
+        updateProtection();
+
         // Update status display every 2 seconds
         if (millis() - lastUpdate > 2000) {
             lastUpdate = millis();
@@ -134,6 +130,27 @@ void FTPUploadScreen::update() {
     }
 }
 
+// Keeps the files the player has open - the current track, playing or
+// paused, and the one queued behind it for gapless - out of reach of
+// overwrites and deletes. Checked every loop() so a track change is
+// covered before the servers can see a request for the new file.
+void FTPUploadScreen::updateProtection() {
+    extern MP3Player mp3Player;
+    Playlist& playlist = Playlist::getInstance();
+    bool open = mp3Player.isPlaying() || mp3Player.isPaused();
+    if (playlist.changeCount() == protectedChange && open == protectedOpen) return;
+    protectedChange = playlist.changeCount();
+    protectedOpen = open;
+
+    char current[256] = "";
+    char upcoming[256] = "";
+    if (open) {
+        playlist.trackPath(playlist.current(), current, sizeof(current));
+        playlist.upcomingPath(upcoming, sizeof(upcoming));
+    }
+    UploadWriter::setProtectedPaths(current, upcoming);
+}
+
 void FTPUploadScreen::updateStatus() {
     auto display = tft.getTFT();
     
@@ -141,6 +158,25 @@ void FTPUploadScreen::updateStatus() {
     static bool blink = false;
     blink = !blink;
     display->fillCircle(450, 30, 10, blink ? TFT_GREEN : TFT_DARKGREEN);
+
+    UploadFtpServer::Status ftp = UploadFtpServer::getInstance().status();
+    UploadHttpServer::Status http = UploadHttpServer::getInstance().status();
+    uint32_t files = ftp.filesReceived + http.filesReceived;
+    char line[96];
+    if (ftp.transferring || http.transferring) {
+        snprintf(line, sizeof(line), "Receiving %s", ftp.transferring ? ftp.lastFile : http.lastFile);
+    } else if (files) {
+        snprintf(line, sizeof(line), "%lu file(s), %.1f MB - last %.2f MB/s",
+                 (unsigned long)files, (ftp.bytesReceived + http.bytesReceived) / 1048576.0f,
+                 http.filesReceived ? http.lastMBps : ftp.lastMBps);
+    } else {
+        snprintf(line, sizeof(line), "%s", ftp.clientConnected ? "Client connected" : "Waiting for upload");
+    }
+    display->fillRect(0, 48, 430, 14, TFT_BLACK);
+    display->setTextSize(1);
+    display->setTextColor(TFT_GREEN);
+    display->setTextDatum(top_center);
+    display->drawString(line, 240, 50);
 }
 
 void FTPUploadScreen::handleTouch(int x, int y) {
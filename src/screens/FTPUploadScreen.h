@@ -1,5 +1,5 @@
 // =====================================================================
-//  FTPUploadScreen.h - FTP Server in AP Mode
+//  FTPUploadScreen.h - FTP and HTTP upload servers in AP Mode
 // =====================================================================
 
 #ifndef FTP_UPLOAD_SCREEN_H
@@ -9,7 +9,6 @@
 #include "../ui/UIButton.h"
 #include "../utils/SD_Module.h"
 #include <WiFi.h>
-#include "ESP32FtpServer.h"
 
 
 class ScreenManager;
@@ -28,14 +27,16 @@ private:
     void startFTPServer();
     void stopFTPServer();
     void updateStatus();
+    void updateProtection();
     
     SD_Module& sdModule;
-    FtpServer* ftpServer;  // Note: might be FtpServer not FTPServer
     
     UIButton doneButton;
     
     bool serverActive;
     unsigned long lastUpdate;
+    uint32_t protectedChange;   // Playlist::changeCount() last protected
+    bool protectedOpen;         // player had a file open then
 };
 
 #endif // FTP_UPLOAD_SCREEN_H
\ No newline at end of file
@@ -9,11 +9,22 @@
 #include "../utils/SD_Module.h"  
 #include "../utils/SPIBusLock.h"
 #include "../managers/MP3Player.h"  
+#include "../managers/Playlist.h"
+#include "../utils/AlbumArtCache.h"
+#include "../utils/PlaybackPosition.h"
+#include "../utils/LibraryIndex.h"
 #include <LovyanGFX.hpp>
-#include <TJpg_Decoder.h>
+#include <esp_heap_caps.h>
 
-// Add this global pointer (ugly but TJpg_Decoder needs it)
-TFT_Module* globalTFT = nullptr;
+// Album art box - centered between the title and NOW PLAYING.
+#define ART_X   90
+#define ART_Y   60
+#define ART_W   300
+#define ART_H   150
+
+// Spectrum bars fill the gap between the left edge and the art.
+#define SPECTRUM_X  10
+#define SPECTRUM_W  (ART_X - SPECTRUM_X - 10)
 
 // Helper: normalize album name for matching
 String normalizeAlbumName(const char* name) {
@@ -26,18 +37,6 @@ String normalizeAlbumName(const char* name) {
     return normalized;
 }
 
-// Add this callback function BEFORE the KidScreen class methods:
-bool tftOutput(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
-    // This function is called by TJpg_Decoder to output decoded JPEG data
-    // We'll set the target TFT in displayAlbumArt()
-    extern TFT_Module* globalTFT;
-    if (globalTFT && bitmap) {
-        auto display = globalTFT->getTFT();
-        display->pushImage(x, y, w, h, bitmap);
-    }
-    return true;
-}
-
 KidScreen::KidScreen(ScreenManager& manager, TFT_Module& tftModule, VS1053_Module& audio, SD_Module& sd)
     : BaseScreen(manager, tftModule),
       audioModule(audio),
@@ -45,11 +44,14 @@ KidScreen::KidScreen(ScreenManager& manager, TFT_Module& tftModule, VS1053_Modul
       albumLoaded(false),
       isPlaying(false),
       albumLoadStartMs(0),
+      artBuffer(nullptr),
       prevButton(40, 240, 80, 60, "<<"),
       playPauseButton(200, 240, 80, 60, "||"),
       nextButton(360, 240, 80, 60, ">>"),
       //backButton(10, 10, 100, 40, "Back"),
-      volumeSlider(440, 80, 30, 200, 0, 100)
+      volumeSlider(440, 80, 30, 200, 0, 100),
+      spectrum(SPECTRUM_X, ART_Y, SPECTRUM_W, ART_H),
+      progressBar(ART_X, 231, ART_W, 5)
 {
     currentAlbum[0] = '\0';
     
@@ -61,6 +63,15 @@ KidScreen::KidScreen(ScreenManager& manager, TFT_Module& tftModule, VS1053_Modul
     
     // Set initial volume to 75%
     volumeSlider.setValue(75);
+
+    // Art canvas allocated once and reused for every album, same as
+    // MP3SongList - PSRAM preferred, internal RAM as a fallback.
+    size_t artBytes = ART_W * ART_H * sizeof(uint16_t);
+    artBuffer = (uint16_t*)heap_caps_malloc(artBytes, MALLOC_CAP_SPIRAM);
+    if (!artBuffer) artBuffer = (uint16_t*)malloc(artBytes);
+    if (!artBuffer) {
+        Serial.println("KidScreen: Art buffer alloc failed - art will be disabled");
+    }
 }
 
 void KidScreen::begin() {
@@ -120,6 +131,9 @@ void KidScreen::drawPlaybackScreen() {
     
     // Draw volume slider on right side
     volumeSlider.draw(tft);
+
+    spectrum.draw(tft);
+    progressBar.draw(tft);
     
     // Draw volume labels
     display->setTextSize(1);
@@ -130,7 +144,11 @@ void KidScreen::drawPlaybackScreen() {
 }
 
 void KidScreen::update() {
-    // Future: animate waiting screen, update playback position
+    // Future: animate waiting screen
+    if (albumLoaded) {
+        spectrum.update(tft, audioModule, isPlaying);
+        progressBar.update(tft, PlaybackPosition::getInstance().read());
+    }
 }
 
 void KidScreen::handleTouch(int x, int y) {
@@ -156,7 +174,8 @@ void KidScreen::handleTouch(int x, int y) {
 
     if (volumeSlider.handleTouch(x, y)) {
         int volume = volumeSlider.getValue();
-        audioModule.setVolume(volume);
+        extern MP3Player mp3Player;
+        mp3Player.setVolume(volume);
         volumeSlider.draw(tft);  // Redraw just the slider
         
         // Update volume percentage display
@@ -200,11 +219,11 @@ void KidScreen::handleTouch(int x, int y) {
             
             if (isPlaying) {
                 // Resume playback
-                mp3Player.resume();  // If you have a resume function
+                mp3Player.resume();
                 playPauseButton.setLabel("||");
             } else {
                 // Pause playback
-                mp3Player.pause();  // Or mp3Player.requestStop() if no pause function
+                mp3Player.pause();
                 playPauseButton.setLabel(">");
             }
             
@@ -230,20 +249,18 @@ void KidScreen::playMP3FromSD() {
     mp3Player.play(mp3Path);
 }
 
-void KidScreen::showAlbum(const char* albumName) {
+void KidScreen::showAlbum(const char* albumName, uint8_t startTrack, bool shuffle) {
     // This function talks to the global `sd` object directly (not through
     // SD_Module), so it was NOT covered by SD_Module's internal locking.
     // That gap is what caused the SPI assert crash when an NFC tag was
     // placed while Core 0 was mid-stream. Lock for the whole function.
     SPIBusGuard guard;
 
+    // Stop and reset the VS1053 (clears any WMA decoder state). Both
+    // happen on Core 0 ahead of the play() below - commands are queued
+    // in order, so there's nothing to wait for here.
     extern MP3Player mp3Player;
-    mp3Player.requestStop();
-    delay(200);
-    
-    // Reset VS1053 to clear any WMA decoder state
-    audioModule.softReset();
-    delay(100);
+    mp3Player.requestStop(true);
 
     strncpy(currentAlbum, albumName, sizeof(currentAlbum) - 1);
     currentAlbum[sizeof(currentAlbum) - 1] = '\0';
@@ -267,12 +284,12 @@ void KidScreen::showAlbum(const char* albumName) {
     
     String targetNorm = normalizeAlbumName(albumName);
     bool found = false;
-    char actualFolderName[128];
+    char actualFolderName[256];
     
     FsFile dir;
     while (dir.openNext(&root, O_RDONLY)) {
         if (dir.isDirectory()) {
-            char name[128];
+            char name[256];
             dir.getName(name, sizeof(name));
             
             // Skip system folders
@@ -283,8 +300,8 @@ void KidScreen::showAlbum(const char* albumName) {
             
             String nameNorm = normalizeAlbumName(name);
             if (nameNorm == targetNorm) {
-                strncpy(actualFolderName, name, sizeof(actualFolderName));
-                strncpy(currentAlbum, name, sizeof(currentAlbum));
+                strcpy(actualFolderName, name);
+                strcpy(currentAlbum, name);
                 found = true;
                 dir.close();
                 break;
@@ -311,58 +328,19 @@ void KidScreen::showAlbum(const char* albumName) {
     }
     
     // Use the actual folder name (with correct capitalization and apostrophes)
-    char searchPath[128];
-    snprintf(searchPath, sizeof(searchPath), "/Music/%s", actualFolderName);  // CHANGED - added /Music
     Serial.printf("Matched to folder: %s\n", actualFolderName);
-    
-    // ... rest of code continues with searchPath
 
-    // Open the matched folder
-    FsFile albumDir;
-
-    if (!albumDir.open(searchPath)) {  // ADD THE if (!  ) CHECK
-    Serial.printf("ERROR: Failed to open %s\n", searchPath);
-    albumLoaded = false;
-    isPlaying = false;
-    return;
+    // Track list from LibraryIndex - indexed now if the background scan
+    // hasn't reached this folder yet
+    int album = LibraryIndex::getInstance().requireAlbum(actualFolderName);
+    if (album < 0) {
+        Serial.printf("ERROR: Failed to open /Music/%s\n", actualFolderName);
+        albumLoaded = false;
+        isPlaying = false;
+        return;
     }
-    Serial.println("Folder opened successfully");  // ADD THIS
-
-// Debug: List what's in the folder
-FsFile testFile;
-Serial.println("Contents of folder:");
-while (testFile.openNext(&albumDir, O_RDONLY)) {
-    char testName[64];
-    testFile.getName(testName, sizeof(testName));
-    Serial.printf("  Found: %s (isDir: %d)\n", testName, testFile.isDirectory());
-    testFile.close();
-}
-
-// Rewind before actual scan
-albumDir.rewind();
-
-
-    
-    // Load ALL tracks from album
-    trackCount = 0;
-    currentTrack = 0;
-    FsFile file;
-    
-    while (file.openNext(&albumDir, O_RDONLY) && trackCount < 100) {
-        char fileName[64];
-        file.getName(fileName, sizeof(fileName));
-        
-        if (strstr(fileName, ".mp3") || strstr(fileName, ".MP3") || 
-            strstr(fileName, ".wma") || strstr(fileName, ".WMA")) {
-            strncpy(trackNames[trackCount], fileName, sizeof(trackNames[0]) - 1);
-            trackNames[trackCount][sizeof(trackNames[0]) - 1] = '\0';
-            trackCount++;
-        }
+    trackCount = LibraryIndex::getInstance().albumTrackCount(album);
 
-        file.close();
-    }
-    albumDir.close();
-    
     Serial.printf("Loaded %d tracks from album\n", trackCount);
     
     if (trackCount == 0) {
@@ -382,24 +360,25 @@ albumDir.rewind();
     
     // Display album art BEFORE starting playback
     displayAlbumArt();
-    delay(100);
     
-    // Play first track
-    char firstTrack[256];
-    snprintf(firstTrack, sizeof(firstTrack), "%s/%s", searchPath, trackNames[0]);  // searchPath already has /Music/
-    Serial.printf("Playing: %s\n", firstTrack);
-
-    extern MP3Player mp3Player;
-    mp3Player.play(firstTrack);
+    // Play the tag's start track (first track if it's out of range).
+    // With the tag's shuffle flag the start track still plays first and
+    // the shuffled order follows it.
+    Playlist& playlist = Playlist::getInstance();
+    playlist.load(album);
+    playlist.play(startTrack < trackCount ? startTrack : 0);
+    playlist.setShuffle(shuffle);
 
     // Stamp the touch cooldown here, at the very end - not at the start
-    // of this function. showAlbum() itself blocks for 600ms-1000ms+
-    // (two explicit delays, a real SD directory scan, a synchronous
-    // JPEG decode) - loop() can't process a queued touch until this
-    // function returns, so stamping at the start meant the cooldown
-    // window could already be expired by the time a touch actually got
-    // processed, defeating the guard entirely. Stamping here means the
-    // cooldown counts from when the screen is actually touchable again.
+    // of this function. showAlbum() can still block for a good while:
+    // the /Music walk to match the folder name, requireAlbum() indexing
+    // the folder if the background scan hasn't got to it, and, on an
+    // AlbumArtCache miss, a synchronous JPEG decode. loop() can't
+    // process a queued touch until this function returns, so stamping
+    // at the start meant the cooldown window could already be expired by
+    // the time a touch actually got processed, defeating the guard
+    // entirely. Stamping here means the cooldown counts from when the
+    // screen is actually touchable again.
     albumLoadStartMs = millis();
 }
 
@@ -414,116 +393,40 @@ void KidScreen::clearAlbum() {
     
     // Request stop safely from Core 1 - Core 0 handles SPI1
     mp3Player.requestStop();
+    Playlist::getInstance().clear();
     
     // Return to splash
     screenManager.showSplash();
 }
 
 
-// Add this method to KidScreen class:
 void KidScreen::displayAlbumArt() {
-    // Get first album folder
-    char albumPath[128];
-    char mp3Path[128];
     Serial.println("=== DISPLAY ALBUM ART CALLED ===");
-    
-   // Use currentAlbum instead of searching for first MP3
-     snprintf(albumPath, sizeof(albumPath), "/Music/%s", currentAlbum);  // ADD /Music/
-   
-    // Find album art in the current album folder
-    char artPath[128];
-    if (!sdModule.getAlbumArt(albumPath, artPath, sizeof(artPath))) {
-        Serial.println("No album art found - trying default");
-        
-        // Try default album art
-        strcpy(artPath, "/Music/FolderDefault.jpg");
-        
-        if (!sdModule.openFile(artPath)) {
-            Serial.println("No default art found either");
-            return;  // No art at all
-        }
-    }
-    
-    
-    // Set up TJpg_Decoder
-    TJpgDec.setJpgScale(1);  // 1:1 scale
-    TJpgDec.setCallback(tftOutput);
-    
-    // Set global TFT pointer for callback
-    globalTFT = &tft;
-    
-    // Open and decode JPEG
-    if (!sdModule.openFile(artPath)) {
-        Serial.println("Failed to open album art");
+
+    if (!artBuffer) return;
+
+    // Through the shared AlbumArtCache: a card that was placed recently
+    // (or whose album was opened on MP3SongList at this size) is a PSRAM
+    // copy with no SD/SPI1 traffic. A miss decodes this album's cover
+    // (or FolderDefault.jpg) fitted into the box, then caches it.
+    if (!AlbumArtCache::getInstance().load(currentAlbum, artBuffer, ART_W, ART_H)) {
+        Serial.println("No album art found");
         return;
     }
-    
-    // Read entire file into buffer (album art should be small)
-    uint8_t* buffer = new uint8_t[50000];  // 50KB buffer
-    size_t totalRead = 0;
-    size_t bytesRead;
-    
-    while ((bytesRead = sdModule.readChunk(buffer + totalRead, 512)) > 0) {
-        totalRead += bytesRead;
-        if (totalRead >= 50000) break;  // Safety limit
-    }
-    
-    sdModule.closeFile();
-    
-    if (totalRead > 0) {
-        Serial.printf("Decoding %d bytes of JPEG...\n", totalRead);
-        
-        // Get JPEG dimensions
-        uint16_t w, h;
-        TJpgDec.getJpgSize(&w, &h, buffer, totalRead);
-        Serial.printf("JPEG size: %dx%d\n", w, h);
-        
-        // Center in the 300x150 box
-        int16_t x = 90 + (300 - w) / 2;
-        int16_t y = 60 + (150 - h) / 2;
-        
-        TJpgDec.setJpgScale(1);  // No scaling
-        TJpgDec.setSwapBytes(true);
-        TJpgDec.drawJpg(x, y, buffer, totalRead);
-    }
-    
-    delete[] buffer;
-    globalTFT = nullptr;
-    
+
+    // RAM-to-TFT over SPI2 only.
+    tft.getTFT()->pushImage(ART_X, ART_Y, ART_W, ART_H, artBuffer);
+
     Serial.println("Album art displayed!");
 }
 
 
 void KidScreen::nextTrack() {
-    currentTrack++;
-    if (currentTrack >= trackCount) {
-        currentTrack = 0;  // Loop back to start
-    }
-    
-    // Build path and play
-    char trackPath[256];
-    snprintf(trackPath, sizeof(trackPath), "/Music/%s/%s", currentAlbum, trackNames[currentTrack]);  // ADD /Music/
-   
-    Serial.printf("KidScreen: Next track - %s\n", trackPath);
-    
-    extern MP3Player mp3Player;
-    delay(300);
-    mp3Player.play(trackPath);
+    Serial.println("KidScreen: Next track");
+    Playlist::getInstance().next();
 }
 
 void KidScreen::prevTrack() {
-    currentTrack--;
-    if (currentTrack < 0) {
-        currentTrack = trackCount - 1;  // Wrap to last track
-    }
-    
-    // Build path and play
-    char trackPath[256];
-    snprintf(trackPath, sizeof(trackPath), "/Music/%s/%s", currentAlbum, trackNames[currentTrack]);  // ADD /Music/
-    
-    Serial.printf("KidScreen: Previous track - %s\n", trackPath);
-    
-    extern MP3Player mp3Player;
-    delay(300);
-    mp3Player.play(trackPath);
+    Serial.println("KidScreen: Previous track");
+    Playlist::getInstance().previous();
 }
@@ -8,6 +8,8 @@
 #include "../managers/BaseScreen.h"
 #include "../ui/UIButton.h"
 #include "../ui/UISlider.h"
+#include "../ui/SpectrumVisualizer.h"
+#include "../ui/UIProgressBar.h"
 
 class VS1053_Module;
 class SD_Module;  // Add this forward declaration
@@ -23,7 +25,7 @@ public:
     bool isAlbumLoaded() const { return albumLoaded; }
     
     // Called when NFC tag is detected
-    void showAlbum(const char* albumName);
+    void showAlbum(const char* albumName, uint8_t startTrack = 0, bool shuffle = false);
     
     // Called when NFC tag is removed
     void clearAlbum();
@@ -36,16 +38,14 @@ public:
 
 
 private:
-    char trackNames[100][64];
     int trackCount;
-    int currentTrack;
     void drawWaitingScreen();
     void drawPlaybackScreen();
     
     VS1053_Module& audioModule;
     SD_Module& sdModule;  // Add this
     
-    char currentAlbum[40];
+    char currentAlbum[256];
     bool albumLoaded;
     bool isPlaying;
 
@@ -55,6 +55,8 @@ private:
     // phantom touch that happened to land on nextButton every time,
     // reliably skipping the first track.
     unsigned long albumLoadStartMs;
+
+    uint16_t* artBuffer;    // ART_W x ART_H RGB565, allocated once (prefers PSRAM), filled from AlbumArtCache
     
     // Playback control buttons
     UIButton prevButton;
@@ -64,6 +66,12 @@ private:
     
     // Volume control
     UISlider volumeSlider;
+
+    // Live band levels, in the strip left of the album art
+    SpectrumVisualizer spectrum;
+
+    // Track progress, just under NOW PLAYING
+    UIProgressBar progressBar;
 };
 
 #endif // KID_SCREEN_H
\ No newline at end of file
@@ -5,13 +5,15 @@
 // =====================================================================
 
 #include "MP3AlbumList.h"
+#include "MP3SongList.h"
 #include "../managers/ScreenManager.h"
 #include "../utils/TFT_Module.h"
 #include "../utils/SD_Module.h"
-#include "../utils/SPIBusLock.h"
+#include "../utils/LibraryIndex.h"
+#include "../ui/GlyphAtlas.h"
+#include "../utils/AlbumArtPrefetcher.h"
 #include <LovyanGFX.hpp>
 #include <lgfx/v1/lgfx_fonts.hpp>
-#include <SdFat.h>
 
 #define ROW_MARGIN_X  20
 #define ROW_WIDTH     440
@@ -21,105 +23,120 @@
 MP3AlbumList::MP3AlbumList(ScreenManager& manager, TFT_Module& tftModule, SD_Module& sd)
     : BaseScreen(manager, tftModule),
       sdModule(sd),
+      albumRows(&albumModel),
       albumCount(0),
+      lastCountCheck(0),
+      listVersion(0),
       currentPage(0),
       totalPages(1),
       backButton(10, 10, 80, 40, "Back"),
+      searchButton(96, 10, 86, 40, "Search"),
       prevPageButton(60, 275, 150, 40, "< Prev"),
       nextPageButton(270, 275, 150, 40, "Next >")
 {
     backButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
+    searchButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
     prevPageButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
     nextPageButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
 }
 
-void MP3AlbumList::loadAlbumsFromSD() {
-    // Direct access to the global `sd` object, not through SD_Module's
-    // own locked methods - same pattern as the old MP3Screen and
-    // KidScreen code. This MUST be guarded, since it was the actual root
-    // cause of the reproducible SPI bus crash found and fixed earlier
-    // this session (Core 1 SD access colliding with Core 0 VS1053
-    // streaming with no lock protecting this specific access path).
-    SPIBusGuard guard;
-
-    Serial.println("MP3AlbumList: Loading albums from SD...");
-
-    if (!sdModule.isInitialized()) {
-        Serial.println("MP3AlbumList: SD not initialized");
-        return;
-    }
-
-    extern SdFs sd;
-    FsFile root;
-    if (!root.open("/Music")) {
-        Serial.println("MP3AlbumList: Failed to open /Music");
-        return;
-    }
-
-    albumCount = 0;
-    FsFile dir;
-
-    while (dir.openNext(&root, O_RDONLY) && albumCount < MAX_ALBUMS) {
-        if (dir.isDirectory()) {
-            char name[64];
-            dir.getName(name, sizeof(name));
-
-            if (name[0] != '.' && strcmp(name, "System Volume Information") != 0) {
-                strncpy(albumNames[albumCount], name, sizeof(albumNames[0]) - 1);
-                albumNames[albumCount][sizeof(albumNames[0]) - 1] = '\0';
-                albumCount++;
-                Serial.printf("  Found album: %s\n", name);
-            }
-        }
-        dir.close();
-    }
-
-    root.close();
-    Serial.printf("MP3AlbumList: Loaded %d albums\n", albumCount);
-
-    totalPages = (albumCount + ROWS_PER_PAGE - 1) / ROWS_PER_PAGE;
-    if (totalPages < 1) totalPages = 1;
-}
-
 void MP3AlbumList::begin() {
     currentPage = 0;
+    drawPage();
+}
 
-    // Only scan the card once - same pattern as the old MP3Screen, so
-    // returning to this screen later doesn't re-scan every time.
-    if (albumCount == 0) {
-        loadAlbumsFromSD();
+void MP3AlbumList::drawPageIndicator() {
+    auto display = tft.getTFT();
+    display->fillRect(300, 20, 166, 10, TFT_BLACK);
+    display->setFont(&fonts::Font0);
+    display->setTextSize(1);
+    display->setTextColor(TFT_CYAN);
+    display->setTextDatum(top_right);
+    char pageStr[24];
+    snprintf(pageStr, sizeof(pageStr), "Page %d of %d", currentPage + 1, totalPages);
+    if (!GlyphAtlas::getInstance().drawString(display, UIFont::Mono1, pageStr, 465, 20,
+                                              top_right, TFT_CYAN, TFT_BLACK)) {
+        display->drawString(pageStr, 465, 20);
     }
+}
 
-    drawPage();
+void MP3AlbumList::countAlbums() {
+    albumCount = albumRows.count();
+    listVersion = albumModel.version();
+    totalPages = (albumCount + ROWS_PER_PAGE - 1) / ROWS_PER_PAGE;
+    if (totalPages < 1) totalPages = 1;
+    if (currentPage >= totalPages) currentPage = totalPages - 1;
+    lastCountCheck = millis();
 }
 
 void MP3AlbumList::drawPage() {
     auto display = tft.getTFT();
+    GlyphAtlas& atlas = GlyphAtlas::getInstance();
     display->fillScreen(TFT_BLACK);
 
+    countAlbums();
+
+    // Every string on this page goes through the glyph atlas first (one
+    // pushImage() per string), with LovyanGFX's own drawString() as the
+    // fallback for anything the atlas can't render (non-ASCII names).
+
     // Title
     display->setFont(&fonts::Font0);
     display->setTextSize(3);
     display->setTextColor(TFT_CYAN);
     display->setTextDatum(top_center);
-    display->drawString("Albums", 240, 8);
+    if (!atlas.drawString(display, UIFont::Mono3, "Albums", 240, 8, top_center, TFT_CYAN, TFT_BLACK)) {
+        display->drawString("Albums", 240, 8);
+    }
 
-    // Page indicator
-    display->setTextSize(1);
-    display->setTextColor(TFT_CYAN);
-    display->setTextDatum(top_right);
-    char pageStr[24];
-    snprintf(pageStr, sizeof(pageStr), "Page %d of %d", currentPage + 1, totalPages);
-    display->drawString(pageStr, 465, 20);
+    drawPageIndicator();
 
     backButton.draw(tft);
+    searchButton.draw(tft);
+
+    drawRows();
+
+    prevPageButton.draw(tft);
+    nextPageButton.draw(tft);
+
+    // Start decoding this page's covers in the background while the user
+    // is still reading it, so whichever album they tap opens with its art
+    // already in AlbumArtCache. A new page replaces the old request.
+    // Full names from the index, not the display rows - the prefetcher
+    // copies them before LibraryIndex next grows.
+    if (albumCount > 0) {
+        LibraryIndex& library = LibraryIndex::getInstance();
+        const char* pageAlbums[ROWS_PER_PAGE];
+        int startIndex = currentPage * ROWS_PER_PAGE;
+        int n = 0;
+        for (int i = startIndex; i < albumCount && n < ROWS_PER_PAGE; i++) {
+            pageAlbums[n++] = library.albumName(library.albumAt(i));
+        }
+        MP3SongList::prefetchAlbumArt(pageAlbums, n);
+    }
+
+    // Reset to the default font before leaving this function - without
+    // this, whatever screen comes next inherits FreeSerif9pt7b as the
+    // active font, since setFont() state persists across screens.
+    display->setFont(&fonts::Font0);
+}
+
+void MP3AlbumList::drawRows() {
+    auto display = tft.getTFT();
+    GlyphAtlas& atlas = GlyphAtlas::getInstance();
+    display->fillRect(0, ROW_START_Y, 480, ROWS_PER_PAGE * ROW_HEIGHT, TFT_BLACK);
 
     if (albumCount == 0) {
+        const char* empty = LibraryIndex::getInstance().isComplete()
+                                ? "No albums found on SD card" : "Scanning library...";
         display->setFont(&fonts::Font0);
         display->setTextSize(2);
         display->setTextColor(TFT_DARKGREY);
         display->setTextDatum(top_left);
-        display->drawString("No albums found on SD card", ROW_MARGIN_X, ROW_START_Y);
+        if (!atlas.drawString(display, UIFont::Mono2, empty,
+                              ROW_MARGIN_X, ROW_START_Y, top_left, TFT_DARKGREY, TFT_BLACK)) {
+            display->drawString(empty, ROW_MARGIN_X, ROW_START_Y);
+        }
     } else {
         int startIndex = currentPage * ROWS_PER_PAGE;
         for (int i = 0; i < ROWS_PER_PAGE; i++) {
@@ -133,20 +150,18 @@ void MP3AlbumList::drawPage() {
             display->setTextColor(TFT_WHITE);
             display->setTextDatum(middle_left);
 
-            String name = String(albumNames[albumIndex]);
+            String name = String(albumRows.row(albumIndex));
             if (name.length() > 55) {
                 name = name.substring(0, 52) + "...";
             }
-            display->drawString(name, ROW_MARGIN_X + 12, rowY + ROW_HEIGHT / 2);
+            if (!atlas.drawString(display, UIFont::Serif9, name.c_str(), ROW_MARGIN_X + 12,
+                                  rowY + ROW_HEIGHT / 2, middle_left, TFT_WHITE, TFT_BLACK)) {
+                display->drawString(name, ROW_MARGIN_X + 12, rowY + ROW_HEIGHT / 2);
+            }
         }
     }
 
-    prevPageButton.draw(tft);
-    nextPageButton.draw(tft);
-
-    // Reset to the default font before leaving this function - without
-    // this, whatever screen comes next inherits FreeSerif9pt7b as the
-    // active font, since setFont() state persists across screens.
+    // Back to the default font - same reason as the end of drawPage()
     display->setFont(&fonts::Font0);
 }
 
@@ -165,16 +180,35 @@ void MP3AlbumList::prevPage() {
 }
 
 void MP3AlbumList::update() {
-    // Nothing animated yet.
+    // The library may still be indexing, or refreshing albums after an
+    // upload. Once a second, pick up albums found or replaced since the
+    // page was drawn - they're sorted in, so can land on any page. Just
+    // the rows and page count are redrawn.
+    if (millis() - lastCountCheck < 1000) return;
+    lastCountCheck = millis();
+
+    if (albumRows.count() == albumCount && albumModel.version() == listVersion) return;
+
+    countAlbums();
+    drawRows();
+    drawPageIndicator();
 }
 
 void MP3AlbumList::handleTouch(int x, int y) {
     if (backButton.hit(x, y)) {
         Serial.println("MP3AlbumList: Back pressed");
+        AlbumArtPrefetcher::getInstance().cancel();
         screenManager.showSplash();
         return;
     }
 
+    if (searchButton.hit(x, y)) {
+        Serial.println("MP3AlbumList: Search pressed");
+        AlbumArtPrefetcher::getInstance().cancel();
+        screenManager.showSearch();
+        return;
+    }
+
     if (prevPageButton.hit(x, y)) {
         Serial.println("MP3AlbumList: Prev page");
         prevPage();
@@ -195,8 +229,14 @@ void MP3AlbumList::handleTouch(int x, int y) {
         int albumIndex = (currentPage * ROWS_PER_PAGE) + rowIndex;
 
         if (rowIndex < ROWS_PER_PAGE && albumIndex < albumCount) {
-            Serial.printf("MP3AlbumList: Selected '%s'\n", albumNames[albumIndex]);
-            screenManager.getSongListScreen()->loadAlbum(albumNames[albumIndex]);
+            // The full folder name - a display row may be cut short
+            LibraryIndex& library = LibraryIndex::getInstance();
+            const char* name = library.albumName(library.albumAt(albumIndex));
+            Serial.printf("MP3AlbumList: Selected '%s'\n", name);
+            // The rest of the page's covers can wait - don't keep reading
+            // them off SD once the chosen album starts streaming.
+            AlbumArtPrefetcher::getInstance().cancel();
+            screenManager.getSongListScreen()->loadAlbum(name);
             screenManager.showSongList();
         }
         return;
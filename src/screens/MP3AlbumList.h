@@ -7,6 +7,8 @@
 
 #include "../managers/BaseScreen.h"
 #include "../ui/UIButton.h"
+#include "../ui/ListWindow.h"
+#include "../utils/LibraryLists.h"
 
 class ScreenManager;
 class TFT_Module;
@@ -22,22 +24,29 @@ public:
 
 private:
     static const int ROWS_PER_PAGE = 7;
-    static const int MAX_ALBUMS = 50;
 
+    void countAlbums();
     void drawPage();
+    void drawRows();
+    void drawPageIndicator();
     void nextPage();
     void prevPage();
-    void loadAlbumsFromSD();
 
     SD_Module& sdModule;
 
-    char albumNames[MAX_ALBUMS][64];
+    // Albums straight from LibraryIndex, which fills in behind us -
+    // albumCount is what the screen was last drawn with.
+    AlbumListModel albumModel;
+    ListWindow albumRows;
     int albumCount;
+    unsigned long lastCountCheck;
+    uint32_t listVersion;       // albumModel.version() when drawn
 
     int currentPage;
     int totalPages;
 
     UIButton backButton;
+    UIButton searchButton;
     UIButton prevPageButton;
     UIButton nextPageButton;
 };
@@ -9,9 +9,11 @@
 #include "../utils/VS1053_Module.h"
 #include "../utils/SPIBusLock.h"
 #include "../managers/MP3Player.h"  
+#include "../managers/Playlist.h"
+#include "../utils/AlbumArtCache.h"
+#include "../utils/LibraryIndex.h"
 #include <LovyanGFX.hpp>
-#include <SdFat.h>
-#include <TJpg_Decoder.h>
+#include <esp_heap_caps.h>
 //#include <lgfx/v1/misc/fonts/FreeSans9pt7b.hpp>
 
 #define LIST_X 220
@@ -21,40 +23,19 @@
 #define ITEM_HEIGHT 18
 #define MAX_VISIBLE 10
 
-// Global for JPEG decoder callback
-TFT_Module* globalTFT_MP3 = nullptr;
-
-
-
-bool tftOutput_MP3(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
-    if (!globalTFT_MP3) {
-        Serial.println("ERROR: globalTFT_MP3 is NULL!");
-        return false;
-    }
-    
-    if (!bitmap) {
-        Serial.println("ERROR: bitmap is NULL!");
-        return false;
-    }
-    
-    auto display = globalTFT_MP3->getTFT();
-    if (!display) {
-        Serial.println("ERROR: display is NULL!");
-        return false;
-    }
-    
-    display->pushImage(x, y, w, h, bitmap);
-    return true;
-}
+#define ART_BOX 200
 
 MP3Screen::MP3Screen(ScreenManager& manager, TFT_Module& tftModule, SD_Module& sd, VS1053_Module& audio)
     : BaseScreen(manager, tftModule),
       sdModule(sd),
       audioModule(audio),
+      albumRows(&albumModel),
       albumCount(0),
       selectedAlbum(-1),
+      trackRows(&trackModel),
       trackCount(0),
       selectedTrack(-1),
+      playlistChanges(0),
       inAlbumView(true),
       scrollOffset(0),
       isPlaying(false),
@@ -75,11 +56,6 @@ void MP3Screen::begin() {
     auto display = tft.getTFT();
     display->fillScreen(TFT_BLACK);
     
-    // Load albums from SD on first entry
-    if (albumCount == 0) {
-        loadAlbumsFromSD();
-    }
-    
     drawLayout();
 }
 
@@ -124,51 +100,11 @@ void MP3Screen::drawLayout() {
     nextButton.draw(tft);
 }
 
-void MP3Screen::loadAlbumsFromSD() {
-    // Direct access to the global `sd` object, not through SD_Module -
-    // same gap that caused the crash in KidScreen::showAlbum(). Lock it.
-    SPIBusGuard guard;
-
-    Serial.println("MP3Screen: Loading albums from SD...");
-    
-    if (!sdModule.isInitialized()) {
-        Serial.println("MP3Screen: SD not initialized");
-        return;
-    }
-    
-    // Open root directory
-    extern SdFs sd;  // Access SD from SD_Module
-    FsFile root;
-    if (!root.open("/Music")) {
-        Serial.println("MP3Screen: Failed to open /Music");
-        return;
-    }
-    
-    albumCount = 0;
-    FsFile dir;
-    
-    while (dir.openNext(&root, O_RDONLY) && albumCount < 50) {
-        if (dir.isDirectory()) {
-            char name[64];
-            dir.getName(name, sizeof(name));
-            
-            // Skip system directories
-            if (name[0] != '.' && strcmp(name, "System Volume Information") != 0) {
-                strncpy(albumNames[albumCount], name, sizeof(albumNames[0]) - 1);
-                albumNames[albumCount][sizeof(albumNames[0]) - 1] = '\0';
-                albumCount++;
-                Serial.printf("  Found album: %s\n", name);
-            }
-        }
-        dir.close();
-    }
-    
-    root.close();
-    Serial.printf("MP3Screen: Loaded %d albums\n", albumCount);
-}
-
 void MP3Screen::drawAlbumList() {
     auto display = tft.getTFT();
+
+    // LibraryIndex may still be finding albums
+    albumCount = albumRows.count();
     
     display->setTextSize(1);
     display->setTextDatum(top_left);
@@ -176,15 +112,16 @@ void MP3Screen::drawAlbumList() {
     for (int i = 0; i < MAX_VISIBLE && (scrollOffset + i) < albumCount; i++) {
         int albumIndex = scrollOffset + i;
         int y = LIST_Y + 5 + (i * ITEM_HEIGHT);
+        bool selected = LibraryIndex::getInstance().albumAt(albumIndex) == selectedAlbum;
         
         // Highlight selected
-        if (albumIndex == selectedAlbum) {
+        if (selected) {
             display->fillRect(LIST_X + 2, y - 2, LIST_W - 4, ITEM_HEIGHT, TFT_DARKGREY);
         }
         
         // Draw album name (truncate if needed)
-        display->setTextColor(albumIndex == selectedAlbum ? TFT_YELLOW : TFT_WHITE);
-        String albumName = String(albumNames[albumIndex]);
+        display->setTextColor(selected ? TFT_YELLOW : TFT_WHITE);
+        String albumName = String(albumRows.row(albumIndex));
         if (albumName.length() > 30) {
             albumName = albumName.substring(0, 15) + "...";
         }
@@ -221,7 +158,7 @@ void MP3Screen::drawTrackList() {
         
         // Draw track name
         display->setTextColor(trackIndex == selectedTrack ? TFT_YELLOW : TFT_WHITE);
-        String trackName = String(trackNames[trackIndex]);
+        String trackName = String(trackRows.row(trackIndex));
         if (trackName.length() > 18) {
             trackName = trackName.substring(0, 15) + "...";
         }
@@ -246,7 +183,6 @@ void MP3Screen::drawAlbumArt() {
     extern MP3Player mp3Player;
     
     mp3Player.requestStop();
-    delay(100);
 
     if (selectedAlbum < 0) {
         // Placeholder
@@ -257,49 +193,22 @@ void MP3Screen::drawAlbumArt() {
         return;
     }
     
-    // Try folder-specific art first
-    char artPath[128];
-    snprintf(artPath, sizeof(artPath), "/Music/%s/folder.jpg", albumNames[selectedAlbum]);
-    
-    if (!sdModule.openFile(artPath)) {
-        // Try default art
-        Serial.println("No album art found - trying default");
-        strcpy(artPath, "/Music/FolderDefault.jpg");
-        
-        if (!sdModule.openFile(artPath)) {
-            Serial.println("No default art found either");
-            return;  // No art at all
-        }
-    }
-    
-    // Read JPEG
-    uint8_t* buffer = new uint8_t[50000];
-    size_t totalRead = 0;
-    size_t bytesRead;
-    
-    while ((bytesRead = sdModule.readChunk(buffer + totalRead, 512)) > 0) {
-        totalRead += bytesRead;
-        if (totalRead >= 50000) break;
-    }
-    
-    sdModule.closeFile();
-    
-    if (totalRead > 0) {
-        TJpgDec.setCallback(tftOutput_MP3);
-        TJpgDec.setSwapBytes(true);
-        globalTFT_MP3 = &tft;
-        
-        TJpgDec.drawJpg(10, 60, buffer, totalRead);
-        
-        globalTFT_MP3 = nullptr;
+    // Same cache/decoder as MP3SongList and KidScreen: streamed from SD,
+    // fitted to the 200x200 box, kept in AlbumArtCache. Scratch buffer
+    // only lives for the blit - this screen is rarely shown.
+    uint16_t* art = (uint16_t*)heap_caps_malloc(ART_BOX * ART_BOX * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    if (!art) return;
+
+    if (AlbumArtCache::getInstance().load(LibraryIndex::getInstance().albumName(selectedAlbum), art, ART_BOX, ART_BOX)) {
+        display->pushImage(10, 60, ART_BOX, ART_BOX, art);
     }
-    
-    delete[] buffer;
+
+    heap_caps_free(art);
 }
 
 void MP3Screen::selectAlbum(int index) {
-    // selectAlbum() also touches the global `sd` object directly further
-    // down (the track-scan loop), same gap as loadAlbumsFromSD(). Lock
+    // requireAlbum() may read the folder off the card through the global
+    // `sd` object, and drawAlbumArt() reads the cover. Lock
     // for the whole function - softReset() and drawAlbumArt() take the
     // same lock internally too, which is safe since it's recursive.
     SPIBusGuard guard;
@@ -310,56 +219,38 @@ void MP3Screen::selectAlbum(int index) {
 
     if (index < 0 || index >= albumCount) return;
 
-    // Stop and reset everything first
-    mp3Player.requestStop();
-    delay(200);
-    
-    // Reset VS1053 to clear decoder state (especially after WMA)
-    audioModule.softReset();
-    delay(100);
+    // Stop and reset the VS1053 first (clears decoder state, especially
+    // after WMA) - both run on Core 0, ahead of any play() issued later.
+    mp3Player.requestStop(true);
 
-    selectedAlbum = index;
-    Serial.printf("MP3Screen: Selected album '%s'\n", albumNames[index]);
+    // index is a list position; albums are numbered in the order found
+    LibraryIndex& library = LibraryIndex::getInstance();
+    int album = library.albumAt(index);
+    selectedAlbum = album;
+    Serial.printf("MP3Screen: Selected album '%s'\n", library.albumName(album));
     
-    // Load tracks from this album folder
-    trackCount = 0;
+    // The album's tracks, from LibraryIndex. requireAlbum() finishes the
+    // folder first if the background scan is still partway through it.
+    // The name is copied since that can move the index's string pool.
+    char name[256];
+    strncpy(name, library.albumName(album), sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    library.requireAlbum(name);
+
     scrollOffset = 0;
-    
-    char folderPath[128];
-    snprintf(folderPath, sizeof(folderPath), "/Music/%s", albumNames[index]);  // ADD /Music/
-   
-    extern SdFs sd;
-    FsFile albumDir;
-    if (!albumDir.open(folderPath)) {
-        Serial.println("Failed to open album folder");
-        return;
-    }
-    
-    FsFile file;
-    while (file.openNext(&albumDir, O_RDONLY) && trackCount < 100) {
-        char name[64];
-        file.getName(name, sizeof(name));
-        
-        if (strstr(name, ".mp3") || strstr(name, ".MP3") || 
-            strstr(name, ".wma") || strstr(name, ".WMA")) {
-            strncpy(trackNames[trackCount], name, sizeof(trackNames[0]) - 1);
-            trackNames[trackCount][sizeof(trackNames[0]) - 1] = '\0';
-            trackCount++;
-        }
-        
-        file.close();
-    }
-    albumDir.close();
+    trackModel.setAlbum(album);
+    trackRows.invalidate();
+    trackCount = library.albumTrackCount(album);
 
     // Load album art FIRST (before starting playback to avoid SPI conflict)
     drawAlbumArt();
     delay(100);  // Let SPI settle
     
     Serial.printf("Loaded %d tracks\n", trackCount);
+    Playlist::getInstance().load(album);
 
     // Auto-play first track (art already loaded)
     if (trackCount > 0) {
-        selectedTrack = 0;
         playTrack(0);
     }
     
@@ -371,8 +262,7 @@ void MP3Screen::selectAlbum(int index) {
 void MP3Screen::selectTrack(int index) {
     if (index < 0 || index >= trackCount) return;
     
-    selectedTrack = index;
-    Serial.printf("MP3Screen: Selected track '%s'\n", trackNames[index]);
+    Serial.printf("MP3Screen: Selected track '%s'\n", trackRows.row(index));
     
     playTrack(index);
     drawLayout();
@@ -391,7 +281,14 @@ void MP3Screen::scrollList(int direction) {
 }
 
 void MP3Screen::update() {
-    // Future: update playback time, etc.
+    // Track changed underneath us (auto-advance, gapless chain) - move
+    // the highlight.
+    Playlist& playlist = Playlist::getInstance();
+    if (playlist.changeCount() != playlistChanges) {
+        playlistChanges = playlist.changeCount();
+        selectedTrack = playlist.current();
+        if (!inAlbumView) drawLayout();
+    }
 }
 
 void MP3Screen::handleTouch(int x, int y) {
@@ -401,14 +298,12 @@ void MP3Screen::handleTouch(int x, int y) {
         if (!inAlbumView) {
             // Go back to album list
             mp3Player.requestStop();
-            delay(100);
             inAlbumView = true;
             scrollOffset = 0;
             drawLayout();
         } else {
             // Go back to splash
             mp3Player.requestStop();
-            delay(300);
             screenManager.showSplash();
         }
         return;
@@ -442,19 +337,14 @@ if (playPauseButton.hit(x, y)) {
 
     if (prevButton.hit(x, y)) {
     Serial.println("Previous track");
-    selectedTrack--;
-    if (selectedTrack < 0) {
-        selectedTrack = trackCount - 1;  // Wrap to last track
-    }
-    playTrack(selectedTrack);
-    drawLayout();
+    Playlist::getInstance().previous();
     return;
 }
     
     // Volume slider
     if (volumeSlider.handleTouch(x, y)) {
         int volume = volumeSlider.getValue();
-        audioModule.setVolume(volume);
+        mp3Player.setVolume(volume);
         volumeSlider.draw(tft);
         return;
     }
@@ -486,17 +376,10 @@ if (playPauseButton.hit(x, y)) {
 void MP3Screen::playTrack(int index) {
     if (index < 0 || index >= trackCount) return;
     
+    Playlist& playlist = Playlist::getInstance();
+    playlist.play(index);
     selectedTrack = index;
-    
-    // Build full path: /Music/AlbumName/TrackName.mp3
-    char trackPath[256];
-    snprintf(trackPath, sizeof(trackPath), "/Music/%s/%s",  // ADD /Music/
-             albumNames[selectedAlbum], trackNames[index]);
-    
-    Serial.printf("Playing: %s\n", trackPath);
-    
-    extern MP3Player mp3Player;
-    mp3Player.play(trackPath);
+    playlistChanges = playlist.changeCount();   // caller redraws
     
     isPlaying = true;
     playPauseButton.setLabel("Pause");
@@ -505,10 +388,6 @@ void MP3Screen::playTrack(int index) {
 
 
 void MP3Screen::nextTrack() {
-    selectedTrack++;
-    if (selectedTrack >= trackCount) {
-        selectedTrack = 0;  // Loop album
-    }
-    playTrack(selectedTrack);
-    drawLayout();  // Update selection highlight
+    // Highlight follows in update()
+    Playlist::getInstance().next();
 }
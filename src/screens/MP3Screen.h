@@ -8,6 +8,8 @@
 #include "../managers/BaseScreen.h"
 #include "../ui/UIButton.h"
 #include "../ui/UISlider.h"
+#include "../ui/ListWindow.h"
+#include "../utils/LibraryLists.h"
 
 class TFT_Module;
 class SD_Module;
@@ -28,7 +30,6 @@ private:
     void drawAlbumList();
     void drawTrackList();
     void drawAlbumArt();
-    void loadAlbumsFromSD();
     void selectAlbum(int index);
     void selectTrack(int index);
     void scrollList(int direction);  // +1 or -1
@@ -37,14 +38,17 @@ private:
     SD_Module& sdModule;
     VS1053_Module& audioModule;
     
-    // Album/track data
-    char albumNames[50][64];  // Max 50 albums
+    // Album/track data - paged views of LibraryIndex
+    AlbumListModel albumModel;
+    ListWindow albumRows;
     int albumCount;
-    int selectedAlbum;
+    int selectedAlbum;         // LibraryIndex album
     
-    char trackNames[100][64];  // Max 100 tracks per album
+    TrackListModel trackModel;
+    ListWindow trackRows;
     int trackCount;
-    int selectedTrack;
+    int selectedTrack;         // mirrors Playlist::current() for the highlight
+    uint32_t playlistChanges;  // last Playlist::changeCount() drawn
     
     bool inAlbumView;  // true = album list, false = track list
     int scrollOffset;
@@ -9,21 +9,32 @@
 #include "../utils/VS1053_Module.h"
 #include "../utils/SPIBusLock.h"
 #include "../managers/MP3Player.h"
+#include "../managers/Playlist.h"
+#include "../ui/GlyphAtlas.h"
+#include "../utils/AlbumArtCache.h"
+#include "../utils/AlbumArtPrefetcher.h"
+#include "../utils/PlaybackPosition.h"
+#include "../utils/LibraryIndex.h"
 #include <LovyanGFX.hpp>
 #include <lgfx/v1/lgfx_fonts.hpp>
 #include <SdFat.h>
-#include <TJpg_Decoder.h>
 #include <esp_heap_caps.h>
 
 #define ART_X       10
 #define ART_Y       55
 #define ART_SIZE    160
 
+#define SPECTRUM_Y  (ART_Y + ART_SIZE + 7)
+#define SPECTRUM_H  38
+
 #define TRACK_X       185
 #define TRACK_Y_START 55
 #define TRACK_ROW_H   16
 #define TRACK_AREA_H  (VISIBLE_TRACK_ROWS * TRACK_ROW_H)
 
+#define PROGRESS_Y    (TRACK_Y_START + TRACK_AREA_H + 7)
+#define PROGRESS_W    140
+
 #define TITLE_Y            12
 #define TITLE_MAX_WIDTH_PX 280   // safe width that won't overlap Back (ends at x=90) when centered at x=240
 
@@ -31,38 +42,15 @@
 // the slider's own hit test still gets first shot at that strip.
 #define TRACK_TAP_RIGHT_X  400
 
-// TJpg_Decoder's callback writes into artBuffer (a RAM canvas) instead
-// of straight to the TFT. Decoding happens before playback starts (see
-// loadAlbum()), so nothing here touches the display or the SPI1 bus -
-// x/y arrive relative to the canvas origin we pass into drawJpg(), not
-// absolute screen coordinates.
-static uint16_t* artDecodeTarget = nullptr;
-static int artDecodeCanvasW = 0;
-static int artDecodeCanvasH = 0;
-
-static bool tftOutput_SongList_ToBuffer(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
-    if (!artDecodeTarget || !bitmap) return false;
-
-    for (int row = 0; row < h; row++) {
-        int destY = y + row;
-        if (destY < 0 || destY >= artDecodeCanvasH) continue;
-
-        for (int col = 0; col < w; col++) {
-            int destX = x + col;
-            if (destX < 0 || destX >= artDecodeCanvasW) continue;
-            artDecodeTarget[destY * artDecodeCanvasW + destX] = bitmap[row * w + col];
-        }
-    }
-    return true;
-}
-
 MP3SongList::MP3SongList(ScreenManager& manager, TFT_Module& tftModule, SD_Module& sd, VS1053_Module& audio)
     : BaseScreen(manager, tftModule),
       sdModule(sd),
       audioModule(audio),
+      trackRows(&trackModel),
       trackCount(0),
       scrollOffset(0),
       currentTrackIndex(0),
+      playlistChanges(0),
       isPlaying(false),
       albumArtLoaded(false),
       artBuffer(nullptr),
@@ -71,8 +59,9 @@ MP3SongList::MP3SongList(ScreenManager& manager, TFT_Module& tftModule, SD_Modul
       playPauseButton(120, 265, 100, 45, "Play"),
       nextButton(240, 265, 60, 45, ">>"),
       volumeSlider(440, 55, 30, 200, 0, 100),
-      trackScrollSlider(405, TRACK_Y_START, 15, TRACK_AREA_H, 0,
-                         (MAX_TRACKS > VISIBLE_TRACK_ROWS) ? (MAX_TRACKS - VISIBLE_TRACK_ROWS) : 0)
+      trackScrollSlider(405, TRACK_Y_START, 15, TRACK_AREA_H, 0, SCROLL_SLIDER_RANGE),
+      spectrum(ART_X, SPECTRUM_Y, ART_SIZE, SPECTRUM_H),
+      progressBar(TRACK_X, PROGRESS_Y, PROGRESS_W, 6, true)
 {
     backButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
     prevButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
@@ -81,7 +70,7 @@ MP3SongList::MP3SongList(ScreenManager& manager, TFT_Module& tftModule, SD_Modul
     volumeSlider.setValue(75);
     trackScrollSlider.setColors(0x4208, TFT_WHITE, TFT_CYAN);
 
-    sliderMaxValue = (MAX_TRACKS > VISIBLE_TRACK_ROWS) ? (MAX_TRACKS - VISIBLE_TRACK_ROWS) : 0;
+    sliderMaxValue = SCROLL_SLIDER_RANGE;
     maxScrollOffset = 0;
 
     currentAlbumName[0] = '\0';
@@ -102,7 +91,7 @@ MP3SongList::MP3SongList(ScreenManager& manager, TFT_Module& tftModule, SD_Modul
     }
 }
 
-void MP3SongList::loadAlbum(const char* albumName) {
+void MP3SongList::loadAlbum(const char* albumName, const char* startFile) {
     // Direct access to the global `sd` object, not through SD_Module's
     // own locked methods - MUST be guarded (root cause of the
     // reproducible SPI bus crash found and fixed earlier this session).
@@ -120,48 +109,41 @@ void MP3SongList::loadAlbum(const char* albumName) {
     // failure look "intermittent": it was actually deterministic,
     // just masked whenever NFC (which does reset unconditionally) or
     // any other prior playback attempt happened first.
+    // requestStop(true) does that reset on Core 0 even when the player
+    // is already IDLE, queued ahead of the play() that follows.
     extern MP3Player mp3Player;
-    mp3Player.requestStop();
-    delay(200);
-    audioModule.softReset();
-    delay(100);
+    mp3Player.requestStop(true);
 
     strncpy(currentAlbumName, albumName, sizeof(currentAlbumName) - 1);
     currentAlbumName[sizeof(currentAlbumName) - 1] = '\0';
+    // Both names may point into LibraryIndex's string pool, which
+    // requireAlbum() below can move - copy them first.
+    char startName[256] = "";
+    if (startFile) {
+        strncpy(startName, startFile, sizeof(startName) - 1);
+        startName[sizeof(startName) - 1] = '\0';
+    }
 
     Serial.printf("MP3SongList: Loading tracks for '%s'\n", currentAlbumName);
 
     trackCount = 0;
     scrollOffset = 0;
 
-    char folderPath[128];
-    snprintf(folderPath, sizeof(folderPath), "/Music/%s", currentAlbumName);
-
-    extern SdFs sd;
-    FsFile albumDir;
-    if (!albumDir.open(folderPath)) {
+    // Track list straight from LibraryIndex - no copy, no cap. Indexes
+    // the folder now if the background scan hasn't reached it yet.
+    LibraryIndex& library = LibraryIndex::getInstance();
+    int album = library.requireAlbum(currentAlbumName);
+    trackModel.setAlbum(album);
+    trackRows.invalidate();
+    if (album < 0) {
         Serial.println("MP3SongList: Failed to open album folder");
         maxScrollOffset = 0;
         return;
     }
-
-    FsFile file;
-    while (file.openNext(&albumDir, O_RDONLY) && trackCount < MAX_TRACKS) {
-        char name[64];
-        file.getName(name, sizeof(name));
-
-        if (strstr(name, ".mp3") || strstr(name, ".MP3") ||
-            strstr(name, ".wma") || strstr(name, ".WMA")) {
-            strncpy(trackNames[trackCount], name, sizeof(trackNames[0]) - 1);
-            trackNames[trackCount][sizeof(trackNames[0]) - 1] = '\0';
-            trackCount++;
-        }
-
-        file.close();
-    }
-    albumDir.close();
+    trackCount = library.albumTrackCount(album);
 
     Serial.printf("MP3SongList: Loaded %d tracks\n", trackCount);
+    Playlist::getInstance().load(album);
 
     maxScrollOffset = trackCount - VISIBLE_TRACK_ROWS;
     if (maxScrollOffset < 0) maxScrollOffset = 0;
@@ -175,24 +157,26 @@ void MP3SongList::loadAlbum(const char* albumName) {
     loadAlbumArt();
 
     // Auto-play the first track, matching the old MP3Screen's behavior
-    // when an album was selected.
+    // when an album was selected - or the one a search result named.
+    int startIndex = 0;
+    for (int i = 0; startName[0] && i < trackCount; i++) {
+        if (strcmp(library.trackFile(library.albumTrack(album, i)), startName) == 0) {
+            startIndex = i;
+            break;
+        }
+    }
     if (trackCount > 0) {
-        playTrack(0);
+        playTrack(startIndex);
     }
 }
 
 void MP3SongList::playTrack(int index) {
     if (index < 0 || index >= trackCount) return;
 
+    Playlist& playlist = Playlist::getInstance();
+    playlist.play(index);
     currentTrackIndex = index;
-
-    char trackPath[256];
-    snprintf(trackPath, sizeof(trackPath), "/Music/%s/%s", currentAlbumName, trackNames[index]);
-
-    Serial.printf("MP3SongList: Playing %s\n", trackPath);
-
-    extern MP3Player mp3Player;
-    mp3Player.play(trackPath);
+    playlistChanges = playlist.changeCount();   // caller redraws
 
     isPlaying = true;
     playPauseButton.setLabel("Pause");
@@ -200,10 +184,9 @@ void MP3SongList::playTrack(int index) {
 
 void MP3SongList::updateScrollOffsetFromSlider() {
     // trackScrollSlider's raw value range (0..sliderMaxValue) is fixed
-    // at construction time, sized for the worst case of MAX_TRACKS (100)
-    // tracks - sliderMaxValue is 88. Most albums have far fewer tracks
-    // than that, so maxScrollOffset (this album's real scrollable range)
-    // is usually much smaller - 7, for a 19-track album. Directly
+    // at construction time - SCROLL_SLIDER_RANGE, 88 - while
+    // maxScrollOffset (this album's real scrollable range) is anything
+    // from 7, for a 19-track album, to thousands for a box set. Directly
     // clamping rawOffset into [0, maxScrollOffset] collapsed almost the
     // entire physical drag range onto a single clamped value, leaving
     // only a sliver of travel with any real effect - that's the "jumps
@@ -225,6 +208,13 @@ void MP3SongList::updateScrollOffsetFromSlider() {
 void MP3SongList::begin() {
     scrollOffset = 0;
     trackScrollSlider.setValue(sliderMaxValue);
+
+    // Opened on a track further down (a search result) - scroll it into
+    // view, slider scaled the same way updateScrollOffsetFromSlider() reads it.
+    if (currentTrackIndex >= VISIBLE_TRACK_ROWS && maxScrollOffset > 0) {
+        scrollOffset = min(currentTrackIndex, maxScrollOffset);
+        trackScrollSlider.setValue(sliderMaxValue - scrollOffset * sliderMaxValue / maxScrollOffset);
+    }
     drawScreen();
 }
 
@@ -239,7 +229,10 @@ void MP3SongList::drawTrackListArea() {
     if (trackCount == 0) {
         display->setTextColor(TFT_DARKGREY);
         display->setTextDatum(top_left);
-        display->drawString("No tracks found", TRACK_X, TRACK_Y_START);
+        if (!GlyphAtlas::getInstance().drawString(display, UIFont::Mono1, "No tracks found",
+                                                  TRACK_X, TRACK_Y_START, top_left, TFT_DARKGREY, TFT_BLACK)) {
+            display->drawString("No tracks found", TRACK_X, TRACK_Y_START);
+        }
         return;
     }
 
@@ -248,14 +241,20 @@ void MP3SongList::drawTrackListArea() {
         if (trackIndex >= trackCount) break;
 
         int rowY = TRACK_Y_START + (i * TRACK_ROW_H);
-        display->setTextColor(trackIndex == currentTrackIndex ? TFT_YELLOW : TFT_WHITE);
+        uint16_t rowColor = (trackIndex == currentTrackIndex) ? TFT_YELLOW : TFT_WHITE;
+        display->setTextColor(rowColor);
         display->setTextDatum(middle_left);
 
-        String trackName = String(trackNames[trackIndex]);
+        String trackName = String(trackRows.row(trackIndex));
         if (trackName.length() > 30) {
             trackName = trackName.substring(0, 27) + "...";
         }
-        display->drawString(trackName, TRACK_X, rowY + TRACK_ROW_H / 2);
+        // Atlas blit first (area was just cleared to black above), plain
+        // drawString() for names the atlas can't cover.
+        if (!GlyphAtlas::getInstance().drawString(display, UIFont::Mono1, trackName.c_str(), TRACK_X,
+                                                  rowY + TRACK_ROW_H / 2, middle_left, rowColor, TFT_BLACK)) {
+            display->drawString(trackName, TRACK_X, rowY + TRACK_ROW_H / 2);
+        }
     }
 
     if (maxScrollOffset > 0) {
@@ -275,7 +274,7 @@ void MP3SongList::drawTitle() {
     display->setTextColor(TFT_CYAN);
     display->setTextDatum(top_center);
 
-    String title = (trackCount > 0) ? String(trackNames[currentTrackIndex]) : String(currentAlbumName);
+    String title = (trackCount > 0) ? String(trackRows.row(currentTrackIndex)) : String(currentAlbumName);
     while (display->textWidth(title) > TITLE_MAX_WIDTH_PX && title.length() > 4) {
         title = title.substring(0, title.length() - 4) + "...";
     }
@@ -307,17 +306,14 @@ void MP3SongList::drawAlbumArtPlaceholder() {
 
 void MP3SongList::loadAlbumArt() {
     // Called from loadAlbum(), BEFORE playTrack() starts streaming -
-    // this is the important part. It holds the SPI1 bus guard for the
-    // whole SD read + JPEG decode; doing that once a track is already
-    // playing starves Core 0 long enough to kill playback outright
-    // (confirmed by testing - the previous "decode straight to screen
-    // from drawScreen()" ordering caused a total streaming failure).
-    // Decoding into artBuffer here means the later on-screen blit
-    // (blitAlbumArt(), called from drawScreen()) is pure RAM-to-TFT
-    // with zero SD/SPI1 involvement, safe regardless of what else is
-    // happening.
-    SPIBusGuard guard;
-
+    // this is the important part. A cache miss holds the SPI1 bus guard
+    // for the whole SD read + JPEG decode; doing that once a track is
+    // already playing starves Core 0 long enough to kill playback
+    // outright (confirmed by testing - the previous "decode straight to
+    // screen from drawScreen()" ordering caused a total streaming
+    // failure). A cache hit is just a PSRAM copy into artBuffer with no
+    // SD/SPI1 involvement. Either way the later on-screen blit
+    // (blitAlbumArt(), called from drawScreen()) is pure RAM-to-TFT.
     albumArtLoaded = false;
 
     if (!artBuffer) {
@@ -325,124 +321,11 @@ void MP3SongList::loadAlbumArt() {
         return;
     }
 
-    size_t artBytes = ART_SIZE * ART_SIZE * sizeof(uint16_t);
-    memset(artBuffer, 0, artBytes);
-
-    // Independent FsFile, not routed through SD_Module - same reasoning
-    // as before: SD_Module appears to use a single shared file handle
-    // for its own streaming reads, and opening art through that path
-    // stomped whatever track was playing. This runs before playback
-    // starts now, but keeping the independent handle is still correct
-    // and matches the track-scan code's own pattern.
-    extern SdFs sd;
-    char artPath[128];
-    snprintf(artPath, sizeof(artPath), "/Music/%s/folder.jpg", currentAlbumName);
-
-    FsFile artFile;
-    bool opened = artFile.open(artPath, O_RDONLY);
-    if (!opened) {
-        Serial.println("MP3SongList: No album-specific art, trying default");
-        opened = artFile.open("/Music/FolderDefault.jpg", O_RDONLY);
-    }
-
-    if (!opened) {
-        Serial.println("MP3SongList: No default art found either");
-        return;
-    }
-
-    uint8_t* buffer = new uint8_t[50000];
-    size_t totalRead = 0;
-    int bytesRead;
-    while ((bytesRead = artFile.read(buffer + totalRead, 512)) > 0) {
-        totalRead += bytesRead;
-        if (totalRead >= 50000) break;
-    }
-    artFile.close();
-
-    if (totalRead == 0) {
-        Serial.println("MP3SongList: Album art file read as empty");
-        delete[] buffer;
-        return;
-    }
-
-    uint16_t jpgW = 0, jpgH = 0;
-    if (TJpgDec.getJpgSize(&jpgW, &jpgH, buffer, totalRead) != JDR_OK || jpgW == 0 || jpgH == 0) {
-        Serial.println("MP3SongList: Failed to parse JPEG header");
-        delete[] buffer;
-        return;
-    }
-
-    // Cover art is usually bigger than the 160x160 art box (300x300,
-    // 500x500, etc. are common), and TJpg_Decoder can only downscale by
-    // powers of 2 (1/2/4/8) - so the decoded output rarely lands near
-    // 160x160, often leaving a lot of the box empty. Decode at the
-    // decoder's native output size into a small temp buffer, then do a
-    // nearest-neighbor upscale into the full art box below, preserving
-    // aspect ratio, so the box actually gets filled regardless of the
-    // source resolution.
-    uint8_t scale = 1;
-    while (scale < 8 && (jpgW / scale > ART_SIZE || jpgH / scale > ART_SIZE)) {
-        scale *= 2;
-    }
-
-    int decodedW = jpgW / scale;
-    int decodedH = jpgH / scale;
-    if (decodedW < 1) decodedW = 1;
-    if (decodedH < 1) decodedH = 1;
-
-    size_t tempBytes = (size_t)decodedW * decodedH * sizeof(uint16_t);
-    uint16_t* tempBuffer = (uint16_t*)heap_caps_malloc(tempBytes, MALLOC_CAP_SPIRAM);
-    if (!tempBuffer) tempBuffer = (uint16_t*)malloc(tempBytes);
-    if (!tempBuffer) {
-        Serial.println("MP3SongList: Temp art buffer alloc failed, skipping art");
-        delete[] buffer;
-        return;
-    }
-    memset(tempBuffer, 0, tempBytes);
-
-    TJpgDec.setJpgScale(scale);
-    TJpgDec.setSwapBytes(true);
-    TJpgDec.setCallback(tftOutput_SongList_ToBuffer);
-
-    artDecodeTarget = tempBuffer;
-    artDecodeCanvasW = decodedW;
-    artDecodeCanvasH = decodedH;
-
-    TJpgDec.drawJpg(0, 0, buffer, totalRead);
-
-    artDecodeTarget = nullptr;
-    delete[] buffer;
-
-    // Nearest-neighbor upscale from tempBuffer (decodedW x decodedH)
-    // into artBuffer (ART_SIZE x ART_SIZE) - scale to fill as much of
-    // the box as possible while preserving aspect ratio, then center.
-    float scaleToFitW = ART_SIZE / (float)decodedW;
-    float scaleToFitH = ART_SIZE / (float)decodedH;
-    float scaleToFit = (scaleToFitW < scaleToFitH) ? scaleToFitW : scaleToFitH;
-
-    int targetW = (int)(decodedW * scaleToFit);
-    int targetH = (int)(decodedH * scaleToFit);
-    if (targetW > ART_SIZE) targetW = ART_SIZE;
-    if (targetH > ART_SIZE) targetH = ART_SIZE;
-    if (targetW < 1) targetW = 1;
-    if (targetH < 1) targetH = 1;
-
-    int offsetX = (ART_SIZE - targetW) / 2;
-    int offsetY = (ART_SIZE - targetH) / 2;
-
-    for (int y = 0; y < targetH; y++) {
-        int srcY = (int)(y / scaleToFit);
-        if (srcY >= decodedH) srcY = decodedH - 1;
-
-        for (int x = 0; x < targetW; x++) {
-            int srcX = (int)(x / scaleToFit);
-            if (srcX >= decodedW) srcX = decodedW - 1;
-            artBuffer[(offsetY + y) * ART_SIZE + (offsetX + x)] = tempBuffer[srcY * decodedW + srcX];
-        }
-    }
+    albumArtLoaded = AlbumArtCache::getInstance().load(currentAlbumName, artBuffer, ART_SIZE, ART_SIZE);
+}
 
-    heap_caps_free(tempBuffer);
-    albumArtLoaded = true;
+void MP3SongList::prefetchAlbumArt(const char* const* albumNames, int count) {
+    AlbumArtPrefetcher::getInstance().request(albumNames, count, ART_SIZE, ART_SIZE);
 }
 
 void MP3SongList::blitAlbumArt() {
@@ -476,8 +359,10 @@ void MP3SongList::drawScreen() {
     // Album art - artBuffer was already decoded back in loadAlbum(),
     // before playback started. This is just a fast blit.
     blitAlbumArt();
+    spectrum.draw(tft);
 
     drawTrackListArea();
+    progressBar.draw(tft);
 
     display->setFont(&fonts::Font0);
     display->setTextSize(1);
@@ -494,22 +379,20 @@ void MP3SongList::drawScreen() {
 }
 
 void MP3SongList::update() {
-    // Auto-advance dispatch now happens centrally through
-    // ScreenManager::handleSongEnd() (called from main.cpp's loop() via
-    // MP3Player::consumeNaturalEnd(), a one-shot signal) - see
-    // advanceToNextTrack() below. Polling consumeNaturalEnd() here too
-    // would just lose the race to loop(), which always runs first.
-}
-
-void MP3SongList::advanceToNextTrack() {
-    if (!isPlaying || trackCount == 0) return;
-
-    int nextIndex = currentTrackIndex + 1;
-    if (nextIndex >= trackCount) nextIndex = 0;
+    // Auto-advance happens in Playlist (ScreenManager::handleSongEnd(),
+    // or a gapless chain reported through loop()); this just notices the
+    // track changed and redraws the now-playing parts.
+    Playlist& playlist = Playlist::getInstance();
+    if (playlist.changeCount() != playlistChanges) {
+        playlistChanges = playlist.changeCount();
+        if (playlist.current() >= 0 && playlist.current() < trackCount) {
+            currentTrackIndex = playlist.current();
+            updateNowPlaying();
+        }
+    }
 
-    Serial.println("MP3SongList: Track ended, auto-advancing");
-    playTrack(nextIndex);
-    updateNowPlaying();
+    spectrum.update(tft, audioModule, isPlaying);
+    progressBar.update(tft, PlaybackPosition::getInstance().read());
 }
 
 void MP3SongList::handleTouch(int x, int y) {
@@ -523,12 +406,8 @@ void MP3SongList::handleTouch(int x, int y) {
     }
 
     if (prevButton.hit(x, y)) {
-        if (trackCount > 0) {
-            int newIndex = currentTrackIndex - 1;
-            if (newIndex < 0) newIndex = trackCount - 1;
-            playTrack(newIndex);
-            updateNowPlaying();
-        }
+        // Now-playing redraw follows in update()
+        if (trackCount > 0) Playlist::getInstance().previous();
         return;
     }
 
@@ -546,18 +425,13 @@ void MP3SongList::handleTouch(int x, int y) {
     }
 
     if (nextButton.hit(x, y)) {
-        if (trackCount > 0) {
-            int newIndex = currentTrackIndex + 1;
-            if (newIndex >= trackCount) newIndex = 0;
-            playTrack(newIndex);
-            updateNowPlaying();
-        }
+        if (trackCount > 0) Playlist::getInstance().next();
         return;
     }
 
     if (volumeSlider.handleTouch(x, y)) {
         int volume = volumeSlider.getValue();
-        audioModule.setVolume(volume);
+        mp3Player.setVolume(volume);
         volumeSlider.draw(tft);
         return;
     }
@@ -583,7 +457,7 @@ void MP3SongList::handleTouch(int x, int y) {
         int trackIndex = scrollOffset + rowIndex;
 
         if (trackIndex < trackCount) {
-            Serial.printf("MP3SongList: Row tapped -> '%s'\n", trackNames[trackIndex]);
+            Serial.printf("MP3SongList: Row tapped -> '%s'\n", trackRows.row(trackIndex));
             playTrack(trackIndex);
             updateNowPlaying();
         }
@@ -8,6 +8,10 @@
 #include "../managers/BaseScreen.h"
 #include "../ui/UIButton.h"
 #include "../ui/UISlider.h"
+#include "../ui/SpectrumVisualizer.h"
+#include "../ui/UIProgressBar.h"
+#include "../ui/ListWindow.h"
+#include "../utils/LibraryLists.h"
 
 class ScreenManager;
 class TFT_Module;
@@ -23,19 +27,19 @@ public:
     void handleTouch(int x, int y) override;
 
     // Called by MP3AlbumList right before navigating here, so this
-    // screen knows which album's tracks to load.
-    void loadAlbum(const char* albumName);
+    // screen knows which album's tracks to load. Playback starts at
+    // startFile (SearchScreen's track results) if given, else track 1.
+    void loadAlbum(const char* albumName, const char* startFile = nullptr);
 
-    // Called by ScreenManager::handleSongEnd() when the current track
-    // finishes naturally (main.cpp's loop() owns detecting that via
-    // MP3Player::consumeNaturalEnd() - it's a one-shot signal, so
-    // exactly one consumer gets it, and ScreenManager::handleSongEnd()
-    // is that single dispatch point for every screen, not just this one).
-    void advanceToNextTrack();
+    // Queue background decodes (AlbumArtPrefetcher) of these albums'
+    // covers at this screen's art size, so loadAlbum() finds them in
+    // AlbumArtCache. MP3AlbumList calls this for each page it shows.
+    static void prefetchAlbumArt(const char* const* albumNames, int count);
 
 private:
-    static const int MAX_TRACKS = 100;       // matches the old MP3Screen's cap
     static const int VISIBLE_TRACK_ROWS = 12;
+    // trackScrollSlider's raw range; maps proportionally onto any album
+    static const int SCROLL_SLIDER_RANGE = 88;
 
     void drawScreen();             // full redraw - only called from begin()
     void updateNowPlaying();       // partial redraw for track changes - title + track list only, does NOT touch album art
@@ -44,30 +48,32 @@ private:
     void updateScrollOffsetFromSlider();
     void playTrack(int index);
 
-    // Art loading is split in two on purpose. loadAlbumArt() reads +
-    // decodes from SD into artBuffer (RAM) and MUST be called before
-    // playback starts - it holds the SPI1 bus guard for the whole
-    // decode, which is long enough to starve Core 0's audio streaming
-    // if a track is already playing. blitAlbumArt() just pushes the
-    // already-decoded buffer to the TFT (a different SPI bus, no SPI1
-    // contention at all) and is safe to call any time, including from
-    // drawScreen() after playback has started.
-    void loadAlbumArt();           // SD read + JPEG decode -> artBuffer. Call BEFORE playTrack().
+    // Art loading is split in two on purpose. loadAlbumArt() fills
+    // artBuffer (RAM) through AlbumArtCache and MUST be called before
+    // playback starts - on a cache miss it holds the SPI1 bus guard for
+    // the whole SD read + decode, which is long enough to starve Core
+    // 0's audio streaming if a track is already playing. blitAlbumArt()
+    // just pushes the already-decoded buffer to the TFT (a different SPI
+    // bus, no SPI1 contention at all) and is safe to call any time,
+    // including from drawScreen() after playback has started.
+    void loadAlbumArt();           // AlbumArtCache hit, or SD read + JPEG decode -> artBuffer. Call BEFORE playTrack().
     void blitAlbumArt();           // artBuffer -> TFT. Cheap, no SD/SPI1 involvement.
     void drawAlbumArtPlaceholder();
 
-    char currentAlbumName[64];
-    char trackNames[MAX_TRACKS][64];
+    char currentAlbumName[256];
+    TrackListModel trackModel;  // the album's tracks in LibraryIndex
+    ListWindow trackRows;       // paged view of trackModel for drawing
     int trackCount;
 
     int scrollOffset;
     int maxScrollOffset;    // real, per-album usable scroll range (trackCount - VISIBLE_TRACK_ROWS)
     int sliderMaxValue;     // fixed at construction, the slider's own worst-case range
-    int currentTrackIndex;  // index of the track actually playing (or about to play)
+    int currentTrackIndex;  // mirrors Playlist::current() - the track playing (or about to)
+    uint32_t playlistChanges;   // last Playlist::changeCount() drawn
     bool isPlaying;
     bool albumArtLoaded;    // true if artBuffer currently holds a valid decoded image for currentAlbumName
 
-    uint16_t* artBuffer;    // ART_SIZE x ART_SIZE RGB565, allocated once (prefers PSRAM), reused/overwritten per album
+    uint16_t* artBuffer;    // ART_SIZE x ART_SIZE RGB565, allocated once (prefers PSRAM), filled from AlbumArtCache per album
 
     SD_Module& sdModule;
     VS1053_Module& audioModule;
@@ -78,6 +84,8 @@ private:
     UIButton nextButton;
     UISlider volumeSlider;
     UISlider trackScrollSlider;
+    SpectrumVisualizer spectrum;   // under the album art
+    UIProgressBar progressBar;     // under the track list, with elapsed/total
 };
 
 #endif // MP3_SONG_LIST_H
@@ -0,0 +1,244 @@
+// =====================================================================
+//  SearchScreen.cpp - Library search screen
+//  Query font: default (Font0), size 2
+//  Row font:   FreeSerif9pt7b
+// =====================================================================
+
+#include "SearchScreen.h"
+#include "MP3SongList.h"
+#include "../managers/ScreenManager.h"
+#include "../utils/TFT_Module.h"
+#include "../utils/LibraryIndex.h"
+#include "../ui/GlyphAtlas.h"
+#include <LovyanGFX.hpp>
+#include <lgfx/v1/lgfx_fonts.hpp>
+
+#define QUERY_X       100
+#define QUERY_Y       10
+#define QUERY_W       370
+#define QUERY_H       40
+
+#define ROW_MARGIN_X  20
+#define ROW_WIDTH     440
+#define ROW_START_Y   56
+#define ROW_HEIGHT    29
+
+#define KEYBOARD_Y    (320 - UIKeyboard::HEIGHT)
+
+SearchScreen::SearchScreen(ScreenManager& manager, TFT_Module& tftModule)
+    : BaseScreen(manager, tftModule),
+      resultCount(0),
+      keyboardVisible(true),
+      shownDocuments(0),
+      shownGeneration(0),
+      lastRefreshMs(0),
+      backButton(10, 10, 80, 40, "Back"),
+      keyboard(KEYBOARD_Y)
+{
+    query[0] = '\0';
+    backButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
+}
+
+int SearchScreen::visibleRows() const {
+    int bottom = keyboardVisible ? KEYBOARD_Y : 320;
+    int rows = (bottom - ROW_START_Y) / ROW_HEIGHT;
+    return rows < MAX_SHOWN ? rows : MAX_SHOWN;
+}
+
+void SearchScreen::begin() {
+    // The last query is kept - coming back from the song list shows
+    // the same results again.
+    keyboardVisible = true;
+
+    auto display = tft.getTFT();
+    display->fillScreen(TFT_BLACK);
+    backButton.draw(tft);
+
+    runSearch();
+    drawQuery();
+    drawResults();
+    keyboard.draw(tft);
+}
+
+void SearchScreen::runSearch() {
+    SearchIndex& index = SearchIndex::getInstance();
+    shownDocuments = index.documentCount();
+    shownGeneration = LibraryIndex::getInstance().generation();
+    lastRefreshMs = millis();
+
+    if (!query[0]) {
+        resultCount = 0;
+        return;
+    }
+
+    uint32_t start = micros();
+    resultCount = index.search(query, results, MAX_SHOWN);
+    uint32_t elapsed = micros() - start;
+
+    Serial.printf("Search: %s '%s' -> %d results in %lu us (%d documents)\n",
+                  elapsed <= SearchIndex::SEARCH_TARGET_US ? "✓" : "✗",
+                  query, resultCount, (unsigned long)elapsed, shownDocuments);
+}
+
+void SearchScreen::drawQuery() {
+    auto display = tft.getTFT();
+    GlyphAtlas& atlas = GlyphAtlas::getInstance();
+
+    display->fillRoundRect(QUERY_X, QUERY_Y, QUERY_W, QUERY_H, 8, TFT_BLACK);
+    display->drawRoundRect(QUERY_X, QUERY_Y, QUERY_W, QUERY_H, 8, TFT_WHITE);
+
+    // Empty query: say how much there is to search (and whether the
+    // background scan is still going) in place of the text.
+    char text[64];
+    uint32_t color = TFT_WHITE;
+    if (query[0]) {
+        snprintf(text, sizeof(text), "%s_", query);
+    } else {
+        LibraryIndex& library = LibraryIndex::getInstance();
+        snprintf(text, sizeof(text), library.isComplete() ? "Search %d tracks" : "Indexing... %d tracks",
+                 library.trackCount());
+        color = TFT_DARKGREY;
+    }
+
+    display->setFont(&fonts::Font0);
+    display->setTextSize(2);
+    display->setTextColor(color);
+    display->setTextDatum(middle_left);
+    if (!atlas.drawString(display, UIFont::Mono2, text, QUERY_X + 10, QUERY_Y + QUERY_H / 2,
+                          middle_left, color, TFT_BLACK)) {
+        display->drawString(text, QUERY_X + 10, QUERY_Y + QUERY_H / 2);
+    }
+}
+
+void SearchScreen::drawResults() {
+    auto display = tft.getTFT();
+    GlyphAtlas& atlas = GlyphAtlas::getInstance();
+    LibraryIndex& library = LibraryIndex::getInstance();
+
+    int rows = visibleRows();
+    display->fillRect(0, ROW_START_Y, 480, rows * ROW_HEIGHT, TFT_BLACK);
+
+    display->setFont(&fonts::FreeSerif9pt7b);
+    display->setTextSize(1, 1);
+    display->setTextDatum(middle_left);
+
+    if (query[0] && resultCount == 0) {
+        display->setTextColor(TFT_DARKGREY);
+        if (!atlas.drawString(display, UIFont::Serif9, "No matches", ROW_MARGIN_X + 12,
+                              ROW_START_Y + ROW_HEIGHT / 2, middle_left, TFT_DARKGREY, TFT_BLACK)) {
+            display->drawString("No matches", ROW_MARGIN_X + 12, ROW_START_Y + ROW_HEIGHT / 2);
+        }
+    }
+
+    for (int i = 0; i < rows && i < resultCount; i++) {
+        const SearchResult& r = results[i];
+        int rowY = ROW_START_Y + i * ROW_HEIGHT + ROW_HEIGHT / 2;
+
+        // Albums in cyan, tracks as "title - artist" in white
+        String line;
+        uint32_t color;
+        if (r.kind == SearchResult::Album) {
+            line = String("Album: ") + library.albumName(r.id);
+            color = TFT_CYAN;
+        } else {
+            line = library.trackTitle(r.id);
+            const char* artist = library.trackArtist(r.id);
+            if (artist[0]) line += String(" - ") + artist;
+            color = TFT_WHITE;
+        }
+        if (line.length() > 55) {
+            line = line.substring(0, 52) + "...";
+        }
+
+        display->setTextColor(color);
+        if (!atlas.drawString(display, UIFont::Serif9, line.c_str(), ROW_MARGIN_X + 12, rowY,
+                              middle_left, color, TFT_BLACK)) {
+            display->drawString(line, ROW_MARGIN_X + 12, rowY);
+        }
+    }
+
+    // Same reset as MP3AlbumList - setFont() state outlives the screen
+    display->setFont(&fonts::Font0);
+}
+
+void SearchScreen::update() {
+    // While LibraryIndex is still scanning, fold newly indexed albums
+    // and tracks into what's on screen - at most once a second, and
+    // only when something actually changed.
+    if (millis() - lastRefreshMs < REFRESH_MS) return;
+    lastRefreshMs = millis();
+
+    if (SearchIndex::getInstance().documentCount() == shownDocuments &&
+        LibraryIndex::getInstance().generation() == shownGeneration) {
+        return;
+    }
+
+    runSearch();
+    drawQuery();
+    if (query[0]) drawResults();
+}
+
+void SearchScreen::openResult(const SearchResult& result) {
+    LibraryIndex& library = LibraryIndex::getInstance();
+    MP3SongList* songList = screenManager.getSongListScreen();
+
+    if (result.kind == SearchResult::Album) {
+        Serial.printf("SearchScreen: Album '%s'\n", library.albumName(result.id));
+        songList->loadAlbum(library.albumName(result.id));
+    } else {
+        const char* album = library.albumName(library.trackAlbum(result.id));
+        Serial.printf("SearchScreen: Track '%s' on '%s'\n", library.trackFile(result.id), album);
+        songList->loadAlbum(album, library.trackFile(result.id));
+    }
+    screenManager.showSongList();
+}
+
+void SearchScreen::handleTouch(int x, int y) {
+    if (backButton.hit(x, y)) {
+        Serial.println("SearchScreen: Back pressed");
+        screenManager.showAlbumList();
+        return;
+    }
+
+    if (x >= QUERY_X && x < QUERY_X + QUERY_W && y >= QUERY_Y && y < QUERY_Y + QUERY_H) {
+        if (!keyboardVisible) {
+            keyboardVisible = true;
+            drawResults();
+            keyboard.draw(tft);
+        }
+        return;
+    }
+
+    if (keyboardVisible && y >= keyboard.top()) {
+        char key = keyboard.hit(x, y);
+        if (!key) return;
+
+        if (key == UIKeyboard::KEY_HIDE) {
+            keyboardVisible = false;
+            drawResults();
+            return;
+        }
+
+        size_t len = strlen(query);
+        if (key == UIKeyboard::KEY_DELETE) {
+            if (len == 0) return;
+            query[len - 1] = '\0';
+        } else {
+            if (len >= MAX_QUERY) return;
+            query[len] = key;
+            query[len + 1] = '\0';
+        }
+
+        runSearch();
+        drawQuery();
+        drawResults();
+        return;
+    }
+
+    if (y >= ROW_START_Y) {
+        int row = (y - ROW_START_Y) / ROW_HEIGHT;
+        if (row < visibleRows() && row < resultCount) {
+            openResult(results[row]);
+        }
+    }
+}
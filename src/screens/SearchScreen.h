@@ -0,0 +1,59 @@
+// =====================================================================
+//  SearchScreen.h - Type-ahead search over the whole library
+//
+//  Query field on top, results under it, UIKeyboard at the bottom.
+//  Every key press re-runs SearchIndex::search() and redraws just the
+//  query and the result rows. Hide folds the keyboard away to show more
+//  results; tapping the query field brings it back.
+//
+//  Tapping an album opens it on MP3SongList; tapping a track opens its
+//  album there, playing from that track. While LibraryIndex is still
+//  scanning, update() re-runs the query as new documents arrive.
+// =====================================================================
+
+#ifndef SEARCH_SCREEN_H
+#define SEARCH_SCREEN_H
+
+#include "../managers/BaseScreen.h"
+#include "../ui/UIButton.h"
+#include "../ui/UIKeyboard.h"
+#include "../utils/SearchIndex.h"
+
+class ScreenManager;
+class TFT_Module;
+
+class SearchScreen : public BaseScreen {
+public:
+    SearchScreen(ScreenManager& manager, TFT_Module& tft);
+
+    void begin() override;
+    void update() override;
+    void handleTouch(int x, int y) override;
+
+private:
+    static const int MAX_QUERY = 40;
+    static const int MAX_SHOWN = 9;         // rows with the keyboard hidden
+    static const unsigned long REFRESH_MS = 1000;
+
+    void drawQuery();
+    void drawResults();
+    void runSearch();
+    void openResult(const SearchResult& result);
+    int visibleRows() const;
+
+    char query[MAX_QUERY + 1];
+    SearchResult results[MAX_SHOWN];
+    int resultCount;
+    bool keyboardVisible;
+
+    // What the shown results were computed from, so update() knows
+    // when the index has moved on.
+    int shownDocuments;
+    uint32_t shownGeneration;
+    unsigned long lastRefreshMs;
+
+    UIButton backButton;
+    UIKeyboard keyboard;
+};
+
+#endif // SEARCH_SCREEN_H
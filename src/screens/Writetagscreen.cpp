@@ -5,8 +5,8 @@
 #include "WriteTagScreen.h"
 #include "../managers/ScreenManager.h"
 #include "../utils/TFT_Module.h"
+#include "../utils/LibraryIndex.h"
 #include <LovyanGFX.hpp>
-#include <SdFat.h>
 
 #define LIST_X 40
 #define LIST_Y 80
@@ -14,17 +14,19 @@
 #define LIST_H 200
 #define ITEM_HEIGHT 25
 
-WriteTagScreen::WriteTagScreen(ScreenManager& manager, TFT_Module& tftModule, SD_Module& sd,PN532_Module& nfc)
+WriteTagScreen::WriteTagScreen(ScreenManager& manager, TFT_Module& tftModule, SD_Module& sd,NfcSession& nfc)
     : BaseScreen(manager, tftModule),
       sdModule(sd),
       nfcModule(nfc),
       backButton(10, 10, 80, 40, "Back"),
+      albumRows(&albumModel),
       albumCount(0),
       selectedAlbum(-1),
       scrollOffset(0),
       currentState(SELECTING_ALBUM)
 {
     backButton.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
+    selectedName[0] = '\0';
 }
 
 void WriteTagScreen::begin() {
@@ -39,48 +41,15 @@ void WriteTagScreen::begin() {
     
     backButton.draw(tft);
     
-    // Load albums from SD
-    loadAlbumsFromSD();
-    
     currentState = SELECTING_ALBUM;
     drawAlbumList();
 }
 
-void WriteTagScreen::loadAlbumsFromSD() {
-    albumCount = 0;
-    
-    extern SdFs sd;
-    FsFile root;
-    if (!root.open("/Music")) {
-        Serial.println("WriteTag: Failed to open /Music");
-        return;
-    }
-    
-    FsFile dir;
-    while (dir.openNext(&root, O_RDONLY) && albumCount < 50) {
-        if (dir.isDirectory()) {
-            char name[64];
-            dir.getName(name, sizeof(name));
-            
-            // Skip system directories
-            if (name[0] == '.' || strcmp(name, "System Volume Information") == 0) {
-                dir.close();
-                continue;
-            }
-            
-            strncpy(albumNames[albumCount], name, sizeof(albumNames[0]) - 1);
-            albumNames[albumCount][sizeof(albumNames[0]) - 1] = '\0';
-            albumCount++;
-        }
-        dir.close();
-    }
-    root.close();
-    
-    Serial.printf("WriteTag: Loaded %d albums\n", albumCount);
-}
-
 void WriteTagScreen::drawAlbumList() {
     auto display = tft.getTFT();
+
+    // Albums come from LibraryIndex, which may still be scanning
+    albumCount = albumRows.count();
     
     // Clear list area
     display->fillRect(LIST_X, LIST_Y, LIST_W, LIST_H, TFT_BLACK);
@@ -108,7 +77,7 @@ void WriteTagScreen::drawAlbumList() {
         // Draw album name
         display->setTextColor(TFT_WHITE);
         display->setTextDatum(top_left);
-        display->drawString(albumNames[index], LIST_X + 10, yPos);
+        display->drawString(albumRows.row(index), LIST_X + 10, yPos);
     }
     
     // Draw scroll arrows (right side with spacing)
@@ -133,11 +102,35 @@ void WriteTagScreen::selectAlbum(int index) {
     if (index < 0 || index >= albumCount) return;
     
     selectedAlbum = index;
-    Serial.printf("WriteTag: Selected '%s'\n", albumNames[index]);
-    
+    LibraryIndex& library = LibraryIndex::getInstance();
+    strncpy(selectedName, library.albumName(library.albumAt(index)), sizeof(selectedName) - 1);
+    selectedName[sizeof(selectedName) - 1] = '\0';
+    Serial.printf("WriteTag: Selected '%s'\n", selectedName);
+
+    auto display = tft.getTFT();
+
+    // Checked before asking for a tag - a name that doesn't fit is
+    // refused, never written cut short
+    uint8_t area[NfcSession::NDEF_AREA_BYTES];
+    if (!NfcSession::encodeAlbumTag(selectedName, 0, false, area)) {
+        display->fillRect(0, 100, 480, 150, TFT_BLACK);
+        display->setTextSize(2);
+        display->setTextDatum(middle_center);
+        display->setTextColor(TFT_RED);
+        display->drawString("Name too long for a tag", 240, 150);
+        display->setTextSize(1);
+        display->setTextColor(TFT_WHITE);
+        display->drawString("Shorten the folder name (39 bytes max)", 240, 180);
+
+        Serial.printf("WriteTag: '%s' doesn't fit on a tag\n", selectedName);
+        delay(2000);
+        selectedAlbum = -1;
+        begin();
+        return;
+    }
+
     currentState = WAITING_FOR_TAG;
     
-    auto display = tft.getTFT();
     display->fillScreen(TFT_BLACK);
     
     // Title
@@ -160,7 +153,7 @@ void WriteTagScreen::selectAlbum(int index) {
     display->setTextColor(TFT_YELLOW);
     display->drawString("Writing:", 240, 200);
     display->setTextSize(2);
-    display->drawString(albumNames[selectedAlbum], 240, 220);
+    display->drawString(selectedName, 240, 220);
 }
 
 void WriteTagScreen::update() {
@@ -186,7 +179,7 @@ void WriteTagScreen::writeTag() {
     display->drawString("Writing tag...", 240, 150);
     
     // Write the tag
-    if (nfcModule.writeAlbumTag(albumNames[selectedAlbum])) {
+    if (nfcModule.writeAlbumTag(selectedName)) {
         currentState = SUCCESS;
         display->fillRect(0, 100, 480, 150, TFT_BLACK);
         display->setTextColor(TFT_GREEN);
@@ -195,12 +188,12 @@ void WriteTagScreen::writeTag() {
         display->setTextColor(TFT_WHITE);
         display->drawString("Tag written for:", 240, 160);
         display->setTextSize(2);
-        display->drawString(albumNames[selectedAlbum], 240, 180);
+        display->drawString(selectedName, 240, 180);
         display->setTextSize(1);
         display->setTextColor(TFT_CYAN);
         display->drawString("Remove tag and press Back", 240, 250);
         
-        Serial.printf("WriteTag: Success - '%s'\n", albumNames[selectedAlbum]);
+        Serial.printf("WriteTag: Success - '%s'\n", selectedName);
     } else {
         currentState = ERROR;
         display->fillRect(0, 100, 480, 150, TFT_BLACK);
@@ -241,7 +234,7 @@ void WriteTagScreen::handleTouch(int x, int y) {
             if (y >= LIST_Y && y < LIST_Y + 50 && scrollOffset > 0) {
                 scrollOffset--;
                 drawAlbumList();
-            } else if (y > LIST_Y + LIST_H - 50 && y <= LIST_Y + LIST_H && scrollOffset < albumCount - 8) {
+            } else if (y > LIST_Y + LIST_H - 50 && y <= LIST_Y + LIST_H && scrollOffset < albumCount - LIST_H / ITEM_HEIGHT) {
                 scrollOffset++;
                 drawAlbumList();
             }
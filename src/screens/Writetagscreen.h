@@ -8,34 +8,36 @@
 #include "../managers/BaseScreen.h"
 #include "../ui/UIButton.h"
 #include "../utils/SD_Module.h"
-#include "../utils/PN532_Module.h"
+#include "../utils/NfcSession.h"
+#include "../utils/LibraryLists.h"
 
 class ScreenManager;
 class TFT_Module;
 
 class WriteTagScreen : public BaseScreen {
 public:
-    WriteTagScreen(ScreenManager& manager, TFT_Module& tft, SD_Module& sd,  PN532_Module& nfc);
+    WriteTagScreen(ScreenManager& manager, TFT_Module& tft, SD_Module& sd,  NfcSession& nfc);
     
     void begin() override;
     void update() override;
     void handleTouch(int x, int y) override;
 
 private:
-    void loadAlbumsFromSD();
     void drawAlbumList();
     void selectAlbum(int index);
     void waitForTag();
     void writeTag();
     
     SD_Module& sdModule;
-    PN532_Module&  nfcModule;
+    NfcSession&  nfcModule;
     
     UIButton backButton;
     
-    char albumNames[50][64];
-    int albumCount;
+    AlbumListModel albumModel;
+    ListWindow albumRows;
+    int albumCount;             // albumModel.count() when the list was drawn
     int selectedAlbum;
+    char selectedName[256];     // full folder name - what goes on the tag
     int scrollOffset;
     
     enum State {
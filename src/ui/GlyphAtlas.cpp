@@ -0,0 +1,277 @@
+// =====================================================================
+//  GlyphAtlas.cpp - Pre-rasterized glyph cache implementation
+// =====================================================================
+
+#include "GlyphAtlas.h"
+#include <lgfx/v1/lgfx_fonts.hpp>
+#include <esp_heap_caps.h>
+
+// What each UIFont entry is rasterized from. Font0 is a pixel font, so
+// it's captured 1:1 (anti-aliasing an integer-scaled bitmap font only
+// blurs it). FreeSerif9pt7b is taken from the 18pt outline rendered at
+// 2x and box-filtered down 2x2 - that gives real fractional edge
+// coverage at roughly the same metrics as the 9pt font, instead of the
+// hard 1-bit edges the 9pt bitmap has.
+struct AtlasSpec {
+    const lgfx::IFont* font;
+    float size;
+    int supersample;
+};
+
+static const AtlasSpec ATLAS_SPECS[(int)UIFont::COUNT] = {
+    { &fonts::Font0,           1, 1 },   // Mono1
+    { &fonts::Font0,           2, 1 },   // Mono2
+    { &fonts::Font0,           3, 1 },   // Mono3
+    { &fonts::FreeSerif18pt7b, 1, 2 },   // Serif9
+};
+
+// Prefer PSRAM (same as MP3SongList's art buffer), fall back to
+// internal RAM if it isn't there for some reason.
+static void* allocPreferPsram(size_t bytes) {
+    void* p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (!p) p = malloc(bytes);
+    return p;
+}
+
+static uint16_t blend565(uint16_t bg, uint16_t fg, int cov, int levels) {
+    int r = ((bg >> 11) & 0x1F) + ((((fg >> 11) & 0x1F) - ((bg >> 11) & 0x1F)) * cov) / levels;
+    int g = ((bg >> 5) & 0x3F)  + ((((fg >> 5) & 0x3F)  - ((bg >> 5) & 0x3F))  * cov) / levels;
+    int b = (bg & 0x1F)         + (((fg & 0x1F)         - (bg & 0x1F))         * cov) / levels;
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+GlyphAtlas& GlyphAtlas::getInstance() {
+    static GlyphAtlas instance;
+    return instance;
+}
+
+GlyphAtlas::GlyphAtlas()
+    : strip(nullptr), stripHeight(0), ready(false)
+{
+    memset(atlases, 0, sizeof(atlases));
+}
+
+bool GlyphAtlas::begin() {
+    if (ready) return true;
+
+    unsigned long t0 = millis();
+    int tallest = 0;
+
+    for (int i = 0; i < (int)UIFont::COUNT; i++) {
+        const AtlasSpec& spec = ATLAS_SPECS[i];
+        if (!buildAtlas(atlases[i], spec.font, spec.size, spec.supersample)) {
+            Serial.printf("GlyphAtlas: ✗ Failed to build atlas %d\n", i);
+            freeAtlases();
+            return false;
+        }
+        if (atlases[i].height > tallest) tallest = atlases[i].height;
+    }
+
+    // One strip shared by every drawString() call: coverage bytes are
+    // composed first (so overlapping glyph ink takes the max rather than
+    // the last glyph drawn), then expanded to RGB565 in the same buffer
+    // layout pushImage() wants.
+    stripHeight = tallest;
+    strip = (uint16_t*)allocPreferPsram((size_t)STRIP_MAX_W * stripHeight * (sizeof(uint16_t) + 1));
+    if (!strip) {
+        Serial.println("GlyphAtlas: ✗ Strip buffer alloc failed");
+        freeAtlases();
+        return false;
+    }
+
+    ready = true;
+    Serial.printf("GlyphAtlas: ✓ %d atlases built in %lu ms\n",
+                  (int)UIFont::COUNT, millis() - t0);
+    return true;
+}
+
+void GlyphAtlas::freeAtlases() {
+    // Without ready, drawString() callers fall back to LovyanGFX text -
+    // nothing keeps using a half-built set, so don't leave it allocated.
+    for (int i = 0; i < (int)UIFont::COUNT; i++) {
+        free(atlases[i].coverage);
+        atlases[i].coverage = nullptr;
+    }
+}
+
+bool GlyphAtlas::buildAtlas(Atlas& atlas, const lgfx::IFont* font, float size, int supersample) {
+    lgfx::LGFX_Sprite cell;
+    cell.setColorDepth(8);
+    cell.setPsram(false);
+    cell.setFont(font);
+    cell.setTextSize(size);
+    cell.setTextDatum(lgfx::top_left);
+
+    const int ss = supersample;
+    const int srcH = cell.fontHeight();
+
+    int maxAdvance = 0;
+    char str[2] = { 0, 0 };
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+        str[0] = (char)c;
+        int adv = cell.textWidth(str);
+        if (adv > maxAdvance) maxAdvance = adv;
+    }
+
+    // Pad on both sides so left-bearing/overhang ink isn't clipped; keep
+    // the pad a multiple of the supersample so the pen lands exactly on
+    // a downsampled column.
+    const int pad = 4 * ss;
+    const int srcW = maxAdvance + 2 * pad;
+    const int dstW = (srcW + ss - 1) / ss;
+    const int dstH = (srcH + ss - 1) / ss;
+
+    if (!cell.createSprite(srcW, srcH)) {
+        return false;
+    }
+
+    uint8_t* scratch = (uint8_t*)malloc((size_t)dstW * dstH);
+    atlas.coverage = (uint8_t*)allocPreferPsram((size_t)GLYPH_COUNT * dstW * dstH);
+    if (!scratch || !atlas.coverage) {
+        free(scratch);
+        free(atlas.coverage);
+        atlas.coverage = nullptr;
+        cell.deleteSprite();
+        return false;
+    }
+
+    atlas.height = dstH;
+    atlas.levels = ss * ss;
+    cell.setTextColor(TFT_WHITE);
+
+    uint32_t offset = 0;
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+        str[0] = (char)c;
+        cell.fillScreen(0);
+        cell.drawString(str, pad, 0);
+
+        // Box-filter ss x ss source pixels into one coverage value.
+        int inkMin = dstW, inkMax = -1;
+        for (int dy = 0; dy < dstH; dy++) {
+            for (int dx = 0; dx < dstW; dx++) {
+                uint8_t cov = 0;
+                for (int sy = dy * ss; sy < dy * ss + ss && sy < srcH; sy++) {
+                    for (int sx = dx * ss; sx < dx * ss + ss && sx < srcW; sx++) {
+                        if (cell.readPixelValue(sx, sy)) cov++;
+                    }
+                }
+                scratch[dy * dstW + dx] = cov;
+                if (cov) {
+                    if (dx < inkMin) inkMin = dx;
+                    if (dx > inkMax) inkMax = dx;
+                }
+            }
+        }
+
+        Glyph& g = atlas.glyphs[c - FIRST_CHAR];
+        g.offset = offset;
+        g.advance = (uint8_t)((cell.textWidth(str) + ss / 2) / ss);
+
+        if (inkMax < 0) {   // blank glyph (space)
+            g.width = 0;
+            g.xOffset = 0;
+            continue;
+        }
+
+        g.width = (uint8_t)(inkMax - inkMin + 1);
+        g.xOffset = (int8_t)(inkMin - pad / ss);
+        for (int row = 0; row < dstH; row++) {
+            memcpy(&atlas.coverage[offset + row * g.width], &scratch[row * dstW + inkMin], g.width);
+        }
+        offset += (uint32_t)g.width * dstH;
+    }
+
+    free(scratch);
+    cell.deleteSprite();
+    return true;
+}
+
+int GlyphAtlas::textWidth(UIFont font, const char* text) const {
+    if (!ready || !text) return -1;
+    const Atlas& atlas = atlases[(int)font];
+
+    int width = 0;
+    for (const char* p = text; *p; p++) {
+        if (*p < FIRST_CHAR || *p > LAST_CHAR) return -1;
+        width += atlas.glyphs[*p - FIRST_CHAR].advance;
+    }
+    return width;
+}
+
+int GlyphAtlas::fontHeight(UIFont font) const {
+    return ready ? atlases[(int)font].height : 0;
+}
+
+bool GlyphAtlas::drawString(lgfx::LGFX_Device* display, UIFont font, const char* text,
+                            int x, int y, lgfx::textdatum_t datum,
+                            uint16_t fg, uint16_t bg) {
+    if (!ready || !display || !text || !*text) return false;
+    const Atlas& atlas = atlases[(int)font];
+
+    // Measure: the datum anchors on the advance box (matches LovyanGFX),
+    // but the strip has to span any ink that overhangs it too.
+    int advanceW = 0;
+    int inkLeft = 0, inkRight = 0;
+    for (const char* p = text; *p; p++) {
+        if (*p < FIRST_CHAR || *p > LAST_CHAR) return false;
+        const Glyph& g = atlas.glyphs[*p - FIRST_CHAR];
+        if (g.width) {
+            int l = advanceW + g.xOffset;
+            if (l < inkLeft) inkLeft = l;
+            if (l + g.width > inkRight) inkRight = l + g.width;
+        }
+        advanceW += g.advance;
+    }
+    if (advanceW > inkRight) inkRight = advanceW;
+
+    const int h = atlas.height;
+    int w = inkRight - inkLeft;
+    if (w > STRIP_MAX_W) w = STRIP_MAX_W;
+    if (w <= 0) return true;
+
+    int left = x;
+    switch ((uint8_t)datum & 3) {
+        case 1: left = x - advanceW / 2; break;
+        case 2: left = x - advanceW;     break;
+    }
+    int top = y;
+    if ((uint8_t)datum & 4)       top = y - h / 2;
+    else if ((uint8_t)datum & 24) top = y - h;   // bottom_* and baseline_* (no separate baseline kept)
+
+    // Coverage pass - max() so kerned/overlapping ink doesn't punch holes.
+    uint8_t* cov = (uint8_t*)(strip + (size_t)STRIP_MAX_W * stripHeight);
+    memset(cov, 0, (size_t)w * h);
+
+    int pen = -inkLeft;
+    for (const char* p = text; *p; p++) {
+        const Glyph& g = atlas.glyphs[*p - FIRST_CHAR];
+        const uint8_t* src = &atlas.coverage[g.offset];
+        int gx = pen + g.xOffset;
+        for (int row = 0; row < h; row++) {
+            uint8_t* dst = &cov[row * w];
+            for (int col = 0; col < g.width; col++) {
+                int sx = gx + col;
+                if (sx < 0 || sx >= w) continue;
+                uint8_t c = src[row * g.width + col];
+                if (c > dst[sx]) dst[sx] = c;
+            }
+        }
+        pen += g.advance;
+    }
+
+    // Expand through a per-call colour table - at most levels+1 distinct
+    // colours, so the blend is computed once per level, not per pixel.
+    // Byte-swapped, the same convention TJpg_Decoder's setSwapBytes(true)
+    // output uses for MP3SongList's artBuffer pushImage().
+    uint16_t lut[17];
+    for (int i = 0; i <= atlas.levels; i++) {
+        uint16_t c = blend565(bg, fg, i, atlas.levels);
+        lut[i] = (uint16_t)((c >> 8) | (c << 8));
+    }
+    for (int i = 0; i < w * h; i++) {
+        strip[i] = lut[cov[i]];
+    }
+
+    display->pushImage(left + inkLeft, top, w, h, strip);
+    return true;
+}
@@ -0,0 +1,94 @@
+// =====================================================================
+//  GlyphAtlas.h - Pre-rasterized glyph cache + blit-based text renderer
+//
+//  Every label on the text-heavy screens (UIButton labels, the album
+//  rows in MP3AlbumList, the track rows in MP3SongList) used to go
+//  through LovyanGFX's drawString(), which re-rasterizes each glyph and
+//  issues a separate little SPI write per glyph run on every redraw.
+//  A page flip on MP3AlbumList is 7 rows x ~30 glyphs, plus buttons.
+//
+//  This rasterizes the handful of font/size combinations the UI
+//  actually uses ONCE at boot into coverage (alpha) atlases in PSRAM.
+//  drawString() then composes the whole string into an RGB565 strip in
+//  RAM (alpha-blended against the known background colour) and pushes
+//  it to the panel with a single pushImage() - one SPI2 transaction per
+//  string instead of one per glyph.
+//
+//  Only printable ASCII is cached. drawString() returns false for
+//  anything it can't render (non-ASCII album names, atlas not built,
+//  out of memory) and callers fall back to plain LovyanGFX drawString().
+// =====================================================================
+
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <Arduino.h>
+#define LGFX_USE_V1
+#include <LovyanGFX.hpp>
+
+// The font/size combinations the UI uses today. Add a row to the
+// table in GlyphAtlas.cpp (and an entry here) to cache another one.
+enum class UIFont : uint8_t {
+    Mono1 = 0,   // Font0, size 1 - track rows, small labels
+    Mono2,       // Font0, size 2 - UIButton labels, titles
+    Mono3,       // Font0, size 3 - screen titles
+    Serif9,      // FreeSerif9pt7b, anti-aliased - album rows
+    COUNT
+};
+
+class GlyphAtlas {
+public:
+    static GlyphAtlas& getInstance();
+
+    // Rasterize every atlas. Call once after TFT_Module::begin() -
+    // takes a few tens of ms and only touches RAM, not the panel.
+    bool begin();
+    bool isReady() const { return ready; }
+
+    // Width in pixels of text in the given font, or -1 if the string
+    // contains anything the atlas doesn't cover.
+    int textWidth(UIFont font, const char* text) const;
+    int fontHeight(UIFont font) const;
+
+    // Draw text with LovyanGFX datum semantics (top_left, middle_center,
+    // etc.). bg must be the colour already behind the text - the strip
+    // is opaque, which is what lets it go out as one pushImage().
+    // Returns false (and draws nothing) if the caller should fall back.
+    bool drawString(lgfx::LGFX_Device* display, UIFont font, const char* text,
+                    int x, int y, lgfx::textdatum_t datum,
+                    uint16_t fg, uint16_t bg);
+
+private:
+    GlyphAtlas();
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    static const char FIRST_CHAR = 32;
+    static const char LAST_CHAR = 126;
+    static const int GLYPH_COUNT = LAST_CHAR - FIRST_CHAR + 1;
+    static const int STRIP_MAX_W = 480;
+
+    struct Glyph {
+        uint32_t offset;   // into Atlas::coverage
+        uint8_t  width;    // ink columns stored
+        int8_t   xOffset;  // ink start relative to the pen position
+        uint8_t  advance;  // pen advance
+    };
+
+    struct Atlas {
+        uint8_t* coverage;     // per-pixel coverage 0..levels, row-major per glyph (width x height)
+        uint8_t  height;
+        uint8_t  levels;       // supersample^2 - full coverage value
+        Glyph    glyphs[GLYPH_COUNT];
+    };
+
+    bool buildAtlas(Atlas& atlas, const lgfx::IFont* font, float size, int supersample);
+    void freeAtlases();     // after a failed begin(), so a retry starts clean
+
+    Atlas atlases[(int)UIFont::COUNT];
+    uint16_t* strip;       // STRIP_MAX_W x tallest atlas, RGB565 (byte-swapped for pushImage)
+    int stripHeight;
+    bool ready;
+};
+
+#endif // GLYPH_ATLAS_H
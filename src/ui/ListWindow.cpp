@@ -0,0 +1,69 @@
+// =====================================================================
+//  ListWindow.cpp - Paged row cache implementation
+// =====================================================================
+
+#include "ListWindow.h"
+
+ListWindow::ListWindow(const ListModel* model)
+    : _model(model), _version(model ? model->version() : 0), _clock(0)
+{
+    invalidate();
+}
+
+void ListWindow::setModel(const ListModel* model) {
+    _model = model;
+    _version = model ? model->version() : 0;
+    invalidate();
+}
+
+void ListWindow::invalidate() {
+    for (int i = 0; i < PAGES; i++) {
+        _pages[i].first = -1;
+        _pages[i].valid = 0;
+        _pages[i].lastUse = 0;
+    }
+}
+
+void ListWindow::fill(Page& page, int first) {
+    int total = _model->count();
+    page.first = first;
+    page.valid = 0;
+    for (int i = 0; i < PAGE_ROWS && first + i < total; i++) {
+        _model->fetch(first + i, page.rows[i], ROW_BYTES);
+        page.rows[i][ROW_BYTES - 1] = '\0';
+        page.valid++;
+    }
+}
+
+const char* ListWindow::row(int index) {
+    if (!_model || index < 0 || index >= _model->count()) return "";
+
+    if (_model->version() != _version) {
+        _version = _model->version();
+        invalidate();
+    }
+
+    int first = index - index % PAGE_ROWS;
+    Page* page = nullptr;
+    for (int i = 0; i < PAGES; i++) {
+        if (_pages[i].first == first) {
+            page = &_pages[i];
+            break;
+        }
+    }
+
+    if (!page) {
+        // Least recently used page goes
+        page = &_pages[0];
+        for (int i = 1; i < PAGES; i++) {
+            if (_pages[i].lastUse < page->lastUse) page = &_pages[i];
+        }
+        fill(*page, first);
+    } else if (index - first >= page->valid) {
+        // The list has grown into this page since it was loaded
+        fill(*page, first);
+    }
+
+    page->lastUse = ++_clock;
+    return page->rows[index - first];
+}
@@ -0,0 +1,71 @@
+// =====================================================================
+//  ListWindow.h - Paged row cache in front of a (possibly huge) list
+//
+//  The browsing screens used to copy the whole list into a fixed
+//  char[N][64] table up front: 50 albums, 100 tracks, names cut at 63
+//  bytes, and the RAM spent whether the album had 3 tracks or 99. A
+//  ListModel instead says how many rows there are and fills in any one
+//  of them on request; ListWindow keeps the last PAGES pages of
+//  PAGE_ROWS rows each, so a screen costs the same few KB whether the
+//  list has ten entries or ten thousand.
+//
+//  row() pointers stay valid until a row() call loads a different page
+//  - drawing one screenful (fewer than PAGE_ROWS rows, so at most two
+//  pages) is safe. Rows the model didn't have yet when their page was
+//  loaded are fetched again once it does, and a change of the model's
+//  version() throws the whole window away.
+// =====================================================================
+
+#ifndef LIST_WINDOW_H
+#define LIST_WINDOW_H
+
+#include <Arduino.h>
+
+class ListModel {
+public:
+    virtual ~ListModel() {}
+
+    virtual int count() const = 0;
+
+    // Row text into out (always terminated). Only called for rows
+    // below count().
+    virtual void fetch(int index, char* out, size_t size) const = 0;
+
+    // Changes whenever existing rows may have changed (not just been
+    // appended to).
+    virtual uint32_t version() const { return 0; }
+};
+
+class ListWindow {
+public:
+    explicit ListWindow(const ListModel* model = nullptr);
+
+    void setModel(const ListModel* model);      // also drops the cache
+    void invalidate();
+
+    int count() const { return _model ? _model->count() : 0; }
+
+    // Row text, "" for out-of-range rows.
+    const char* row(int index);
+
+    static const int PAGE_ROWS = 16;
+    static const int PAGES = 2;
+    static const int ROW_BYTES = 128;
+
+private:
+    struct Page {
+        int first;          // -1 = empty
+        int valid;          // rows actually fetched
+        uint32_t lastUse;
+        char rows[PAGE_ROWS][ROW_BYTES];
+    };
+
+    void fill(Page& page, int first);
+
+    const ListModel* _model;
+    uint32_t _version;
+    uint32_t _clock;
+    Page _pages[PAGES];
+};
+
+#endif // LIST_WINDOW_H
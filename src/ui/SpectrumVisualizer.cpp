@@ -0,0 +1,137 @@
+// =====================================================================
+//  SpectrumVisualizer.cpp - Spectrum bar widget implementation
+// =====================================================================
+
+#include "SpectrumVisualizer.h"
+#include "../utils/TFT_Module.h"
+#include "../utils/VS1053_Module.h"
+
+#define LEVEL_MAX   31
+#define FALL_STEP   2       // levels per frame a bar sinks - rises are instant
+#define BAR_GAP     1
+
+#define COLOR_BG    TFT_BLACK
+#define COLOR_LOW   0x07E0  // green
+#define COLOR_MID   0xFFE0  // yellow
+#define COLOR_HIGH  0xF800  // red
+
+SpectrumVisualizer::SpectrumVisualizer(int x, int y, int width, int height)
+    : x(x), y(y), width(width), height(height),
+      bandCount(0),
+      lastPollMs(0),
+      sprite(nullptr)
+{
+    memset(target, 0, sizeof(target));
+    memset(shown, 0, sizeof(shown));
+}
+
+void SpectrumVisualizer::reset() {
+    memset(target, 0, sizeof(target));
+    memset(shown, 0, sizeof(shown));
+}
+
+bool SpectrumVisualizer::ensureSprite() {
+    if (sprite) return true;
+
+    sprite = new lgfx::LGFX_Sprite();
+    sprite->setColorDepth(16);
+    sprite->setPsram(false);   // small, and pushSprite() is faster from internal RAM
+    if (!sprite->createSprite(width, height)) {
+        Serial.println("SpectrumVisualizer: ✗ Sprite alloc failed");
+        delete sprite;
+        sprite = nullptr;
+        return false;
+    }
+    sprite->fillScreen(COLOR_BG);
+    return true;
+}
+
+int SpectrumVisualizer::bandLeft(int band) const {
+    return bandCount ? (band * width) / bandCount : 0;
+}
+
+void SpectrumVisualizer::render(int firstBand, int lastBand) {
+    for (int b = firstBand; b <= lastBand; b++) {
+        int left = bandLeft(b);
+        int barW = bandLeft(b + 1) - left - BAR_GAP;
+        if (barW < 1) barW = 1;
+
+        int barH = (shown[b] * height) / LEVEL_MAX;
+        sprite->fillRect(left, 0, barW, height - barH, COLOR_BG);
+
+        // Colour by how high the bar reaches, in three zones.
+        int greenTop = height - (height * 2) / 3;
+        int yellowTop = height - (height * 9) / 10;
+        for (int row = height - barH; row < height; row++) {
+            uint16_t color = row >= greenTop ? COLOR_LOW : (row >= yellowTop ? COLOR_MID : COLOR_HIGH);
+            sprite->drawFastHLine(left, row, barW, color);
+        }
+    }
+}
+
+void SpectrumVisualizer::push(TFT_Module& tft, int firstBand, int lastBand) {
+    auto display = tft.getTFT();
+    int left = bandLeft(firstBand);
+    int right = (lastBand + 1 >= bandCount) ? width : bandLeft(lastBand + 1);
+
+    // Clip to the dirty columns so pushSprite() only sends those.
+    display->setClipRect(x + left, y, right - left, height);
+    sprite->pushSprite(display, x, y);
+    display->clearClipRect();
+}
+
+void SpectrumVisualizer::draw(TFT_Module& tft) {
+    auto display = tft.getTFT();
+    if (!ensureSprite() || bandCount == 0) {
+        display->fillRect(x, y, width, height, COLOR_BG);
+        return;
+    }
+    sprite->fillScreen(COLOR_BG);
+    render(0, bandCount - 1);
+    sprite->pushSprite(display, x, y);
+}
+
+void SpectrumVisualizer::update(TFT_Module& tft, VS1053_Module& audio, bool playing) {
+    unsigned long now = millis();
+    if (now - lastPollMs < POLL_INTERVAL_MS) return;
+    lastPollMs = now;
+
+    if (playing) {
+        uint8_t levels[MAX_BANDS];
+        int n = audio.readSpectrum(levels, MAX_BANDS);
+        if (n < 0) return;   // bus busy - skip this frame entirely
+
+        if (n != bandCount) {
+            // Analyzer (re)appeared or changed band count - relayout.
+            bandCount = n;
+            reset();
+            if (n > 0) draw(tft);
+            if (n == 0) return;
+        }
+        memcpy(target, levels, n);
+    } else {
+        memset(target, 0, sizeof(target));
+    }
+    if (bandCount == 0 || !ensureSprite()) return;
+
+    // Rises jump straight up, falls sink FALL_STEP per frame - the usual
+    // VU look, and it means idle bars settle to zero by themselves.
+    int firstDirty = -1, lastDirty = -1;
+    for (int b = 0; b < bandCount; b++) {
+        uint8_t next = shown[b];
+        if (target[b] > shown[b]) {
+            next = target[b];
+        } else if (shown[b] > target[b]) {
+            next = (shown[b] - target[b] > FALL_STEP) ? shown[b] - FALL_STEP : target[b];
+        }
+        if (next != shown[b]) {
+            shown[b] = next;
+            if (firstDirty < 0) firstDirty = b;
+            lastDirty = b;
+        }
+    }
+    if (firstDirty < 0) return;
+
+    render(firstDirty, lastDirty);
+    push(tft, firstDirty, lastDirty);
+}
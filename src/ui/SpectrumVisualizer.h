@@ -0,0 +1,62 @@
+// =====================================================================
+//  SpectrumVisualizer.h - Animated band-level bars for Now Playing
+//
+//  Bars come from VLSI's spectrum analyzer plugin running on the VS1053
+//  itself (drop its .plg into /Plugins - see VS1053_Plugins.h), so the
+//  ESP32 does no FFT work at all; it just reads ~20 band levels.
+//
+//  Bus etiquette, since SPI1 is the audio feeder's lifeline:
+//    - polled at most every POLL_INTERVAL_MS (~15 Hz), only while playing
+//    - VS1053_Module::readSpectrum() uses a try-lock and gives up at
+//      once if the feeder (or SD) holds SPI1; that frame is just skipped
+//    - one short transaction per poll (< 1 ms at 1 MHz)
+//
+//  Drawing is TFT-only (SPI2): bars are rendered into a sprite and only
+//  the columns that changed since the last frame are pushed.
+// =====================================================================
+
+#ifndef SPECTRUM_VISUALIZER_H
+#define SPECTRUM_VISUALIZER_H
+
+#include <Arduino.h>
+#define LGFX_USE_V1
+#include <LovyanGFX.hpp>
+
+class TFT_Module;
+class VS1053_Module;
+
+class SpectrumVisualizer {
+public:
+    SpectrumVisualizer(int x, int y, int width, int height);
+
+    // Full draw of the box (background + current bars). Call from the
+    // owning screen's full redraw.
+    void draw(TFT_Module& tft);
+
+    // Call every screen update(). Rate-limits itself; when not playing
+    // the bars fall to zero and polling stops.
+    void update(TFT_Module& tft, VS1053_Module& audio, bool playing);
+
+    // Drop all bars to zero without drawing (e.g. new album).
+    void reset();
+
+    static const int MAX_BANDS = 23;
+    static const unsigned long POLL_INTERVAL_MS = 66;
+
+private:
+    bool ensureSprite();
+    void render(int firstBand, int lastBand);
+    void push(TFT_Module& tft, int firstBand, int lastBand);
+    int bandLeft(int band) const;
+
+    int x, y, width, height;
+
+    int bandCount;                  // from the plugin; 0 = nothing to show yet
+    uint8_t target[MAX_BANDS];      // last levels read, 0..31
+    uint8_t shown[MAX_BANDS];       // what's on screen, falls toward target
+    unsigned long lastPollMs;
+
+    lgfx::LGFX_Sprite* sprite;
+};
+
+#endif // SPECTRUM_VISUALIZER_H
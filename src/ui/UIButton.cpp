@@ -4,6 +4,7 @@
 
 #include "UIButton.h"
 #include "../utils/TFT_Module.h"
+#include "GlyphAtlas.h"
 #include <LovyanGFX.hpp>
 
 UIButton::UIButton()
@@ -27,11 +28,15 @@ void UIButton::draw(TFT_Module& tftModule) {
     // Draw border
     tft->drawRoundRect(x, y, w, h, 8, borderColor);
     
-    // Draw label centered
-    tft->setTextColor(textColor);
-    tft->setTextDatum(middle_center);
-    tft->setTextSize(2);
-    tft->drawString(label, x + w/2, y + h/2);
+    // Draw label centered - one blit from the glyph atlas when it covers
+    // the label, LovyanGFX's own renderer otherwise.
+    if (!GlyphAtlas::getInstance().drawString(tft, UIFont::Mono2, label, x + w/2, y + h/2,
+                                              middle_center, textColor, bgColor)) {
+        tft->setTextColor(textColor);
+        tft->setTextDatum(middle_center);
+        tft->setTextSize(2);
+        tft->drawString(label, x + w/2, y + h/2);
+    }
 }
 
 bool UIButton::hit(int tx, int ty) const {
@@ -0,0 +1,57 @@
+// =====================================================================
+//  UIKeyboard.cpp - On-screen keyboard implementation
+// =====================================================================
+
+#include "UIKeyboard.h"
+#include "UIButton.h"
+#include "../utils/TFT_Module.h"
+#include <LovyanGFX.hpp>
+
+// One character per KEY_PITCH_X column; a run of spaces is one wide key.
+const char* const UIKeyboard::LAYOUT[ROWS] = {
+    "1234567890",
+    "qwertyuiop",
+    "asdfghjkl\b",
+    "zxcvbnm  \x1b"
+};
+
+UIKeyboard::UIKeyboard(int y)
+    : y(y)
+{
+}
+
+void UIKeyboard::draw(TFT_Module& tftModule) {
+    tftModule.getTFT()->fillRect(0, y, 480, HEIGHT, TFT_BLACK);
+
+    for (int row = 0; row < ROWS; row++) {
+        const char* keys = LAYOUT[row];
+        int col = 0;
+        while (keys[col]) {
+            char code = keys[col];
+            int span = 1;
+            while (code == ' ' && keys[col + span] == ' ') span++;
+
+            char text[2] = { code, '\0' };
+            const char* label = text;
+            if (code == KEY_DELETE) label = "Del";
+            else if (code == KEY_HIDE) label = "Hide";
+            else if (code == ' ') label = "Space";
+
+            UIButton key(col * KEY_PITCH_X + 2, y + row * KEY_PITCH_Y + 2,
+                         span * KEY_PITCH_X - 4, KEY_PITCH_Y - 4, label);
+            key.setColors(TFT_DARKGREY, TFT_WHITE, TFT_WHITE);
+            key.draw(tftModule);
+
+            col += span;
+        }
+    }
+}
+
+char UIKeyboard::hit(int tx, int ty) const {
+    if (ty < y || ty >= y + HEIGHT || tx < 0) return 0;
+
+    int row = (ty - y) / KEY_PITCH_Y;
+    int col = tx / KEY_PITCH_X;
+    if (col >= (int)strlen(LAYOUT[row])) return 0;
+    return LAYOUT[row][col];
+}
@@ -0,0 +1,44 @@
+// =====================================================================
+//  UIKeyboard.h - On-screen keyboard for the 480 px wide display
+//
+//  Four rows: digits, then QWERTY letters (lower case - SearchIndex
+//  doesn't care about case), with Del, a double-width Space and Hide.
+//  Keys are drawn as UIButtons, so they look like every other button.
+//  hit() maps a touch to the key under it; the screen owning the
+//  keyboard decides what each key does.
+// =====================================================================
+
+#ifndef UI_KEYBOARD_H
+#define UI_KEYBOARD_H
+
+#include <Arduino.h>
+
+class TFT_Module;
+
+class UIKeyboard {
+public:
+    explicit UIKeyboard(int y);     // full width, top edge at y
+
+    void draw(TFT_Module& tft);
+
+    // Key under the touch: a printable character, KEY_DELETE, KEY_HIDE,
+    // or 0 for none.
+    char hit(int tx, int ty) const;
+
+    int top() const { return y; }
+
+    static const char KEY_DELETE = '\b';
+    static const char KEY_HIDE = '\x1b';
+
+    static const int ROWS = 4;
+    static const int KEY_PITCH_X = 48;
+    static const int KEY_PITCH_Y = 36;
+    static const int HEIGHT = ROWS * KEY_PITCH_Y;
+
+private:
+    static const char* const LAYOUT[ROWS];
+
+    int y;
+};
+
+#endif // UI_KEYBOARD_H
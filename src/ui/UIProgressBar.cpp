@@ -0,0 +1,102 @@
+// =====================================================================
+//  UIProgressBar.cpp - Track progress bar implementation
+// =====================================================================
+
+#include "UIProgressBar.h"
+#include "GlyphAtlas.h"
+#include "../utils/TFT_Module.h"
+#include "../utils/PlaybackPosition.h"
+#include <LovyanGFX.hpp>
+
+UIProgressBar::UIProgressBar(int x, int y, int width, int height, bool showTime)
+    : x(x), y(y), width(width), height(height), showTime(showTime),
+      trackColor(0x4208),  // Dark gray, same as UISlider's track
+      fillColor(0x04BF),   // Cyan, same as UISlider's fill
+      trackSeq(0),
+      fillPx(0),
+      elapsedSec(0),
+      totalSec(0),
+      lastRefreshMs(0)
+{
+}
+
+void UIProgressBar::setColors(uint32_t track, uint32_t fill) {
+    trackColor = track;
+    fillColor = fill;
+}
+
+void UIProgressBar::draw(TFT_Module& tft) {
+    auto display = tft.getTFT();
+
+    display->fillRect(x, y, width, height, trackColor);
+    if (fillPx > 0) {
+        display->fillRect(x, y, fillPx, height, fillColor);
+    }
+    if (showTime) {
+        drawTime(tft);
+    }
+}
+
+void UIProgressBar::drawTime(TFT_Module& tft) {
+    auto display = tft.getTFT();
+
+    char label[16];
+    if (totalSec) {
+        snprintf(label, sizeof(label), "%lu:%02lu/%lu:%02lu",
+                 (unsigned long)(elapsedSec / 60), (unsigned long)(elapsedSec % 60),
+                 (unsigned long)(totalSec / 60), (unsigned long)(totalSec % 60));
+    } else {
+        snprintf(label, sizeof(label), "%lu:%02lu",
+                 (unsigned long)(elapsedSec / 60), (unsigned long)(elapsedSec % 60));
+    }
+
+    int labelX = x + width + 6;
+    int labelY = y + height / 2;
+    display->fillRect(labelX, labelY - 5, TIME_LABEL_W, 10, TFT_BLACK);
+
+    display->setFont(&fonts::Font0);
+    display->setTextSize(1);
+    display->setTextColor(TFT_WHITE);
+    display->setTextDatum(middle_left);
+    if (!GlyphAtlas::getInstance().drawString(display, UIFont::Mono1, label, labelX, labelY,
+                                              middle_left, TFT_WHITE, TFT_BLACK)) {
+        display->drawString(label, labelX, labelY);
+    }
+}
+
+void UIProgressBar::update(TFT_Module& tft, const PlaybackSnapshot& pos) {
+    unsigned long now = millis();
+    if (now - lastRefreshMs < REFRESH_MS) return;
+    lastRefreshMs = now;
+
+    int newFill = (int)(((uint64_t)pos.progressPermille() * width) / 1000);
+    if (newFill > width) newFill = width;
+    uint32_t newElapsed = pos.decodeSec;
+    uint32_t newTotal = pos.durationSec();
+
+    auto display = tft.getTFT();
+
+    if (pos.trackSeq != trackSeq) {
+        // New track (or stopped) - start the bar over.
+        trackSeq = pos.trackSeq;
+        fillPx = newFill;
+        elapsedSec = newElapsed;
+        totalSec = newTotal;
+        draw(tft);
+        return;
+    }
+
+    // Paint only the strip between the old and new fill edge.
+    if (newFill > fillPx) {
+        display->fillRect(x + fillPx, y, newFill - fillPx, height, fillColor);
+    } else if (newFill < fillPx) {
+        display->fillRect(x + newFill, y, fillPx - newFill, height, trackColor);
+    }
+    fillPx = newFill;
+
+    if (showTime && (newElapsed != elapsedSec || newTotal != totalSec)) {
+        elapsedSec = newElapsed;
+        totalSec = newTotal;
+        drawTime(tft);
+    }
+}
@@ -0,0 +1,46 @@
+// =====================================================================
+//  UIProgressBar.h - Track progress bar with optional elapsed/total time
+//
+//  Fed from PlaybackPosition snapshots (a lock-free read - no SPI1 at
+//  all), redrawn at most every REFRESH_MS, and only the part of the bar
+//  that actually moved is painted.
+// =====================================================================
+
+#ifndef UI_PROGRESS_BAR_H
+#define UI_PROGRESS_BAR_H
+
+#include <Arduino.h>
+
+class TFT_Module;
+struct PlaybackSnapshot;
+
+class UIProgressBar {
+public:
+    // showTime draws "m:ss/m:ss" just right of the bar (TIME_LABEL_W px).
+    UIProgressBar(int x, int y, int width, int height, bool showTime = false);
+
+    void draw(TFT_Module& tft);                                  // full redraw
+    void update(TFT_Module& tft, const PlaybackSnapshot& pos);   // rate-limited partial redraw
+
+    void setColors(uint32_t track, uint32_t fill);
+
+    static const unsigned long REFRESH_MS = 250;   // 4 Hz
+    static const int TIME_LABEL_W = 66;
+
+private:
+    void drawTime(TFT_Module& tft);
+
+    int x, y, width, height;
+    bool showTime;
+
+    uint32_t trackColor;
+    uint32_t fillColor;
+
+    uint32_t trackSeq;      // snapshot trackSeq last drawn
+    int fillPx;             // inner pixels currently filled
+    uint32_t elapsedSec;
+    uint32_t totalSec;
+    unsigned long lastRefreshMs;
+};
+
+#endif // UI_PROGRESS_BAR_H
@@ -0,0 +1,321 @@
+// =====================================================================
+//  AlbumArtCache.cpp - Shared album art cache implementation
+// =====================================================================
+
+#include "AlbumArtCache.h"
+#include "SPIBusLock.h"
+#include "ImageScaler.h"
+#include <SdFat.h>
+#include <TJpg_Decoder.h>
+#include <esp_heap_caps.h>
+
+// tjpgd (the decoder inside TJpg_Decoder) is driven directly rather
+// than through the global TJpgDec object: input is pulled from the SD
+// file on demand and output lands in a per-call canvas, so there's no
+// whole-file staging buffer, no size cap, and no shared state between a
+// foreground load and a background prefetch decoding at the same time.
+// Input requests are JD_SZBUF (512) bytes; the workspace size covers
+// tjpgd's fast-decode tables with room to spare.
+static const size_t JPEG_WORKSPACE_SIZE = 10 * 1024;
+
+struct ArtDecodeJob {
+    FsFile* file;
+    bool yieldToAudio;
+    uint16_t* canvas;       // decoded-size RGB565, byte-swapped for pushImage()
+    int canvasW;
+    int canvasH;
+};
+
+static size_t artJpegInput(JDEC* jd, uint8_t* buf, size_t len) {
+    ArtDecodeJob* job = (ArtDecodeJob*)jd->device;
+    size_t n;
+    {
+        // Per block, not per file - SPI1 is free again between blocks.
+        SPIBusGuard guard;
+        if (buf) {
+            int r = job->file->read(buf, len);
+            n = r > 0 ? (size_t)r : 0;
+        } else {
+            // tjpgd skipping a segment it doesn't need.
+            n = job->file->seekCur(len) ? len : 0;
+        }
+    }
+    // Background decodes step aside so the audio feeder on Core 0 gets
+    // the bus at least once per block.
+    if (job->yieldToAudio && buf) vTaskDelay(1);
+    return n;
+}
+
+static int artJpegOutput(JDEC* jd, void* bitmap, JRECT* rect) {
+    ArtDecodeJob* job = (ArtDecodeJob*)jd->device;
+    const uint16_t* src = (const uint16_t*)bitmap;
+    int w = rect->right - rect->left + 1;
+
+    for (int y = rect->top; y <= rect->bottom; y++) {
+        if (y >= job->canvasH) break;
+        uint16_t* dst = job->canvas + y * job->canvasW;
+        for (int x = rect->left; x <= rect->right && x < job->canvasW; x++) {
+            // tjpgd emits native RGB565; the cache stores it swapped.
+            uint16_t v = src[(y - rect->top) * w + (x - rect->left)];
+            dst[x] = (uint16_t)((v >> 8) | (v << 8));
+        }
+    }
+    return 1;   // keep going
+}
+
+// Same candidates, same order, as SD_Module::getAlbumArt().
+static const char* const ART_NAMES[] = { "folder.jpg", "cover.jpg", "album.jpg", "front.jpg" };
+static const char* const DEFAULT_ART = "/Music/FolderDefault.jpg";
+
+AlbumArtCache& AlbumArtCache::getInstance() {
+    static AlbumArtCache instance;
+    return instance;
+}
+
+AlbumArtCache::AlbumArtCache()
+    : useCounter(0)
+{
+    memset(entries, 0, sizeof(entries));
+    mutex = xSemaphoreCreateMutex();
+}
+
+int AlbumArtCache::findLocked(const char* albumName, int w, int h) {
+    for (int i = 0; i < CAPACITY; i++) {
+        const Entry& e = entries[i];
+        if (e.lastUsed && e.w == w && e.h == h && strcmp(e.album, albumName) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool AlbumArtCache::get(const char* albumName, int w, int h, uint16_t* dest) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    int i = findLocked(albumName, w, h);
+    if (i >= 0) {
+        memcpy(dest, entries[i].pixels, (size_t)w * h * sizeof(uint16_t));
+        entries[i].lastUsed = ++useCounter;
+    }
+    xSemaphoreGive(mutex);
+    return i >= 0;
+}
+
+bool AlbumArtCache::contains(const char* albumName, int w, int h) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool found = findLocked(albumName, w, h) >= 0;
+    xSemaphoreGive(mutex);
+    return found;
+}
+
+bool AlbumArtCache::put(const char* albumName, int w, int h, const uint16_t* src) {
+    size_t bytes = (size_t)w * h * sizeof(uint16_t);
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    // Reuse the existing slot for this key, else an empty one, else the
+    // least recently used.
+    int slot = findLocked(albumName, w, h);
+    if (slot < 0) {
+        uint32_t oldest = UINT32_MAX;
+        for (int i = 0; i < CAPACITY; i++) {
+            if (entries[i].lastUsed < oldest) {
+                oldest = entries[i].lastUsed;
+                slot = i;
+            }
+        }
+    }
+
+    Entry& e = entries[slot];
+    if (e.pixels && (e.w != w || e.h != h)) {
+        heap_caps_free(e.pixels);
+        e.pixels = nullptr;
+    }
+    if (!e.pixels) {
+        e.pixels = (uint16_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    }
+    if (!e.pixels) {
+        e.lastUsed = 0;
+        xSemaphoreGive(mutex);
+        Serial.println("AlbumArtCache: PSRAM alloc failed, not caching");
+        return false;
+    }
+
+    memcpy(e.pixels, src, bytes);
+    strncpy(e.album, albumName, sizeof(e.album) - 1);
+    e.album[sizeof(e.album) - 1] = '\0';
+    e.w = w;
+    e.h = h;
+    e.lastUsed = ++useCounter;
+
+    xSemaphoreGive(mutex);
+    return true;
+}
+
+void AlbumArtCache::invalidate(const char* albumName) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (int i = 0; i < CAPACITY; i++) {
+        if (entries[i].lastUsed && strcmp(entries[i].album, albumName) == 0) {
+            entries[i].lastUsed = 0;   // slot (and its buffer) gets reused by the next put()
+        }
+    }
+    xSemaphoreGive(mutex);
+}
+
+bool AlbumArtCache::load(const char* albumName, uint16_t* dest, int w, int h) {
+    if (!albumName || !dest || w <= 0 || h <= 0) return false;
+
+    if (get(albumName, w, h, dest)) {
+        Serial.printf("AlbumArtCache: Hit for '%s' (%dx%d)\n", albumName, w, h);
+        return true;
+    }
+    return decodeAndCache(albumName, dest, w, h, false);
+}
+
+bool AlbumArtCache::prefetch(const char* albumName, int w, int h) {
+    if (!albumName || w <= 0 || h <= 0) return false;
+    if (contains(albumName, w, h)) return true;
+
+    size_t bytes = (size_t)w * h * sizeof(uint16_t);
+    uint16_t* scratch = (uint16_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (!scratch) return false;
+
+    // A partial decode isn't cached, so that's not "ready" either
+    bool ok = decodeAndCache(albumName, scratch, w, h, true) && contains(albumName, w, h);
+    heap_caps_free(scratch);
+    return ok;
+}
+
+bool AlbumArtCache::decodeAndCache(const char* albumName, uint16_t* dest, int w, int h, bool yieldToAudio) {
+    extern SdFs sd;
+    // "/Music/" + a 255-byte folder name + "/folder.jpg", the longest of ART_NAMES
+    char artPath[sizeof("/Music/") + 255 + sizeof("/folder.jpg")];
+    bool found = false;
+
+    {
+        SPIBusGuard guard;
+        for (size_t i = 0; i < sizeof(ART_NAMES) / sizeof(ART_NAMES[0]) && !found; i++) {
+            snprintf(artPath, sizeof(artPath), "/Music/%s/%s", albumName, ART_NAMES[i]);
+            found = sd.exists(artPath);
+        }
+    }
+
+    DecodeResult result = Unsupported;
+    if (found) {
+        result = decodeFile(artPath, dest, w, h, yieldToAudio);
+        if (result == Unsupported) {
+            Serial.printf("AlbumArtCache: Can't decode %s (progressive?), using the default\n", artPath);
+        }
+    }
+    // No art of its own, or none tjpgd can read - the default beats nothing
+    if (result == Unsupported) {
+        result = decodeFile(DEFAULT_ART, dest, w, h, yieldToAudio);
+    }
+
+    if (result == Decoded) {
+        put(albumName, w, h, dest);
+        Serial.printf("AlbumArtCache: Decoded '%s' -> %dx%d%s\n",
+                      albumName, w, h, yieldToAudio ? " (prefetch)" : "");
+        return true;
+    }
+    if (result == Partial) {
+        // Shown, but not cached - a later visit gets to try again
+        return true;
+    }
+    if (result == Unsupported) Serial.printf("AlbumArtCache: No art (or default) for '%s'\n", albumName);
+    return false;
+}
+
+AlbumArtCache::DecodeResult AlbumArtCache::decodeFile(const char* path, uint16_t* dest, int w, int h,
+                                                      bool yieldToAudio) {
+    // Independent FsFile, not SD_Module's shared streaming handle, so
+    // this can never stomp a track that's open for playback.
+    FsFile file;
+    {
+        SPIBusGuard guard;
+        if (!file.open(path, O_RDONLY)) return Unsupported;
+    }
+
+    DecodeResult result = decodeJpeg(file, dest, w, h, yieldToAudio);
+
+    SPIBusGuard guard;
+    file.close();
+    return result;
+}
+
+AlbumArtCache::DecodeResult AlbumArtCache::decodeJpeg(FsFile& file, uint16_t* dest, int w, int h,
+                                                      bool yieldToAudio) {
+    // Workspace in internal RAM - tjpgd hits its Huffman/IDCT tables hard.
+    void* work = heap_caps_malloc(JPEG_WORKSPACE_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!work) work = malloc(JPEG_WORKSPACE_SIZE);
+    if (!work) {
+        Serial.println("AlbumArtCache: JPEG workspace alloc failed, skipping art");
+        return DecodeFailed;
+    }
+
+    ArtDecodeJob job = { &file, yieldToAudio, nullptr, 0, 0 };
+    JDEC jd;
+    memset(&jd, 0, sizeof(jd));
+
+    JRESULT res = jd_prepare(&jd, artJpegInput, work, JPEG_WORKSPACE_SIZE, &job);
+    if (res != JDR_OK || jd.width == 0 || jd.height == 0) {
+        // JDR_FMT3 is a progressive file - tjpgd only does baseline
+        Serial.printf("AlbumArtCache: Failed to parse JPEG header (%d)\n", (int)res);
+        free(work);
+        return res == JDR_MEM1 ? DecodeFailed : Unsupported;
+    }
+    uint16_t jpgW = jd.width;
+    uint16_t jpgH = jd.height;
+
+    // tjpgd can only downscale by powers of 2 (1/2/4/8), so the decoded
+    // output rarely lands on the box size. Decode at the smallest
+    // power-of-2 size that still covers the fitted size, then let
+    // ImageScaler area-average it down (or bilinear it up, for covers
+    // smaller than the box) - sharper than decoding under-size and
+    // blowing it back up.
+    int fitW, fitH;
+    if ((uint32_t)w * jpgH <= (uint32_t)h * jpgW) {
+        fitW = w;
+        fitH = (int)(((uint32_t)jpgH * w) / jpgW);
+    } else {
+        fitH = h;
+        fitW = (int)(((uint32_t)jpgW * h) / jpgH);
+    }
+
+    uint8_t scaleLog2 = 0;
+    while (scaleLog2 < 3 && (jpgW >> (scaleLog2 + 1)) >= fitW && (jpgH >> (scaleLog2 + 1)) >= fitH) {
+        scaleLog2++;
+    }
+
+    // tjpgd rounds partial MCUs up, so size the canvas the same way.
+    int decodedW = (jpgW + (1 << scaleLog2) - 1) >> scaleLog2;
+    int decodedH = (jpgH + (1 << scaleLog2) - 1) >> scaleLog2;
+
+    size_t canvasBytes = (size_t)decodedW * decodedH * sizeof(uint16_t);
+    uint16_t* canvas = (uint16_t*)heap_caps_malloc(canvasBytes, MALLOC_CAP_SPIRAM);
+    if (!canvas) canvas = (uint16_t*)malloc(canvasBytes);
+    if (!canvas) {
+        Serial.println("AlbumArtCache: Decode canvas alloc failed, skipping art");
+        free(work);
+        return DecodeFailed;
+    }
+    memset(canvas, 0, canvasBytes);
+
+    job.canvas = canvas;
+    job.canvasW = decodedW;
+    job.canvasH = decodedH;
+
+    res = jd_decomp(&jd, artJpegOutput, scaleLog2);
+    free(work);
+
+    // A truncated or slightly corrupt file still leaves whatever MCU rows
+    // did decode in the canvas - show that rather than nothing, but
+    // it's not what the file holds, so it isn't cached.
+    if (res != JDR_OK) {
+        Serial.printf("AlbumArtCache: JPEG decode stopped early (%d)\n", (int)res);
+    }
+
+    ImageScaler::fitCentered(canvas, decodedW, decodedH, dest, w, h, true);
+
+    heap_caps_free(canvas);
+    return res == JDR_OK ? Decoded : Partial;
+}
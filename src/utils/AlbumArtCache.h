@@ -0,0 +1,88 @@
+// =====================================================================
+//  AlbumArtCache.h - Shared, PSRAM-resident cache of decoded album art
+//
+//  MP3SongList used to keep exactly one decoded cover (its artBuffer)
+//  and re-read + re-decode the JPEG on every loadAlbum(); KidScreen
+//  decoded straight to the TFT with no cache at all. Flipping between a
+//  couple of favourite albums paid for an SD read and a full JPEG
+//  decode - with the SPI1 bus guard held - every single time.
+//
+//  This keeps the last CAPACITY decoded images, keyed by album name AND
+//  target size (the same album is 160x160 on MP3SongList and 300x150
+//  on KidScreen), as RGB565 in PSRAM with least-recently-used eviction.
+//  load() is the one entry point screens need: a hit is a PSRAM memcpy
+//  with no SD or SPI1 involvement at all; a miss decodes from SD into
+//  the caller's buffer and then keeps a copy.
+//
+//  Pixels are byte-swapped (the TJpg_Decoder setSwapBytes(true) layout), ready for
+//  pushImage(), letterboxed to the requested box with black.
+// =====================================================================
+
+#ifndef ALBUM_ART_CACHE_H
+#define ALBUM_ART_CACHE_H
+
+#include <Arduino.h>
+#include <freertos/semphr.h>
+
+class FsFile;
+
+class AlbumArtCache {
+public:
+    static AlbumArtCache& getInstance();
+
+    // Fill dest (w x h RGB565) with albumName's cover - from the cache
+    // if present, otherwise decoded from /Music/<albumName>/ (falling
+    // back to /Music/FolderDefault.jpg, also when the album's own file
+    // can't be decoded - tjpgd has no progressive JPEG) and then cached.
+    // A decode that stops early is shown but not cached. false = no art.
+    bool load(const char* albumName, uint16_t* dest, int w, int h);
+
+    // Background variant for AlbumArtPrefetcher: decodes into a scratch
+    // buffer and only caches. SD reads step aside (vTaskDelay) between
+    // 512-byte blocks so the audio feeder keeps getting SPI1. Safe to
+    // run concurrently with load() - each decode has its own state.
+    bool prefetch(const char* albumName, int w, int h);
+
+    // Cache-only lookups - never touch the SD card.
+    bool get(const char* albumName, int w, int h, uint16_t* dest);
+    bool contains(const char* albumName, int w, int h);
+
+    // Store a copy of an already-decoded image, evicting the LRU entry
+    // if every slot is taken.
+    bool put(const char* albumName, int w, int h, const uint16_t* src);
+
+    // Drop every size cached for an album (e.g. its folder.jpg changed).
+    void invalidate(const char* albumName);
+
+    static const int CAPACITY = 10;
+
+private:
+    AlbumArtCache();
+    AlbumArtCache(const AlbumArtCache&) = delete;
+    AlbumArtCache& operator=(const AlbumArtCache&) = delete;
+
+    struct Entry {
+        char album[256];    // a whole FAT long name - a cut one never matches
+        uint16_t w, h;
+        uint16_t* pixels;    // PSRAM, w * h
+        uint32_t lastUsed;   // useCounter stamp, 0 = empty slot
+    };
+
+    enum DecodeResult : uint8_t {
+        Decoded,            // whole image in dest
+        Partial,            // stopped early - dest has what did decode, not cacheable
+        Unsupported,        // tjpgd can't read it at all (progressive, bad header)
+        DecodeFailed        // out of memory - dest untouched
+    };
+
+    int findLocked(const char* albumName, int w, int h);
+    bool decodeAndCache(const char* albumName, uint16_t* dest, int w, int h, bool yieldToAudio);
+    DecodeResult decodeFile(const char* path, uint16_t* dest, int w, int h, bool yieldToAudio);
+    DecodeResult decodeJpeg(FsFile& file, uint16_t* dest, int w, int h, bool yieldToAudio);
+
+    Entry entries[CAPACITY];
+    uint32_t useCounter;
+    SemaphoreHandle_t mutex;        // guards entries[] - never held across SD or decode work
+};
+
+#endif // ALBUM_ART_CACHE_H
@@ -0,0 +1,113 @@
+// =====================================================================
+//  AlbumArtPrefetcher.cpp - Background album art decode implementation
+// =====================================================================
+
+#include "AlbumArtPrefetcher.h"
+#include "AlbumArtCache.h"
+
+AlbumArtPrefetcher& AlbumArtPrefetcher::getInstance() {
+    static AlbumArtPrefetcher instance;
+    return instance;
+}
+
+AlbumArtPrefetcher::AlbumArtPrefetcher()
+    : pendingCount(0),
+      pendingNext(0),
+      pendingW(0),
+      pendingH(0),
+      task(nullptr)
+{
+    memset(pending, 0, sizeof(pending));
+    mutex = xSemaphoreCreateMutex();
+}
+
+bool AlbumArtPrefetcher::begin() {
+    if (task) return true;
+
+    // Core 1, same priority as the Arduino loop task: it time-slices with
+    // the UI rather than competing with the MP3Stream task on Core 0.
+    // (Priority 0 isn't an option - loop() never blocks, so an idle-
+    // priority task on Core 1 would simply never run.) The stack covers
+    // TJpg_Decoder's work area plus the decode call chain.
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        taskEntry,
+        "ArtPrefetch",
+        8192,
+        this,
+        1,
+        &task,
+        1
+    );
+    if (ok != pdPASS) {
+        task = nullptr;
+        Serial.println("AlbumArtPrefetcher: ✗ Task create failed");
+        return false;
+    }
+    Serial.println("AlbumArtPrefetcher: ✓ Started on Core 1");
+    return true;
+}
+
+void AlbumArtPrefetcher::request(const char* const* albumNames, int count, int w, int h) {
+    if (!albumNames || count <= 0 || w <= 0 || h <= 0) return;
+    if (count > MAX_PENDING) count = MAX_PENDING;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (int i = 0; i < count; i++) {
+        strncpy(pending[i], albumNames[i], sizeof(pending[0]) - 1);
+        pending[i][sizeof(pending[0]) - 1] = '\0';
+    }
+    pendingCount = count;
+    pendingNext = 0;
+    pendingW = w;
+    pendingH = h;
+    xSemaphoreGive(mutex);
+
+    if (task) xTaskNotifyGive(task);
+}
+
+void AlbumArtPrefetcher::cancel() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    pendingCount = 0;
+    pendingNext = 0;
+    xSemaphoreGive(mutex);
+}
+
+bool AlbumArtPrefetcher::takeNext(char* nameOut, size_t nameLen, int* wOut, int* hOut) {
+    bool found = false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (pendingNext < pendingCount) {
+        strncpy(nameOut, pending[pendingNext], nameLen - 1);
+        nameOut[nameLen - 1] = '\0';
+        *wOut = pendingW;
+        *hOut = pendingH;
+        pendingNext++;
+        found = true;
+    }
+    xSemaphoreGive(mutex);
+    return found;
+}
+
+void AlbumArtPrefetcher::taskEntry(void* param) {
+    static_cast<AlbumArtPrefetcher*>(param)->run();
+}
+
+void AlbumArtPrefetcher::run() {
+    char album[sizeof(pending[0])];
+    int w, h;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Re-checks the list after every album, so a request() that lands
+        // mid-page takes effect at the next album boundary.
+        while (takeNext(album, sizeof(album), &w, &h)) {
+            AlbumArtCache& cache = AlbumArtCache::getInstance();
+            if (cache.contains(album, w, h)) continue;
+
+            unsigned long t0 = millis();
+            if (cache.prefetch(album, w, h)) {
+                Serial.printf("AlbumArtPrefetcher: '%s' ready in %lu ms\n", album, millis() - t0);
+            }
+        }
+    }
+}
@@ -0,0 +1,63 @@
+// =====================================================================
+//  AlbumArtPrefetcher.h - Background album art decode while browsing
+//
+//  AlbumArtCache makes the SECOND visit to an album instant; this makes
+//  the first one instant too. While MP3AlbumList is on screen, a small
+//  task on Core 1 decodes the covers of the albums visible on the
+//  current page into the cache at MP3SongList's art size, so tapping
+//  one of them finds its art already decoded.
+//
+//  It is strictly background work:
+//    - request() replaces whatever was still pending (flipping pages
+//      abandons the old page's covers rather than queueing up behind
+//      them); an album already being decoded is allowed to finish.
+//    - Decodes go through AlbumArtCache::prefetch(), which streams the
+//      JPEG off SD taking the SPI1 bus guard per 512-byte block and
+//      steps aside between blocks, so the audio feeder on Core 0 is
+//      never locked out for a whole cover.
+// =====================================================================
+
+#ifndef ALBUM_ART_PREFETCHER_H
+#define ALBUM_ART_PREFETCHER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+class AlbumArtPrefetcher {
+public:
+    static AlbumArtPrefetcher& getInstance();
+
+    // Create the worker task. Call once from setup(), after the SD card
+    // is mounted.
+    bool begin();
+
+    // Replace the pending list with these albums, decoded at w x h. At
+    // most MAX_PENDING are taken; names are copied.
+    void request(const char* const* albumNames, int count, int w, int h);
+
+    // Drop anything still pending (e.g. leaving the album browser).
+    void cancel();
+
+    static const int MAX_PENDING = 8;
+
+private:
+    AlbumArtPrefetcher();
+    AlbumArtPrefetcher(const AlbumArtPrefetcher&) = delete;
+    AlbumArtPrefetcher& operator=(const AlbumArtPrefetcher&) = delete;
+
+    static void taskEntry(void* param);
+    void run();
+    bool takeNext(char* nameOut, size_t nameLen, int* wOut, int* hOut);
+
+    char pending[MAX_PENDING][256];   // album folder names, up to 255 bytes
+    int pendingCount;
+    int pendingNext;        // index of the next name to decode
+    int pendingW, pendingH;
+
+    SemaphoreHandle_t mutex;
+    TaskHandle_t task;
+};
+
+#endif // ALBUM_ART_PREFETCHER_H
@@ -0,0 +1,444 @@
+// =====================================================================
+//  HttpRequestParser.cpp - Incremental HTTP request parser
+// =====================================================================
+
+#include "HttpRequestParser.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static bool containsNoCase(const char* haystack, const char* needle) {
+    size_t n = strlen(needle);
+    for (; *haystack; haystack++) {
+        if (strncasecmp(haystack, needle, n) == 0) return true;
+    }
+    return false;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+HttpRequestParser::HttpRequestParser(Handler& handler)
+    : _handler(handler)
+{
+    reset();
+}
+
+void HttpRequestParser::reset() {
+    _state = RequestLine;
+    _errorStatus = 0;
+    _lineLen = 0;
+    _lineOverflow = false;
+    _method = Other;
+    _path[0] = '\0';
+    _chunked = false;
+    _hasLength = false;
+    _expectContinue = false;
+    _contentLength = 0;
+    _remaining = 0;
+    _chunkState = ChunkSize;
+    _delim[0] = '\0';
+    _delimLen = 0;
+    _matched = 0;
+    _partState = Preamble;
+    _afterDelimLen = 0;
+    _partIsFile = false;
+    _partLineLen = 0;
+    _partLineOverflow = false;
+    _partName[0] = '\0';
+}
+
+void HttpRequestParser::fail(int status) {
+    _state = Error;
+    _errorStatus = status;
+}
+
+// Collects one line across calls; true once it's complete (in line,
+// CR/LF stripped). Anything past the buffer is dropped and flagged.
+bool HttpRequestParser::takeLine(const uint8_t*& p, const uint8_t* end,
+                                 char* line, size_t* lineLen, bool* overflow) {
+    while (p < end) {
+        char c = (char)*p++;
+        if (c == '\n') {
+            size_t len = *lineLen;
+            if (len && line[len - 1] == '\r') len--;
+            line[len] = '\0';
+            *lineLen = 0;
+            return true;
+        }
+        if (*lineLen < MAX_LINE - 1) line[(*lineLen)++] = c;
+        else *overflow = true;
+    }
+    return false;
+}
+
+size_t HttpRequestParser::feed(const uint8_t* data, size_t len) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+
+    while (p < end && _state != Done && _state != Error) {
+        switch (_state) {
+        case RequestLine:
+            if (!takeLine(p, end, _line, &_lineLen, &_lineOverflow)) break;
+            if (_lineOverflow) {
+                fail(414);
+            } else if (_line[0] != '\0') {     // blank lines before a request are allowed
+                if (parseRequestLine()) _state = Headers;
+                else if (_state != Error) fail(400);
+            }
+            break;
+
+        case Headers:
+            if (!takeLine(p, end, _line, &_lineLen, &_lineOverflow)) break;
+            if (_line[0] == '\0' && !_lineOverflow) {
+                headersDone();
+            } else if (!_lineOverflow) {
+                parseHeader();
+            }
+            _lineOverflow = false;      // long cookies and the like: nothing we need
+            break;
+
+        case Body:
+            if (!_chunked) {
+                size_t n = (uint64_t)(end - p) < _remaining ? (size_t)(end - p) : (size_t)_remaining;
+                _remaining -= n;
+                bodyData(p, n);
+                p += n;
+                if (_state == Body && _remaining == 0) bodyDone();
+                break;
+            }
+
+            switch (_chunkState) {
+            case ChunkSize:
+                if (!takeLine(p, end, _line, &_lineLen, &_lineOverflow)) break;
+                {
+                    char* digits;
+                    unsigned long long size = strtoull(_line, &digits, 16);
+                    if (digits == _line || _lineOverflow) {
+                        fail(400);
+                    } else if (size == 0) {
+                        _chunkState = Trailers;
+                    } else {
+                        _remaining = size;
+                        _chunkState = ChunkData;
+                    }
+                }
+                break;
+            case ChunkData: {
+                size_t n = (uint64_t)(end - p) < _remaining ? (size_t)(end - p) : (size_t)_remaining;
+                _remaining -= n;
+                bodyData(p, n);
+                p += n;
+                if (_remaining == 0) _chunkState = ChunkDataEnd;
+                break;
+            }
+            case ChunkDataEnd:
+                if (!takeLine(p, end, _line, &_lineLen, &_lineOverflow)) break;
+                if (_line[0] != '\0') fail(400);
+                else _chunkState = ChunkSize;
+                break;
+            case Trailers:
+                if (!takeLine(p, end, _line, &_lineLen, &_lineOverflow)) break;
+                if (_line[0] == '\0' && !_lineOverflow) bodyDone();
+                _lineOverflow = false;
+                break;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+    return p - data;
+}
+
+bool HttpRequestParser::parseRequestLine() {
+    char* target = strchr(_line, ' ');
+    if (!target) return false;
+    *target++ = '\0';
+    char* version = strchr(target, ' ');
+    if (!version) return false;
+    *version++ = '\0';
+    if (strncmp(version, "HTTP/1.", 7) != 0) return false;
+
+    if (!strcmp(_line, "GET") || !strcmp(_line, "HEAD")) _method = Get;
+    else if (!strcmp(_line, "PUT")) _method = Put;
+    else if (!strcmp(_line, "POST")) _method = Post;
+    else if (!strcmp(_line, "DELETE")) _method = Delete;
+    else _method = Other;
+
+    // Absolute form, as sent to proxies
+    if (strncasecmp(target, "http://", 7) == 0) {
+        target = strchr(target + 7, '/');
+        if (!target) return false;
+    }
+    if (target[0] != '/') return false;
+
+    size_t len = 0;
+    for (const char* s = target; *s && *s != '?' && *s != '#'; s++) {
+        int c = (unsigned char)*s;
+        if (c == '%') {
+            int hi = hexDigit(s[1]);
+            int lo = hi < 0 ? -1 : hexDigit(s[2]);
+            if (lo < 0) return false;
+            c = hi * 16 + lo;
+            s += 2;
+        }
+        if (c < 0x20 || c == 0x7F) return false;
+        if (len >= MAX_PATH - 1) {
+            fail(414);
+            return false;
+        }
+        _path[len++] = (char)c;
+    }
+    _path[len] = '\0';
+    return true;
+}
+
+void HttpRequestParser::parseHeader() {
+    char* value = strchr(_line, ':');
+    if (!value) return;
+    *value++ = '\0';
+    while (*value == ' ' || *value == '\t') value++;
+    size_t len = strlen(value);
+    while (len && (value[len - 1] == ' ' || value[len - 1] == '\t')) value[--len] = '\0';
+
+    if (!strcasecmp(_line, "Content-Length")) {
+        char* digits;
+        _contentLength = strtoull(value, &digits, 10);
+        if (digits == value || *digits != '\0') fail(400);
+        _hasLength = true;
+    } else if (!strcasecmp(_line, "Transfer-Encoding")) {
+        if (containsNoCase(value, "chunked")) _chunked = true;
+        else fail(501);
+    } else if (!strcasecmp(_line, "Expect")) {
+        if (!strcasecmp(value, "100-continue")) _expectContinue = true;
+    } else if (!strcasecmp(_line, "Content-Type")) {
+        if (strncasecmp(value, "multipart/form-data", 19) != 0) return;
+        const char* b = value;
+        while (*b && strncasecmp(b, "boundary=", 9) != 0) b++;
+        if (!*b) {
+            fail(400);
+            return;
+        }
+        b += 9;
+        size_t n;
+        if (*b == '"') {
+            b++;
+            n = strcspn(b, "\"");
+        } else {
+            n = strcspn(b, "; \t");
+        }
+        if (n == 0 || n > MAX_BOUNDARY) {
+            fail(400);
+            return;
+        }
+        memcpy(_delim, "\r\n--", 4);
+        memcpy(_delim + 4, b, n);
+        _delimLen = 4 + n;
+        _delim[_delimLen] = '\0';
+    }
+}
+
+void HttpRequestParser::headersDone() {
+    // Only a POST body is taken apart; a multipart PUT is stored as sent
+    if (_method != Post) _delimLen = 0;
+
+    if (_chunked) {
+        _contentLength = 0;
+        _remaining = 0;
+        _chunkState = ChunkSize;
+    } else if (_hasLength) {
+        _remaining = _contentLength;
+    } else if (_method == Put || _method == Post) {
+        fail(411);
+        return;
+    }
+
+    int status = _handler.onHeaders(*this);
+    if (status) {
+        fail(status);
+        return;
+    }
+    _state = Body;
+
+    if (isMultipart()) {
+        // The first delimiter has no CRLF in front - start as if it had
+        _partState = Preamble;
+        _matched = 2;
+    } else if (_method == Put) {
+        status = _handler.onFileBegin("");
+        if (status) {
+            fail(status);
+            return;
+        }
+        _partIsFile = true;
+    }
+
+    if (!_chunked && _remaining == 0) bodyDone();
+}
+
+void HttpRequestParser::bodyData(const uint8_t* data, size_t len) {
+    if (isMultipart()) {
+        multipartData(data, data + len);
+    } else if (_partIsFile && len) {
+        int status = _handler.onFileData(data, len);
+        if (status) fail(status);
+    }
+}
+
+void HttpRequestParser::bodyDone() {
+    if (isMultipart()) {
+        if (_partState != Epilogue) {
+            fail(400);      // body ended before the closing delimiter
+            return;
+        }
+    } else if (_partIsFile) {
+        _partIsFile = false;
+        int status = _handler.onFileEnd();
+        if (status) {
+            fail(status);
+            return;
+        }
+    }
+    _state = Done;
+}
+
+void HttpRequestParser::partData(const uint8_t* data, size_t len) {
+    if (_partState != PartData || !_partIsFile || !len) return;
+    int status = _handler.onFileData(data, len);
+    if (status) fail(status);
+}
+
+void HttpRequestParser::multipartData(const uint8_t* p, const uint8_t* end) {
+    while (p < end && _state == Body) {
+        switch (_partState) {
+        case Epilogue:
+            return;
+
+        case AfterDelimiter:
+            // "--" closes the body, CRLF starts another part
+            _afterDelim[_afterDelimLen++] = *p++;
+            if (_afterDelimLen < 2) break;
+            if (!memcmp(_afterDelim, "--", 2)) {
+                _partState = Epilogue;
+            } else if (!memcmp(_afterDelim, "\r\n", 2)) {
+                _partState = PartHeaders;
+                _partLineLen = 0;
+                _partLineOverflow = false;
+                _partName[0] = '\0';
+            } else {
+                fail(400);
+            }
+            break;
+
+        case PartHeaders:
+            if (!takeLine(p, end, _partLine, &_partLineLen, &_partLineOverflow)) break;
+            if (_partLine[0] != '\0' || _partLineOverflow) {
+                if (!_partLineOverflow) partHeader();
+                _partLineOverflow = false;
+                break;
+            }
+            _partState = PartData;
+            _matched = 0;
+            _partIsFile = _partName[0] != '\0';     // form fields are skipped
+            if (_partIsFile) {
+                int status = _handler.onFileBegin(_partName);
+                if (status) fail(status);
+            }
+            break;
+
+        case Preamble:
+        case PartData: {
+            // Data is passed on in runs straight from the caller's buffer.
+            // A partial delimiter match that began in this buffer is held
+            // back by position; one carried over from the last buffer is
+            // a prefix of _delim, so if it falls through it's passed on
+            // from there.
+            const uint8_t* run = p;
+            const uint8_t* matchStart = nullptr;
+            bool found = false;
+            while (p < end) {
+                if (_matched == 0) {
+                    const uint8_t* cr = (const uint8_t*)memchr(p, '\r', end - p);
+                    if (!cr) {
+                        p = end;
+                        break;
+                    }
+                    matchStart = cr;
+                    _matched = 1;
+                    p = cr + 1;
+                    continue;
+                }
+                if (*p == (uint8_t)_delim[_matched]) {
+                    p++;
+                    if (++_matched == _delimLen) {
+                        found = true;
+                        break;
+                    }
+                    continue;
+                }
+                // Not the delimiter - what matched was data. A boundary
+                // can't hold a CR, so no later start is inside it; *p is
+                // looked at again from scratch.
+                if (!matchStart) {
+                    partData((const uint8_t*)_delim, _matched);
+                    if (_state != Body) return;
+                    run = p;
+                }
+                matchStart = nullptr;
+                _matched = 0;
+            }
+
+            if (!found) {
+                const uint8_t* runEnd = _matched == 0 ? p : (matchStart ? matchStart : run);
+                partData(run, runEnd - run);
+                break;
+            }
+
+            if (matchStart) partData(run, matchStart - run);
+            if (_state != Body) return;
+            if (_partState == PartData && _partIsFile) {
+                _partIsFile = false;
+                int status = _handler.onFileEnd();
+                if (status) {
+                    fail(status);
+                    return;
+                }
+            }
+            _partState = AfterDelimiter;
+            _afterDelimLen = 0;
+            _matched = 0;
+            break;
+        }
+        }
+    }
+}
+
+// Picks filename="..." out of a part's Content-Disposition
+void HttpRequestParser::partHeader() {
+    if (strncasecmp(_partLine, "Content-Disposition:", 20) != 0) return;
+
+    const char* s = _partLine + 20;
+    while ((s = strchr(s, ';')) != nullptr) {
+        s++;
+        while (*s == ' ' || *s == '\t') s++;
+        if (strncasecmp(s, "filename=", 9) != 0) continue;
+        s += 9;
+        size_t n;
+        if (*s == '"') {
+            s++;
+            n = strcspn(s, "\"");   // browsers send a quote in a name as %22
+        } else {
+            n = strcspn(s, ";");
+        }
+        if (n >= sizeof(_partName)) n = sizeof(_partName) - 1;
+        memcpy(_partName, s, n);
+        _partName[n] = '\0';
+        return;
+    }
+}
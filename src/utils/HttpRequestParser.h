@@ -0,0 +1,154 @@
+// =====================================================================
+//  HttpRequestParser.h - Incremental HTTP/1.1 request parser for uploads
+//
+//  Fed whatever the socket hands over, a few bytes or a few KB at a
+//  time, and never buffers a body: file data is passed to the Handler
+//  as pointers into the caller's buffer as soon as it's known not to be
+//  framing. That covers the three ways a file arrives:
+//
+//    PUT with Content-Length              curl -T, scripts
+//    PUT with Transfer-Encoding: chunked  curl -T - (piped), fetch()
+//    POST multipart/form-data             browser <input type=file>,
+//                                         one or many files, chunked
+//                                         or not
+//
+//  Multipart boundaries are found with a running match against
+//  "\r\n--boundary", so one split across two reads costs nothing extra
+//  and the part's data is never copied to look for it.
+//
+//  Plain C++ - no Arduino or ESP-IDF headers - so it builds and can be
+//  exercised on a desktop against a real HTTP client: test/
+//  test_http_parser serves it on a local socket (pio test -e native).
+// =====================================================================
+
+#ifndef HTTP_REQUEST_PARSER_H
+#define HTTP_REQUEST_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class HttpRequestParser {
+public:
+    enum Method {
+        Get,
+        Put,
+        Post,
+        Delete,
+        Other
+    };
+
+    // Each callback returns 0 to carry on, or an HTTP status to stop
+    // the request with (errorStatus()).
+    class Handler {
+    public:
+        virtual ~Handler() {}
+
+        // Request line and headers are in; the body hasn't started.
+        virtual int onHeaders(const HttpRequestParser& request) = 0;
+
+        // A file starts: the body of a PUT (name ""), or each multipart
+        // part that has a filename (name as sent - may hold a relative
+        // path for folder uploads). Other parts are skipped.
+        virtual int onFileBegin(const char* name) = 0;
+        virtual int onFileData(const uint8_t* data, size_t len) = 0;
+        virtual int onFileEnd() = 0;
+    };
+
+    explicit HttpRequestParser(Handler& handler);
+
+    // Ready for a new request.
+    void reset();
+
+    // Returns how much was used - less than len only once the request
+    // is complete or has failed.
+    size_t feed(const uint8_t* data, size_t len);
+
+    bool isDone() const { return _state == Done; }
+    bool failed() const { return _state == Error; }
+    int errorStatus() const { return _errorStatus; }
+
+    // Headers are in and the body is wanted: time to answer
+    // "Expect: 100-continue" if the client asked.
+    bool inBody() const { return _state == Body; }
+    bool expectsContinue() const { return _expectContinue; }
+
+    Method method() const { return _method; }
+    const char* path() const { return _path; }     // %-decoded, query dropped
+    bool isChunked() const { return _chunked; }
+    bool isMultipart() const { return _delimLen > 0; }
+    uint64_t contentLength() const { return _contentLength; }   // 0 if chunked
+
+    // Body bytes still to come, when that's known (not chunked).
+    uint64_t bodyRemaining() const { return _chunked ? 0 : _remaining; }
+
+    static const size_t MAX_LINE = 512;
+    static const size_t MAX_PATH = 256;
+    static const size_t MAX_BOUNDARY = 70;      // RFC 2046
+
+private:
+    enum State {
+        RequestLine,
+        Headers,
+        Body,
+        Done,
+        Error
+    };
+
+    enum ChunkState {
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailers
+    };
+
+    enum PartState {
+        Preamble,
+        AfterDelimiter,
+        PartHeaders,
+        PartData,
+        Epilogue
+    };
+
+    bool takeLine(const uint8_t*& p, const uint8_t* end, char* line, size_t* lineLen, bool* overflow);
+    bool parseRequestLine();
+    void parseHeader();
+    void headersDone();
+    void bodyData(const uint8_t* data, size_t len);
+    void bodyDone();
+    void multipartData(const uint8_t* p, const uint8_t* end);
+    void partData(const uint8_t* data, size_t len);
+    void partHeader();
+    void fail(int status);
+
+    Handler& _handler;
+    State _state;
+    int _errorStatus;
+
+    char _line[MAX_LINE];
+    size_t _lineLen;
+    bool _lineOverflow;
+
+    Method _method;
+    char _path[MAX_PATH];
+    bool _chunked;
+    bool _hasLength;
+    bool _expectContinue;
+    uint64_t _contentLength;
+    uint64_t _remaining;        // of the body, or of the current chunk
+    ChunkState _chunkState;
+
+    // Multipart: "\r\n--" + boundary
+    char _delim[4 + MAX_BOUNDARY + 1];
+    size_t _delimLen;
+    size_t _matched;            // of _delim, so far
+    PartState _partState;
+    uint8_t _afterDelim[2];
+    size_t _afterDelimLen;
+    bool _partIsFile;
+    char _partLine[MAX_LINE];
+    size_t _partLineLen;
+    bool _partLineOverflow;
+    char _partName[MAX_PATH];
+};
+
+#endif // HTTP_REQUEST_PARSER_H
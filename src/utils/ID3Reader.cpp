@@ -0,0 +1,244 @@
+// =====================================================================
+//  ID3Reader.cpp - ID3v2/v1 title and artist implementation
+// =====================================================================
+
+#include "ID3Reader.h"
+#include <SdFat.h>
+
+static uint32_t synchsafe32(const uint8_t* p) {
+    return ((uint32_t)(p[0] & 0x7F) << 21) | ((uint32_t)(p[1] & 0x7F) << 14) |
+           ((uint32_t)(p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+static uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Appends one code point as UTF-8 if ALL of it fits (plus the NUL) -
+// a name never ends in half a character. false = out is full.
+static bool appendUtf8(char* out, size_t outSize, size_t& pos, uint32_t cp) {
+    uint8_t bytes[4];
+    size_t n;
+    if (cp < 0x80) {
+        bytes[0] = cp; n = 1;
+    } else if (cp < 0x800) {
+        bytes[0] = 0xC0 | (cp >> 6); bytes[1] = 0x80 | (cp & 0x3F); n = 2;
+    } else if (cp < 0x10000) {
+        bytes[0] = 0xE0 | (cp >> 12); bytes[1] = 0x80 | ((cp >> 6) & 0x3F);
+        bytes[2] = 0x80 | (cp & 0x3F); n = 3;
+    } else {
+        bytes[0] = 0xF0 | (cp >> 18); bytes[1] = 0x80 | ((cp >> 12) & 0x3F);
+        bytes[2] = 0x80 | ((cp >> 6) & 0x3F); bytes[3] = 0x80 | (cp & 0x3F); n = 4;
+    }
+    if (pos + n >= outSize) return false;
+    memcpy(out + pos, bytes, n);
+    pos += n;
+    return true;
+}
+
+static void decodeLatin1(const uint8_t* p, size_t n, char* out, size_t outSize, size_t& pos) {
+    for (size_t i = 0; i < n && p[i]; i++) {
+        if (!appendUtf8(out, outSize, pos, p[i])) return;
+    }
+}
+
+static void decodeUtf16(const uint8_t* p, size_t n, bool bigEndian,
+                        char* out, size_t outSize, size_t& pos) {
+    for (size_t i = 0; i + 1 < n; i += 2) {
+        uint32_t unit = bigEndian ? (p[i] << 8) | p[i + 1] : (p[i + 1] << 8) | p[i];
+        if (unit == 0) return;
+
+        if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < n) {
+            uint32_t low = bigEndian ? (p[i + 2] << 8) | p[i + 3] : (p[i + 3] << 8) | p[i + 2];
+            if (low >= 0xDC00 && low < 0xE000) {
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+        }
+        if (!appendUtf8(out, outSize, pos, unit)) return;
+    }
+}
+
+static void decodeUtf8(const uint8_t* p, size_t n, char* out, size_t outSize, size_t& pos) {
+    size_t i = 0;
+    while (i < n && p[i]) {
+        size_t len = p[i] < 0x80 ? 1 : p[i] < 0xE0 ? 2 : p[i] < 0xF0 ? 3 : 4;
+        if (i + len > n || pos + len >= outSize) return;
+        memcpy(out + pos, p + i, len);
+        pos += len;
+        i += len;
+    }
+}
+
+void ID3Reader::decodeText(const uint8_t* data, size_t len, char* out, size_t outSize) {
+    if (!outSize) return;
+    out[0] = '\0';
+    if (len < 2) return;
+
+    const uint8_t* p = data + 1;
+    size_t n = len - 1;
+    size_t pos = 0;
+
+    switch (data[0]) {
+        case 0:
+            decodeLatin1(p, n, out, outSize, pos);
+            break;
+        case 1:
+            // BOM decides; without one, little-endian is what the
+            // common taggers write.
+            if (n >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+                decodeUtf16(p + 2, n - 2, true, out, outSize, pos);
+            } else if (n >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+                decodeUtf16(p + 2, n - 2, false, out, outSize, pos);
+            } else {
+                decodeUtf16(p, n, false, out, outSize, pos);
+            }
+            break;
+        case 2:
+            decodeUtf16(p, n, true, out, outSize, pos);
+            break;
+        case 3:
+            decodeUtf8(p, n, out, outSize, pos);
+            break;
+        default:
+            break;
+    }
+
+    // ID3v1 pads with spaces, and plenty of v2 taggers copied that
+    while (pos > 0 && out[pos - 1] == ' ') pos--;
+    out[pos] = '\0';
+}
+
+uint16_t ID3Reader::parseNumber(const uint8_t* data, size_t len) {
+    // "7", "07", "7/12" - any encoding, so decode first
+    char text[16];
+    decodeText(data, len, text, sizeof(text));
+    const char* p = text;
+    while (*p == ' ') p++;
+    uint32_t n = 0;
+    while (*p >= '0' && *p <= '9' && n < 10000) n = n * 10 + (*p++ - '0');
+    return n;
+}
+
+bool ID3Reader::readV2(FsFile& file, ID3Tags& out) {
+    uint8_t header[10];
+    if (!file.seekSet(0) || file.read(header, sizeof(header)) != (int)sizeof(header)) {
+        return false;
+    }
+    if (memcmp(header, "ID3", 3) != 0) return false;
+
+    uint8_t version = header[3];
+    if (version < 2 || version > 4) return false;
+    if (header[5] & 0x80) return false;     // tag-wide unsynchronisation
+
+    uint32_t end = 10 + synchsafe32(header + 6);
+    uint32_t pos = 10;
+
+    if (version >= 3 && (header[5] & 0x40)) {
+        uint8_t ext[4];
+        if (file.read(ext, sizeof(ext)) != (int)sizeof(ext)) return false;
+        // v2.3 doesn't count the size field itself, v2.4 does
+        uint32_t extSize = version == 3 ? be32(ext) : synchsafe32(ext);
+        if (extSize > end - pos) return false;
+        pos += version == 3 ? 4 + extSize : extSize;
+    }
+
+    const size_t headerLen = version == 2 ? 6 : 10;
+    bool gotTitle = false;
+    bool gotArtist = false;
+
+    // No early exit on title + artist: TRCK/TPOS can be anywhere, and
+    // walking the rest is one small header read per frame.
+    while (pos + headerLen <= end) {
+        uint8_t fh[10];
+        if (!file.seekSet(pos) || file.read(fh, headerLen) != (int)headerLen) break;
+        if (fh[0] == 0) break;      // padding
+
+        uint32_t size;
+        bool isTitle, isArtist, isTrack, isDisc;
+        uint32_t skip = 0;
+        bool usable = true;
+
+        if (version == 2) {
+            size = ((uint32_t)fh[3] << 16) | (fh[4] << 8) | fh[5];
+            isTitle = memcmp(fh, "TT2", 3) == 0;
+            isArtist = memcmp(fh, "TP1", 3) == 0;
+            isTrack = memcmp(fh, "TRK", 3) == 0;
+            isDisc = memcmp(fh, "TPA", 3) == 0;
+        } else {
+            size = version == 4 ? synchsafe32(fh + 4) : be32(fh + 4);
+            isTitle = memcmp(fh, "TIT2", 4) == 0;
+            isArtist = memcmp(fh, "TPE1", 4) == 0;
+            isTrack = memcmp(fh, "TRCK", 4) == 0;
+            isDisc = memcmp(fh, "TPOS", 4) == 0;
+            uint8_t format = fh[9];
+            if (version == 3) {
+                usable = !(format & 0xC0);          // compressed / encrypted
+            } else {
+                usable = !(format & 0x0E);          // compressed / encrypted / unsynchronised
+                if (format & 0x01) skip = 4;        // data length indicator
+            }
+        }
+
+        // A corrupt size (a raw be32 in v2.3) could otherwise wrap pos
+        // back round to this same frame - forever, under the bus guard
+        uint32_t dataPos = pos + headerLen;
+        if (size > end - dataPos) break;
+        pos = dataPos + size;
+        if (!(isTitle || isArtist || isTrack || isDisc) || !usable || size <= skip) continue;
+
+        uint8_t data[MAX_FRAME_BYTES];
+        size_t len = size - skip;
+        if (len > sizeof(data)) len = sizeof(data);
+        if (!file.seekSet(dataPos + skip) || file.read(data, len) != (int)len) break;
+
+        if (isTitle) {
+            decodeText(data, len, out.title, sizeof(out.title));
+            gotTitle = out.title[0] != '\0';
+        } else if (isArtist) {
+            decodeText(data, len, out.artist, sizeof(out.artist));
+            gotArtist = out.artist[0] != '\0';
+        } else if (isTrack) {
+            out.track = parseNumber(data, len);
+        } else {
+            out.disc = parseNumber(data, len);
+        }
+    }
+    return gotTitle || gotArtist || out.track;
+}
+
+bool ID3Reader::readV1(FsFile& file, ID3Tags& out) {
+    uint64_t size = file.fileSize();
+    if (size < 128) return false;
+
+    uint8_t tag[128];
+    if (!file.seekSet(size - 128) || file.read(tag, sizeof(tag)) != (int)sizeof(tag)) {
+        return false;
+    }
+    if (memcmp(tag, "TAG", 3) != 0) return false;
+
+    // Same path as a Latin-1 v2 frame: encoding byte, then the field
+    uint8_t field[31];
+    field[0] = 0;
+    if (!out.title[0]) {
+        memcpy(field + 1, tag + 3, 30);
+        decodeText(field, sizeof(field), out.title, sizeof(out.title));
+    }
+    if (!out.artist[0]) {
+        memcpy(field + 1, tag + 33, 30);
+        decodeText(field, sizeof(field), out.artist, sizeof(out.artist));
+    }
+    // ID3v1.1: a zero byte ending the comment, then the track number
+    if (!out.track && tag[125] == 0 && tag[126] != 0) {
+        out.track = tag[126];
+    }
+    return out.title[0] || out.artist[0] || out.track;
+}
+
+bool ID3Reader::read(FsFile& file, ID3Tags& out) {
+    memset(&out, 0, sizeof(out));
+    // The v1 trailer means seeking to the end of the file, which on
+    // FAT32 walks the whole cluster chain - only worth it when there's
+    // no v2 tag at all.
+    return readV2(file, out) || readV1(file, out);
+}
@@ -0,0 +1,51 @@
+// =====================================================================
+//  ID3Reader.h - Title/artist from an MP3's ID3 tag
+//
+//  Just enough ID3 for the library index: TIT2 (title), TPE1 (artist)
+//  and TRCK/TPOS (track and disc number, for play order) from an
+//  ID3v2.2/2.3/2.4 tag at the start of the file, with an ID3v1(.1)
+//  trailer as the fallback for files with no v2 tag. Frames
+//  are walked header by header and everything else - APIC cover art in
+//  particular, often hundreds of KB - is seeked over rather than read,
+//  so a tagged file costs a handful of small SD reads.
+//
+//  Text comes out as UTF-8 whatever the tag stored (Latin-1, UTF-16
+//  with BOM, UTF-16BE, UTF-8), truncated on a character boundary.
+//  Not handled: tag-wide unsynchronisation and compressed/encrypted
+//  frames - those fields are just left empty.
+// =====================================================================
+
+#ifndef ID3_READER_H
+#define ID3_READER_H
+
+#include <Arduino.h>
+
+class FsFile;
+
+struct ID3Tags {
+    char title[64];
+    char artist[48];
+    uint16_t track;     // 0 = none; "3/12" gives 3
+    uint16_t disc;      // 0 = none
+};
+
+class ID3Reader {
+public:
+    // Read from an open file (position is moved). true = at least one
+    // field found. Caller holds the SPI1 bus guard.
+    static bool read(FsFile& file, ID3Tags& out);
+
+    // One text frame's body (encoding byte first) -> UTF-8 in out.
+    static void decodeText(const uint8_t* data, size_t len, char* out, size_t outSize);
+
+    // Largest text frame body read; longer ones are cut (and then
+    // truncated to the field anyway).
+    static const size_t MAX_FRAME_BYTES = 160;
+
+private:
+    static bool readV2(FsFile& file, ID3Tags& out);
+    static bool readV1(FsFile& file, ID3Tags& out);
+    static uint16_t parseNumber(const uint8_t* data, size_t len);
+};
+
+#endif // ID3_READER_H
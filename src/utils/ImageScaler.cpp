@@ -0,0 +1,259 @@
+// =====================================================================
+//  ImageScaler.cpp - Fixed-point RGB565 resampler implementation
+// =====================================================================
+
+#include "ImageScaler.h"
+#include <string.h>
+
+// Byte order is a template parameter rather than a per-pixel test, so
+// each kernel's inner loop is straight-line and the compiler can unroll
+// or vectorize it.
+template <bool Swapped>
+static inline uint16_t loadPixel(const uint16_t* p) {
+    uint16_t v = *p;
+    return Swapped ? (uint16_t)((v >> 8) | (v << 8)) : v;
+}
+
+template <bool Swapped>
+static inline uint16_t storeValue(uint32_t r, uint32_t g, uint32_t b) {
+    uint16_t v = (uint16_t)((r << 11) | (g << 5) | b);
+    return Swapped ? (uint16_t)((v >> 8) | (v << 8)) : v;
+}
+
+// One bilinear sample; wx, wy are 8-bit fractions.
+template <bool Swapped>
+static inline uint16_t blend(const uint16_t* row0, const uint16_t* row1,
+                             int x0, int x1, uint32_t wx, uint32_t wy) {
+    uint16_t p00 = loadPixel<Swapped>(row0 + x0);
+    uint16_t p01 = loadPixel<Swapped>(row0 + x1);
+    uint16_t p10 = loadPixel<Swapped>(row1 + x0);
+    uint16_t p11 = loadPixel<Swapped>(row1 + x1);
+
+    // Weights sum to 65536; +32768 rounds to nearest.
+    uint32_t w00 = (256 - wx) * (256 - wy);
+    uint32_t w01 = wx * (256 - wy);
+    uint32_t w10 = (256 - wx) * wy;
+    uint32_t w11 = wx * wy;
+
+    uint32_t r = ((p00 >> 11) * w00 + (p01 >> 11) * w01 +
+                  (p10 >> 11) * w10 + (p11 >> 11) * w11 + 32768) >> 16;
+    uint32_t g = (((p00 >> 5) & 0x3F) * w00 + ((p01 >> 5) & 0x3F) * w01 +
+                  ((p10 >> 5) & 0x3F) * w10 + ((p11 >> 5) & 0x3F) * w11 + 32768) >> 16;
+    uint32_t b = ((p00 & 0x1F) * w00 + (p01 & 0x1F) * w01 +
+                  (p10 & 0x1F) * w10 + (p11 & 0x1F) * w11 + 32768) >> 16;
+    return storeValue<Swapped>(r, g, b);
+}
+
+// Channel sums of n consecutive pixels
+template <bool Swapped>
+static inline void sumRun(const uint16_t* p, uint32_t n,
+                          uint32_t& r, uint32_t& g, uint32_t& b) {
+    uint32_t sr = 0, sg = 0, sb = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t v = loadPixel<Swapped>(p + i);
+        sr += v >> 11;
+        sg += (v >> 5) & 0x3F;
+        sb += v & 0x1F;
+    }
+    r += sr;
+    g += sg;
+    b += sb;
+}
+
+void ImageScaler::scale(const uint16_t* src, int srcW, int srcH,
+                        uint16_t* dst, int dstW, int dstH, int dstStride,
+                        Mode mode, bool swapped) {
+    if (!src || !dst || srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0) return;
+
+    switch (mode) {
+        case Nearest:
+            // Pure copy of existing pixels - byte order doesn't matter.
+            scaleNearest(src, srcW, srcH, dst, dstW, dstH, dstStride);
+            break;
+        case Bilinear:
+            if (swapped) scaleBilinear<true>(src, srcW, srcH, dst, dstW, dstH, dstStride);
+            else scaleBilinear<false>(src, srcW, srcH, dst, dstW, dstH, dstStride);
+            break;
+        case AreaAverage:
+            if (swapped) scaleAreaAverage<true>(src, srcW, srcH, dst, dstW, dstH, dstStride);
+            else scaleAreaAverage<false>(src, srcW, srcH, dst, dstW, dstH, dstStride);
+            break;
+    }
+}
+
+void ImageScaler::fitCentered(const uint16_t* src, int srcW, int srcH,
+                              uint16_t* dst, int boxW, int boxH, bool swapped) {
+    if (!src || !dst || srcW <= 0 || srcH <= 0 || boxW <= 0 || boxH <= 0) return;
+
+    // Fit by whichever axis is tighter - integer cross-multiplication
+    // instead of comparing two float ratios.
+    int targetW, targetH;
+    if ((int64_t)boxW * srcH <= (int64_t)boxH * srcW) {
+        targetW = boxW;
+        targetH = (int)(((int64_t)srcH * boxW + srcW / 2) / srcW);
+    } else {
+        targetH = boxH;
+        targetW = (int)(((int64_t)srcW * boxH + srcH / 2) / srcH);
+    }
+    if (targetW < 1) targetW = 1;
+    if (targetH < 1) targetH = 1;
+    if (targetW > boxW) targetW = boxW;
+    if (targetH > boxH) targetH = boxH;
+
+    memset(dst, 0, (size_t)boxW * boxH * sizeof(uint16_t));
+
+    int offsetX = (boxW - targetW) / 2;
+    int offsetY = (boxH - targetH) / 2;
+    Mode mode = (targetW < srcW || targetH < srcH) ? AreaAverage : Bilinear;
+    if (targetW == srcW && targetH == srcH) mode = Nearest;   // 1:1 - straight copy
+
+    scale(src, srcW, srcH, dst + offsetY * boxW + offsetX, targetW, targetH, boxW, mode, swapped);
+}
+
+void ImageScaler::scaleNearest(const uint16_t* src, int srcW, int srcH,
+                               uint16_t* dst, int dstW, int dstH, int dstStride) {
+    const uint32_t stepX = ((uint32_t)srcW << 16) / dstW;
+    const uint32_t stepY = ((uint32_t)srcH << 16) / dstH;
+
+    // Start half a step in so samples land on source pixel centres.
+    uint32_t fy = stepY >> 1;
+    for (int y = 0; y < dstH; y++, fy += stepY) {
+        const uint16_t* srcRow = src + (fy >> 16) * srcW;
+        uint16_t* out = dst + y * dstStride;
+
+        uint32_t fx = stepX >> 1;
+        for (int x = 0; x < dstW; x++, fx += stepX) {
+            out[x] = srcRow[fx >> 16];
+        }
+    }
+}
+
+template <bool Swapped>
+void ImageScaler::scaleBilinear(const uint16_t* src, int srcW, int srcH,
+                                uint16_t* dst, int dstW, int dstH, int dstStride) {
+    // Centre-aligned mapping: dst pixel x samples source position
+    // (x + 0.5) * srcW / dstW - 0.5, in 16.16. Positions before the first
+    // pixel centre clamp to it, as do positions past the last one.
+    const int32_t stepX = (int32_t)(((int64_t)srcW << 16) / dstW);
+    const int32_t stepY = (int32_t)(((int64_t)srcH << 16) / dstH);
+    const int32_t maxX = (srcW - 1) << 16;
+    const int32_t maxY = (srcH - 1) << 16;
+    const int32_t startX = (stepX >> 1) - 0x8000;
+
+    // Columns split once, so the inner loop needs no clamp: [0, left)
+    // sit before the first centre and [right, dstW) on or past the last,
+    // both a plain vertical blend of the edge column. In between, x0 + 1
+    // is always a real pixel.
+    int left = 0;
+    while (left < dstW && startX + (int64_t)left * stepX < 0) left++;
+    int right = dstW;
+    while (right > left && startX + (int64_t)(right - 1) * stepX >= maxX) right--;
+
+    int32_t fy = (stepY >> 1) - 0x8000;
+    for (int y = 0; y < dstH; y++, fy += stepY) {
+        int32_t cy = fy < 0 ? 0 : (fy > maxY ? maxY : fy);
+        int y0 = cy >> 16;
+        int y1 = (y0 + 1 < srcH) ? y0 + 1 : y0;
+        uint32_t wy = (cy >> 8) & 0xFF;   // 8-bit fraction
+
+        const uint16_t* row0 = src + y0 * srcW;
+        const uint16_t* row1 = src + y1 * srcW;
+        uint16_t* out = dst + y * dstStride;
+
+        for (int x = 0; x < left; x++) {
+            out[x] = blend<Swapped>(row0, row1, 0, 0, 0, wy);
+        }
+        int32_t fx = startX + left * stepX;
+        for (int x = left; x < right; x++, fx += stepX) {
+            int x0 = fx >> 16;
+            out[x] = blend<Swapped>(row0, row1, x0, x0 + 1, (fx >> 8) & 0xFF, wy);
+        }
+        for (int x = right; x < dstW; x++) {
+            out[x] = blend<Swapped>(row0, row1, srcW - 1, srcW - 1, 0, wy);
+        }
+    }
+}
+
+template <bool Swapped>
+void ImageScaler::scaleAreaAverage(const uint16_t* src, int srcW, int srcH,
+                                   uint16_t* dst, int dstW, int dstH, int dstStride) {
+    // Each output pixel covers [start, end) of the source in 24.8 fixed
+    // point; edge pixels contribute by their covered fraction. Only
+    // meant for shrinking (fitCentered() only picks it then), but it's
+    // still correct - just equivalent to nearest - when enlarging.
+    //
+    // Overflow bound: channel (<= 63) * coverage area in 1/65536ths. For
+    // an 8x reduction the area is 2048 * 2048, so the sum stays < 2^28.
+    const uint32_t spanX = ((uint32_t)srcW << 8);
+    const uint32_t spanY = ((uint32_t)srcH << 8);
+
+    // x * spanX / dstW is stepped as quotient + remainder - exact, and no
+    // divide per pixel
+    const uint32_t stepQ = spanX / dstW;
+    const uint32_t stepR = spanX % dstW;
+
+    for (int y = 0; y < dstH; y++) {
+        uint32_t ys = (uint32_t)(((uint64_t)spanY * y) / dstH);
+        uint32_t ye = (uint32_t)(((uint64_t)spanY * (y + 1)) / dstH);
+        uint16_t* out = dst + y * dstStride;
+
+        uint32_t xe = 0, rem = 0;
+
+        for (int x = 0; x < dstW; x++) {
+            uint32_t xs = xe;
+            xe += stepQ;
+            rem += stepR;
+            if (rem >= (uint32_t)dstW) {
+                xe++;
+                rem -= dstW;
+            }
+
+            uint32_t sumW = (xe - xs) * (ye - ys);
+            if (sumW == 0) {   // can't happen for dst <= src, but never divide by zero
+                out[x] = 0;
+                continue;
+            }
+
+            // A partly covered first and last column, full ones between:
+            // per row that's two weighted pixels and one plain run.
+            uint32_t firstX = xs >> 8;
+            uint32_t lastX = (xe - 1) >> 8;
+            uint32_t firstW = firstX == lastX ? xe - xs : ((firstX + 1) << 8) - xs;
+            uint32_t lastW = firstX == lastX ? 0 : xe - (lastX << 8);
+            uint32_t inner = firstX == lastX ? 0 : lastX - firstX - 1;
+
+            uint32_t sumR = 0, sumG = 0, sumB = 0;
+            uint32_t lastY = (ye - 1) >> 8;
+            for (uint32_t sy = ys >> 8; sy <= lastY; sy++) {
+                uint32_t top = (sy << 8) > ys ? (sy << 8) : ys;
+                uint32_t bottom = ((sy + 1) << 8) < ye ? ((sy + 1) << 8) : ye;
+                uint32_t wy = bottom - top;
+                const uint16_t* srcRow = src + sy * srcW;
+
+                uint32_t r = 0, g = 0, b = 0;
+                sumRun<Swapped>(srcRow + firstX + 1, inner, r, g, b);
+                r <<= 8;
+                g <<= 8;
+                b <<= 8;
+
+                uint16_t p = loadPixel<Swapped>(srcRow + firstX);
+                r += (p >> 11) * firstW;
+                g += ((p >> 5) & 0x3F) * firstW;
+                b += (p & 0x1F) * firstW;
+                if (lastW) {
+                    p = loadPixel<Swapped>(srcRow + lastX);
+                    r += (p >> 11) * lastW;
+                    g += ((p >> 5) & 0x3F) * lastW;
+                    b += (p & 0x1F) * lastW;
+                }
+
+                sumR += r * wy;
+                sumG += g * wy;
+                sumB += b * wy;
+            }
+
+            uint32_t half = sumW >> 1;
+            out[x] = storeValue<Swapped>((sumR + half) / sumW, (sumG + half) / sumW, (sumB + half) / sumW);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+// =====================================================================
+//  ImageScaler.h - Fixed-point RGB565 resampler for album art
+//
+//  TJpg_Decoder can only scale by 1/2/4/8, so every cover comes out of
+//  the decoder at "roughly" the right size and has to be resampled into
+//  its box. AlbumArtCache used to do that with a float nearest-neighbour
+//  loop - two float divides per pixel, and blocky output.
+//
+//  No floats anywhere. Nearest and Bilinear walk the source with 16.16
+//  fixed-point step accumulators (no divides in the pixel loops either);
+//  AreaAverage works in 24.8 source coordinates:
+//    Nearest     - cheapest, blocky. Kept for completeness / previews.
+//    Bilinear    - for upscaling (source smaller than the box).
+//    AreaAverage - for downscaling: every source pixel contributes in
+//                  proportion to how much of it the output pixel covers,
+//                  so 1.x-times reductions don't drop or alias rows.
+//
+//  Inner loops carry no clamps or byte-order tests: Bilinear handles its
+//  clamped edge columns in separate loops, AreaAverage sums each row's
+//  fully covered pixels as one plain run, and swapped is a template
+//  parameter. That leaves them to the compiler to unroll/vectorize.
+//
+//  Plain portable C++ with no Arduino dependency - only <stdint.h>.
+//  Golden-image tests and a benchmark: test/test_image_scaler.
+//
+//  Pixels are RGB565. Pass swapped = true for the byte-swapped layout
+//  TJpg_Decoder's setSwapBytes(true) produces and pushImage() expects;
+//  channel maths is done on the unswapped value either way.
+// =====================================================================
+
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <stdint.h>
+
+class ImageScaler {
+public:
+    enum Mode : uint8_t {
+        Nearest = 0,
+        Bilinear,
+        AreaAverage
+    };
+
+    // Resample src (srcW x srcH, tightly packed) into a dstW x dstH
+    // rectangle of dst, whose rows are dstStride pixels apart.
+    static void scale(const uint16_t* src, int srcW, int srcH,
+                      uint16_t* dst, int dstW, int dstH, int dstStride,
+                      Mode mode, bool swapped);
+
+    // Aspect-preserving fit: scales src to the largest size that fits
+    // boxW x boxH, centered, and fills the letterbox bars with black.
+    // Picks AreaAverage when shrinking and Bilinear when enlarging.
+    static void fitCentered(const uint16_t* src, int srcW, int srcH,
+                            uint16_t* dst, int boxW, int boxH, bool swapped);
+
+private:
+    static void scaleNearest(const uint16_t* src, int srcW, int srcH,
+                             uint16_t* dst, int dstW, int dstH, int dstStride);
+    template <bool Swapped>
+    static void scaleBilinear(const uint16_t* src, int srcW, int srcH,
+                              uint16_t* dst, int dstW, int dstH, int dstStride);
+    template <bool Swapped>
+    static void scaleAreaAverage(const uint16_t* src, int srcW, int srcH,
+                                 uint16_t* dst, int dstW, int dstH, int dstStride);
+};
+
+#endif // IMAGE_SCALER_H
@@ -0,0 +1,403 @@
+// =====================================================================
+//  LibraryIndex.cpp - Background library scan implementation
+// =====================================================================
+
+#include "LibraryIndex.h"
+#include "ID3Reader.h"
+#include "SD_Module.h"
+#include "VS1053_Module.h"
+#include "SPIBusLock.h"
+#include <esp_heap_caps.h>
+#include <algorithm>
+
+LibraryIndex& LibraryIndex::getInstance() {
+    static LibraryIndex instance;
+    return instance;
+}
+
+LibraryIndex::LibraryIndex()
+    : _sd(nullptr), _audio(nullptr), _phase(Idle), _generation(0), _scanStartMs(0),
+      _outOfOrder(false), _albumOrderVersion(0),
+      _albums(nullptr), _albumCount(0), _albumCapacity(0),
+      _albumOrder(nullptr), _albumListed(0), _albumOrderCapacity(0),
+      _tracks(nullptr), _trackCount(0), _trackCapacity(0),
+      _trackOrder(nullptr), _trackOrderCapacity(0),
+      _pool(nullptr), _poolUsed(0), _poolCapacity(0)
+{
+}
+
+void LibraryIndex::begin(SD_Module* sd, VS1053_Module* audio) {
+    _sd = sd;
+    _audio = audio;
+    rescan();
+}
+
+bool LibraryIndex::grow(void** buffer, uint32_t* capacity, uint32_t needed, size_t itemSize) {
+    if (needed <= *capacity) return true;
+
+    uint32_t newCapacity = *capacity ? *capacity : 64;
+    while (newCapacity < needed) newCapacity *= 2;
+
+    // PSRAM first - a few thousand tracks is a few hundred KB
+    void* p = heap_caps_realloc(*buffer, newCapacity * itemSize, MALLOC_CAP_SPIRAM);
+    if (!p) p = realloc(*buffer, newCapacity * itemSize);
+    if (!p) {
+        Serial.printf("Library: ✗ Out of memory growing to %lu entries\n", (unsigned long)newCapacity);
+        return false;
+    }
+    *buffer = p;
+    *capacity = newCapacity;
+    return true;
+}
+
+uint32_t LibraryIndex::addString(const char* s) {
+    uint32_t len = strlen(s) + 1;
+    if (!grow((void**)&_pool, &_poolCapacity, _poolUsed + len, 1)) {
+        return 0;   // offset 0 is always ""
+    }
+    uint32_t offset = _poolUsed;
+    memcpy(_pool + offset, s, len);
+    _poolUsed += len;
+    return offset;
+}
+
+void LibraryIndex::rescan() {
+    SPIBusGuard guard;
+
+    if (_albumDir.isOpen()) _albumDir.close();
+    if (_root.isOpen()) _root.close();
+
+    _albumCount = 0;
+    _albumListed = 0;
+    _trackCount = 0;
+    _poolUsed = 0;
+    addString("");
+    _generation++;
+    _albumOrderVersion++;
+    _outOfOrder = false;
+
+    if (!_sd || !_sd->isInitialized()) {
+        Serial.println("Library: SD not initialized, nothing to index");
+        _phase = Done;
+        return;
+    }
+    if (!_root.open("/Music")) {
+        Serial.println("Library: ✗ Failed to open /Music");
+        _phase = Done;
+        return;
+    }
+
+    Serial.println("Library: Indexing /Music in the background...");
+    _scanStartMs = millis();
+    _phase = Scanning;
+}
+
+void LibraryIndex::addTrack(FsFile& file, const char* name) {
+    if (!grow((void**)&_tracks, &_trackCapacity, _trackCount + 1, sizeof(Track)) ||
+        !grow((void**)&_trackOrder, &_trackOrderCapacity, _trackCount + 1, sizeof(uint32_t))) {
+        return;
+    }
+
+    ID3Tags tags;
+    memset(&tags, 0, sizeof(tags));
+    const char* dot = strrchr(name, '.');
+    if (dot && strcasecmp(dot, ".mp3") == 0) {
+        ID3Reader::read(file, tags);
+    }
+    if (!tags.title[0]) {
+        // No tag - the file name, less its extension, is the title
+        size_t len = dot ? (size_t)(dot - name) : strlen(name);
+        if (len >= sizeof(tags.title)) len = sizeof(tags.title) - 1;
+        memcpy(tags.title, name, len);
+        tags.title[len] = '\0';
+    }
+
+    Album& album = _albums[_albumCount - 1];
+    Track& t = _tracks[_trackCount];
+    t.file = addString(name);
+    t.title = addString(tags.title);
+    t.album = _albumCount - 1;
+    t.number = tags.track;
+    t.disc = tags.disc;
+
+    // An album is nearly always one artist - share the previous
+    // track's copy rather than pooling the same name a dozen times.
+    const Track* prev = album.trackCount ? &_tracks[_trackCount - 1] : nullptr;
+    if (!tags.artist[0]) {
+        t.artist = 0;
+    } else if (prev && strcmp(_pool + prev->artist, tags.artist) == 0) {
+        t.artist = prev->artist;
+    } else {
+        t.artist = addString(tags.artist);
+    }
+
+    _trackOrder[_trackCount] = _trackCount;     // until finishAlbum()
+    _trackCount++;
+    album.trackCount++;
+}
+
+bool LibraryIndex::addAlbum(const char* name) {
+    if (!grow((void**)&_albums, &_albumCapacity, _albumCount + 1, sizeof(Album)) ||
+        !grow((void**)&_albumOrder, &_albumOrderCapacity, _albumCount + 1, sizeof(uint32_t))) {
+        return false;
+    }
+
+    // Insert into name order. Usually at or near the end - FAT order is
+    // often roughly alphabetical already - so the memmove is short.
+    uint32_t lo = 0, hi = _albumListed;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (naturalCompare(_pool + _albums[_albumOrder[mid]].name, name) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < _albumListed) {
+        memmove(_albumOrder + lo + 1, _albumOrder + lo, (_albumListed - lo) * sizeof(uint32_t));
+        _albumOrderVersion++;
+    }
+    _albumOrder[lo] = _albumCount;
+    _albumListed++;
+
+    Album& a = _albums[_albumCount++];
+    a.name = addString(name);
+    a.firstTrack = _trackCount;
+    a.trackCount = 0;
+    a.removed = false;
+    return true;
+}
+
+void LibraryIndex::removeAlbum(int album) {
+    _albums[album].removed = true;
+    for (uint32_t i = 0; i < _albumListed; i++) {
+        if (_albumOrder[i] == (uint32_t)album) {
+            memmove(_albumOrder + i, _albumOrder + i + 1, (_albumListed - i - 1) * sizeof(uint32_t));
+            _albumListed--;
+            break;
+        }
+    }
+    _albumOrderVersion++;
+}
+
+void LibraryIndex::finishAlbum(int album) {
+    const Album& a = _albums[album];
+    if (a.trackCount < 2) return;
+
+    // Tag numbers only if the whole album has them - a mix of tagged
+    // and untagged tracks has no one consistent order.
+    bool byTag = true;
+    for (uint32_t i = 0; i < a.trackCount && byTag; i++) {
+        byTag = _tracks[a.firstTrack + i].number != 0;
+    }
+
+    uint32_t* first = _trackOrder + a.firstTrack;
+    std::sort(first, first + a.trackCount, [this, byTag](uint32_t x, uint32_t y) {
+        const Track& tx = _tracks[x];
+        const Track& ty = _tracks[y];
+        if (byTag) {
+            if (tx.disc != ty.disc) return tx.disc < ty.disc;
+            if (tx.number != ty.number) return tx.number < ty.number;
+        }
+        return naturalCompare(_pool + tx.file, _pool + ty.file) < 0;
+    });
+}
+
+int LibraryIndex::naturalCompare(const char* a, const char* b) {
+    const char* startA = a;
+    const char* startB = b;
+
+    while (*a && *b) {
+        if (isdigit((uint8_t)*a) && isdigit((uint8_t)*b)) {
+            // Compare the numbers by value: ignore leading zeros, then
+            // the longer run is bigger, then digit by digit.
+            while (*a == '0') a++;
+            while (*b == '0') b++;
+            const char* digitsA = a;
+            const char* digitsB = b;
+            while (isdigit((uint8_t)*a)) a++;
+            while (isdigit((uint8_t)*b)) b++;
+            int lenA = a - digitsA;
+            int lenB = b - digitsB;
+            if (lenA != lenB) return lenA - lenB;
+            int c = strncmp(digitsA, digitsB, lenA);
+            if (c) return c;
+            continue;
+        }
+        int ca = tolower((uint8_t)*a);
+        int cb = tolower((uint8_t)*b);
+        if (ca != cb) return ca - cb;
+        a++;
+        b++;
+    }
+    if (*a || *b) return *a ? 1 : -1;
+
+    // "01" and "1", "ABC" and "abc": equal so far, but a sort still
+    // needs them in a fixed order
+    return strcmp(startA, startB);
+}
+
+bool LibraryIndex::scanTrack(FsFile& dir) {
+    FsFile file;
+    if (!file.openNext(&dir, O_RDONLY)) return false;
+
+    if (!file.isDirectory()) {
+        char name[256];
+        file.getName(name, sizeof(name));
+        if (_audio && _audio->canDecode(name)) {
+            addTrack(file, name);
+        }
+    }
+    file.close();
+    return true;
+}
+
+bool LibraryIndex::scanEntry() {
+    // Direct access to the global `sd` object - MUST be guarded. Held
+    // for one directory entry only, so playback never waits on more
+    // than one file's ID3 header.
+    SPIBusGuard guard;
+
+    if (!_albumDir.isOpen()) {
+        if (!_albumDir.openNext(&_root, O_RDONLY)) {
+            _root.close();
+            return false;
+        }
+        char name[256];
+        _albumDir.getName(name, sizeof(name));
+        if (!_albumDir.isDirectory() || name[0] == '.' ||
+            strcmp(name, "System Volume Information") == 0 ||
+            (_outOfOrder && findAlbum(name) >= 0) ||
+            !addAlbum(name)) {
+            _albumDir.close();
+        }
+        return true;
+    }
+
+    if (!scanTrack(_albumDir)) {
+        finishAlbum(_albumCount - 1);
+        _albumDir.close();
+    }
+    return true;
+}
+
+int LibraryIndex::findAlbum(const char* name) const {
+    for (uint32_t i = 0; i < _albumCount; i++) {
+        if (!_albums[i].removed && strcmp(_pool + _albums[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int LibraryIndex::indexFolder(const char* name) {
+    char path[300];
+    snprintf(path, sizeof(path), "/Music/%s", name);
+    FsFile dir;
+    if (!dir.open(path) || !dir.isDirectory() || !addAlbum(name)) return -1;
+    while (scanTrack(dir)) {}
+    dir.close();
+    finishAlbum(_albumCount - 1);
+
+    // The background scan may still meet this folder
+    if (_phase == Scanning) _outOfOrder = true;
+    return _albumCount - 1;
+}
+
+int LibraryIndex::requireAlbum(const char* name) {
+    int album = findAlbum(name);
+    bool halfDone = album >= 0 && album == (int)_albumCount - 1 && _albumDir.isOpen();
+    if (album >= 0 && !halfDone) return album;
+
+    SPIBusGuard guard;
+
+    // Tracks of one album are contiguous, so whatever the scan is in
+    // the middle of gets finished first - it may be this very album.
+    while (_albumDir.isOpen()) scanEntry();
+    if (album >= 0) return album;
+
+    album = indexFolder(name);
+    if (album < 0) {
+        Serial.printf("Library: ✗ No album folder /Music/%s\n", name);
+        return -1;
+    }
+    Serial.printf("Library: Indexed '%s' on demand (%lu tracks)\n", name,
+                  (unsigned long)_albums[album].trackCount);
+    return album;
+}
+
+int LibraryIndex::refreshAlbum(const char* name) {
+    if (!_sd || !_sd->isInitialized()) return -1;
+
+    SPIBusGuard guard;
+
+    // Same as requireAlbum(): whatever the scan has half done goes first
+    while (_albumDir.isOpen()) scanEntry();
+
+    int old = findAlbum(name);
+    if (old >= 0) removeAlbum(old);
+    int album = indexFolder(name);
+
+    if (album >= 0) {
+        Serial.printf("Library: Refreshed '%s' (%lu tracks)\n", name,
+                      (unsigned long)_albums[album].trackCount);
+    } else if (old >= 0) {
+        Serial.printf("Library: Removed '%s'\n", name);
+    }
+    return album;
+}
+
+bool LibraryIndex::step() {
+    if (_phase != Scanning) return false;
+
+    uint32_t start = micros();
+    while (micros() - start < STEP_BUDGET_US) {
+        if (!scanEntry()) {
+            _phase = Done;
+            Serial.printf("Library: ✓ %lu albums, %lu tracks indexed in %lu ms (%lu KB)\n",
+                          (unsigned long)_albumCount, (unsigned long)_trackCount,
+                          millis() - _scanStartMs,
+                          (unsigned long)((_albumCapacity * sizeof(Album) +
+                                           _albumOrderCapacity * sizeof(uint32_t) +
+                                           _trackCapacity * sizeof(Track) +
+                                           _trackOrderCapacity * sizeof(uint32_t) +
+                                           _poolCapacity) / 1024));
+            return false;
+        }
+    }
+    return true;
+}
+
+int LibraryIndex::albumAt(int position) const {
+    return (position >= 0 && position < (int)_albumListed) ? _albumOrder[position] : -1;
+}
+
+bool LibraryIndex::albumRemoved(int album) const {
+    return album >= 0 && album < (int)_albumCount && _albums[album].removed;
+}
+
+const char* LibraryIndex::albumName(int album) const {
+    return (album >= 0 && album < (int)_albumCount) ? _pool + _albums[album].name : "";
+}
+
+int LibraryIndex::albumTrackCount(int album) const {
+    return (album >= 0 && album < (int)_albumCount) ? _albums[album].trackCount : 0;
+}
+
+int LibraryIndex::albumTrack(int album, int i) const {
+    if (album < 0 || album >= (int)_albumCount || i < 0 || i >= (int)_albums[album].trackCount) {
+        return -1;
+    }
+    return _trackOrder[_albums[album].firstTrack + i];
+}
+
+int LibraryIndex::trackAlbum(int track) const {
+    return (track >= 0 && track < (int)_trackCount) ? _tracks[track].album : -1;
+}
+
+const char* LibraryIndex::trackFile(int track) const {
+    return (track >= 0 && track < (int)_trackCount) ? _pool + _tracks[track].file : "";
+}
+
+const char* LibraryIndex::trackTitle(int track) const {
+    return (track >= 0 && track < (int)_trackCount) ? _pool + _tracks[track].title : "";
+}
+
+const char* LibraryIndex::trackArtist(int track) const {
+    return (track >= 0 && track < (int)_trackCount) ? _pool + _tracks[track].artist : "";
+}
@@ -0,0 +1,176 @@
+// =====================================================================
+//  LibraryIndex.h - Every album and track on the card, in PSRAM
+//
+//  The browsing screens each scan /Music for themselves and keep what
+//  they find in fixed arrays (50 albums, 100 tracks), which is fine for
+//  paging but gives nothing to search. This is one index of the whole
+//  library: album folders, the decodable files in each, and each MP3's
+//  ID3 title and artist.
+//
+//  It's built in the background. step() is called every loop() and
+//  does at most STEP_BUDGET_US of work - one directory entry at a time,
+//  taking the SPI1 bus guard per entry rather than per step, so the
+//  audio feeder on Core 0 gets the bus between every file. A card with
+//  thousands of tracks fills in over a minute or so while the player
+//  is in use; anything reading the index just sees it grow.
+//
+//  Storage is append-only: fixed-size album/track records plus one
+//  string pool, each grown in PSRAM as needed. Tracks of one album are
+//  contiguous. Strings are returned as pointers into the pool, which
+//  can move when it grows - don't keep one across a step().
+//
+//  Order is worked out here, once, rather than by every screen that
+//  lists something: FAT hands entries back in creation order, which is
+//  whatever order they were copied in. Albums are kept in natural name
+//  order ("Vol 2" before "Vol 10") as they're found. An album's tracks
+//  are sorted when its folder is finished - by TPOS/TRCK disc and track
+//  number when every track has one, else by natural file name order.
+//  Both are permutations on the side, so album and track numbers never
+//  change within a generation.
+//
+//  A screen that needs one album before the scan has got to it calls
+//  requireAlbum(), which indexes that folder on the spot; the scan then
+//  skips it when it arrives there.
+//
+//  refreshAlbum() re-reads one folder after it changed on the card (see
+//  LibraryJournal). The old record is marked removed and dropped from
+//  the name order, and the folder, if it still exists, is indexed again
+//  as a new album at the end. Its old tracks stay in the arrays - a
+//  Playlist may still be walking them - until the next rescan().
+//
+//  Everything here runs on loop() (Core 1), so there's no locking.
+// =====================================================================
+
+#ifndef LIBRARY_INDEX_H
+#define LIBRARY_INDEX_H
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+class SD_Module;
+class VS1053_Module;
+
+class LibraryIndex {
+public:
+    static LibraryIndex& getInstance();
+
+    // Call once from setup(), after the SD card is mounted. Starts the
+    // first scan; step() does the work.
+    void begin(SD_Module* sd, VS1053_Module* audio);
+
+    // Throw the index away and scan again from the top.
+    void rescan();
+
+    // Call every loop(). false once the scan is complete (or there's
+    // no card).
+    bool step();
+    bool isComplete() const { return _phase == Done; }
+
+    // Bumped by rescan(), so anything derived from the index (SearchIndex)
+    // knows to start over rather than append.
+    uint32_t generation() const { return _generation; }
+
+    // Bumped whenever an album is found that sorts before the last one,
+    // i.e. album list positions shift, as well as by rescan().
+    uint32_t albumOrderVersion() const { return _albumOrderVersion; }
+
+    // Album number for a folder name in /Music, -1 if not indexed (yet).
+    int findAlbum(const char* name) const;
+
+    // Same, but if the scan hasn't indexed it yet, do it now. -1 only
+    // if there's no such folder. Caller may hold the SPI1 bus guard.
+    int requireAlbum(const char* name);
+
+    // Index /Music/<name> again from the card, replacing what was there.
+    // Returns the new album number, -1 if the folder is gone.
+    int refreshAlbum(const char* name);
+
+    // Album numbers run 0..albumCount()-1, removed ones included; the
+    // name order (what a list shows) holds the listedAlbumCount() that
+    // aren't.
+    int albumCount() const { return _albumCount; }
+    int listedAlbumCount() const { return _albumListed; }
+    int albumAt(int position) const;            // album at a position in name order
+    bool albumRemoved(int album) const;
+    const char* albumName(int album) const;
+    int albumTrackCount(int album) const;
+    int albumTrack(int album, int i) const;     // album's i-th track in play order
+
+    int trackCount() const { return _trackCount; }
+    int trackAlbum(int track) const;
+    const char* trackFile(int track) const;     // file name in the album folder
+    const char* trackTitle(int track) const;    // ID3 title, else the file name without extension
+    const char* trackArtist(int track) const;   // ID3 artist, else ""
+
+    // strcasecmp, except runs of digits compare by value: "2 x" < "10 x"
+    static int naturalCompare(const char* a, const char* b);
+
+    static const uint32_t STEP_BUDGET_US = 3000;
+
+private:
+    LibraryIndex();
+    LibraryIndex(const LibraryIndex&) = delete;
+    LibraryIndex& operator=(const LibraryIndex&) = delete;
+
+    enum Phase {
+        Idle,
+        Scanning,
+        Done
+    };
+
+    struct Album {
+        uint32_t name;          // pool offsets
+        uint32_t firstTrack;
+        uint32_t trackCount;
+        bool removed;           // replaced by refreshAlbum()
+    };
+
+    struct Track {
+        uint32_t file;
+        uint32_t title;
+        uint32_t artist;
+        uint32_t album;
+        uint16_t number;        // ID3 TRCK, 0 = none
+        uint16_t disc;          // ID3 TPOS, 0 = none
+    };
+
+    bool scanEntry();           // one directory entry; false = scan finished
+    bool scanTrack(FsFile& dir);    // one entry of an album folder; false = folder done
+    bool addAlbum(const char* name);
+    void finishAlbum(int album);    // sort its tracks into play order
+    void removeAlbum(int album);
+    int indexFolder(const char* name);      // whole folder now; -1 = no such folder
+    void addTrack(FsFile& file, const char* name);
+    uint32_t addString(const char* s);
+    bool grow(void** buffer, uint32_t* capacity, uint32_t needed, size_t itemSize);
+
+    SD_Module* _sd;
+    VS1053_Module* _audio;
+    Phase _phase;
+    uint32_t _generation;
+    unsigned long _scanStartMs;
+    bool _outOfOrder;           // requireAlbum() added albums the scan will meet again
+    uint32_t _albumOrderVersion;
+
+    FsFile _root;               // /Music, open while scanning
+    FsFile _albumDir;           // album being scanned, if any
+
+    Album* _albums;
+    uint32_t _albumCount;
+    uint32_t _albumCapacity;
+    uint32_t* _albumOrder;      // album numbers in name order
+    uint32_t _albumListed;      // entries in _albumOrder
+    uint32_t _albumOrderCapacity;
+
+    Track* _tracks;
+    uint32_t _trackCount;
+    uint32_t _trackCapacity;
+    uint32_t* _trackOrder;      // per album range [firstTrack, +trackCount): track numbers in play order
+    uint32_t _trackOrderCapacity;
+
+    char* _pool;
+    uint32_t _poolUsed;
+    uint32_t _poolCapacity;
+};
+
+#endif // LIBRARY_INDEX_H
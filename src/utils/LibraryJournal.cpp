@@ -0,0 +1,90 @@
+// =====================================================================
+//  LibraryJournal.cpp - Changed-album journal implementation
+// =====================================================================
+
+#include "LibraryJournal.h"
+#include "LibraryIndex.h"
+
+LibraryJournal& LibraryJournal::getInstance() {
+    static LibraryJournal instance;
+    return instance;
+}
+
+LibraryJournal::LibraryJournal()
+    : albumCount(0),
+      overflow(false)
+{
+    mutex = xSemaphoreCreateMutex();
+}
+
+void LibraryJournal::record(const char* path) {
+    if (!path) return;
+
+    // Clients send "Music/x" as often as "/Music/x", and some double up
+    // the separators
+    while (*path == '/') path++;
+    if (strncasecmp(path, "Music", 5) != 0 || (path[5] != '/' && path[5] != '\0')) return;
+    path += 5;
+    while (*path == '/') path++;
+
+    size_t len = strcspn(path, "/");
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (len == 0 || len >= sizeof(albums[0])) {
+        // /Music itself was touched (or a name too long to keep)
+        overflow = true;
+    } else if (!overflow) {
+        bool known = false;
+        for (int i = 0; i < albumCount && !known; i++) {
+            known = strncmp(albums[i], path, len) == 0 && albums[i][len] == '\0';
+        }
+        if (!known) {
+            if (albumCount < MAX_ALBUMS) {
+                memcpy(albums[albumCount], path, len);
+                albums[albumCount][len] = '\0';
+                albumCount++;
+            } else {
+                overflow = true;
+            }
+        }
+    }
+    xSemaphoreGive(mutex);
+}
+
+bool LibraryJournal::isEmpty() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool empty = albumCount == 0 && !overflow;
+    xSemaphoreGive(mutex);
+    return empty;
+}
+
+int LibraryJournal::apply() {
+    LibraryIndex& library = LibraryIndex::getInstance();
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (overflow) {
+        albumCount = 0;
+        overflow = false;
+        xSemaphoreGive(mutex);
+        Serial.println("Journal: Too many changes, rescanning the library");
+        library.rescan();
+        return -1;
+    }
+
+    int refreshed = 0;
+    while (albumCount > 0) {
+        // Copy out so a slow folder scan doesn't hold off record()
+        char name[sizeof(albums[0])];
+        strcpy(name, albums[--albumCount]);
+        xSemaphoreGive(mutex);
+
+        library.refreshAlbum(name);
+        refreshed++;
+
+        xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    xSemaphoreGive(mutex);
+
+    if (refreshed) Serial.printf("Journal: ✓ %d album(s) refreshed\n", refreshed);
+    return refreshed;
+}
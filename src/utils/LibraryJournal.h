@@ -0,0 +1,56 @@
+// =====================================================================
+//  LibraryJournal.h - Albums changed on the card since the last index
+//
+//  LibraryIndex builds itself once at boot. Anything that changes
+//  /Music behind its back - an upload session - notes each path it
+//  stores, deletes, renames (both names) or creates here. On the way
+//  out of upload mode, apply() hands just those album folders to
+//  LibraryIndex::refreshAlbum(), so new music shows up straight away
+//  without a full rescan of the card.
+//
+//  Paths are reduced to their album folder (the first component under
+//  /Music) and kept once each. A change to /Music itself, or more
+//  folders than MAX_ALBUMS, isn't worth tracking piecemeal - apply()
+//  falls back to LibraryIndex::rescan().
+//
+//  record() may be called from a network task; apply() runs on loop()
+//  (Core 1) like everything else that touches LibraryIndex.
+// =====================================================================
+
+#ifndef LIBRARY_JOURNAL_H
+#define LIBRARY_JOURNAL_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+class LibraryJournal {
+public:
+    static LibraryJournal& getInstance();
+
+    // A file or folder at path (absolute, e.g. "/Music/Frozen/01.mp3")
+    // was created, written, deleted or renamed. Paths outside /Music
+    // are ignored.
+    void record(const char* path);
+
+    bool isEmpty();
+
+    // Refresh every recorded album in LibraryIndex, then clear.
+    // Returns the number of albums refreshed (-1 = full rescan).
+    int apply();
+
+    static const int MAX_ALBUMS = 16;
+
+private:
+    LibraryJournal();
+    LibraryJournal(const LibraryJournal&) = delete;
+    LibraryJournal& operator=(const LibraryJournal&) = delete;
+
+    char albums[MAX_ALBUMS][256];
+    int albumCount;
+    bool overflow;          // too much changed - rescan everything
+
+    SemaphoreHandle_t mutex;
+};
+
+#endif // LIBRARY_JOURNAL_H
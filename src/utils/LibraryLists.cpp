@@ -0,0 +1,43 @@
+// =====================================================================
+//  LibraryLists.cpp - LibraryIndex list models implementation
+// =====================================================================
+
+#include "LibraryLists.h"
+#include "LibraryIndex.h"
+
+// strncpy that doesn't leave half a UTF-8 character at the cut
+static void copyRow(char* out, const char* in, size_t size) {
+    size_t len = strlen(in);
+    if (len >= size) {
+        len = size - 1;
+        while (len > 0 && ((uint8_t)in[len] & 0xC0) == 0x80) len--;
+    }
+    memcpy(out, in, len);
+    out[len] = '\0';
+}
+
+int AlbumListModel::count() const {
+    return LibraryIndex::getInstance().listedAlbumCount();
+}
+
+void AlbumListModel::fetch(int index, char* out, size_t size) const {
+    LibraryIndex& library = LibraryIndex::getInstance();
+    copyRow(out, library.albumName(library.albumAt(index)), size);
+}
+
+uint32_t AlbumListModel::version() const {
+    return LibraryIndex::getInstance().albumOrderVersion();
+}
+
+int TrackListModel::count() const {
+    return _album >= 0 ? LibraryIndex::getInstance().albumTrackCount(_album) : 0;
+}
+
+void TrackListModel::fetch(int index, char* out, size_t size) const {
+    LibraryIndex& library = LibraryIndex::getInstance();
+    copyRow(out, library.trackTitle(library.albumTrack(_album, index)), size);
+}
+
+uint32_t TrackListModel::version() const {
+    return LibraryIndex::getInstance().generation();
+}
@@ -0,0 +1,39 @@
+// =====================================================================
+//  LibraryLists.h - ListModels over LibraryIndex
+//
+//  What the browsing screens page through with a ListWindow: every
+//  album on the card in name order, or the tracks of one album in play
+//  order (shown by ID3 title, falling back to the file name). Both read
+//  LibraryIndex directly, so a list grows while the background scan is
+//  still filling it in. Album rows are positions, not album numbers -
+//  LibraryIndex::albumAt() maps one to the other.
+// =====================================================================
+
+#ifndef LIBRARY_LISTS_H
+#define LIBRARY_LISTS_H
+
+#include "../ui/ListWindow.h"
+
+class AlbumListModel : public ListModel {
+public:
+    int count() const override;
+    void fetch(int index, char* out, size_t size) const override;
+    uint32_t version() const override;
+};
+
+class TrackListModel : public ListModel {
+public:
+    TrackListModel() : _album(-1) {}
+
+    void setAlbum(int album) { _album = album; }
+    int album() const { return _album; }
+
+    int count() const override;
+    void fetch(int index, char* out, size_t size) const override;
+    uint32_t version() const override;
+
+private:
+    int _album;     // LibraryIndex album, -1 = none
+};
+
+#endif // LIBRARY_LISTS_H
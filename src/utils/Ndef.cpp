@@ -0,0 +1,282 @@
+// =====================================================================
+//  Ndef.cpp - NDEF parser / encoder implementation
+// =====================================================================
+
+#include "Ndef.h"
+#include <string.h>
+
+// TLV types
+static const uint8_t TLV_NULL        = 0x00;
+static const uint8_t TLV_NDEF        = 0x03;
+static const uint8_t TLV_TERMINATOR  = 0xFE;
+
+// Record header flags
+static const uint8_t HDR_MB = 0x80;     // message begin
+static const uint8_t HDR_ME = 0x40;     // message end
+static const uint8_t HDR_CF = 0x20;     // chunked
+static const uint8_t HDR_SR = 0x10;     // short record (1-byte payload length)
+static const uint8_t HDR_IL = 0x08;     // ID length present
+
+// URI record abbreviations, indexed by the identifier code (NFC Forum
+// URI RTD, codes 0x00-0x23).
+static const char* const URI_PREFIXES[] = {
+    "", "http://www.", "https://www.", "http://", "https://", "tel:",
+    "mailto:", "ftp://anonymous:anonymous@", "ftp://ftp.", "ftps://",
+    "sftp://", "smb://", "nfs://", "ftp://", "dav://", "news:",
+    "telnet://", "imap:", "rtsp://", "urn:", "pop:", "sip:", "sips:",
+    "tftp:", "btspp://", "btl2cap://", "btgoep://", "tcpobex://",
+    "irdaobex://", "file://", "urn:epc:id:", "urn:epc:tag:",
+    "urn:epc:pat:", "urn:epc:raw:", "urn:epc:", "urn:nfc:"
+};
+static const uint8_t URI_PREFIX_COUNT = sizeof(URI_PREFIXES) / sizeof(URI_PREFIXES[0]);
+
+// Copy up to n bytes of UTF-8 into out, terminated, never splitting a
+// multi-byte character.
+static void copyUtf8(char* out, size_t outSize, const uint8_t* src, size_t n) {
+    if (outSize == 0) return;
+    if (n > outSize - 1) {
+        n = outSize - 1;
+        while (n > 0 && (src[n] & 0xC0) == 0x80) n--;   // src[n] is the first byte cut
+    }
+    memcpy(out, src, n);
+    out[n] = '\0';
+}
+
+// --- NdefRecord -----------------------------------------------------------
+
+bool NdefRecord::is(uint8_t wantTnf, const char* typeName) const {
+    size_t n = strlen(typeName);
+    return tnf == wantTnf && typeLength == n && memcmp(type, typeName, n) == 0;
+}
+
+bool NdefRecord::decodeText(char* out, size_t outSize, char* lang, size_t langSize) const {
+    if (!is(NDEF_TNF_WELL_KNOWN, "T") || payloadLength < 1) return false;
+
+    uint8_t status = payload[0];
+    if (status & 0x80) return false;                // UTF-16 - not supported
+    uint8_t langLen = status & 0x3F;
+    if (1u + langLen > payloadLength) return false;
+
+    if (lang && langSize) copyUtf8(lang, langSize, payload + 1, langLen);
+    copyUtf8(out, outSize, payload + 1 + langLen, payloadLength - 1 - langLen);
+    return true;
+}
+
+bool NdefRecord::decodeUri(char* out, size_t outSize) const {
+    if (!is(NDEF_TNF_WELL_KNOWN, "U") || payloadLength < 1 || outSize == 0) return false;
+
+    uint8_t code = payload[0];
+    const char* prefix = code < URI_PREFIX_COUNT ? URI_PREFIXES[code] : "";
+    size_t prefixLen = strlen(prefix);
+    if (prefixLen >= outSize) return false;
+
+    memcpy(out, prefix, prefixLen);
+    copyUtf8(out + prefixLen, outSize - prefixLen, payload + 1, payloadLength - 1);
+    return true;
+}
+
+// --- NdefParser -----------------------------------------------------------
+
+NdefParser::NdefParser()
+    : _msg(nullptr), _msgLen(0), _pos(0), _done(true), _malformed(false)
+{
+}
+
+bool NdefParser::begin(const uint8_t* area, size_t len) {
+    _msg = nullptr;
+    _msgLen = 0;
+    _pos = 0;
+    _done = true;
+    _malformed = false;
+
+    size_t i = 0;
+    while (i < len) {
+        uint8_t t = area[i++];
+        if (t == TLV_NULL) continue;
+        if (t == TLV_TERMINATOR) return false;
+
+        // Length: 1 byte, or 0xFF + 2 bytes big-endian
+        if (i >= len) return false;
+        size_t l = area[i++];
+        if (l == 0xFF) {
+            if (i + 2 > len) return false;
+            l = ((size_t)area[i] << 8) | area[i + 1];
+            i += 2;
+        }
+        if (l > len - i) return false;
+
+        if (t == TLV_NDEF) {
+            _msg = area + i;
+            _msgLen = l;
+            _done = (l == 0);
+            return true;
+        }
+        i += l;     // Lock / Memory Control, proprietary - skip
+    }
+    return false;
+}
+
+bool NdefParser::next(NdefRecord& record) {
+    if (_done) return false;
+
+    // Fails the parse and stops iteration
+    auto fail = [this]() { _malformed = true; _done = true; return false; };
+
+    size_t remaining = _msgLen - _pos;
+    const uint8_t* p = _msg + _pos;
+    if (remaining < 3) return fail();
+
+    uint8_t header = p[0];
+    if (header & HDR_CF) return fail();             // chunked records not supported
+
+    size_t i = 1;
+    record.tnf = header & 0x07;
+    record.typeLength = p[i++];
+
+    if (header & HDR_SR) {
+        record.payloadLength = p[i++];
+    } else {
+        if (remaining < i + 4) return fail();
+        record.payloadLength = ((uint32_t)p[i] << 24) | ((uint32_t)p[i + 1] << 16) |
+                               ((uint32_t)p[i + 2] << 8) | p[i + 3];
+        i += 4;
+    }
+
+    record.idLength = 0;
+    if (header & HDR_IL) {
+        if (remaining < i + 1) return fail();
+        record.idLength = p[i++];
+    }
+
+    // Compare against what's left rather than summing, so huge lengths
+    // can't wrap.
+    if (record.typeLength > remaining - i) return fail();
+    record.type = p + i;
+    i += record.typeLength;
+
+    if (record.idLength > remaining - i) return fail();
+    record.id = p + i;
+    i += record.idLength;
+
+    if (record.payloadLength > remaining - i) return fail();
+    record.payload = p + i;
+    i += record.payloadLength;
+
+    _pos += i;
+    if ((header & HDR_ME) || _pos >= _msgLen) _done = true;
+    return true;
+}
+
+// --- NdefWriter -----------------------------------------------------------
+
+// Room kept at the front for the TLV header in its 3-byte-length form:
+// 03 FF hi lo. Short messages slide down by two in finish().
+static const size_t TLV_HEADER_MAX = 4;
+
+NdefWriter::NdefWriter(uint8_t* buffer, size_t capacity)
+    : _buf(buffer), _cap(capacity), _pos(TLV_HEADER_MAX), _lastHeader(0),
+      _hasRecord(false), _overflow(capacity < TLV_HEADER_MAX + 1)
+{
+}
+
+uint8_t* NdefWriter::beginRecord(uint8_t tnf, const char* type, size_t payloadLength) {
+    if (_overflow) return nullptr;
+
+    size_t typeLen = strlen(type);
+    bool shortRecord = payloadLength <= 0xFF;
+    size_t need = 2 + (shortRecord ? 1 : 4) + typeLen + payloadLength;
+    if (typeLen > 0xFF || need > _cap - _pos) {
+        _overflow = true;
+        return nullptr;
+    }
+
+    uint8_t header = (tnf & 0x07) | (shortRecord ? HDR_SR : 0) | (_hasRecord ? 0 : HDR_MB);
+    _lastHeader = _pos;
+    _hasRecord = true;
+
+    _buf[_pos++] = header;
+    _buf[_pos++] = (uint8_t)typeLen;
+    if (shortRecord) {
+        _buf[_pos++] = (uint8_t)payloadLength;
+    } else {
+        _buf[_pos++] = (uint8_t)(payloadLength >> 24);
+        _buf[_pos++] = (uint8_t)(payloadLength >> 16);
+        _buf[_pos++] = (uint8_t)(payloadLength >> 8);
+        _buf[_pos++] = (uint8_t)payloadLength;
+    }
+    memcpy(_buf + _pos, type, typeLen);
+    _pos += typeLen;
+
+    uint8_t* payload = _buf + _pos;
+    _pos += payloadLength;
+    return payload;
+}
+
+bool NdefWriter::addRecord(uint8_t tnf, const char* type,
+                           const uint8_t* payload, size_t payloadLength) {
+    uint8_t* p = beginRecord(tnf, type, payloadLength);
+    if (!p) return false;
+    if (payloadLength) memcpy(p, payload, payloadLength);
+    return true;
+}
+
+bool NdefWriter::addText(const char* text, const char* lang) {
+    size_t langLen = strlen(lang);
+    size_t textLen = strlen(text);
+    if (langLen > 0x3F) return false;
+
+    uint8_t* p = beginRecord(NDEF_TNF_WELL_KNOWN, "T", 1 + langLen + textLen);
+    if (!p) return false;
+    p[0] = (uint8_t)langLen;                        // UTF-8, language length
+    memcpy(p + 1, lang, langLen);
+    memcpy(p + 1 + langLen, text, textLen);
+    return true;
+}
+
+bool NdefWriter::addUri(const char* uri) {
+    uint8_t code = 0;
+    size_t best = 0;
+    for (uint8_t c = 1; c < URI_PREFIX_COUNT; c++) {
+        size_t n = strlen(URI_PREFIXES[c]);
+        if (n > best && strncmp(uri, URI_PREFIXES[c], n) == 0) {
+            code = c;
+            best = n;
+        }
+    }
+
+    size_t restLen = strlen(uri) - best;
+    uint8_t* p = beginRecord(NDEF_TNF_WELL_KNOWN, "U", 1 + restLen);
+    if (!p) return false;
+    p[0] = code;
+    memcpy(p + 1, uri + best, restLen);
+    return true;
+}
+
+size_t NdefWriter::finish() {
+    if (_overflow) return 0;
+
+    if (_hasRecord) _buf[_lastHeader] |= HDR_ME;
+
+    size_t msgLen = _pos - TLV_HEADER_MAX;
+    if (_pos >= _cap) return 0;                     // no room for the terminator
+    if (msgLen > 0xFFFE) return 0;
+
+    size_t start;
+    if (msgLen < 0xFF) {
+        start = 2;
+        _buf[2] = TLV_NDEF;
+        _buf[3] = (uint8_t)msgLen;
+    } else {
+        start = 0;
+        _buf[0] = TLV_NDEF;
+        _buf[1] = 0xFF;
+        _buf[2] = (uint8_t)(msgLen >> 8);
+        _buf[3] = (uint8_t)msgLen;
+    }
+    _buf[_pos++] = TLV_TERMINATOR;
+
+    size_t total = _pos - start;
+    if (start) memmove(_buf, _buf + start, total);
+    _overflow = true;       // one message per writer
+    return total;
+}
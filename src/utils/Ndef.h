@@ -0,0 +1,111 @@
+// =====================================================================
+//  Ndef.h - Allocation-free NDEF TLV / record parser and encoder
+//
+//  Replaces the fixed-offset extractText() (TLV assumed at byte 0,
+//  record type at byte 5, text at byte 9, non-ASCII dropped) and the
+//  hand-built message in writeAlbumTag().
+//
+//  Parsing works in place on the raw tag memory: NdefParser finds the
+//  NDEF Message TLV (skipping NULL, Lock/Memory Control and proprietary
+//  TLVs), then walks its records - short and long, with or without an
+//  ID - handing out pointers into the caller's buffer. Nothing is
+//  copied until a record is decoded (UTF-8 Text, URI with prefix
+//  expansion), and everything is bounds-checked, so truncated or
+//  hostile tag data fails cleanly.
+//
+//  NdefWriter builds a message into a caller buffer and wraps it in the
+//  TLV + terminator a Type 2 / Type 5 tag expects.
+//
+//  Plain C++ with no Arduino dependencies, so it compiles and is
+//  fuzzed on a Linux host as-is - test/test_ndef, pio test -e native.
+// =====================================================================
+
+#ifndef NDEF_H
+#define NDEF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Type Name Format (low 3 bits of the record header)
+enum NdefTnf : uint8_t {
+    NDEF_TNF_EMPTY      = 0x00,
+    NDEF_TNF_WELL_KNOWN = 0x01,     // "T", "U", ...
+    NDEF_TNF_MIME       = 0x02,
+    NDEF_TNF_URI        = 0x03,
+    NDEF_TNF_EXTERNAL   = 0x04,     // "domain:type"
+    NDEF_TNF_UNKNOWN    = 0x05,
+    NDEF_TNF_UNCHANGED  = 0x06
+};
+
+struct NdefRecord {
+    uint8_t tnf;
+    const uint8_t* type;
+    uint8_t typeLength;
+    const uint8_t* id;
+    uint8_t idLength;
+    const uint8_t* payload;
+    uint32_t payloadLength;
+
+    // tnf matches and the type is exactly typeName (no terminator)
+    bool is(uint8_t tnf, const char* typeName) const;
+
+    // Text record ("T"): UTF-8 text into out (always terminated, cut at
+    // a character boundary). lang gets the IANA language code if given.
+    // false for UTF-16 text or a record that isn't Text.
+    bool decodeText(char* out, size_t outSize,
+                    char* lang = nullptr, size_t langSize = 0) const;
+
+    // URI record ("U"): full URI with the abbreviation prefix expanded.
+    bool decodeUri(char* out, size_t outSize) const;
+};
+
+class NdefParser {
+public:
+    NdefParser();
+
+    // area = tag memory from the first TLV on. false if no NDEF Message
+    // TLV is found (or its length runs past the buffer).
+    bool begin(const uint8_t* area, size_t len);
+
+    // Next record of the message. false at the end of the message, or
+    // on a malformed / chunked record (see malformed()).
+    bool next(NdefRecord& record);
+
+    bool malformed() const { return _malformed; }
+
+private:
+    const uint8_t* _msg;
+    size_t _msgLen;
+    size_t _pos;
+    bool _done;
+    bool _malformed;
+};
+
+class NdefWriter {
+public:
+    NdefWriter(uint8_t* buffer, size_t capacity);
+
+    bool addText(const char* text, const char* lang = "en");
+    bool addUri(const char* uri);     // picks the longest matching prefix code
+    bool addRecord(uint8_t tnf, const char* type,
+                   const uint8_t* payload, size_t payloadLength);
+
+    // Sets ME on the last record, wraps the message in its TLV (1- or
+    // 3-byte length) and appends the terminator TLV. Returns the number
+    // of bytes to write to the tag, 0 if anything didn't fit.
+    size_t finish();
+
+private:
+    // Writes a record header for payloadLength bytes; returns where the
+    // payload goes, or nullptr on overflow.
+    uint8_t* beginRecord(uint8_t tnf, const char* type, size_t payloadLength);
+
+    uint8_t* _buf;
+    size_t _cap;
+    size_t _pos;
+    size_t _lastHeader;
+    bool _hasRecord;
+    bool _overflow;
+};
+
+#endif // NDEF_H
@@ -0,0 +1,71 @@
+// =====================================================================
+//  NfcReader.h - Common interface for the NFC reader backends
+//
+//  PN532_Module, RC522_Module and PN5180_Module used to each carry their
+//  own copy of readUserData()/extractText()/monitorForTags(). Now a
+//  backend only does the chip-specific part - find a tag, read/write
+//  its NDEF area, power down - and everything above that (session
+//  tracking, debouncing, NDEF text parsing, tag writing) lives once in
+//  NfcSession.
+//
+//  Which backend is built is picked by a build flag in platformio.ini:
+//      -D NFC_READER_PN5180   PN5180 on SPI1 (ISO15693 + ISO14443A)
+//      -D NFC_READER_RC522    RC522 on SPI1
+//      (neither)              PN532 on I2C - the current hardware
+// =====================================================================
+
+#ifndef NFC_READER_H
+#define NFC_READER_H
+
+#include <Arduino.h>
+
+enum class NfcTagType : uint8_t {
+    None,
+    Iso14443A,      // NTAG21x / Ultralight - NDEF from page 4
+    Iso15693        // ICODE SLIX etc. - NDEF from block 1 (block 0 is the CC)
+};
+
+struct NfcTag {
+    NfcTagType type = NfcTagType::None;
+    uint8_t uid[8];         // 4 or 7 bytes for 14443A, 8 for 15693 (LSB first)
+    uint8_t uidLength = 0;
+
+    bool sameAs(const NfcTag& other) const {
+        return type == other.type && uidLength == other.uidLength &&
+               memcmp(uid, other.uid, uidLength) == 0;
+    }
+};
+
+class NfcReader {
+public:
+    virtual ~NfcReader() {}
+
+    // Bring the chip up. false = not found / not responding.
+    virtual bool begin() = 0;
+    virtual const char* name() const = 0;
+
+    // One detection attempt, bounded by roughly timeoutMs (backends that
+    // can't wait just try once). Fills tag on success.
+    virtual bool detectTag(NfcTag& tag, uint16_t timeoutMs) = 0;
+
+    // The NDEF area of the tag last returned by detectTag(): the bytes
+    // from the first TLV on, whatever the tag's page/block layout.
+    virtual bool readNdefArea(const NfcTag& tag, uint8_t* buffer, size_t len) = 0;
+    virtual bool writeNdefArea(const NfcTag& tag, const uint8_t* data, size_t len) = 0;
+
+    // Is the tag last returned by detectTag() still in the field? Meant
+    // to be cheap enough to call every ~100 ms: backends keep the tag
+    // selected and send it one short command rather than running a new
+    // anticollision. Default: a full detection.
+    virtual bool pingTag(const NfcTag& tag) {
+        NfcTag seen;
+        return detectTag(seen, 20) && seen.sameAs(tag);
+    }
+
+    // Lowest-power state the chip has that a later wakeUp() can leave.
+    // Default: nothing to do.
+    virtual void powerDown() {}
+    virtual void wakeUp() {}
+};
+
+#endif // NFC_READER_H
@@ -0,0 +1,241 @@
+// =====================================================================
+//  NfcSession.cpp - Card session tracking implementation
+// =====================================================================
+
+#include "NfcSession.h"
+#include "TagAlbumCache.h"
+#include "Ndef.h"
+#include "pins.h"
+
+NfcSession::NfcSession(NfcReader& reader)
+    : _reader(reader), _inSession(false), _pingUsable(true),
+      _noReadCount(0), _lastPollMs(0)
+{
+}
+
+bool NfcSession::begin() {
+    Serial.printf("NFC: Using %s reader\n", _reader.name());
+    return _reader.begin();
+}
+
+void NfcSession::postEvent(NfcEvent::Type type, const NfcTag& tag,
+                           const AlbumTag* content, bool fromCache) {
+    NfcEvent ev;
+    ev.type = type;
+    ev.tag = tag;
+    ev.fromCache = fromCache;
+    memset(&ev.content, 0, sizeof(ev.content));
+    if (content) ev.content = *content;
+    if (!_events.push(ev)) {
+        Serial.println("NFC: Event queue full, dropping event");
+    }
+}
+
+bool NfcSession::nextEvent(NfcEvent& ev) {
+    return _events.pop(ev);
+}
+
+void NfcSession::endSession() {
+    Serial.println("NFC: Card removed");
+    _inSession = false;
+    _noReadCount = 0;
+    postEvent(NfcEvent::TagRemoved, _sessionTag);
+
+    // Look for the next card straight away - a swap shows up as a
+    // removal followed by an arrival.
+    _lastPollMs = 0;
+}
+
+void NfcSession::checkPresence() {
+    if (_pingUsable) {
+        if (millis() - _lastPollMs < PRESENCE_PING_MS) return;
+        _lastPollMs = millis();
+
+        if (_reader.pingTag(_sessionTag)) {
+            _noReadCount = 0;
+            return;
+        }
+        if (++_noReadCount < PRESENCE_PING_MISSES) return;
+
+        // Two failed pings. Either the card is gone, or it's still there
+        // but doesn't answer the ping (a READ on a card that isn't an
+        // NTAG) - one real detection tells which.
+        NfcTag tag;
+        if (_reader.detectTag(tag, 30) && tag.sameAs(_sessionTag)) {
+            Serial.println("NFC: Card doesn't answer pings - slow presence checks");
+            _pingUsable = false;
+            _noReadCount = 0;
+            return;
+        }
+        endSession();
+        return;
+    }
+
+    // Fallback: full detection, debounced over several polls.
+    if (millis() - _lastPollMs < POLL_SESSION_MS) return;
+    _lastPollMs = millis();
+
+    NfcTag tag;
+    if (_reader.detectTag(tag, 100) && tag.sameAs(_sessionTag)) {
+        _noReadCount = 0;
+    } else if (++_noReadCount >= NO_READ_THRESHOLD) {
+        endSession();
+    }
+}
+
+void NfcSession::poll() {
+    if (_inSession) {
+        checkPresence();
+        return;
+    }
+
+    if (millis() - _lastPollMs < POLL_IDLE_MS) return;
+    _lastPollMs = millis();
+
+    NfcTag tag;
+    if (_reader.detectTag(tag, 100)) {
+        _noReadCount = 0;
+        _pingUsable = true;
+
+        Serial.println("NFC: Card detected");
+        _inSession = true;
+        _sessionTag = tag;
+        digitalWrite(BT_ENABLE_PIN, LOW);
+
+        // Stay in the session even if the read fails - the card has to
+        // come off the reader before it's looked at again.
+        AlbumTag content;
+        if (TagAlbumCache::getInstance().lookup(tag, content)) {
+            Serial.printf("NFC: Album = '%s' (cached)\n", content.album);
+            postEvent(NfcEvent::TagArrived, tag, &content, true);
+        } else if (readAlbumTag(tag, content)) {
+            Serial.printf("NFC: Album = '%s', track %d%s\n", content.album,
+                          content.startTrack + 1, content.shuffle ? ", shuffle" : "");
+            TagAlbumCache::getInstance().store(tag, content);
+            postEvent(NfcEvent::TagArrived, tag, &content);
+        } else {
+            Serial.println("NFC: Could not read album text");
+            postEvent(NfcEvent::ReadFailed, tag);
+        }
+    }
+}
+
+bool NfcSession::isCardPresent() {
+    NfcTag tag;
+    return _reader.detectTag(tag, 100);
+}
+
+bool NfcSession::parseAlbumTag(const uint8_t* area, size_t len, AlbumTag& out) {
+    memset(&out, 0, sizeof(out));
+
+    NdefParser parser;
+    if (!parser.begin(area, len)) return false;
+
+    NdefRecord record;
+    while (parser.next(record)) {
+        if (!out.album[0] && record.decodeText(out.album, sizeof(out.album))) {
+            // Old writeAlbumTag() layout: status byte 0 (no language)
+            // and the text starting with the "\x02e" it meant as one.
+            if (record.payload[0] == 0 && out.album[0] == 0x02 && out.album[1] == 'e') {
+                memmove(out.album, out.album + 2, strlen(out.album + 2) + 1);
+            }
+        } else if (record.is(NDEF_TNF_EXTERNAL, ALBUM_OPTIONS_TYPE) &&
+                   record.payloadLength >= 3 && record.payload[0] == 1) {
+            out.startTrack = record.payload[1];
+            out.shuffle = record.payload[2] & ALBUM_FLAG_SHUFFLE;
+        }
+    }
+    return out.album[0] != '\0';
+}
+
+bool NfcSession::readAlbumTag(const NfcTag& tag, AlbumTag& out) {
+    uint8_t area[NDEF_AREA_BYTES];
+
+    if (!_reader.readNdefArea(tag, area, sizeof(area))) {
+        return false;
+    }
+    return parseAlbumTag(area, sizeof(area), out);
+}
+
+size_t NfcSession::encodeAlbumTag(const char* albumName, uint8_t startTrack, bool shuffle,
+                                  uint8_t* area) {
+    // A longer name would be read back (and cached) cut short, naming a
+    // folder that doesn't exist
+    if (strlen(albumName) >= sizeof(AlbumTag::album)) return 0;
+
+    memset(area, 0, NDEF_AREA_BYTES);
+    NdefWriter writer(area, NDEF_AREA_BYTES);
+    writer.addText(albumName);
+    if (startTrack || shuffle) {
+        const uint8_t options[] = { 1, startTrack, (uint8_t)(shuffle ? ALBUM_FLAG_SHUFFLE : 0) };
+        writer.addRecord(NDEF_TNF_EXTERNAL, ALBUM_OPTIONS_TYPE, options, sizeof(options));
+    }
+    size_t len = writer.finish();
+    return (len + 3) & ~(size_t)3;
+}
+
+bool NfcSession::writeAlbumTag(const char* albumName, uint8_t startTrack, bool shuffle) {
+    // The terminator TLV ends the message, so whatever a longer old one
+    // left past it doesn't need clearing
+    uint8_t area[NDEF_AREA_BYTES];
+    size_t len = encodeAlbumTag(albumName, startTrack, shuffle, area);
+    if (!len) {
+        Serial.printf("NFC: ✗ Album name too long for a tag: %s\n", albumName);
+        return false;
+    }
+
+    NfcTag tag;
+    if (!_reader.detectTag(tag, 100)) {
+        Serial.println("NFC: No card to write");
+        return false;
+    }
+
+    if (!_reader.writeNdefArea(tag, area, len)) {
+        return false;
+    }
+
+    // The tag now says something else - don't let a later tap play
+    // whatever it was before.
+    AlbumTag content;
+    memset(&content, 0, sizeof(content));
+    strcpy(content.album, albumName);
+    content.startTrack = startTrack;
+    content.shuffle = shuffle;
+    TagAlbumCache::getInstance().store(tag, content);
+    return true;
+}
+
+void NfcSession::runTest(int count) {
+    for (int i = 0; i < count; i++) {
+        Serial.printf("\n--- %s Read %d/%d ---\n", _reader.name(), i + 1, count);
+        Serial.println("Waiting for card...");
+
+        NfcTag tag;
+        unsigned long start = millis();
+        bool found = false;
+        while (!found && millis() - start < 5000) {
+            found = _reader.detectTag(tag, 100);
+            if (!found) delay(10);
+        }
+        if (!found) {
+            Serial.println("No card found (timeout)");
+            continue;
+        }
+
+        Serial.print("UID: ");
+        for (uint8_t j = 0; j < tag.uidLength; j++) {
+            Serial.printf("%02X ", tag.uid[j]);
+        }
+        Serial.println();
+
+        AlbumTag content;
+        if (readAlbumTag(tag, content)) {
+            Serial.printf("Album: \"%s\" (track %d%s)\n", content.album,
+                          content.startTrack + 1, content.shuffle ? ", shuffle" : "");
+        } else {
+            Serial.println("Failed to read album tag");
+        }
+
+        delay(500);
+    }
+}
@@ -0,0 +1,126 @@
+// =====================================================================
+//  NfcSession.h - Card session tracking on top of any NfcReader
+//
+//  One copy of what each reader module used to duplicate: rate-limited
+//  polling, the "card stays on the reader" session with its removal
+//  debounce, NDEF text parsing and album tag writing.
+//
+//  poll() runs one detection pass when one is due and turns what it
+//  sees into NfcEvents; loop() drains them with nextEvent() and hands
+//  them to ScreenManager::handleNfcEvent(). The session logic no
+//  longer reaches into screens itself.
+//
+//  A tag seen before is answered from TagAlbumCache using only its UID;
+//  the NDEF area is read just the first time (or after a rewrite).
+// =====================================================================
+
+#ifndef NFC_SESSION_H
+#define NFC_SESSION_H
+
+#include <Arduino.h>
+#include "NfcReader.h"
+#include "SPSCQueue.h"
+
+// What an album tag carries. Written as a Text record (the album, so
+// a phone shows something sensible) plus an optional "mp3p:opt"
+// external record: { version, startTrack, flags }.
+struct AlbumTag {
+    char album[40];
+    uint8_t startTrack;     // 0-based
+    bool shuffle;
+};
+
+struct NfcEvent {
+    enum Type : uint8_t {
+        TagArrived,     // new card, album text read OK
+        ReadFailed,     // new card, but no album text on it
+        TagRemoved      // session card gone (after the debounce)
+    };
+
+    Type type;
+    NfcTag tag;
+    AlbumTag content;   // TagArrived only
+    bool fromCache;     // TagArrived: content came from TagAlbumCache, tag not read
+};
+
+class NfcSession {
+public:
+    explicit NfcSession(NfcReader& reader);
+
+    bool begin();
+
+    // Call every loop(). Without a card: a detection pass every
+    // POLL_IDLE_MS. With one: a pingTag() every PRESENCE_PING_MS - one
+    // short command to the still-selected tag - so removal is reported
+    // within about PRESENCE_PING_MS * PRESENCE_PING_MISSES. Cards that
+    // don't answer the ping fall back to full detection every
+    // POLL_SESSION_MS, debounced over NO_READ_THRESHOLD misses.
+    void poll();
+    bool nextEvent(NfcEvent& ev);
+
+    // Session state
+    bool inSession() const { return _inSession; }
+    const NfcTag& sessionTag() const { return _sessionTag; }
+
+    // The session card went away while nobody was polling (shelf mode) -
+    // end the session without an event, so placing it again is new.
+    void forgetSession() { _inSession = false; }
+
+    // Direct access for the tag writer and PowerManager
+    bool detectTag(NfcTag& tag, uint16_t timeoutMs) { return _reader.detectTag(tag, timeoutMs); }
+    bool isCardPresent();
+    bool readAlbumTag(const NfcTag& tag, AlbumTag& out);
+    bool writeAlbumTag(const char* albumName, uint8_t startTrack = 0, bool shuffle = false);
+    void powerDown() { _reader.powerDown(); }
+    void wakeUp() { _reader.wakeUp(); }
+
+    // Serial test loop: wait for N cards and print UID + album.
+    void runTest(int count);
+
+    // Album tag from a raw NDEF area (see Ndef.h). Also accepts tags
+    // written by the old writeAlbumTag(), whose Text record had a zero
+    // status byte and "\x02e" in front of the album.
+    static bool parseAlbumTag(const uint8_t* area, size_t len, AlbumTag& out);
+
+    // The NDEF image writeAlbumTag() writes, zero padded to whole 4-byte
+    // pages; area needs NDEF_AREA_BYTES. 0 if the album name is too long
+    // for AlbumTag::album or the message for NDEF_AREA_BYTES - nothing
+    // is ever cut short to fit.
+    static size_t encodeAlbumTag(const char* albumName, uint8_t startTrack, bool shuffle,
+                                 uint8_t* area);
+
+    NfcReader& reader() { return _reader; }
+
+    static const unsigned long POLL_IDLE_MS = 500;
+    static const unsigned long POLL_SESSION_MS = 1000;
+    static const unsigned long NO_READ_THRESHOLD = 4;    // missed polls before "removed"
+    static const unsigned long PRESENCE_PING_MS = 100;
+    static const unsigned long PRESENCE_PING_MISSES = 2;
+    // What's read back: room for a 39-char album Text record + the
+    // options record + TLV. 16 pages - still a single FAST_READ on the
+    // PN532. Writes only cover the encoded message, rounded up to a
+    // page, so a short name still fits a 48-byte Ultralight.
+    static const size_t NDEF_AREA_BYTES = 64;
+
+    static constexpr const char* ALBUM_OPTIONS_TYPE = "mp3p:opt";
+    static const uint8_t ALBUM_FLAG_SHUFFLE = 0x01;
+
+private:
+    void checkPresence();
+    void endSession();
+    void postEvent(NfcEvent::Type type, const NfcTag& tag,
+                   const AlbumTag* content = nullptr, bool fromCache = false);
+
+    NfcReader& _reader;
+    bool _inSession;
+    bool _pingUsable;       // session card answers pingTag()
+    NfcTag _sessionTag;
+    unsigned long _noReadCount;
+    unsigned long _lastPollMs;
+
+    // poll() and nextEvent() both run on loop(), so the SPSC contract
+    // holds trivially.
+    SPSCQueue<NfcEvent, 4> _events;
+};
+
+#endif // NFC_SESSION_H
@@ -0,0 +1,226 @@
+// =====================================================================
+//  PN5180_Module.cpp - PN5180 NFC Reader Implementation
+// =====================================================================
+
+#include "PN5180_Module.h"
+#include "SPIBusLock.h"
+#include "pins.h"
+
+// NTAG21x user memory (and the NDEF TLV) starts at page 4.
+static const uint8_t NTAG_FIRST_USER_PAGE = 4;
+
+// Type 5 (ISO15693) tags keep a 4-byte Capability Container at the
+// start of block 0; the NDEF TLV follows it directly.
+static const uint8_t T5T_CC_BYTES = 4;
+static const size_t  T5T_MAX_IMAGE = 128;
+
+PN5180_Module::PN5180_Module(uint8_t nss, uint8_t busy, uint8_t rst)
+    : iso15693(nss, busy, rst), iso14443(nss, busy, rst), _rfMode(RF_NONE)
+{
+}
+
+bool PN5180_Module::begin() {
+    SPIBusGuard guard;
+
+    Serial.println("PN5180: Initializing...");
+
+    // SPI1 is already running (SPIClass::begin() is a no-op then); this
+    // only sets up the NSS/BUSY/RST pins for each front-end.
+    iso15693.begin(SPI1_SCK, SPI1_MISO, SPI1_MOSI);
+    iso14443.begin(SPI1_SCK, SPI1_MISO, SPI1_MOSI);
+    iso15693.reset();
+
+    uint8_t firmware[2] = {0};
+    iso15693.readEEprom(FIRMWARE_VERSION, firmware, sizeof(firmware));
+    if (firmware[1] == 0xFF || (firmware[0] == 0 && firmware[1] == 0)) {
+        Serial.println("PN5180: ✗ Not responding - check wiring");
+        return false;
+    }
+
+    Serial.printf("PN5180: Firmware version %d.%d ✓\n", firmware[1], firmware[0]);
+    Serial.println("PN5180: ✓ Ready!");
+    return true;
+}
+
+bool PN5180_Module::selectMode(RfMode mode) {
+    // ISO14443A is re-selected every time: cycling the field resets a
+    // card left ACTIVE by the previous poll, so it answers REQA again.
+    if (mode == _rfMode && mode != RF_14443) return true;
+
+    iso15693.setRF_off();
+    bool ok = (mode == RF_15693) ? iso15693.setupRF() : iso14443.setupRF();
+    _rfMode = ok ? mode : RF_NONE;
+    return ok;
+}
+
+bool PN5180_Module::detectTag(NfcTag& tag, uint16_t timeoutMs) {
+    SPIBusGuard guard;
+
+    // ICODE first - an inventory is a single short exchange.
+    uint8_t uid[8];
+    if (selectMode(RF_15693) && iso15693.getInventory(uid) == ISO15693_EC_OK) {
+        tag.type = NfcTagType::Iso15693;
+        tag.uidLength = 8;
+        memcpy(tag.uid, uid, 8);
+        return true;
+    }
+
+    // Then NTAG. readCardSerial() returns ATQA(2) + SAK(1) + UID(7, zero
+    // padded for 4-byte UIDs).
+    uint8_t response[10];
+    if (selectMode(RF_14443)) {
+        int8_t uidLength = iso14443.readCardSerial(response);
+        if (uidLength >= 4) {
+            tag.type = NfcTagType::Iso14443A;
+            tag.uidLength = uidLength > 7 ? 7 : uidLength;
+            memcpy(tag.uid, &response[3], tag.uidLength);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PN5180_Module::readNdefArea(const NfcTag& tag, uint8_t* buffer, size_t len) {
+    SPIBusGuard guard;
+
+    if (tag.type == NfcTagType::Iso15693) return readNdef15693(tag, buffer, len);
+    if (tag.type == NfcTagType::Iso14443A) return readNdef14443(buffer, len);
+    return false;
+}
+
+bool PN5180_Module::writeNdefArea(const NfcTag& tag, const uint8_t* data, size_t len) {
+    SPIBusGuard guard;
+
+    if (tag.type == NfcTagType::Iso15693) return writeNdef15693(tag, data, len);
+    if (tag.type == NfcTagType::Iso14443A) return writeNdef14443(data, len);
+    return false;
+}
+
+bool PN5180_Module::pingTag(const NfcTag& tag) {
+    SPIBusGuard guard;
+
+    // No selectMode() - the field and protocol are still set up from
+    // detectTag(), and re-selecting ISO14443A would cycle the field.
+    if (tag.type == NfcTagType::Iso15693 && _rfMode == RF_15693) {
+        uint8_t uid[8];
+        memcpy(uid, tag.uid, sizeof(uid));
+        uint8_t block[32];
+        return iso15693.readSingleBlock(uid, 0, block, 4) == ISO15693_EC_OK;
+    }
+    if (tag.type == NfcTagType::Iso14443A && _rfMode == RF_14443) {
+        uint8_t page0[16];
+        return iso14443.mifareBlockRead(0, page0);
+    }
+    return false;
+}
+
+void PN5180_Module::powerDown() {
+    SPIBusGuard guard;
+    iso15693.setRF_off();
+    _rfMode = RF_NONE;
+}
+
+// --- ISO15693 -----------------------------------------------------------
+
+bool PN5180_Module::readNdef15693(const NfcTag& tag, uint8_t* buffer, size_t len) {
+    if (!selectMode(RF_15693)) return false;
+
+    uint8_t uid[8];
+    memcpy(uid, tag.uid, sizeof(uid));
+
+    uint8_t blockSize = 4, numBlocks = 0;
+    if (iso15693.getSystemInfo(uid, &blockSize, &numBlocks) != ISO15693_EC_OK || blockSize == 0) {
+        blockSize = 4;   // ICODE SLIX default
+    }
+
+    // The whole CC + NDEF area in one command. Always from block 0: the
+    // library's range check rejects any non-zero start block, and the
+    // CC has to be skipped over anyway.
+    size_t imageBytes = T5T_CC_BYTES + len;
+    uint8_t blocks = (imageBytes + blockSize - 1) / blockSize;
+    if ((size_t)blocks * blockSize > T5T_MAX_IMAGE) return false;
+
+    uint8_t image[T5T_MAX_IMAGE];
+    ISO15693ErrorCode rc = iso15693.readMultipleBlock(uid, 0, blocks, image, blockSize);
+    if (rc != ISO15693_EC_OK) {
+        Serial.printf("PN5180: Read failed (%s)\n", iso15693.strerror(rc));
+        return false;
+    }
+
+    memcpy(buffer, image + T5T_CC_BYTES, len);
+    return true;
+}
+
+bool PN5180_Module::writeNdef15693(const NfcTag& tag, const uint8_t* data, size_t len) {
+    if (!selectMode(RF_15693)) return false;
+
+    uint8_t uid[8];
+    memcpy(uid, tag.uid, sizeof(uid));
+
+    uint8_t blockSize = 4, numBlocks = 0;
+    if (iso15693.getSystemInfo(uid, &blockSize, &numBlocks) != ISO15693_EC_OK || blockSize == 0) {
+        blockSize = 4;
+    }
+
+    size_t imageBytes = T5T_CC_BYTES + len;
+    uint8_t blocks = (imageBytes + blockSize - 1) / blockSize;
+    if ((size_t)blocks * blockSize > T5T_MAX_IMAGE) return false;
+
+    uint8_t image[T5T_MAX_IMAGE];
+    memset(image, 0, sizeof(image));
+
+    // Keep an existing CC; a blank tag gets one (magic E1, version 1.0,
+    // memory size / 8, "read multiple blocks supported").
+    if (iso15693.readSingleBlock(uid, 0, image, blockSize) != ISO15693_EC_OK || image[0] != 0xE1) {
+        image[0] = 0xE1;
+        image[1] = 0x40;
+        image[2] = numBlocks ? (uint8_t)(((uint16_t)numBlocks * blockSize) / 8) : 0x0E;
+        image[3] = 0x01;
+    }
+    memcpy(image + T5T_CC_BYTES, data, len);
+
+    for (uint8_t b = 0; b < blocks; b++) {
+        ISO15693ErrorCode rc = iso15693.writeSingleBlock(uid, b, image + b * blockSize, blockSize);
+        if (rc != ISO15693_EC_OK) {
+            Serial.printf("PN5180: Write failed at block %d (%s)\n", b, iso15693.strerror(rc));
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- ISO14443A (NTAG21x) ------------------------------------------------
+
+bool PN5180_Module::readNdef14443(uint8_t* buffer, size_t len) {
+    // No re-select here: the card is still ACTIVE from detectTag().
+    // READ returns 16 bytes = 4 pages per command.
+    for (size_t offset = 0; offset < len; offset += 16) {
+        uint8_t chunk[16];
+        uint8_t page = NTAG_FIRST_USER_PAGE + offset / 4;
+        if (!iso14443.mifareBlockRead(page, chunk)) {
+            Serial.printf("PN5180: Read failed at page %d\n", page);
+            return false;
+        }
+        size_t n = len - offset < 16 ? len - offset : 16;
+        memcpy(buffer + offset, chunk, n);
+    }
+    return true;
+}
+
+bool PN5180_Module::writeNdef14443(const uint8_t* data, size_t len) {
+    for (size_t offset = 0; offset < len; offset += 4) {
+        // COMPATIBILITY WRITE: 16 bytes on the wire, only the first 4
+        // land in the page.
+        uint8_t block[16] = {0};
+        size_t n = len - offset < 4 ? len - offset : 4;
+        memcpy(block, data + offset, n);
+
+        uint8_t page = NTAG_FIRST_USER_PAGE + offset / 4;
+        uint8_t ack = iso14443.mifareBlockWrite16(page, block);
+        if ((ack & 0x0F) != 0x0A) {
+            Serial.printf("PN5180: Write failed at page %d\n", page);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+// =====================================================================
+//  PN5180_Module.h - PN5180 NFC Reader Module (SPI1)
+//  NfcReader backend over the vendored lib/PN5180_Elechouse driver.
+//
+//  Longer range and faster than the PN532, and it reads both tag
+//  families: ISO15693 (ICODE SLIX - inventory, then the NDEF area in a
+//  single readMultipleBlock) and ISO14443A (the NTAG21x tags already in
+//  use). Each poll tries ISO15693 first, then ISO14443A.
+//
+//  Wiring: shares SPI1 and the RC522's CS/RST lines (NFC_CS, NFC_RST),
+//  plus NFC_BUSY. Build with -D NFC_READER_PN5180.
+// =====================================================================
+
+#ifndef PN5180_MODULE_H
+#define PN5180_MODULE_H
+
+#include <Arduino.h>
+#include <PN5180.h>
+#include <PN5180ISO15693.h>
+#include <PN5180ISO14443.h>
+#include "NfcReader.h"
+
+class PN5180_Module : public NfcReader {
+public:
+    PN5180_Module(uint8_t nss, uint8_t busy, uint8_t rst);
+
+    bool begin() override;
+    const char* name() const override { return "PN5180"; }
+
+    bool detectTag(NfcTag& tag, uint16_t timeoutMs) override;
+    bool readNdefArea(const NfcTag& tag, uint8_t* buffer, size_t len) override;
+    bool writeNdefArea(const NfcTag& tag, const uint8_t* data, size_t len) override;
+
+    // Addressed READ SINGLE BLOCK 0 (ISO15693) / READ page 0 (ISO14443A)
+    bool pingTag(const NfcTag& tag) override;
+
+    // RF field off; the next detectTag() reloads the RF config.
+    void powerDown() override;
+
+private:
+    enum RfMode : uint8_t { RF_NONE, RF_15693, RF_14443 };
+
+    bool selectMode(RfMode mode);
+
+    bool readNdef15693(const NfcTag& tag, uint8_t* buffer, size_t len);
+    bool writeNdef15693(const NfcTag& tag, const uint8_t* data, size_t len);
+    bool readNdef14443(uint8_t* buffer, size_t len);
+    bool writeNdef14443(const uint8_t* data, size_t len);
+
+    // Two protocol front-ends over the same chip and pins.
+    PN5180ISO15693 iso15693;
+    PN5180ISO14443 iso14443;
+    RfMode _rfMode;
+};
+
+#endif // PN5180_MODULE_H
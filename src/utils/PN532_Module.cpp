@@ -3,15 +3,27 @@
 // =====================================================================
 
 #include "PN532_Module.h"
-#include "../managers/ScreenManager.h"
-#include "../screens/KidScreen.h"
 
 extern void touchISR();
+
+// NTAG21x user memory (and the NDEF TLV) starts at page 4.
+static const uint8_t NTAG_FIRST_USER_PAGE = 4;
+
+// Tag commands (sent through InDataExchange)
+static const uint8_t NTAG_CMD_READ      = 0x30;   // 4 pages / 16 bytes
+static const uint8_t NTAG_CMD_FAST_READ = 0x3A;   // page range, NTAG21x only
+
+// Response frame = RDY + preamble/start (3) + LEN/LCS (2) + TFI/cmd/
+// status (3) + data + DCS/postamble (2). The ESP32 Wire buffer is 128
+// bytes, so cap a single FAST_READ well inside it.
+static const uint8_t FRAME_OVERHEAD = 1 + 3 + 2 + 3 + 2;
+static const uint8_t MAX_FAST_READ_PAGES = 16;
+
 // Constructor - I2C mode
 PN532_Module::PN532_Module() : nfc(-1, -1) {
 }
 
-void PN532_Module::begin() {
+bool PN532_Module::begin() {
     Serial.println("PN532: Initializing...");
     
     nfc.begin();
@@ -19,7 +31,7 @@ void PN532_Module::begin() {
     uint32_t versiondata = nfc.getFirmwareVersion();
     if (!versiondata) {
         Serial.println("PN532: ✗ Not found - check wiring");
-        return;
+        return false;
     }
     
     Serial.printf("PN532: Firmware version %d.%d ✓\n",
@@ -28,201 +40,154 @@ void PN532_Module::begin() {
     
     nfc.SAMConfig();
     Serial.println("PN532: ✓ Ready!");
+    return true;
 }
 
-void PN532_Module::monitorForTags(ScreenManager& screenManager) {
-    static bool inCardSession = false;
-    static bool albumNotFound = false;
-    static unsigned long noReadCount = 0;
-    static unsigned long lastCheck = 0;
-    
-    const unsigned long CHECK_INTERVAL = inCardSession ? 1000 : 500;
-    const unsigned long NO_READ_THRESHOLD = 4;
-
-    // Don't monitor when in settings or write tag screens
-    if (screenManager.isOnSettingsScreen() || 
-        screenManager.isOnWriteTagScreen()) return;
-    
-    if (millis() - lastCheck < CHECK_INTERVAL) return;
-    lastCheck = millis();
-
+bool PN532_Module::detectTag(NfcTag& tag, uint16_t timeoutMs) {
     // Detach touch interrupt during NFC read
     detachInterrupt(digitalPinToInterrupt(TOUCH_INT));
-    
-    bool cardFound = nfc.readPassiveTargetID(
-        PN532_MIFARE_ISO14443A, _uid, &_uidLength, 100);
-    
+
+    uint8_t uidLength = 0;
+    bool found = nfc.readPassiveTargetID(
+        PN532_MIFARE_ISO14443A, tag.uid, &uidLength, timeoutMs);
+
     // Reattach touch interrupt
     pinMode(TOUCH_INT, INPUT_PULLUP);
     attachInterrupt(digitalPinToInterrupt(TOUCH_INT), touchISR, FALLING);
 
-    if (cardFound) {
-        noReadCount = 0;
-        
-        if (!inCardSession) {
-            Serial.println("NFC: Card detected");
-            inCardSession = true;
-            albumNotFound = false;
-            digitalWrite(BT_ENABLE_PIN, LOW);
-            
-            char albumText[40];
-            if (readAlbumText(albumText, sizeof(albumText))) {
-                Serial.printf("NFC: Album = '%s'\n", albumText);
-                screenManager.showKids();
-                screenManager.getKidScreen()->showAlbum(albumText);
-                
-                if (!screenManager.getKidScreen()->isAlbumLoaded()) {
-                    Serial.println("NFC: Album not found on SD card");
-                    albumNotFound = true;
-                    // Stay in session - wait for card removal to clear screen
-                }
-            } else {
-                Serial.println("NFC: Could not read album text");
-                albumNotFound = true;
-                // Stay in session - wait for card removal
-            }
-        }
-        // If already in session (found or not found) - do nothing
-        
-    } else if (inCardSession) {
-        noReadCount++;
-        if (noReadCount >= NO_READ_THRESHOLD) {
-            Serial.println("NFC: Card removed");
-            inCardSession = false;
-            albumNotFound = false;
-            noReadCount = 0;
-            // Always clear and return to splash on removal
-            screenManager.getKidScreen()->clearAlbum();
-            screenManager.showSplash();
-        }
-    }
+    if (!found || uidLength > sizeof(tag.uid)) return false;
+    tag.type = NfcTagType::Iso14443A;
+    tag.uidLength = uidLength;
+    return true;
 }
 
-bool PN532_Module::isCardPresent() {
-    detachInterrupt(TOUCH_INT);
-    bool result = nfc.readPassiveTargetID(
-        PN532_MIFARE_ISO14443A, _uid, &_uidLength, 100);
-    pinMode(TOUCH_INT, INPUT_PULLUP);
-    attachInterrupt(digitalPinToInterrupt(TOUCH_INT), touchISR, FALLING);
-    return result;
-}
+bool PN532_Module::exchange(const uint8_t* send, uint8_t sendLen,
+                            uint8_t* response, uint8_t responseLen) {
+    // The library's ntag2xx_ReadPage() issues a 16-byte READ and throws
+    // 12 bytes away, and its inDataExchange() targets the tag number
+    // from InListPassiveTarget, which readPassiveTargetID() never sets.
+    // So build InDataExchange here and read the reply frame directly.
+    uint8_t cmd[2 + 8];
+    if (sendLen > sizeof(cmd) - 2) return false;
+    cmd[0] = PN532_COMMAND_INDATAEXCHANGE;
+    cmd[1] = 1;                                  // first (only) listed target
+    memcpy(&cmd[2], send, sendLen);
 
-void PN532_Module::haltCard() {
-    // PN532 handles this automatically
-}
+    if (!nfc.sendCommandCheckAck(cmd, 2 + sendLen, 100)) return false;
 
-bool PN532_Module::waitForCard(uint32_t timeout_ms) {
-    uint32_t start = millis();
-    while (millis() - start < timeout_ms) {
-        detachInterrupt(digitalPinToInterrupt(TOUCH_INT));
-        bool found = nfc.readPassiveTargetID(
-            PN532_MIFARE_ISO14443A, _uid, &_uidLength, 100);
-        pinMode(TOUCH_INT, INPUT_PULLUP);
-        attachInterrupt(digitalPinToInterrupt(TOUCH_INT), touchISR, FALLING);
-        if (found) return true;
-        delay(10);
+    // Every I2C read starts with the RDY byte; wait for it to go to 1.
+    unsigned long start = millis();
+    while (true) {
+        Wire.requestFrom((uint8_t)PN532_I2C_ADDRESS, (uint8_t)1);
+        if (Wire.available() && (Wire.read() & 0x01)) break;
+        if (millis() - start > 100) return false;
+        delay(1);
     }
-    return false;
+
+    uint8_t total = FRAME_OVERHEAD + responseLen;
+    uint8_t frame[FRAME_OVERHEAD + MAX_FAST_READ_PAGES * 4];
+    if (total > sizeof(frame)) return false;
+
+    Wire.requestFrom((uint8_t)PN532_I2C_ADDRESS, total);
+    uint8_t got = 0;
+    while (Wire.available() && got < total) frame[got++] = Wire.read();
+
+    // RDY, 00 00 FF, LEN, LCS, D5 41 status, data...
+    if (got < total || frame[1] != 0x00 || frame[2] != 0x00 || frame[3] != 0xFF) return false;
+    if (frame[6] != PN532_PN532TOHOST || frame[7] != PN532_COMMAND_INDATAEXCHANGE + 1) return false;
+    if ((frame[8] & 0x3F) != 0x00) return false;         // tag error / NAK
+    if (frame[4] != 3 + responseLen) return false;       // short answer
+
+    memcpy(response, &frame[9], responseLen);
+    return true;
 }
-bool PN532_Module::readUserData(uint8_t *buffer, uint8_t numBytes) {
-    uint8_t startPage = 4;
-    uint8_t numPages = (numBytes + 3) / 4;
-    
-    for (uint8_t i = 0; i < numPages; i++) {
-        uint8_t readBuffer[4];
-        
-        if (!nfc.ntag2xx_ReadPage(startPage + i, readBuffer)) {
-            Serial.printf("PN532: Read failed at page %d\n", startPage + i);
+
+bool PN532_Module::readPages(uint8_t firstPage, uint8_t* buffer, size_t len) {
+    // READ returns four pages at a time - 3 exchanges for 48 bytes.
+    for (size_t offset = 0; offset < len; offset += 16) {
+        uint8_t page = firstPage + offset / 4;
+        uint8_t cmd[] = { NTAG_CMD_READ, page };
+        uint8_t chunk[16];
+        if (!exchange(cmd, sizeof(cmd), chunk, sizeof(chunk))) {
+            Serial.printf("PN532: Read failed at page %d\n", page);
             return false;
         }
-        
-        for (uint8_t j = 0; j < 4 && (i*4 + j) < numBytes; j++) {
-            buffer[i*4 + j] = readBuffer[j];
-        }
+        size_t n = len - offset < 16 ? len - offset : 16;
+        memcpy(buffer + offset, chunk, n);
     }
     return true;
 }
 
-int PN532_Module::extractText(const uint8_t *ndefData, char *textOut, uint8_t maxLen) {
-    // Identical to RC522 version - NDEF format unchanged
-    if (ndefData[0] != 0x03) return 0;
-    if (ndefData[5] != 0x54) return 0;
-    
-    int textStart = 9;
-    int textLen = 0;
-    
-    for (int i = textStart; i < maxLen + textStart && 
-         ndefData[i] != 0x00 && ndefData[i] != 0xFE; i++) {
-        if (ndefData[i] >= 32 && ndefData[i] <= 126) {
-            textOut[textLen++] = ndefData[i];
+bool PN532_Module::readNdefArea(const NfcTag& tag, uint8_t* buffer, size_t len) {
+    uint8_t numPages = (len + 3) / 4;
+
+    // FAST_READ: the whole area in one exchange.
+    if (!_noFastRead.sameAs(tag) && numPages <= MAX_FAST_READ_PAGES) {
+        uint8_t area[MAX_FAST_READ_PAGES * 4];
+        uint8_t cmd[] = { NTAG_CMD_FAST_READ, NTAG_FIRST_USER_PAGE,
+                          (uint8_t)(NTAG_FIRST_USER_PAGE + numPages - 1) };
+        if (exchange(cmd, sizeof(cmd), area, numPages * 4)) {
+            memcpy(buffer, area, len);
+            return true;
         }
+
+        // Plain Ultralight (or anything else without FAST_READ) NAKs,
+        // which drops the tag back to IDLE - select it again and stick
+        // to READ for this tag. Remembered by UID, so the next NTAG
+        // gets FAST_READ again.
+        Serial.println("PN532: FAST_READ not supported, using READ");
+        _noFastRead = tag;
+        NfcTag again;
+        if (!detectTag(again, 50) || !again.sameAs(tag)) return false;
     }
-    
-    textOut[textLen] = '\0';
-    return textLen;
+
+    return readPages(NTAG_FIRST_USER_PAGE, buffer, len);
 }
 
-bool PN532_Module::readAlbumText(char *textOut, uint8_t maxLen) {
-    uint8_t userData[48];
-    
-    if (!readUserData(userData, 48)) {
-        return false;
-    }
-    
-    int textLen = extractText(userData, textOut, maxLen);
-    return textLen > 0;
+bool PN532_Module::pingTag(const NfcTag& tag) {
+    // The tag stays listed as target 1 after readPassiveTargetID(); if
+    // it has left the field the PN532 answers with a timeout status.
+    uint8_t cmd[] = { NTAG_CMD_READ, 0 };
+    uint8_t page0[16];
+    return exchange(cmd, sizeof(cmd), page0, sizeof(page0));
 }
 
-bool PN532_Module::writeAlbumTag(const char* albumName) {
-    uint8_t message[48] = {0};
-    
-    message[0] = 0x03;
-    message[1] = strlen(albumName) + 7;
-    message[2] = 0xD1;
-    message[3] = 0x01;
-    message[4] = strlen(albumName) + 3;
-    message[5] = 0x54;
-    message[7] = 0x02;
-    message[8] = 'e';
-    message[9] = 'n';
-    strcpy((char*)&message[9], albumName);
-    message[10 + strlen(albumName)] = 0xFE;
-    
-    for (int page = 4; page < 16; page++) {
-        uint8_t block[4];
-        memcpy(block, &message[(page-4)*4], 4);
+bool PN532_Module::writeNdefArea(const NfcTag& tag, const uint8_t* data, size_t len) {
+    uint8_t numPages = (len + 3) / 4;
+
+    for (uint8_t i = 0; i < numPages; i++) {
+        uint8_t block[4] = {0};
+        for (uint8_t j = 0; j < 4 && (i*4 + j) < len; j++) {
+            block[j] = data[i*4 + j];
+        }
         
-        if (!nfc.ntag2xx_WritePage(page, block)) {
-            Serial.printf("PN532: Write failed at page %d\n", page);
+        if (!nfc.ntag2xx_WritePage(NTAG_FIRST_USER_PAGE + i, block)) {
+            Serial.printf("PN532: Write failed at page %d\n", NTAG_FIRST_USER_PAGE + i);
             return false;
         }
     }
     return true;
 }
 
-void PN532_Module::runTest(int count) {
-    for (int i = 0; i < count; i++) {
-        Serial.printf("\n--- PN532 Read %d/%d ---\n", i + 1, count);
-        Serial.println("Waiting for card...");
-        
-        if (!waitForCard(5000)) {
-            Serial.println("No card found (timeout)");
-            continue;
-        }
-        
-        Serial.print("UID: ");
-        for (byte j = 0; j < _uidLength; j++) {
-            Serial.printf("%02X ", _uid[j]);
-        }
-        Serial.println();
-        
-        char cleanText[40];
-        if (readAlbumText(cleanText, sizeof(cleanText) - 1)) {
-            Serial.printf("Album: \"%s\"\n", cleanText);
-        } else {
-            Serial.println("Failed to read album text");
-        }
-        
-        delay(500);
+void PN532_Module::powerDown() {
+    uint8_t cmd[] = { 0x16, 0x80 };   // PowerDown, WakeUpEnable = I2C
+    if (!nfc.sendCommandCheckAck(cmd, sizeof(cmd))) {
+        Serial.println("PN532: ✗ PowerDown not acknowledged");
+        return;
     }
-}
\ No newline at end of file
+    // The PN532 only drops into power-down once its response frame has
+    // been read; the library keeps its reader private, so drain it here.
+    delay(1);
+    Wire.requestFrom((uint8_t)PN532_I2C_ADDRESS, (uint8_t)10);
+    while (Wire.available()) Wire.read();
+}
+
+void PN532_Module::wakeUp() {
+    // The first transaction after power-down only wakes the chip and
+    // can be lost - hence the retry.
+    for (int attempt = 0; attempt < 3; attempt++) {
+        if (nfc.SAMConfig()) return;
+        delay(2);
+    }
+    Serial.println("PN532: ✗ No response after wake");
+}
@@ -1,6 +1,6 @@
 // =====================================================================
 //  PN532_Module.h - PN532 NFC Reader Module (I2C)
-//  Replaces RC522_Module, identical external interface
+//  NfcReader backend - ISO14443A (NTAG21x) only
 // =====================================================================
 
 #ifndef PN532_MODULE_H
@@ -9,50 +9,38 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <Adafruit_PN532.h>
+#include "NfcReader.h"
 #include "pins.h"
 
-// Forward declaration
-class ScreenManager;
-
-class PN532_Module {
+class PN532_Module : public NfcReader {
 public:
   // Constructor - I2C mode, no CS or RST pins needed
   PN532_Module();
   
   // Initialize the PN532
-  void begin();
-  
-  // Write album text to NFC tag
-  bool writeAlbumTag(const char* albumName);
-  
-  // Read user data from NTAG215 (starting at page 4)
-  bool readUserData(uint8_t *buffer, uint8_t numBytes);
-
-  // Monitor NFC for tag placement/removal with debouncing
-  void monitorForTags(ScreenManager& screenManager);
-    
-  // Extract clean text from NDEF formatted data
-  int extractText(const uint8_t *ndefData, char *textOut, uint8_t maxLen);
-  
-  // Run test routine (N reads)
-  void runTest(int count);
-  
-  // Check if a card is present
-  bool isCardPresent();
-  
-  // Get album text from current card
-  bool readAlbumText(char *textOut, uint8_t maxLen);
-  
-  // Halt current card
-  void haltCard();
+  bool begin() override;
+  const char* name() const override { return "PN532"; }
+
+  bool detectTag(NfcTag& tag, uint16_t timeoutMs) override;
+  bool readNdefArea(const NfcTag& tag, uint8_t* buffer, size_t len) override;
+  bool writeNdefArea(const NfcTag& tag, const uint8_t* data, size_t len) override;
+
+  // READ of page 0 to the still-listed target - one InDataExchange
+  bool pingTag(const NfcTag& tag) override;
+
+  // PowerDown (0x16) with I2C as the wake source, and back again -
+  // any I2C traffic wakes it; wakeUp() then re-runs SAMConfig.
+  void powerDown() override;
+  void wakeUp() override;
 
 private:
+  // One InDataExchange to the listed tag; responseLen bytes of tag data
+  // expected back. false on any PN532 or tag error.
+  bool exchange(const uint8_t* send, uint8_t sendLen, uint8_t* response, uint8_t responseLen);
+  bool readPages(uint8_t firstPage, uint8_t* buffer, size_t len);
+
   Adafruit_PN532 nfc;
-  uint8_t _uid[7];
-  uint8_t _uidLength;
-  
-  // Wait for card with timeout
-  bool waitForCard(uint32_t timeout_ms = 5000);
+  NfcTag _noFastRead;   // last tag that NAKed FAST_READ - READ only for it
 };
 
-#endif // PN532_MODULE_H
\ No newline at end of file
+#endif // PN532_MODULE_H
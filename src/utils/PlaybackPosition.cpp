@@ -0,0 +1,54 @@
+// =====================================================================
+//  PlaybackPosition.cpp - Sequence-locked playback snapshot
+// =====================================================================
+
+#include "PlaybackPosition.h"
+
+static_assert(sizeof(PlaybackSnapshot) % sizeof(uint32_t) == 0,
+              "PlaybackSnapshot must be whole uint32_t fields");
+
+PlaybackPosition& PlaybackPosition::getInstance() {
+    static PlaybackPosition instance;
+    return instance;
+}
+
+PlaybackPosition::PlaybackPosition()
+    : seq(0)
+{
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        fields[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void PlaybackPosition::publish(const PlaybackSnapshot& s) {
+    uint32_t raw[FIELD_COUNT];
+    memcpy(raw, &s, sizeof(raw));
+
+    uint32_t start = seq.load(std::memory_order_relaxed);
+    seq.store(start + 1, std::memory_order_relaxed);        // odd - write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        fields[i].store(raw[i], std::memory_order_relaxed);
+    }
+
+    seq.store(start + 2, std::memory_order_release);        // even - stable
+}
+
+PlaybackSnapshot PlaybackPosition::read() const {
+    uint32_t raw[FIELD_COUNT];
+    uint32_t before, after;
+
+    do {
+        before = seq.load(std::memory_order_acquire);
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            raw[i] = fields[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    PlaybackSnapshot s;
+    memcpy(&s, raw, sizeof(s));
+    return s;
+}
@@ -0,0 +1,60 @@
+// =====================================================================
+//  PlaybackPosition.h - Lock-free "where are we in the track" snapshot
+//
+//  The VS1053 knows how many seconds it has decoded (SCI_DECODE_TIME)
+//  and the stream's average byte rate (WRAM 0x1E05); MP3Player knows
+//  how many bytes of how big a file it has fed. Neither is worth an
+//  extra SPI1 round-trip to ask about: VS1053_Module::sendMP3Data()
+//  samples the two decoder values every POSITION_SAMPLE_MS while it
+//  already holds the bus, and the feeder publishes everything here.
+//
+//  Single writer (mp3StreamTask on Core 0), any number of readers (UI
+//  on Core 1). publish()/read() form a sequence lock: the writer bumps
+//  a counter to odd, writes, bumps it to even; a reader retries if the
+//  counter was odd or moved underneath it. Readers never block the
+//  feeder and never see a half-written snapshot.
+// =====================================================================
+
+#ifndef PLAYBACK_POSITION_H
+#define PLAYBACK_POSITION_H
+
+#include <Arduino.h>
+#include <atomic>
+
+struct PlaybackSnapshot {
+    uint32_t trackSeq;      // bumped on every track open - UI resets on change
+    uint32_t fileSize;      // bytes, 0 = nothing playing
+    uint32_t bytesFed;      // bytes handed to the VS1053 so far
+    uint32_t decodeSec;     // SCI_DECODE_TIME
+    uint32_t byteRate;      // bytes/s as reported by the decoder, 0 = unknown yet
+
+    // Estimated track length - fileSize / byteRate, 0 until known.
+    uint32_t durationSec() const { return byteRate ? fileSize / byteRate : 0; }
+
+    // 0..1000, from bytes fed (exact, unlike the rate-based duration).
+    uint32_t progressPermille() const {
+        return fileSize ? (uint32_t)(((uint64_t)bytesFed * 1000) / fileSize) : 0;
+    }
+};
+
+class PlaybackPosition {
+public:
+    static PlaybackPosition& getInstance();
+
+    void publish(const PlaybackSnapshot& s);   // mp3StreamTask only
+    PlaybackSnapshot read() const;             // any task, never blocks the writer
+
+    static const unsigned long POSITION_SAMPLE_MS = 250;
+
+private:
+    PlaybackPosition();
+    PlaybackPosition(const PlaybackPosition&) = delete;
+    PlaybackPosition& operator=(const PlaybackPosition&) = delete;
+
+    static const int FIELD_COUNT = sizeof(PlaybackSnapshot) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> fields[FIELD_COUNT];
+};
+
+#endif // PLAYBACK_POSITION_H
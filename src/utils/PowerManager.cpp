@@ -0,0 +1,186 @@
+// =====================================================================
+//  PowerManager.cpp - Idle power stages implementation
+// =====================================================================
+
+#include "PowerManager.h"
+#include "TFT_Module.h"
+#include "NfcSession.h"
+#include "pins.h"
+#include <WiFi.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+extern void touchISR();
+
+// A card wake that never reaches playback (unknown album, unreadable
+// tag) shouldn't leave a measurement open for the next unrelated play.
+static const uint32_t WAKE_MEASUREMENT_EXPIRY_MS = 10000;
+
+PowerManager& PowerManager::getInstance() {
+    static PowerManager instance;
+    return instance;
+}
+
+PowerManager::PowerManager()
+    : _tft(nullptr), _nfc(nullptr), _stage(Awake),
+      _lastActivityMs(0), _cardWakeMs(0)
+{
+}
+
+void PowerManager::begin(TFT_Module* tft, NfcSession* nfc) {
+    _tft = tft;
+    _nfc = nfc;
+    _lastActivityMs = millis();
+    _stage = Awake;
+    Serial.printf("Power: ✓ Dim after %lus, shelf after %lus\n",
+                  (unsigned long)(DIM_AFTER_MS / 1000),
+                  (unsigned long)(SHELF_AFTER_MS / 1000));
+}
+
+void PowerManager::setStage(Stage s) {
+    if (s == _stage) return;
+    _stage = s;
+
+    switch (s) {
+        case Awake:
+            _tft->setBrightness(FULL_BRIGHTNESS);
+            break;
+        case Dimmed:
+            Serial.println("Power: Idle, dimming backlight");
+            _tft->setBrightness(DIM_BRIGHTNESS);
+            break;
+        case Shelf:
+            break;   // enterShelf() does the work
+    }
+}
+
+void PowerManager::update(bool busy) {
+    if (!_tft) return;
+
+    unsigned long now = millis();
+    if (busy) {
+        _lastActivityMs = now;
+        setStage(Awake);
+        return;
+    }
+
+    unsigned long idle = now - _lastActivityMs;
+    if (idle >= SHELF_AFTER_MS) {
+        enterShelf();
+    } else if (idle >= DIM_AFTER_MS && _stage == Awake) {
+        setStage(Dimmed);
+    }
+}
+
+bool PowerManager::noteTouch() {
+    _lastActivityMs = millis();
+    if (_stage == Awake) return false;
+
+    setStage(Awake);
+    return true;
+}
+
+void PowerManager::notePlaybackStarted() {
+    if (!_cardWakeMs) return;
+
+    unsigned long latency = millis() - _cardWakeMs;
+    _cardWakeMs = 0;
+    if (latency > WAKE_MEASUREMENT_EXPIRY_MS) return;
+
+    Serial.printf("Power: %s Card wake -> play %lu ms (target %lu ms)\n",
+                  latency <= WAKE_TO_PLAY_TARGET_MS ? "✓" : "✗",
+                  latency, (unsigned long)WAKE_TO_PLAY_TARGET_MS);
+}
+
+void PowerManager::enterShelf() {
+    Serial.println("Power: Shelf mode - screen off, NFC duty-cycled, light sleep");
+    _stage = Shelf;
+
+    auto display = _tft->getTFT();
+    _tft->setBrightness(0);
+    display->sleep();
+
+    // Light sleep would drop the association anyway; turning the radio
+    // off is both cleaner and the bigger saving.
+    bool wifiWasOn = WiFi.getMode() != WIFI_OFF;
+    if (wifiWasOn) {
+        WiFi.disconnect(true);
+        WiFi.mode(WIFI_OFF);
+    }
+
+    _nfc->powerDown();
+
+    esp_sleep_enable_gpio_wakeup();
+    esp_sleep_enable_timer_wakeup((uint64_t)SHELF_POLL_MS * 1000ULL);
+
+    // A card left on the reader from before shouldn't wake us every
+    // poll - only a different card, or this one taken off and put back.
+    bool sessionCardOnReader = _nfc->inSession();
+    bool cardWake = false;
+    unsigned long polls = 0;
+    unsigned long sleptSince = millis();
+
+    while (true) {
+        // The touch controller holds INT low while it has a touch - level
+        // wakeup, since edge interrupts don't run in light sleep. Armed
+        // every time round: the readers' detectTag() re-attaches the
+        // FALLING touch ISR on that pin, which replaces the level type.
+        detachInterrupt(digitalPinToInterrupt(TOUCH_INT));
+        gpio_wakeup_enable((gpio_num_t)TOUCH_INT, GPIO_INTR_LOW_LEVEL);
+
+        Serial.flush();
+        esp_light_sleep_start();
+
+        if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
+            break;
+        }
+
+        // Timer: one quick card check, then straight back down.
+        polls++;
+        _nfc->wakeUp();
+        NfcTag tag;
+        if (_nfc->detectTag(tag, 30)) {
+            if (!sessionCardOnReader || !tag.sameAs(_nfc->sessionTag())) {
+                cardWake = true;
+                break;
+            }
+        } else if (sessionCardOnReader) {
+            _nfc->forgetSession();
+            sessionCardOnReader = false;
+        }
+        _nfc->powerDown();
+    }
+
+    unsigned long wakeMs = millis();
+
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+    gpio_wakeup_disable((gpio_num_t)TOUCH_INT);
+    pinMode(TOUCH_INT, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(TOUCH_INT), touchISR, FALLING);
+
+    if (!cardWake) _nfc->wakeUp();
+
+    display->wakeup();
+    _tft->setBrightness(FULL_BRIGHTNESS);
+    _stage = Awake;
+    _lastActivityMs = millis();
+
+    unsigned long screenLatency = millis() - wakeMs;
+    Serial.printf("Power: Woke by %s after %lus on the shelf (%lu card polls)\n",
+                  cardWake ? "card" : "touch",
+                  (wakeMs - sleptSince) / 1000, polls);
+    Serial.printf("Power: %s Wake -> screen %lu ms (target %lu ms)\n",
+                  screenLatency <= WAKE_TO_SCREEN_TARGET_MS ? "✓" : "✗",
+                  screenLatency, (unsigned long)WAKE_TO_SCREEN_TARGET_MS);
+
+    // The card itself is picked up by the next NfcSession::poll() pass,
+    // exactly as if it had been placed while awake.
+    if (cardWake) _cardWakeMs = wakeMs;
+
+    if (wifiWasOn) {
+        // Reconnects in the background with the stored credentials.
+        WiFi.mode(WIFI_STA);
+        WiFi.begin();
+    }
+}
@@ -0,0 +1,91 @@
+// =====================================================================
+//  PowerManager.h - Idle dimming, screen-off and "shelf" light sleep
+//
+//  Left alone, the player used to keep the backlight at full and poll
+//  the PN532 every 500 ms forever. A kid's player spends most of its
+//  life sitting on a shelf, so that was most of the battery.
+//
+//  Three stages, driven from loop() by update():
+//    Awake     - full backlight. Anything "busy" (audio playing, or a
+//                screen that must stay up) or a touch keeps us here.
+//    Dimmed    - after DIM_AFTER_MS idle, backlight drops to
+//                DIM_BRIGHTNESS. First touch only undims.
+//    Shelf     - after SHELF_AFTER_MS idle: panel asleep and backlight
+//                off, WiFi off, NFC reader powered down between polls, and
+//                the ESP32-S3 in light sleep. A timer wakes it every
+//                SHELF_POLL_MS for one short card check; the touch
+//                controller's INT line wakes it immediately.
+//
+//  The PN532 has no passive-card low-power detect (its RF level
+//  detector only sees another reader's field), so detection is duty-
+//  cycled: power up, one InListPassiveTarget, power down. PN5180 LPCD
+//  can slot in here once that reader is wired.
+//
+//  Wake latencies are measured and logged against targets: touch ->
+//  screen back on (WAKE_TO_SCREEN_TARGET_MS), and card -> first audio
+//  (WAKE_TO_PLAY_TARGET_MS, closed by notePlaybackStarted()).
+// =====================================================================
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+class TFT_Module;
+class NfcSession;
+
+class PowerManager {
+public:
+    static PowerManager& getInstance();
+
+    enum Stage {
+        Awake,
+        Dimmed,
+        Shelf
+    };
+
+    // Call once from setup(), after the TFT and NFC reader are up.
+    void begin(TFT_Module* tft, NfcSession* nfc);
+
+    // Call every loop(). busy = the device is doing something a user
+    // would notice stopping. May block for a long time: entering Shelf
+    // only returns once a card or touch has woken the device.
+    void update(bool busy);
+
+    // A touch arrived. Returns true if it only woke/undimmed the screen,
+    // in which case the caller should drop it rather than act on it.
+    bool noteTouch();
+
+    // Player reported PlayerEvent::Started - closes a card wake's
+    // wake-to-play measurement, if one is open.
+    void notePlaybackStarted();
+
+    Stage stage() const { return _stage; }
+
+    static const uint32_t DIM_AFTER_MS   = 60000;
+    static const uint32_t SHELF_AFTER_MS = 180000;
+    static const uint32_t SHELF_POLL_MS  = 400;      // worst-case card detect delay on the shelf
+    static const uint8_t  FULL_BRIGHTNESS = 255;
+    static const uint8_t  DIM_BRIGHTNESS  = 40;
+
+    static const uint32_t WAKE_TO_SCREEN_TARGET_MS = 150;
+    static const uint32_t WAKE_TO_PLAY_TARGET_MS   = 1500;
+
+private:
+    PowerManager();
+    PowerManager(const PowerManager&) = delete;
+    PowerManager& operator=(const PowerManager&) = delete;
+
+    void enterShelf();      // blocks until woken
+    void setStage(Stage s);
+
+    TFT_Module* _tft;
+    NfcSession* _nfc;
+    Stage _stage;
+    unsigned long _lastActivityMs;
+
+    // Card wake -> PlayerEvent::Started, 0 = no measurement open.
+    unsigned long _cardWakeMs;
+};
+
+#endif // POWER_MANAGER_H
@@ -3,8 +3,10 @@
 // =====================================================================
 
 #include "RC522_Module.h"
-#include "../managers/ScreenManager.h"  // Add this
-#include "../screens/KidScreen.h"        // And this
+#include "SPIBusLock.h"
+
+// NTAG21x user memory (and the NDEF TLV) starts at page 4.
+static const uint8_t NTAG_FIRST_USER_PAGE = 4;
 
 // Constructor - initialize rfid object in initializer list
 RC522_Module::RC522_Module(uint8_t cs, uint8_t rst)
@@ -12,7 +14,9 @@ RC522_Module::RC522_Module(uint8_t cs, uint8_t rst)
 {
 }
 
-void RC522_Module::begin() {
+bool RC522_Module::begin() {
+  SPIBusGuard guard;
+
   Serial.println("RC522: Initializing...");
   
   // Initialize RC522 (SPI already started in main)
@@ -25,219 +29,93 @@ void RC522_Module::begin() {
   
   if (version == 0x00 || version == 0xFF) {
     Serial.println("RC522: ✗ Communication failure - check wiring");
-  } else {
-    Serial.println("RC522: ✓ Ready!");
+    return false;
   }
+  Serial.println("RC522: ✓ Ready!");
+  return true;
 }
 
-void RC522_Module::monitorForTags(ScreenManager& screenManager) {
-    static bool inCardSession = false;
-    static unsigned long noReadCount = 0;
-    static unsigned long lastCheck = 0;
-    static byte lastUID[10];
-    static byte lastUIDSize = 0;
-    
-    // Check every 500ms when idle, every 2000ms when playing
-    const unsigned long CHECK_INTERVAL = inCardSession ? 1000 : 500;
-    const unsigned long NO_READ_THRESHOLD = 4;
-    
-    if (millis() - lastCheck < CHECK_INTERVAL) return;
-    lastCheck = millis();
-    
-    if (rfid.PICC_IsNewCardPresent()) {
-        if (rfid.PICC_ReadCardSerial()) {
-
-            noReadCount = 0;
-            
-            if (!inCardSession) {
-                Serial.println("NFC: Card detected");
-                inCardSession = true;
-                // Disable Bluetooth when NFC detected
-                digitalWrite(BT_ENABLE_PIN, LOW);
-                lastUIDSize = rfid.uid.size;
-                for (byte i = 0; i < lastUIDSize; i++) {
-                    lastUID[i] = rfid.uid.uidByte[i];
-                }
-                
-                char albumText[40];
-                if (readAlbumText(albumText, sizeof(albumText))) {
-                    Serial.printf("NFC: Album = '%s'\n", albumText);
-                    screenManager.showKids();
-                    screenManager.getKidScreen()->showAlbum(albumText);
-                }
-            }
-        }
-    }
-    else if (inCardSession) {
-        noReadCount++;
-        if (noReadCount >= NO_READ_THRESHOLD) {
-            Serial.println("NFC: Card removed");
-            inCardSession = false;
-            noReadCount = 0;
-            screenManager.getKidScreen()->clearAlbum();
-            screenManager.showSplash();
-        }
-    }
-}
+bool RC522_Module::detectTag(NfcTag& tag, uint16_t timeoutMs) {
+  SPIBusGuard guard;
 
-bool RC522_Module::isCardPresent() {
-  return rfid.PICC_IsNewCardPresent() && rfid.PICC_ReadCardSerial();
-}
+  // WUPA rather than REQA (PICC_IsNewCardPresent) so a card that's been
+  // sitting on the reader - HALTed or not - still answers every poll;
+  // NfcSession needs that to know it's still there.
+  byte atqa[2];
+  byte atqaSize = sizeof(atqa);
+  MFRC522::StatusCode status = rfid.PICC_WakeupA(atqa, &atqaSize);
+  if (status != MFRC522::STATUS_OK && status != MFRC522::STATUS_COLLISION) {
+    return false;
+  }
+  if (!rfid.PICC_ReadCardSerial()) {
+    return false;
+  }
 
-void RC522_Module::haltCard() {
-  rfid.PICC_HaltA();
+  tag.type = NfcTagType::Iso14443A;
+  tag.uidLength = rfid.uid.size > sizeof(tag.uid) ? sizeof(tag.uid) : rfid.uid.size;
+  memcpy(tag.uid, rfid.uid.uidByte, tag.uidLength);
+  return true;
 }
 
-bool RC522_Module::waitForCard(uint32_t timeout_ms) {
-  uint32_t start = millis();
-  
-  while (millis() - start < timeout_ms) {
-    if (rfid.PICC_IsNewCardPresent()) {
-      if (rfid.PICC_ReadCardSerial()) {
-        return true;
-      }
-    }
-    delay(50);
-  }
-  
-  return false;
+bool RC522_Module::pingTag(const NfcTag& tag) {
+  SPIBusGuard guard;
+
+  // The card is left ACTIVE by detectTag(), so a READ goes straight to
+  // it - no WUPA/anticollision/select round trips.
+  byte readBuffer[18];
+  byte size = sizeof(readBuffer);
+  return rfid.MIFARE_Read(0, readBuffer, &size) == MFRC522::STATUS_OK;
 }
 
-bool RC522_Module::readUserData(uint8_t *buffer, uint8_t numBytes) {
-  uint8_t startPage = 4;
-  uint8_t numPages = (numBytes + 3) / 4;  // 4 bytes per page
-  
-  for (uint8_t i = 0; i < numPages; i++) {
+bool RC522_Module::readNdefArea(const NfcTag& tag, uint8_t* buffer, size_t len) {
+  SPIBusGuard guard;
+
+  // MIFARE_Read returns 16 bytes (four pages) + 2 CRC - use all of
+  // them: 3 transactions for 48 bytes instead of 12.
+  for (size_t offset = 0; offset < len; offset += 16) {
     byte readBuffer[18];
     byte size = sizeof(readBuffer);
+    uint8_t page = NTAG_FIRST_USER_PAGE + offset / 4;
     
-    MFRC522::StatusCode status = rfid.MIFARE_Read(startPage + i, readBuffer, &size);
+    MFRC522::StatusCode status = rfid.MIFARE_Read(page, readBuffer, &size);
     if (status != MFRC522::STATUS_OK) {
       return false;
     }
     
-    // Copy 4 bytes from this page
-    for (uint8_t j = 0; j < 4 && (i*4 + j) < numBytes; j++) {
-      buffer[i*4 + j] = readBuffer[j];
-    }
+    size_t n = len - offset < 16 ? len - offset : 16;
+    memcpy(buffer + offset, readBuffer, n);
   }
   
   return true;
 }
 
-int RC522_Module::extractText(const uint8_t *ndefData, char *textOut, uint8_t maxLen) {
-  // NDEF structure:
-  // Byte 0: 0x03 (message start)
-  // Byte 5: 0x54 ('T' for text record type)
-  // Byte 9+: Text data starts here
-  
-  if (ndefData[0] != 0x03) return 0;   // Not NDEF
-  if (ndefData[5] != 0x54) return 0;   // Not text record
-  
-  int textStart = 9;
-  int textLen = 0;
-  
-  for (int i = textStart; i < maxLen + textStart && ndefData[i] != 0x00 && ndefData[i] != 0xFE; i++) {
-    if (ndefData[i] >= 32 && ndefData[i] <= 126) {  // Printable ASCII
-      textOut[textLen++] = ndefData[i];
-    }
-  }
-  
-  textOut[textLen] = '\0';
-  return textLen;
-}
+bool RC522_Module::writeNdefArea(const NfcTag& tag, const uint8_t* data, size_t len) {
+  SPIBusGuard guard;
 
-bool RC522_Module::readAlbumText(char *textOut, uint8_t maxLen) {
-  uint8_t userData[48];
-  
-  if (!readUserData(userData, 48)) {
-    return false;
-  }
-  
-  int textLen = extractText(userData, textOut, maxLen);
-  return textLen > 0;
-}
+  uint8_t numPages = (len + 3) / 4;
 
-void RC522_Module::runTest(int count) {
-  for (int i = 0; i < count; i++) {
-    Serial.printf("\n--- RC522 Read %d/%d ---\n", i + 1, count);
-    Serial.println("Waiting for card...");
-    
-    if (!waitForCard(5000)) {
-      Serial.println("No card found (timeout)");
-      continue;
-    }
-    
-    // Print UID
-    Serial.print("UID: ");
-    for (byte j = 0; j < rfid.uid.size; j++) {
-      Serial.printf("%02X ", rfid.uid.uidByte[j]);
+  for (uint8_t i = 0; i < numPages; i++) {
+    uint8_t block[16] = {0};
+    for (uint8_t j = 0; j < 4 && (i*4 + j) < len; j++) {
+      block[j] = data[i*4 + j];
     }
-    Serial.println();
     
-    // Read album text
-    char cleanText[40];
-    if (readAlbumText(cleanText, sizeof(cleanText) - 1)) {
-      Serial.print("Album: \"");
-      Serial.print(cleanText);
-      Serial.println("\"");
-    } else {
-      // Fallback to raw data
-      uint8_t userData[48];
-      if (readUserData(userData, 48)) {
-        Serial.print("Raw: ");
-        for (int k = 0; k < 20; k++) {
-          char c = userData[k];
-          Serial.print((c >= 32 && c <= 126) ? c : '.');
-        }
-        Serial.println();
-      } else {
-        Serial.println("Failed to read user data");
-      }
+    byte status = rfid.MIFARE_Ultralight_Write(NTAG_FIRST_USER_PAGE + i, block, 16);
+    if (status != MFRC522::STATUS_OK) {
+      Serial.printf("RC522: Write failed at page %d\n", NTAG_FIRST_USER_PAGE + i);
+      return false;
     }
-    
-    haltCard();
-    delay(500);
   }
+  
+  return true;
 }
 
-bool RC522_Module::writeAlbumTag(const char* albumName) {
-    // Format NDEF text message
-    uint8_t message[48] = {0};
-    
-    // NDEF header
-    message[0] = 0x03;  // NDEF message start
-    message[1] = strlen(albumName) + 7;  // Payload length
-    message[2] = 0xD1;  // Record header
-    message[3] = 0x01;  // Type length
-    message[4] = strlen(albumName) + 3;  // Payload length
-    message[5] = 0x54;  // 'T' = Text record
-    message[7] = 0x02;  // Language code length
-    message[8] = 'e';   // 'e'
-    message[9] = 'n';   // 'n'
-
-    // Copy album name starting at position 10
-    strcpy((char*)&message[9], albumName);
-
-    // NDEF terminator
-    message[10 + strlen(albumName)] = 0xFE;
-    
-    // Write to tag (pages 4-15)
-    for (int page = 4; page < 16; page++) {
-        uint8_t block[16];
-        memcpy(block, &message[(page-4)*4], 4);
-        
-        // Pad rest of block
-        for (int i = 4; i < 16; i++) {
-            block[i] = 0;
-        }
-        
-        byte status = rfid.MIFARE_Ultralight_Write(page, block, 16);
-        if (status != MFRC522::STATUS_OK) {
-            Serial.printf("Write failed at page %d\n", page);
-            return false;
-        }
-    }
-    
-    return true;
-}
\ No newline at end of file
+void RC522_Module::powerDown() {
+  SPIBusGuard guard;
+  rfid.PCD_SoftPowerDown();
+}
+
+void RC522_Module::wakeUp() {
+  SPIBusGuard guard;
+  rfid.PCD_SoftPowerUp();
+}
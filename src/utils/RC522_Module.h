@@ -1,6 +1,6 @@
 // =====================================================================
 //  RC522_Module.h - RC522 NFC Reader Module
-//  Encapsulates MFRC522 library for NTAG215 reading
+//  NfcReader backend on SPI1 - ISO14443A (NTAG21x) only
 // =====================================================================
 
 #ifndef RC522_MODULE_H
@@ -8,48 +8,32 @@
 
 #include <Arduino.h>
 #include <MFRC522.h>
+#include "NfcReader.h"
 #include "pins.h"
 
-// Forward declaration
-class ScreenManager;
-
-class RC522_Module {
+class RC522_Module : public NfcReader {
 public:
   // Constructor
   RC522_Module(uint8_t cs, uint8_t rst);
-  bool writeAlbumTag(const char* albumName);
   
   // Initialize the RC522
-  void begin();
-  
-  
-  // Read user data from NTAG215 (starting at page 4)
-  bool readUserData(uint8_t *buffer, uint8_t numBytes);
-
-  // Monitor NFC for tag placement/removal with debouncing
-  void monitorForTags(ScreenManager& screenManager);
-    
-  // Extract clean text from NDEF formatted data
-  int extractText(const uint8_t *ndefData, char *textOut, uint8_t maxLen);
-  
-  // Run test routine (N reads)
-  void runTest(int count);
-  
-  // Check if a card is present
-  bool isCardPresent();
-  
-  // Get album text from current card
-  bool readAlbumText(char *textOut, uint8_t maxLen);
-  
-  // Halt current card
-  void haltCard();
+  bool begin() override;
+  const char* name() const override { return "RC522"; }
+
+  bool detectTag(NfcTag& tag, uint16_t timeoutMs) override;
+  bool readNdefArea(const NfcTag& tag, uint8_t* buffer, size_t len) override;
+  bool writeNdefArea(const NfcTag& tag, const uint8_t* data, size_t len) override;
+
+  // READ of page 0 to the still-selected card
+  bool pingTag(const NfcTag& tag) override;
+
+  // Soft power-down bit in CommandReg, and back
+  void powerDown() override;
+  void wakeUp() override;
 
 private:
   uint8_t _cs, _rst;
   MFRC522 rfid;  // Static object, NOT pointer
-  
-  // Wait for card with timeout
-  bool waitForCard(uint32_t timeout_ms = 5000);
 };
 
-#endif // RC522_MODULE_H
\ No newline at end of file
+#endif // RC522_MODULE_H
@@ -139,6 +139,15 @@ void SD_Module::closeFile() {
     }
 }
 
+bool SD_Module::seek(uint32_t offset) {
+    SPIBusGuard guard;
+
+    if (!currentFile.isOpen() || offset > currentFile.fileSize()) {
+        return false;
+    }
+    return currentFile.seekSet(offset);
+}
+
 size_t SD_Module::readChunk(uint8_t* buffer, size_t size) {
     SPIBusGuard guard;
 
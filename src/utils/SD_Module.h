@@ -27,9 +27,17 @@ public:
     
     // Read chunk of data (returns bytes read, 0 = EOF)
     size_t readChunk(uint8_t* buffer, size_t size);
+
+    // Reposition the current file (absolute byte offset). false if no
+    // file is open or the offset is past the end.
+    bool seek(uint32_t offset);
     
     // Check if current file is still open
     bool isFileOpen() const { return currentFile.isOpen(); }
+
+    // Size of the currently open file, 0 if none (cached by SdFat - no
+    // bus access).
+    uint32_t fileSize() const { return currentFile.isOpen() ? (uint32_t)currentFile.fileSize() : 0; }
     
 private:
     uint8_t _cs;
@@ -43,4 +43,20 @@ struct SPIBusGuard {
     }
 };
 
+// Non-blocking variant for purely cosmetic bus work (the spectrum
+// visualizer) - if anyone else holds SPI1, don't wait, just skip this
+// round. Check it before touching the bus: `SPIBusTryGuard guard; if
+// (!guard) return;`
+struct SPIBusTryGuard {
+    SPIBusTryGuard() {
+        locked = xSemaphoreTakeRecursive(spi1BusMutex, 0) == pdTRUE;
+    }
+    ~SPIBusTryGuard() {
+        if (locked) xSemaphoreGiveRecursive(spi1BusMutex);
+    }
+    explicit operator bool() const { return locked; }
+
+    bool locked;
+};
+
 #endif // SPI_BUS_LOCK_H
@@ -0,0 +1,63 @@
+// =====================================================================
+//  SPSCQueue.h - Lock-free single-producer / single-consumer ring
+//
+//  For handing small messages between exactly two tasks - in practice
+//  the UI loop on Core 1 and mp3StreamTask on Core 0 (MP3Player's
+//  command and event queues). No mutex, no FreeRTOS queue copy through
+//  the kernel, never blocks: push() fails if the ring is full, pop()
+//  fails if it's empty.
+//
+//  The producer only ever writes `tail`, the consumer only ever writes
+//  `head`; each publishes its index with release ordering after the
+//  slot data is in place, and reads the other side's index with
+//  acquire. N must be a power of two; capacity is N - 1.
+// =====================================================================
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N>
+class SPSCQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SPSCQueue size must be a power of two");
+
+public:
+    SPSCQueue() : head(0), tail(0) {}
+
+    // Producer side only.
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1) & (N - 1);
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;   // full
+        }
+        slots[t] = item;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only.
+    bool pop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;   // empty
+        }
+        out = slots[h];
+        head.store((h + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Approximate from either side - exact only when the other side is idle.
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T slots[N];
+    std::atomic<size_t> head;   // next slot to pop - written by the consumer
+    std::atomic<size_t> tail;   // next slot to fill - written by the producer
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,298 @@
+// =====================================================================
+//  SearchIndex.cpp - Library trigram index implementation
+// =====================================================================
+
+#include "SearchIndex.h"
+#include "LibraryIndex.h"
+#include <esp_heap_caps.h>
+
+static const uint32_t TRACK_BIT = 0x80000000UL;
+static const int MAX_RESULTS = 64;
+
+// U+00C0..U+00FF (and the same 32 again, lower case) folded to the
+// plain letter they're typed as; × and ÷ become separators.
+static const char LATIN1_FOLD[33] = "aaaaaaaceeeeiiiidnooooo ouuuuyts";
+
+static bool growBuffer(void** buffer, uint32_t* capacity, uint32_t needed, size_t itemSize) {
+    if (needed <= *capacity) return true;
+
+    uint32_t newCapacity = *capacity ? *capacity : 256;
+    while (newCapacity < needed) newCapacity *= 2;
+
+    void* p = heap_caps_realloc(*buffer, newCapacity * itemSize, MALLOC_CAP_SPIRAM);
+    if (!p) p = realloc(*buffer, newCapacity * itemSize);
+    if (!p) {
+        Serial.printf("Search: ✗ Out of memory growing to %lu entries\n", (unsigned long)newCapacity);
+        return false;
+    }
+    *buffer = p;
+    *capacity = newCapacity;
+    return true;
+}
+
+SearchIndex& SearchIndex::getInstance() {
+    static SearchIndex instance;
+    return instance;
+}
+
+SearchIndex::SearchIndex()
+    : _ready(false), _generation(0), _albumsIndexed(0), _tracksIndexed(0),
+      _buckets(nullptr),
+      _docs(nullptr), _docCount(0), _docCapacity(0),
+      _blocks(nullptr), _blockCount(1), _blockCapacity(0),
+      _text(nullptr), _textUsed(0), _textCapacity(0)
+{
+}
+
+size_t SearchIndex::normalize(const char* in, char* out, size_t outSize) {
+    if (!outSize) return 0;
+
+    const uint8_t* p = (const uint8_t*)in;
+    size_t n = 0;
+    bool lastWasSpace = true;       // also drops leading separators
+
+    while (*p && n + 1 < outSize) {
+        char c;
+        if (*p < 0x80) {
+            c = isalnum(*p) ? tolower(*p) : ' ';
+            p++;
+        } else if (p[0] == 0xC3 && p[1] >= 0x80 && p[1] <= 0xBF) {
+            uint8_t cp = 0x40 + p[1];           // U+00C0..U+00FF
+            c = cp == 0xFF ? 'y' : LATIN1_FOLD[(cp - 0xC0) & 0x1F];
+            p += 2;
+        } else {
+            // Anything else non-ASCII is kept as-is, whole characters only
+            size_t len = *p < 0xE0 ? 2 : *p < 0xF0 ? 3 : 4;
+            size_t i = 1;
+            while (i < len && p[i]) i++;
+            if (i < len || n + len >= outSize) break;
+            memcpy(out + n, p, len);
+            n += len;
+            p += len;
+            lastWasSpace = false;
+            continue;
+        }
+
+        if (c == ' ') {
+            if (lastWasSpace) continue;
+            lastWasSpace = true;
+        } else {
+            lastWasSpace = false;
+        }
+        out[n++] = c;
+    }
+
+    if (n > 0 && out[n - 1] == ' ') n--;
+    out[n] = '\0';
+    return n;
+}
+
+uint32_t SearchIndex::trigramHash(const char* p) {
+    uint32_t v = (uint8_t)p[0] | ((uint8_t)p[1] << 8) | ((uint32_t)(uint8_t)p[2] << 16);
+    return (uint32_t)(v * 2654435761u) >> 20;      // top 12 bits = BUCKETS
+}
+
+void SearchIndex::reset() {
+    memset(_buckets, 0, BUCKETS * sizeof(Bucket));
+    _docCount = 0;
+    _blockCount = 1;
+    _textUsed = 0;
+    _albumsIndexed = 0;
+    _tracksIndexed = 0;
+}
+
+void SearchIndex::addPosting(uint32_t hash, uint16_t doc) {
+    Bucket& b = _buckets[hash];
+
+    if (b.tail) {
+        Block& tail = _blocks[b.tail];
+        // Same trigram twice in one document - one posting is enough
+        if (tail.ids[tail.count - 1] == doc) return;
+        if (tail.count < sizeof(tail.ids) / sizeof(tail.ids[0])) {
+            tail.ids[tail.count++] = doc;
+            b.count++;
+            return;
+        }
+    }
+
+    if (!growBuffer((void**)&_blocks, &_blockCapacity, _blockCount + 1, sizeof(Block))) return;
+
+    uint32_t index = _blockCount++;
+    Block& block = _blocks[index];
+    block.next = 0;
+    block.count = 1;
+    block.ids[0] = doc;
+
+    if (b.tail) {
+        _blocks[b.tail].next = index;
+    } else {
+        b.head = index;
+    }
+    b.tail = index;
+    b.count++;
+}
+
+bool SearchIndex::addDocument(SearchResult::Kind kind, int id, const char* text, const char* text2) {
+    if (_docCount >= MAX_DOCUMENTS) return false;
+
+    char raw[160];
+    char norm[160];
+    snprintf(raw, sizeof(raw), "%s %s", text, text2 ? text2 : "");
+    size_t len = normalize(raw, norm, sizeof(norm));
+
+    if (!growBuffer((void**)&_docs, &_docCapacity, _docCount + 1, sizeof(Document)) ||
+        !growBuffer((void**)&_text, &_textCapacity, _textUsed + len + 1, 1)) {
+        return false;
+    }
+
+    uint16_t doc = _docCount++;
+    _docs[doc].text = _textUsed;
+    _docs[doc].ref = (uint32_t)id | (kind == SearchResult::Track ? TRACK_BIT : 0);
+    memcpy(_text + _textUsed, norm, len + 1);
+    _textUsed += len + 1;
+
+    for (size_t i = 0; i + 3 <= len; i++) {
+        addPosting(trigramHash(norm + i), doc);
+    }
+    return true;
+}
+
+void SearchIndex::sync() {
+    LibraryIndex& library = LibraryIndex::getInstance();
+
+    if (!_ready) {
+        _buckets = (Bucket*)heap_caps_calloc(BUCKETS, sizeof(Bucket), MALLOC_CAP_SPIRAM);
+        if (!_buckets) _buckets = (Bucket*)calloc(BUCKETS, sizeof(Bucket));
+        if (!_buckets) return;
+        _ready = true;
+        _generation = library.generation();
+    }
+
+    if (library.generation() != _generation) {
+        reset();
+        _generation = library.generation();
+    }
+
+    int budget = SYNC_BATCH;
+    bool added = false;
+    while (budget > 0 && _albumsIndexed < library.albumCount()) {
+        addDocument(SearchResult::Album, _albumsIndexed,
+                    library.albumName(_albumsIndexed), nullptr);
+        _albumsIndexed++;
+        budget--;
+        added = true;
+    }
+    while (budget > 0 && _tracksIndexed < library.trackCount()) {
+        addDocument(SearchResult::Track, _tracksIndexed,
+                    library.trackTitle(_tracksIndexed), library.trackArtist(_tracksIndexed));
+        _tracksIndexed++;
+        budget--;
+        added = true;
+    }
+
+    if (added && library.isComplete() &&
+        _albumsIndexed == library.albumCount() && _tracksIndexed == library.trackCount()) {
+        Serial.printf("Search: ✓ %lu documents indexed (%lu KB)\n", (unsigned long)_docCount,
+                      (unsigned long)((BUCKETS * sizeof(Bucket) + _docCapacity * sizeof(Document) +
+                                       _blockCapacity * sizeof(Block) + _textCapacity) / 1024));
+    }
+}
+
+// A document of an album LibraryIndex::refreshAlbum() has replaced -
+// the replacement is indexed as new documents of its own.
+bool SearchIndex::isStale(uint16_t doc) const {
+    LibraryIndex& library = LibraryIndex::getInstance();
+    uint32_t ref = _docs[doc].ref;
+    int album = (ref & TRACK_BIT) ? library.trackAlbum(ref & ~TRACK_BIT) : (int)ref;
+    return library.albumRemoved(album);
+}
+
+// Sort key for one candidate (lower is better), -1 = no match.
+int SearchIndex::rank(uint16_t doc, const char* query) const {
+    const char* text = _text + _docs[doc].text;
+    const char* hit = strstr(text, query);
+    if (!hit) return -1;
+
+    int score = 2;
+    if (hit == text) {
+        score = 0;
+    } else {
+        for (const char* p = hit; p; p = strstr(p + 1, query)) {
+            if (p[-1] == ' ') {
+                score = 1;
+                break;
+            }
+        }
+    }
+    return score * 2 + ((_docs[doc].ref & TRACK_BIT) ? 1 : 0);
+}
+
+int SearchIndex::search(const char* query, SearchResult* results, int maxResults) {
+    if (!_ready || !_docCount || maxResults <= 0) return 0;
+    if (maxResults > MAX_RESULTS) maxResults = MAX_RESULTS;
+
+    char q[64];
+    size_t len = normalize(query, q, sizeof(q));
+    if (!len) return 0;
+
+    uint16_t found[MAX_RESULTS];
+    int keys[MAX_RESULTS];
+    int count = 0;
+
+    // Candidates: every document for a short query, otherwise the
+    // shortest posting list among the query's trigrams.
+    uint32_t block = 0;
+    uint32_t nextDoc = 0;
+    bool shortQuery = len < 3;
+    if (!shortQuery) {
+        uint32_t fewest = UINT32_MAX;
+        for (size_t i = 0; i + 3 <= len; i++) {
+            const Bucket& b = _buckets[trigramHash(q + i)];
+            if (b.count < fewest) {
+                fewest = b.count;
+                block = b.head;
+            }
+        }
+        if (!block) return 0;
+    }
+
+    int blockPos = 0;
+    while (true) {
+        uint16_t doc;
+        if (shortQuery) {
+            if (nextDoc >= _docCount) break;
+            doc = nextDoc++;
+        } else {
+            if (!block) break;
+            const Block& b = _blocks[block];
+            doc = b.ids[blockPos++];
+            if (blockPos >= b.count) {
+                block = b.next;
+                blockPos = 0;
+            }
+        }
+
+        int key = rank(doc, q);
+        if (key < 0 || isStale(doc)) continue;
+        if (shortQuery && key >= 4) continue;       // word starts only
+        if (count == maxResults && key >= keys[count - 1]) continue;
+
+        // Insertion into the (small) sorted result list; equal keys keep
+        // library order.
+        int pos = count < maxResults ? count++ : maxResults - 1;
+        while (pos > 0 && keys[pos - 1] > key) {
+            found[pos] = found[pos - 1];
+            keys[pos] = keys[pos - 1];
+            pos--;
+        }
+        found[pos] = doc;
+        keys[pos] = key;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint32_t ref = _docs[found[i]].ref;
+        results[i].kind = (ref & TRACK_BIT) ? SearchResult::Track : SearchResult::Album;
+        results[i].id = ref & ~TRACK_BIT;
+    }
+    return count;
+}
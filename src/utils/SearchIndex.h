@@ -0,0 +1,116 @@
+// =====================================================================
+//  SearchIndex.h - Trigram index over the library for type-ahead search
+//
+//  Album names, track titles and track artists from LibraryIndex, kept
+//  searchable fast enough to re-run on every key press - SearchScreen
+//  budgets SEARCH_TARGET_US for a query over thousands of tracks.
+//
+//  Each album and each track is one document. Its text is normalized
+//  (lower case, Latin-1 accents folded, punctuation to single spaces)
+//  into a PSRAM pool, and every 3-byte window of it is hashed into one
+//  of BUCKETS posting lists of 16-bit document ids. Lists are chains of
+//  small fixed blocks carved from one growing array, so appending a
+//  document never moves anything and the index grows along with
+//  LibraryIndex: sync() picks up whatever the background scan has added
+//  since the last call.
+//
+//  A query of three or more characters walks only its rarest trigram's
+//  list and confirms each candidate with a substring match on the
+//  stored text (the hash buckets are shared, so a list entry alone
+//  proves nothing). Shorter queries don't have a trigram; they scan all
+//  documents for a word starting with them, which is still well inside
+//  budget for a few thousand short strings.
+//
+//  Results are ranked: text starts with the query, then a word starts
+//  with it, then anywhere; albums before tracks; library order after.
+// =====================================================================
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <Arduino.h>
+
+struct SearchResult {
+    enum Kind : uint8_t {
+        Album,
+        Track
+    };
+    Kind kind;
+    int id;     // LibraryIndex album or track number
+};
+
+class SearchIndex {
+public:
+    static SearchIndex& getInstance();
+
+    // Call every loop(). Indexes up to SYNC_BATCH documents that
+    // LibraryIndex has gained; starts over if LibraryIndex rescanned.
+    void sync();
+
+    // Best maxResults matches for query, best first. Returns the count.
+    // Ids refer to LibraryIndex's current generation.
+    int search(const char* query, SearchResult* results, int maxResults);
+
+    int documentCount() const { return _docCount; }
+
+    // Lower-case, accent-folded, single-spaced copy of in. Used for both
+    // documents and queries so they compare byte for byte.
+    static size_t normalize(const char* in, char* out, size_t outSize);
+
+    static const int BUCKETS = 4096;
+    static const int SYNC_BATCH = 128;
+    static const uint32_t MAX_DOCUMENTS = 65535;     // 16-bit ids
+    static const uint32_t SEARCH_TARGET_US = 20000;
+
+private:
+    SearchIndex();
+    SearchIndex(const SearchIndex&) = delete;
+    SearchIndex& operator=(const SearchIndex&) = delete;
+
+    struct Document {
+        uint32_t text;          // offset into _text
+        uint32_t ref;           // LibraryIndex id, top bit set = track
+    };
+
+    // 32 bytes; block 0 is never used, so 0 means "none"
+    struct Block {
+        uint32_t next;
+        uint16_t count;
+        uint16_t ids[13];
+    };
+
+    struct Bucket {
+        uint32_t head;
+        uint32_t tail;
+        uint32_t count;
+    };
+
+    void reset();
+    bool addDocument(SearchResult::Kind kind, int id, const char* text, const char* text2);
+    void addPosting(uint32_t hash, uint16_t doc);
+    int rank(uint16_t doc, const char* query) const;
+    bool isStale(uint16_t doc) const;
+
+    static uint32_t trigramHash(const char* p);
+
+    bool _ready;
+    uint32_t _generation;       // LibraryIndex generation indexed
+    int _albumsIndexed;
+    int _tracksIndexed;
+
+    Bucket* _buckets;
+
+    Document* _docs;
+    uint32_t _docCount;
+    uint32_t _docCapacity;
+
+    Block* _blocks;
+    uint32_t _blockCount;
+    uint32_t _blockCapacity;
+
+    char* _text;
+    uint32_t _textUsed;
+    uint32_t _textCapacity;
+};
+
+#endif // SEARCH_INDEX_H
@@ -56,6 +56,11 @@ TFT_Module::TFT_Module(uint8_t cs, uint8_t dc, uint8_t rst, uint8_t bl,
 // At the top of TFT_Module.cpp, make hspi global to this file
 static SPIClass hspi(HSPI);
 
+// Backlight PWM - well above audible range so the panel can't whine.
+#define BL_LEDC_CHANNEL   7
+#define BL_LEDC_FREQ      20000
+#define BL_LEDC_BITS      8
+
 bool TFT_Module::begin() {
   Serial.println("TFT: Initializing ST7796S...");
   
@@ -65,8 +70,9 @@ bool TFT_Module::begin() {
   
   // Setup backlight
   if (_bl >= 0) {
-    pinMode(_bl, OUTPUT);
-    digitalWrite(_bl, HIGH);
+    ledcSetup(BL_LEDC_CHANNEL, BL_LEDC_FREQ, BL_LEDC_BITS);
+    ledcAttachPin(_bl, BL_LEDC_CHANNEL);
+    ledcWrite(BL_LEDC_CHANNEL, 255);
     Serial.println("TFT: Backlight ON");
   }
   
@@ -94,8 +100,12 @@ lgfx::LGFX_Device* TFT_Module::getTFT() {
 }
 
 void TFT_Module::setBacklight(bool on) {
+  setBrightness(on ? 255 : 0);
+}
+
+void TFT_Module::setBrightness(uint8_t level) {
   if (_bl >= 0) {
-    digitalWrite(_bl, on ? HIGH : LOW);
+    ledcWrite(BL_LEDC_CHANNEL, level);
   }
 }
 
@@ -27,6 +27,9 @@ public:
   
   // Control backlight
   void setBacklight(bool on);
+
+  // Backlight level through LEDC PWM, 0 (off) - 255 (full)
+  void setBrightness(uint8_t level);
   
   // Set rotation (0, 1, 2, 3)
   void setRotation(uint8_t rotation);
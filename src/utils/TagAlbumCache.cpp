@@ -0,0 +1,97 @@
+// =====================================================================
+//  TagAlbumCache.cpp - Tag UID -> album map implementation
+// =====================================================================
+
+#include "TagAlbumCache.h"
+
+TagAlbumCache::TagAlbumCache()
+    : _open(false)
+{
+}
+
+bool TagAlbumCache::open() {
+    // Kept open for the life of the program - lookups sit on the
+    // card-to-play path, so don't pay for begin()/end() each tap.
+    if (!_open) {
+        _open = prefs.begin("tag_album", false);
+        if (!_open) Serial.println("TagCache: ✗ Could not open NVS namespace");
+    }
+    return _open;
+}
+
+void TagAlbumCache::makeKey(const NfcTag& tag, char* key) {
+    // FNV-1a over type + UID, as "t" + 8 hex digits
+    uint32_t h = 2166136261u;
+    h = (h ^ (uint8_t)tag.type) * 16777619u;
+    for (uint8_t i = 0; i < tag.uidLength; i++) {
+        h = (h ^ tag.uid[i]) * 16777619u;
+    }
+    snprintf(key, 10, "t%08lx", (unsigned long)h);
+}
+
+bool TagAlbumCache::readEntry(const NfcTag& tag, const char* key, Entry& entry) {
+    if (prefs.getBytes(key, &entry, sizeof(entry)) != sizeof(entry)) return false;
+
+    // Hash collision guard - the blob must be for exactly this tag.
+    return entry.type == (uint8_t)tag.type &&
+           entry.uidLength == tag.uidLength &&
+           memcmp(entry.uid, tag.uid, tag.uidLength) == 0;
+}
+
+bool TagAlbumCache::lookup(const NfcTag& tag, AlbumTag& out) {
+    if (!open()) return false;
+
+    char key[10];
+    makeKey(tag, key);
+    Entry entry;
+    if (!readEntry(tag, key, entry)) return false;
+
+    out = entry.content;
+    out.album[sizeof(out.album) - 1] = '\0';
+    return out.album[0] != '\0';
+}
+
+void TagAlbumCache::store(const NfcTag& tag, const AlbumTag& content) {
+    if (!open() || !content.album[0]) return;
+
+    char key[10];
+    makeKey(tag, key);
+
+    // Flash writes wear the NVS sectors - only write on a change.
+    Entry entry;
+    if (readEntry(tag, key, entry) &&
+        strncmp(entry.content.album, content.album, sizeof(content.album)) == 0 &&
+        entry.content.startTrack == content.startTrack &&
+        entry.content.shuffle == content.shuffle) {
+        return;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.type = (uint8_t)tag.type;
+    entry.uidLength = tag.uidLength;
+    memcpy(entry.uid, tag.uid, tag.uidLength);
+    entry.content = content;
+
+    if (prefs.putBytes(key, &entry, sizeof(entry)) == sizeof(entry)) {
+        Serial.printf("TagCache: Remembered '%s'\n", entry.content.album);
+    } else {
+        Serial.println("TagCache: ✗ Write failed (NVS full?)");
+    }
+}
+
+void TagAlbumCache::forget(const NfcTag& tag) {
+    if (!open()) return;
+
+    char key[10];
+    makeKey(tag, key);
+    if (prefs.isKey(key)) {
+        prefs.remove(key);
+        Serial.println("TagCache: Dropped stale entry");
+    }
+}
+
+void TagAlbumCache::clear() {
+    if (!open()) return;
+    prefs.clear();
+    Serial.println("TagCache: Cleared");
+}
@@ -0,0 +1,65 @@
+// =====================================================================
+//  TagAlbumCache.h - Persistent tag UID -> album tag map (NVS)
+//
+//  Nearly every tap is a card the player has seen before, yet each one
+//  still paid for a full NDEF read (12 NTAG pages, one I2C round trip
+//  each on the PN532) before playback could start. The UID is already
+//  in hand after detection, so remember what each UID said the first
+//  time and skip the read on every later tap.
+//
+//  Stored in NVS (Preferences namespace "tag_album"), one blob per tag.
+//  NVS keys max out at 15 chars - too short for an 8-byte ISO15693 UID
+//  in hex - so the key is a hash of the UID and the blob carries the
+//  full UID, checked on lookup.
+//
+//  Kept correct by: writeAlbumTag() updating the entry for the tag it
+//  just wrote, and ScreenManager dropping an entry whose album didn't
+//  resolve on the SD card (the tag is then read properly next time).
+// =====================================================================
+
+#ifndef TAG_ALBUM_CACHE_H
+#define TAG_ALBUM_CACHE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "NfcReader.h"
+#include "NfcSession.h"
+
+class TagAlbumCache {
+public:
+    static TagAlbumCache& getInstance() {
+        static TagAlbumCache instance;
+        return instance;
+    }
+
+    // What this tag said when it was last read, if it has been seen.
+    bool lookup(const NfcTag& tag, AlbumTag& out);
+
+    // Remember / replace. Skips the flash write when nothing changed.
+    void store(const NfcTag& tag, const AlbumTag& content);
+
+    void forget(const NfcTag& tag);
+    void clear();
+
+private:
+    TagAlbumCache();
+    TagAlbumCache(const TagAlbumCache&) = delete;
+    TagAlbumCache& operator=(const TagAlbumCache&) = delete;
+
+    struct Entry {
+        uint8_t type;
+        uint8_t uidLength;
+        uint8_t uid[8];
+        AlbumTag content;
+    };
+    // Entries from an older layout read back short and count as misses.
+
+    bool open();
+    static void makeKey(const NfcTag& tag, char* key);
+    bool readEntry(const NfcTag& tag, const char* key, Entry& entry);
+
+    Preferences prefs;
+    bool _open;
+};
+
+#endif // TAG_ALBUM_CACHE_H
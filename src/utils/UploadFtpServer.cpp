@@ -0,0 +1,637 @@
+// =====================================================================
+//  UploadFtpServer.cpp - FTP server implementation
+// =====================================================================
+
+#include "UploadFtpServer.h"
+#include "LibraryJournal.h"
+#include "SPIBusLock.h"
+#include <SdFat.h>
+#include <esp_heap_caps.h>
+#include <stdarg.h>
+
+extern SdFs sd;
+
+static const size_t READ_CHUNK = 4096;
+
+UploadFtpServer& UploadFtpServer::getInstance() {
+    static UploadFtpServer instance;
+    return instance;
+}
+
+UploadFtpServer::UploadFtpServer()
+    : _controlServer(CONTROL_PORT),
+      _dataServer(DATA_PORT),
+      _loggedIn(false),
+      _userOk(false),
+      _passive(false),
+      _allocSize(0),
+      _lineLen(0),
+      _lastActivity(0),
+      _readBuffer(nullptr),
+      _task(nullptr),
+      _stopping(false)
+{
+    _user[0] = '\0';
+    _password[0] = '\0';
+    strcpy(_cwd, "/");
+    _renameFrom[0] = '\0';
+    memset(&_status, 0, sizeof(_status));
+    _mutex = xSemaphoreCreateMutex();
+}
+
+bool UploadFtpServer::begin(const char* user, const char* password) {
+    if (_task) return true;
+
+    strncpy(_user, user, sizeof(_user) - 1);
+    _user[sizeof(_user) - 1] = '\0';
+    strncpy(_password, password, sizeof(_password) - 1);
+    _password[sizeof(_password) - 1] = '\0';
+
+    if (!_readBuffer) {
+        _readBuffer = (uint8_t*)heap_caps_malloc(READ_CHUNK, MALLOC_CAP_SPIRAM);
+        if (!_readBuffer) _readBuffer = (uint8_t*)malloc(READ_CHUNK);
+        if (!_readBuffer) return false;
+    }
+
+    _controlServer.begin();
+    _controlServer.setNoDelay(true);
+    _dataServer.begin();
+    _dataServer.setNoDelay(true);
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    memset(&_status, 0, sizeof(_status));
+    xSemaphoreGive(_mutex);
+
+    // Core 1 with the UI, at loop()'s priority: the feeder on Core 0
+    // and lwIP's own task are left alone, and a stalled client only
+    // ever blocks this task.
+    _stopping = false;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        taskEntry,
+        "FtpServer",
+        8192,
+        this,
+        1,
+        &_task,
+        1
+    );
+    if (ok != pdPASS) {
+        _task = nullptr;
+        _controlServer.end();
+        _dataServer.end();
+        Serial.println("FTP: ✗ Task create failed");
+        return false;
+    }
+    Serial.printf("FTP: ✓ Listening on port %u\n", CONTROL_PORT);
+    return true;
+}
+
+void UploadFtpServer::end() {
+    if (!_task) return;
+    _stopping = true;
+    // The task notices within one poll interval, or at the end of the
+    // SD write in progress
+    for (int i = 0; i < 300 && _task; i++) delay(10);
+    _controlServer.end();
+    _dataServer.end();
+    Serial.println("FTP: Stopped");
+}
+
+UploadFtpServer::Status UploadFtpServer::status() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Status s = _status;
+    xSemaphoreGive(_mutex);
+    return s;
+}
+
+void UploadFtpServer::taskEntry(void* param) {
+    static_cast<UploadFtpServer*>(param)->run();
+}
+
+void UploadFtpServer::run() {
+    while (!_stopping) {
+        if (_control && !_control.connected()) closeSession();
+
+        if (!_control) {
+            WiFiClient client = _controlServer.available();
+            if (!client) {
+                vTaskDelay(pdMS_TO_TICKS(50));
+                continue;
+            }
+
+            _control = client;
+            _control.setNoDelay(true);
+            _loggedIn = false;
+            _userOk = false;
+            _passive = false;
+            _allocSize = 0;
+            _lineLen = 0;
+            strcpy(_cwd, "/");
+            _renameFrom[0] = '\0';
+            _lastActivity = millis();
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            _status.clientConnected = true;
+            xSemaphoreGive(_mutex);
+            Serial.printf("FTP: Client %s connected\n", _control.remoteIP().toString().c_str());
+            reply(220, "MP3Player FTP ready");
+            continue;
+        }
+
+        if (readLine()) {
+            _lastActivity = millis();
+            handleCommand(_line);
+        } else if (millis() - _lastActivity > IDLE_TIMEOUT_MS) {
+            reply(421, "Idle timeout");
+            closeSession();
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+    }
+
+    if (_writer.isOpen()) _writer.abort();
+    if (_data) _data.stop();
+    if (_control) closeSession();
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _status.transferring = false;
+    xSemaphoreGive(_mutex);
+
+    _task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void UploadFtpServer::closeSession() {
+    _control.stop();
+    Serial.println("FTP: Client disconnected");
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _status.clientConnected = false;
+    xSemaphoreGive(_mutex);
+}
+
+// true once a whole line (CRLF or LF) is in _line, without the ending
+bool UploadFtpServer::readLine() {
+    while (_control.available()) {
+        int c = _control.read();
+        if (c < 0) break;
+        if (c == '\n') {
+            while (_lineLen && _line[_lineLen - 1] == '\r') _lineLen--;
+            _line[_lineLen] = '\0';
+            _lineLen = 0;
+            return true;
+        }
+        if (_lineLen < sizeof(_line) - 1) _line[_lineLen++] = (char)c;
+    }
+    return false;
+}
+
+void UploadFtpServer::reply(int code, const char* fmt, ...) {
+    char text[300];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    _control.printf("%d %s\r\n", code, text);
+}
+
+// Absolute, normalized path for a client argument: relative to _cwd,
+// "." and ".." folded, no trailing slash (except "/" itself).
+bool UploadFtpServer::resolve(const char* arg, char* out, size_t size) const {
+    char joined[600];
+    if (!arg || !*arg) arg = ".";
+    if (arg[0] == '/') {
+        snprintf(joined, sizeof(joined), "%s", arg);
+    } else {
+        snprintf(joined, sizeof(joined), "%s/%s", _cwd, arg);
+    }
+
+    size_t len = 0;
+    out[0] = '\0';
+    const char* p = joined;
+    while (*p) {
+        while (*p == '/') p++;
+        const char* start = p;
+        while (*p && *p != '/') p++;
+        size_t n = p - start;
+        if (n == 0 || (n == 1 && start[0] == '.')) continue;
+        if (n == 2 && start[0] == '.' && start[1] == '.') {
+            while (len > 0 && out[len - 1] != '/') len--;
+            if (len > 0) len--;
+            out[len] = '\0';
+            continue;
+        }
+        if (len + 1 + n + 1 > size) return false;
+        out[len++] = '/';
+        memcpy(out + len, start, n);
+        len += n;
+        out[len] = '\0';
+    }
+    if (len == 0) {
+        if (size < 2) return false;
+        strcpy(out, "/");
+    }
+    return true;
+}
+
+// A client that connected for a transfer we then refused (550 before
+// openData()) is still waiting in the listen queue - it mustn't be
+// taken for the next transfer's connection
+void UploadFtpServer::dropStaleData() {
+    while (true) {
+        WiFiClient stale = _dataServer.available();
+        if (!stale) break;
+        stale.stop();
+    }
+}
+
+bool UploadFtpServer::openData() {
+    if (!_passive) {
+        reply(425, "Use PASV first");
+        return false;
+    }
+    _passive = false;
+
+    unsigned long start = millis();
+    while (millis() - start < 10000 && !_stopping) {
+        _data = _dataServer.available();
+        if (_data) {
+            _data.setNoDelay(true);
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    reply(425, "No data connection");
+    return false;
+}
+
+void UploadFtpServer::handleCommand(char* line) {
+    char* arg = strchr(line, ' ');
+    if (arg) {
+        *arg++ = '\0';
+        while (*arg == ' ') arg++;
+    } else {
+        arg = line + strlen(line);
+    }
+    const char* cmd = line;
+
+    if (!strcasecmp(cmd, "USER")) {
+        _userOk = strcmp(arg, _user) == 0;
+        _loggedIn = false;
+        reply(331, "Password required");
+        return;
+    }
+    if (!strcasecmp(cmd, "PASS")) {
+        _loggedIn = _userOk && strcmp(arg, _password) == 0;
+        if (_loggedIn) reply(230, "Logged in");
+        else reply(530, "Login incorrect");
+        return;
+    }
+    if (!strcasecmp(cmd, "QUIT")) {
+        reply(221, "Bye");
+        closeSession();
+        return;
+    }
+    if (!strcasecmp(cmd, "NOOP")) { reply(200, "OK"); return; }
+    if (!strcasecmp(cmd, "SYST")) { reply(215, "UNIX Type: L8"); return; }
+    if (!strcasecmp(cmd, "FEAT")) {
+        _control.print("211-Features:\r\n SIZE\r\n UTF8\r\n EPSV\r\n PASV\r\n211 End\r\n");
+        return;
+    }
+    if (!strcasecmp(cmd, "OPTS")) { reply(200, "OK"); return; }
+
+    if (!_loggedIn) {
+        reply(530, "Not logged in");
+        return;
+    }
+
+    char path[256];
+
+    if (!strcasecmp(cmd, "PWD") || !strcasecmp(cmd, "XPWD")) {
+        reply(257, "\"%s\" is the current directory", _cwd);
+    } else if (!strcasecmp(cmd, "CWD") || !strcasecmp(cmd, "CDUP") || !strcasecmp(cmd, "XCUP")) {
+        if (!resolve(strcasecmp(cmd, "CWD") ? ".." : arg, path, sizeof(path))) {
+            reply(550, "Bad path");
+            return;
+        }
+        bool isDir;
+        {
+            SPIBusGuard guard;
+            FsFile dir;
+            isDir = dir.open(path) && dir.isDirectory();
+            dir.close();
+        }
+        if (isDir) {
+            strcpy(_cwd, path);
+            reply(250, "Directory is %s", _cwd);
+        } else {
+            reply(550, "No such directory");
+        }
+    } else if (!strcasecmp(cmd, "TYPE") || !strcasecmp(cmd, "MODE") || !strcasecmp(cmd, "STRU")) {
+        reply(200, "OK");     // binary, stream, file - the only ones there are
+    } else if (!strcasecmp(cmd, "PASV")) {
+        IPAddress ip = _control.localIP();
+        dropStaleData();
+        _passive = true;
+        reply(227, "Entering Passive Mode (%u,%u,%u,%u,%u,%u)", ip[0], ip[1], ip[2], ip[3],
+              DATA_PORT >> 8, DATA_PORT & 0xFF);
+    } else if (!strcasecmp(cmd, "EPSV")) {
+        dropStaleData();
+        _passive = true;
+        reply(229, "Entering Extended Passive Mode (|||%u|)", DATA_PORT);
+    } else if (!strcasecmp(cmd, "PORT") || !strcasecmp(cmd, "EPRT")) {
+        reply(502, "Passive mode only");
+    } else if (!strcasecmp(cmd, "LIST")) {
+        doList(arg, false);
+    } else if (!strcasecmp(cmd, "NLST")) {
+        doList(arg, true);
+    } else if (!strcasecmp(cmd, "ALLO")) {
+        _allocSize = strtoull(arg, nullptr, 10);
+        reply(200, "OK");
+    } else if (!resolve(arg, path, sizeof(path))) {
+        reply(550, "Bad path");
+    } else if (!strcasecmp(cmd, "STOR")) {
+        doStore(path);
+    } else if (!strcasecmp(cmd, "RETR")) {
+        doRetrieve(path);
+    } else if (!strcasecmp(cmd, "DELE")) {
+        doDelete(path, false);
+    } else if (!strcasecmp(cmd, "RMD") || !strcasecmp(cmd, "XRMD")) {
+        doDelete(path, true);
+    } else if (!strcasecmp(cmd, "MKD") || !strcasecmp(cmd, "XMKD")) {
+        bool ok;
+        {
+            SPIBusGuard guard;
+            ok = sd.mkdir(path);
+        }
+        if (ok) {
+            LibraryJournal::getInstance().record(path);
+            reply(257, "\"%s\" created", path);
+        } else {
+            reply(550, "Can't create directory");
+        }
+    } else if (!strcasecmp(cmd, "RNFR")) {
+        bool exists;
+        {
+            SPIBusGuard guard;
+            exists = sd.exists(path);
+        }
+        if (!exists) {
+            reply(550, "No such file");
+        } else if (UploadWriter::isProtected(path)) {
+            reply(550, "In use - playing now");
+        } else {
+            strcpy(_renameFrom, path);
+            reply(350, "Ready for RNTO");
+        }
+    } else if (!strcasecmp(cmd, "RNTO")) {
+        doRename(path);
+    } else if (!strcasecmp(cmd, "SIZE")) {
+        FsFile file;
+        bool ok;
+        uint64_t size = 0;
+        {
+            SPIBusGuard guard;
+            ok = file.open(path) && !file.isDirectory();
+            if (ok) size = file.fileSize();
+            file.close();
+        }
+        if (ok) reply(213, "%llu", size);
+        else reply(550, "No such file");
+    } else {
+        reply(502, "%s not implemented", cmd);
+    }
+}
+
+void UploadFtpServer::doList(const char* arg, bool namesOnly) {
+    // Clients pass ls flags ("-la"); there's only one listing format
+    while (*arg == '-') {
+        while (*arg && *arg != ' ') arg++;
+        while (*arg == ' ') arg++;
+    }
+
+    char path[256];
+    if (!resolve(arg, path, sizeof(path))) {
+        reply(550, "Bad path");
+        return;
+    }
+
+    FsFile dir;
+    bool ok;
+    {
+        SPIBusGuard guard;
+        ok = dir.open(path) && dir.isDirectory();
+    }
+    if (!ok) {
+        reply(550, "No such directory");
+        return;
+    }
+    if (!openData()) {
+        SPIBusGuard guard;
+        dir.close();
+        return;
+    }
+    reply(150, "Listing %s", path);
+
+    static const char* const MONTHS[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+
+    while (!_stopping) {
+        char name[256];
+        bool isDir;
+        uint64_t size;
+        uint16_t date = 0, time = 0;
+        {
+            // Bus held for one entry; the network send happens after
+            SPIBusGuard guard;
+            FsFile entry;
+            if (!entry.openNext(&dir, O_RDONLY)) break;
+            entry.getName(name, sizeof(name));
+            isDir = entry.isDirectory();
+            size = entry.fileSize();
+            entry.getModifyDateTime(&date, &time);
+            entry.close();
+        }
+
+        char text[340];
+        if (namesOnly) {
+            snprintf(text, sizeof(text), "%s\r\n", name);
+        } else {
+            int month = FS_MONTH(date);
+            snprintf(text, sizeof(text), "%s 1 owner group %12llu %s %2d %5d %s\r\n",
+                     isDir ? "drwxr-xr-x" : "-rw-r--r--", isDir ? 0ULL : (unsigned long long)size,
+                     MONTHS[(month >= 1 && month <= 12) ? month - 1 : 0], FS_DAY(date),
+                     FS_YEAR(date), name);
+        }
+        _data.print(text);
+    }
+
+    {
+        SPIBusGuard guard;
+        dir.close();
+    }
+    _data.stop();
+    reply(226, "Listing done");
+}
+
+void UploadFtpServer::doStore(const char* path) {
+    if (UploadWriter::isProtected(path)) {
+        reply(550, "In use - playing now");
+        return;
+    }
+    if (!openData()) return;
+
+    uint64_t expected = _allocSize;
+    _allocSize = 0;
+    if (!_writer.open(path, expected)) {
+        _data.stop();
+        reply(550, "Can't create file");
+        return;
+    }
+    reply(150, "Receiving %s", path);
+
+    const char* name = strrchr(path, '/');
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _status.transferring = true;
+    strncpy(_status.lastFile, name ? name + 1 : path, sizeof(_status.lastFile) - 1);
+    _status.lastFile[sizeof(_status.lastFile) - 1] = '\0';
+    xSemaphoreGive(_mutex);
+
+    // Straight from the socket into the writer's buffer - no copy
+    bool ok = true;
+    unsigned long lastData = millis();
+    while (true) {
+        int avail = _data.available();
+        if (avail > 0) {
+            size_t room;
+            uint8_t* dst = _writer.space(&room);
+            if (!dst) {
+                ok = false;
+                break;
+            }
+            int n = _data.read(dst, (size_t)avail < room ? (size_t)avail : room);
+            if (n > 0 && !_writer.commit(n)) {
+                ok = false;
+                break;
+            }
+            lastData = millis();
+            continue;
+        }
+        if (!_data.connected()) break;      // sender closed: that's the end of the file
+        if (_stopping || millis() - lastData > DATA_TIMEOUT_MS) {
+            ok = false;
+            break;
+        }
+        vTaskDelay(1);
+    }
+    _data.stop();
+
+    if (ok) {
+        ok = _writer.close();
+    } else {
+        _writer.abort();
+    }
+    finishUpload(path, ok);
+}
+
+void UploadFtpServer::finishUpload(const char* path, bool ok) {
+    // Recorded either way - a failed upload has been removed, and if it
+    // replaced an existing file that's gone from the album too
+    LibraryJournal::getInstance().record(path);
+
+    const UploadWriter::Stats& s = _writer.lastStats();
+    float mbps = UploadWriter::mbPerSec(s.bytes, s.totalUs);
+    float sdMbps = UploadWriter::mbPerSec(s.bytes, s.sdUs);
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _status.transferring = false;
+    if (ok) {
+        _status.filesReceived++;
+        _status.bytesReceived += s.bytes;
+        _status.lastMBps = mbps;
+        _status.lastSdMBps = sdMbps;
+    }
+    xSemaphoreGive(_mutex);
+
+    if (!ok) {
+        reply(451, "Transfer failed");
+        return;
+    }
+    Serial.printf("FTP: ✓ %s - %.2f MB in %.2f s = %.2f MB/s (SD writes %.2f MB/s, %u%% busy%s)\n",
+                  path, s.bytes / 1048576.0f, s.totalUs / 1e6f, mbps, sdMbps,
+                  s.totalUs ? (unsigned)((uint64_t)s.sdUs * 100 / s.totalUs) : 0,
+                  s.preAllocated ? ", contiguous" : "");
+    reply(226, "Stored, %.2f MB/s", mbps);
+}
+
+void UploadFtpServer::doRetrieve(const char* path) {
+    FsFile file;
+    bool ok;
+    {
+        SPIBusGuard guard;
+        ok = file.open(path) && !file.isDirectory();
+    }
+    if (!ok) {
+        reply(550, "No such file");
+        return;
+    }
+    if (!openData()) {
+        SPIBusGuard guard;
+        file.close();
+        return;
+    }
+    reply(150, "Sending %s", path);
+
+    while (!_stopping && _data.connected()) {
+        int n;
+        {
+            SPIBusGuard guard;
+            n = file.read(_readBuffer, READ_CHUNK);
+        }
+        if (n <= 0) break;
+        if (_data.write(_readBuffer, n) != (size_t)n) break;
+    }
+
+    {
+        SPIBusGuard guard;
+        file.close();
+    }
+    _data.stop();
+    reply(226, "Sent");
+}
+
+void UploadFtpServer::doDelete(const char* path, bool directory) {
+    if (UploadWriter::isProtected(path)) {
+        reply(550, "In use - playing now");
+        return;
+    }
+    bool ok;
+    {
+        SPIBusGuard guard;
+        ok = directory ? sd.rmdir(path) : sd.remove(path);
+    }
+    if (!ok) {
+        reply(550, directory ? "Can't remove directory (not empty?)" : "Can't delete file");
+        return;
+    }
+    LibraryJournal::getInstance().record(path);
+    reply(250, "Deleted");
+}
+
+void UploadFtpServer::doRename(const char* to) {
+    if (!_renameFrom[0]) {
+        reply(503, "RNFR first");
+        return;
+    }
+    bool ok;
+    {
+        SPIBusGuard guard;
+        ok = sd.rename(_renameFrom, to);
+    }
+    if (ok) {
+        LibraryJournal::getInstance().record(_renameFrom);
+        LibraryJournal::getInstance().record(to);
+        reply(250, "Renamed");
+    } else {
+        reply(550, "Rename failed");
+    }
+    _renameFrom[0] = '\0';
+}
@@ -0,0 +1,116 @@
+// =====================================================================
+//  UploadFtpServer.h - Minimal FTP server for loading music onto the card
+//
+//  Replaces the ESP32FtpServer library, which needed the Arduino SD
+//  library mounted on the same card alongside SdFat (two FAT drivers
+//  with separate caches writing one volume), was pumped from the UI
+//  loop one handleFTP() at a time, and copied uploads to the card in
+//  small unaligned writes. That cost FTPUploadScreen a deleted MP3
+//  task, too - there was no sharing the card with it.
+//
+//  This one runs in its own task on Core 1, goes through the global
+//  SdFs like everything else (SPI1 bus guard per operation, never while
+//  waiting on the network), and stores uploads through UploadWriter.
+//  Playback carries on throughout; the player's open and queued files
+//  are refused for overwrite, delete and rename
+//  (UploadWriter::setProtectedPaths()).
+//
+//  One client at a time, passive mode only (PASV/EPSV) - enough for
+//  FileZilla, WinSCP, Finder/Explorer and curl. Every store, delete,
+//  rename and mkdir/rmdir is recorded in LibraryJournal, and every
+//  upload is timed: the MB/s figures land on the serial log and in
+//  status() for the screen.
+// =====================================================================
+
+#ifndef UPLOAD_FTP_SERVER_H
+#define UPLOAD_FTP_SERVER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "UploadWriter.h"
+
+class UploadFtpServer {
+public:
+    struct Status {
+        bool clientConnected;
+        bool transferring;
+        uint32_t filesReceived;
+        uint64_t bytesReceived;
+        char lastFile[64];
+        float lastMBps;         // last upload, end to end
+        float lastSdMBps;       // same bytes over time spent in SD writes
+    };
+
+    static UploadFtpServer& getInstance();
+
+    // Start listening (WiFi must already be up) and create the task.
+    bool begin(const char* user, const char* password);
+
+    // Close any session and stop the task. Blocks until it has.
+    void end();
+
+    bool isRunning() const { return _task != nullptr; }
+
+    Status status();
+
+    static const uint16_t CONTROL_PORT = 21;
+    static const uint16_t DATA_PORT = 50009;
+    static const uint32_t IDLE_TIMEOUT_MS = 300000;
+    static const uint32_t DATA_TIMEOUT_MS = 30000;
+
+private:
+    UploadFtpServer();
+    UploadFtpServer(const UploadFtpServer&) = delete;
+    UploadFtpServer& operator=(const UploadFtpServer&) = delete;
+
+    static void taskEntry(void* param);
+    void run();
+
+    void closeSession();
+    bool readLine();
+    void handleCommand(char* line);
+    void reply(int code, const char* fmt, ...);
+
+    bool resolve(const char* arg, char* out, size_t size) const;
+    void dropStaleData();
+    bool openData();
+
+    void doList(const char* arg, bool namesOnly);
+    void doStore(const char* path);
+    void doRetrieve(const char* path);
+    void doDelete(const char* path, bool directory);
+    void doRename(const char* to);
+    void finishUpload(const char* path, bool ok);
+
+    WiFiServer _controlServer;
+    WiFiServer _dataServer;
+    WiFiClient _control;
+    WiFiClient _data;
+
+    char _user[32];
+    char _password[32];
+    bool _loggedIn;
+    bool _userOk;
+    bool _passive;
+    char _cwd[256];
+    char _renameFrom[256];
+    uint64_t _allocSize;        // from ALLO, for the next STOR
+
+    char _line[320];
+    size_t _lineLen;
+    unsigned long _lastActivity;
+
+    UploadWriter _writer;
+    uint8_t* _readBuffer;       // RETR
+
+    Status _status;
+    SemaphoreHandle_t _mutex;
+
+    TaskHandle_t _task;
+    volatile bool _stopping;
+};
+
+#endif // UPLOAD_FTP_SERVER_H
@@ -0,0 +1,655 @@
+// =====================================================================
+//  UploadHttpServer.cpp - HTTP upload server implementation
+// =====================================================================
+
+#include "UploadHttpServer.h"
+#include "LibraryIndex.h"
+#include "LibraryJournal.h"
+#include "SPIBusLock.h"
+#include <SdFat.h>
+#include <esp_heap_caps.h>
+#include <stdarg.h>
+
+extern SdFs sd;
+
+static const size_t READ_CHUNK = 4096;
+
+static const char INDEX_PAGE[] =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\">"
+    "<meta name=\"viewport\" content=\"width=device-width\">"
+    "<title>MP3Player</title></head><body style=\"font-family:sans-serif\">"
+    "<h2>MP3Player upload</h2>"
+    "<form method=\"post\" enctype=\"multipart/form-data\" "
+    "onsubmit=\"this.action='/files/Music/'+encodeURIComponent(this.album.value)\">"
+    "<p>Album folder: <input name=\"album\" placeholder=\"blank = keep folder names\"></p>"
+    "<p>Files: <input type=\"file\" name=\"f\" multiple></p>"
+    "<p>or a whole folder: <input type=\"file\" name=\"d\" webkitdirectory></p>"
+    "<p><button>Upload</button></p></form>"
+    "<p><a href=\"/api/library\">Library (JSON)</a></p>"
+    "</body></html>";
+
+static const char* reasonPhrase(int code) {
+    switch (code) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 414: return "URI Too Long";
+    case 415: return "Unsupported Media Type";
+    case 423: return "Locked";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    case 507: return "Insufficient Storage";
+    default:  return "Internal Server Error";
+    }
+}
+
+// Appends to a fixed buffer; ok goes false (and stays) once something
+// didn't fit, so a caller can roll back to a mark and try again later.
+struct JsonOut {
+    char* buf;
+    size_t size;
+    size_t& len;
+    bool ok;
+
+    JsonOut(char* b, size_t s, size_t& l) : buf(b), size(s), len(l), ok(true) {}
+
+    void raw(const char* s) {
+        size_t n = strlen(s);
+        if (!ok || len + n > size) {
+            ok = false;
+            return;
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+    }
+
+    void str(const char* s) {
+        raw("\"");
+        for (; *s && ok; s++) {
+            unsigned char c = (unsigned char)*s;
+            char esc[8];
+            if (c == '"' || c == '\\') {
+                esc[0] = '\\';
+                esc[1] = (char)c;
+                esc[2] = '\0';
+            } else if (c < 0x20) {
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+            } else {
+                esc[0] = (char)c;       // UTF-8 passes straight through
+                esc[1] = '\0';
+            }
+            raw(esc);
+        }
+        raw("\"");
+    }
+
+    void rollback(size_t mark) {
+        len = mark;
+        ok = true;
+    }
+};
+
+UploadHttpServer& UploadHttpServer::getInstance() {
+    static UploadHttpServer instance;
+    return instance;
+}
+
+UploadHttpServer::UploadHttpServer()
+    : _server(PORT),
+      _parser(*this),
+      _readBuffer(nullptr),
+      _route(NotFound),
+      _error(nullptr),
+      _files(0),
+      _bytes(0),
+      _startUs(0),
+      _sdUs(0),
+      _json(nullptr),
+      _jsonLen(0),
+      _jsonWanted(false),
+      _jsonStarted(false),
+      _jsonDone(false),
+      _jsonAlbum(0),
+      _jsonTrack(-1),
+      _jsonGeneration(0),
+      _jsonOrderVersion(0),
+      _task(nullptr),
+      _stopping(false)
+{
+    _target[0] = '\0';
+    _filePath[0] = '\0';
+    memset(&_status, 0, sizeof(_status));
+    _mutex = xSemaphoreCreateMutex();
+    _jsonReady = xSemaphoreCreateBinary();
+}
+
+bool UploadHttpServer::begin() {
+    if (_task) return true;
+
+    if (!_readBuffer) {
+        _readBuffer = (uint8_t*)heap_caps_malloc(READ_CHUNK, MALLOC_CAP_SPIRAM);
+        if (!_readBuffer) _readBuffer = (uint8_t*)malloc(READ_CHUNK);
+    }
+    if (!_json) {
+        _json = (char*)heap_caps_malloc(JSON_BUFFER, MALLOC_CAP_SPIRAM);
+        if (!_json) _json = (char*)malloc(JSON_BUFFER);
+    }
+    if (!_readBuffer || !_json) {
+        Serial.println("HTTP: ✗ No memory for buffers");
+        return false;
+    }
+
+    _server.begin();
+    _server.setNoDelay(true);
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    memset(&_status, 0, sizeof(_status));
+    xSemaphoreGive(_mutex);
+
+    // Core 1 beside the UI, at loop()'s priority - see UploadFtpServer
+    _stopping = false;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        taskEntry,
+        "HttpServer",
+        8192,
+        this,
+        1,
+        &_task,
+        1
+    );
+    if (ok != pdPASS) {
+        _task = nullptr;
+        _server.end();
+        Serial.println("HTTP: ✗ Task create failed");
+        return false;
+    }
+    Serial.printf("HTTP: ✓ Listening on port %u\n", PORT);
+    return true;
+}
+
+void UploadHttpServer::end() {
+    if (!_task) return;
+    _stopping = true;
+    for (int i = 0; i < 300 && _task; i++) {
+        service();      // a library request may be waiting on loop()
+        delay(10);
+    }
+    _server.end();
+    Serial.println("HTTP: Stopped");
+}
+
+UploadHttpServer::Status UploadHttpServer::status() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Status s = _status;
+    xSemaphoreGive(_mutex);
+    return s;
+}
+
+void UploadHttpServer::taskEntry(void* param) {
+    static_cast<UploadHttpServer*>(param)->run();
+}
+
+void UploadHttpServer::run() {
+    while (!_stopping) {
+        _client = _server.available();
+        if (!_client) {
+            vTaskDelay(pdMS_TO_TICKS(50));
+            continue;
+        }
+        _client.setNoDelay(true);
+        handleConnection();
+        _client.stop();
+    }
+
+    _task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void UploadHttpServer::handleConnection() {
+    _parser.reset();
+    _route = NotFound;
+    _error = nullptr;
+    _filePath[0] = '\0';
+
+    bool continued = false;
+    unsigned long lastData = millis();
+    while (!_stopping && !_parser.isDone() && !_parser.failed()) {
+        int avail = _client.available();
+        if (avail > 0) {
+            int n = _client.read(_readBuffer, (size_t)avail < READ_CHUNK ? (size_t)avail : READ_CHUNK);
+            if (n > 0) _parser.feed(_readBuffer, n);
+            lastData = millis();
+            // curl holds back a large PUT body until told to go ahead
+            if (!continued && _parser.inBody() && _parser.expectsContinue()) {
+                _client.print("HTTP/1.1 100 Continue\r\n\r\n");
+                continued = true;
+            }
+            continue;
+        }
+        if (!_client.connected() || millis() - lastData > TIMEOUT_MS) break;
+        vTaskDelay(1);
+    }
+
+    if (_writer.isOpen()) {
+        // Dropped, timed out or refused mid-file
+        _writer.abort();
+        LibraryJournal::getInstance().record(_filePath);
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        _status.transferring = false;
+        xSemaphoreGive(_mutex);
+    }
+
+    if (_parser.isDone()) {
+        respond();
+    } else if (_parser.failed()) {
+        int code = _parser.errorStatus();
+        sendError(code, _error ? _error : reasonPhrase(code));
+    }
+}
+
+// Request line and headers are in: route it, and refuse early anything
+// that shouldn't get as far as a body
+int UploadHttpServer::onHeaders(const HttpRequestParser& request) {
+    _files = 0;
+    _bytes = 0;
+    _sdUs = 0;
+    _startUs = micros();
+
+    const char* path = request.path();
+    HttpRequestParser::Method method = request.method();
+
+    if (method == HttpRequestParser::Get) {
+        if (!strcmp(path, "/")) _route = IndexPage;
+        else if (!strcmp(path, "/api/library")) _route = Library;
+        return 0;
+    }
+
+    if (strncmp(path, "/files", 6) != 0 || (path[6] != '/' && path[6] != '\0')) return 404;
+    if (!cleanPath(path + 6, _target, sizeof(_target))) {
+        _error = "Bad path";
+        return 400;
+    }
+
+    switch (method) {
+    case HttpRequestParser::Put:
+        if (!strcmp(_target, "/")) {
+            _error = "PUT needs a file name";
+            return 400;
+        }
+        if (UploadWriter::isProtected(_target)) {
+            _error = "In use - playing now";
+            return 423;
+        }
+        if (!makeParents(_target)) {
+            _error = "Can't create folder";
+            return 500;
+        }
+        _route = PutFile;
+        return 0;
+
+    case HttpRequestParser::Post: {
+        if (!request.isMultipart()) {
+            _error = "POST takes multipart/form-data";
+            return 415;
+        }
+        bool ok;
+        {
+            SPIBusGuard guard;
+            ok = !strcmp(_target, "/") || sd.exists(_target) || sd.mkdir(_target, true);
+        }
+        if (!ok) {
+            _error = "Can't create folder";
+            return 500;
+        }
+        _route = PostFiles;
+        return 0;
+    }
+
+    case HttpRequestParser::Delete:
+        if (UploadWriter::isProtected(_target)) {
+            _error = "In use - playing now";
+            return 423;
+        }
+        _route = DeletePath;
+        return 0;
+
+    default:
+        return 405;
+    }
+}
+
+int UploadHttpServer::onFileBegin(const char* name) {
+    uint64_t expected;
+    if (_route == PutFile) {
+        strcpy(_filePath, _target);
+        expected = _parser.contentLength();
+    } else {
+        // A folder upload names files "Album/01.mp3" - keep the folders
+        char rel[256];
+        if (!cleanPath(name, rel, sizeof(rel)) || !strcmp(rel, "/")) {
+            _error = "Bad file name";
+            return 400;
+        }
+        if (snprintf(_filePath, sizeof(_filePath), "%s%s",
+                     strcmp(_target, "/") ? _target : "", rel) >= (int)sizeof(_filePath)) {
+            _error = "Path too long";
+            return 414;
+        }
+        if (strchr(rel + 1, '/') && !makeParents(_filePath)) {
+            _error = "Can't create folder";
+            return 500;
+        }
+        // What's left of the body bounds this file; the default extent
+        // otherwise (trimmed on close either way)
+        expected = _parser.bodyRemaining();
+        if (expected > UploadWriter::DEFAULT_EXTENT) expected = 0;
+    }
+
+    if (UploadWriter::isProtected(_filePath)) {
+        _error = "In use - playing now";
+        return 423;
+    }
+    if (!_writer.open(_filePath, expected)) {
+        _error = "Can't create file";
+        return 500;
+    }
+
+    const char* fileName = strrchr(_filePath, '/');
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _status.transferring = true;
+    strncpy(_status.lastFile, fileName ? fileName + 1 : _filePath, sizeof(_status.lastFile) - 1);
+    _status.lastFile[sizeof(_status.lastFile) - 1] = '\0';
+    xSemaphoreGive(_mutex);
+    return 0;
+}
+
+int UploadHttpServer::onFileData(const uint8_t* data, size_t len) {
+    if (_writer.write(data, len)) return 0;
+    _error = "Write failed - card full?";
+    return 507;
+}
+
+int UploadHttpServer::onFileEnd() {
+    bool ok = _writer.close();
+    // Recorded either way - a failed write has been removed, and if it
+    // replaced an existing file that's gone from the album too
+    LibraryJournal::getInstance().record(_filePath);
+
+    const UploadWriter::Stats& s = _writer.lastStats();
+    float mbps = UploadWriter::mbPerSec(s.bytes, s.totalUs);
+    float sdMbps = UploadWriter::mbPerSec(s.bytes, s.sdUs);
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _status.transferring = false;
+    if (ok) {
+        _status.filesReceived++;
+        _status.bytesReceived += s.bytes;
+        _status.lastMBps = mbps;
+        _status.lastSdMBps = sdMbps;
+    }
+    xSemaphoreGive(_mutex);
+
+    if (!ok) {
+        _error = "Write failed - card full?";
+        return 507;
+    }
+    _files++;
+    _bytes += s.bytes;
+    _sdUs += s.sdUs;
+    Serial.printf("HTTP: ✓ %s - %.2f MB in %.2f s = %.2f MB/s (SD writes %.2f MB/s%s)\n",
+                  _filePath, s.bytes / 1048576.0f, s.totalUs / 1e6f, mbps, sdMbps,
+                  s.preAllocated ? ", contiguous" : "");
+    return 0;
+}
+
+void UploadHttpServer::respond() {
+    switch (_route) {
+    case IndexPage:
+        sendHead(200, "text/html; charset=utf-8", sizeof(INDEX_PAGE) - 1);
+        _client.write((const uint8_t*)INDEX_PAGE, sizeof(INDEX_PAGE) - 1);
+        break;
+
+    case Library:
+        sendLibrary();
+        break;
+
+    case PutFile:
+    case PostFiles: {
+        uint32_t us = micros() - _startUs;
+        char path[300];
+        size_t pathLen = 0;
+        JsonOut out(path, sizeof(path) - 1, pathLen);
+        out.str(_route == PutFile ? _filePath : _target);
+        path[out.ok ? pathLen : 0] = '\0';
+        sendJson(_route == PutFile ? 201 : 200,
+                 "{\"path\":%s,\"files\":%lu,\"bytes\":%llu,\"seconds\":%.3f,"
+                 "\"mbps\":%.2f,\"sdMbps\":%.2f}",
+                 path, (unsigned long)_files, _bytes, us / 1e6f,
+                 UploadWriter::mbPerSec(_bytes, us), UploadWriter::mbPerSec(_bytes, _sdUs));
+        break;
+    }
+
+    case DeletePath: {
+        int code = deletePath();
+        if (code == 204) sendHead(204, "application/json", 0);
+        else sendError(code, _error ? _error : reasonPhrase(code));
+        break;
+    }
+
+    default:
+        sendError(404, reasonPhrase(404));
+        break;
+    }
+}
+
+int UploadHttpServer::deletePath() {
+    if (!strcmp(_target, "/")) {
+        _error = "Won't delete the root";
+        return 400;
+    }
+
+    bool found, isDir = false, ok = false;
+    {
+        SPIBusGuard guard;
+        FsFile file;
+        found = file.open(_target);
+        if (found) {
+            isDir = file.isDirectory();
+            file.close();
+            ok = isDir ? sd.rmdir(_target) : sd.remove(_target);
+        }
+    }
+    if (!found) return 404;
+    if (!ok) {
+        _error = isDir ? "Folder not empty" : "Can't delete file";
+        return isDir ? 409 : 500;
+    }
+    LibraryJournal::getInstance().record(_target);
+    return 204;
+}
+
+void UploadHttpServer::sendHead(int code, const char* type, long length) {
+    char head[200];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n",
+                     code, reasonPhrase(code), type);
+    if (length >= 0) {
+        n += snprintf(head + n, sizeof(head) - n, "Content-Length: %ld\r\n", length);
+    } else {
+        n += snprintf(head + n, sizeof(head) - n, "Transfer-Encoding: chunked\r\n");
+    }
+    snprintf(head + n, sizeof(head) - n, "Connection: close\r\n\r\n");
+    _client.print(head);
+}
+
+void UploadHttpServer::sendJson(int code, const char* fmt, ...) {
+    char body[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(body, sizeof(body), fmt, args);
+    va_end(args);
+    if (n >= (int)sizeof(body)) n = sizeof(body) - 1;
+    sendHead(code, "application/json", n);
+    _client.write((const uint8_t*)body, n);
+}
+
+void UploadHttpServer::sendError(int code, const char* message) {
+    char text[160];
+    size_t len = 0;
+    JsonOut out(text, sizeof(text) - 1, len);
+    out.str(message);
+    text[out.ok ? len : 0] = '\0';
+    sendJson(code, "{\"error\":%s}", text);
+}
+
+// Sent a JSON_BUFFER at a time as loop() renders it
+void UploadHttpServer::sendLibrary() {
+    sendHead(200, "application/json", -1);
+
+    _jsonStarted = false;
+    _jsonDone = false;
+    xSemaphoreTake(_jsonReady, 0);      // anything left from a request that gave up
+    while (!_stopping && _client.connected()) {
+        _jsonWanted = true;
+        if (xSemaphoreTake(_jsonReady, pdMS_TO_TICKS(2000)) != pdTRUE) {
+            _jsonWanted = false;
+            Serial.println("HTTP: ✗ Library listing timed out - service() not called?");
+            break;
+        }
+        if (_jsonLen == 0 && !_jsonDone) break;     // no progress - can't happen, but don't spin
+
+        char size[12];
+        snprintf(size, sizeof(size), "%x\r\n", (unsigned)_jsonLen);
+        _client.print(size);
+        _client.write((const uint8_t*)_json, _jsonLen);
+        _client.print("\r\n");
+        if (_jsonDone) break;
+    }
+    _client.print("0\r\n\r\n");
+}
+
+void UploadHttpServer::service() {
+    if (!_jsonWanted) return;
+    _jsonLen = 0;
+    renderLibrary();
+    _jsonWanted = false;
+    xSemaphoreGive(_jsonReady);
+}
+
+// As much of the listing as fits in _json, whole entries only, from
+// where the last round stopped. Album positions shift if the scan
+// finds one that sorts earlier; the listing then ends early with
+// "complete":false rather than repeat or skip albums.
+bool UploadHttpServer::renderLibrary() {
+    LibraryIndex& library = LibraryIndex::getInstance();
+    JsonOut out(_json, JSON_BUFFER, _jsonLen);
+    char num[96];
+
+    if (!_jsonStarted) {
+        _jsonGeneration = library.generation();
+        _jsonOrderVersion = library.albumOrderVersion();
+        _jsonAlbum = 0;
+        _jsonTrack = -1;
+        snprintf(num, sizeof(num), "{\"generation\":%lu,\"scanComplete\":%s,\"albums\":[",
+                 (unsigned long)_jsonGeneration, library.isComplete() ? "true" : "false");
+        out.raw(num);
+        _jsonStarted = true;
+    }
+
+    bool changed = false;
+    while (true) {
+        changed = library.generation() != _jsonGeneration ||
+                  library.albumOrderVersion() != _jsonOrderVersion;
+        if (changed || _jsonAlbum >= library.listedAlbumCount()) break;
+
+        int album = library.albumAt(_jsonAlbum);
+        size_t mark = out.len;
+        if (_jsonTrack < 0) {
+            out.raw(_jsonAlbum ? ",{\"name\":" : "{\"name\":");
+            out.str(library.albumName(album));
+            out.raw(",\"tracks\":[");
+            if (!out.ok) {
+                out.rollback(mark);
+                return false;
+            }
+            _jsonTrack = 0;
+        }
+
+        while (_jsonTrack < library.albumTrackCount(album)) {
+            int track = library.albumTrack(album, _jsonTrack);
+            mark = out.len;
+            out.raw(_jsonTrack ? ",{\"file\":" : "{\"file\":");
+            out.str(library.trackFile(track));
+            out.raw(",\"title\":");
+            out.str(library.trackTitle(track));
+            out.raw(",\"artist\":");
+            out.str(library.trackArtist(track));
+            out.raw("}");
+            if (!out.ok) {
+                out.rollback(mark);
+                return false;
+            }
+            _jsonTrack++;
+        }
+
+        mark = out.len;
+        out.raw("]}");
+        if (!out.ok) {
+            out.rollback(mark);
+            return false;
+        }
+        _jsonAlbum++;
+        _jsonTrack = -1;
+    }
+
+    size_t mark = out.len;
+    out.raw(changed ? "],\"complete\":false}" : "],\"complete\":true}");
+    if (!out.ok) {
+        out.rollback(mark);
+        return false;
+    }
+    _jsonDone = true;
+    return true;
+}
+
+// Request path (or a multipart filename) to a card path: "/a/b" form,
+// backslashes taken as separators, "." and ".." refused rather than
+// resolved - nothing outside what the client named.
+bool UploadHttpServer::cleanPath(const char* in, char* out, size_t size) {
+    size_t len = 0;
+    const char* p = in;
+    while (*p) {
+        while (*p == '/' || *p == '\\') p++;
+        const char* start = p;
+        while (*p && *p != '/' && *p != '\\') p++;
+        size_t n = p - start;
+        if (n == 0) continue;
+        if (start[0] == '.' && (n == 1 || (n == 2 && start[1] == '.'))) return false;
+        if (len + 1 + n + 1 > size) return false;
+        out[len++] = '/';
+        memcpy(out + len, start, n);
+        len += n;
+    }
+    if (len == 0) {
+        if (size < 2) return false;
+        out[len++] = '/';
+    }
+    out[len] = '\0';
+    return true;
+}
+
+bool UploadHttpServer::makeParents(const char* path) {
+    char parent[256];
+    strncpy(parent, path, sizeof(parent) - 1);
+    parent[sizeof(parent) - 1] = '\0';
+    char* slash = strrchr(parent, '/');
+    if (!slash || slash == parent) return true;
+    *slash = '\0';
+
+    SPIBusGuard guard;
+    return sd.exists(parent) || sd.mkdir(parent, true);
+}
@@ -0,0 +1,141 @@
+// =====================================================================
+//  UploadHttpServer.h - HTTP upload and library endpoint
+//
+//  FTP needs a client program and works one file per transfer. This
+//  takes uploads from a browser or curl on the same WiFi AP:
+//
+//    GET    /                  upload page (files or a whole folder)
+//    PUT    /files/<path>      body is the file; folders are created
+//    POST   /files/<folder>    multipart/form-data, any number of files
+//                              (a folder upload keeps its subfolders)
+//    DELETE /files/<path>      a file, or an empty folder
+//    GET    /api/library       the LibraryIndex as JSON
+//
+//  Bodies go through HttpRequestParser - Content-Length or chunked,
+//  multipart taken apart as it streams - into UploadWriter, pre-
+//  allocated to the request size when there is one. Nothing is
+//  buffered beyond the writer's two buffers, whatever the upload size.
+//
+//  Like UploadFtpServer it runs in its own task on Core 1 and shares
+//  the card through SdFat and the SPI1 bus guard, so playback carries
+//  on; the playing track is off limits (UploadWriter::isProtected()).
+//  One connection at a time, each closed after its response.
+//
+//  LibraryIndex belongs to loop(), so /api/library is rendered there:
+//  service() (call it every loop() while the server runs) fills one
+//  JSON_BUFFER at a time, which this task sends as one HTTP chunk.
+// =====================================================================
+
+#ifndef UPLOAD_HTTP_SERVER_H
+#define UPLOAD_HTTP_SERVER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "HttpRequestParser.h"
+#include "UploadWriter.h"
+
+class UploadHttpServer : private HttpRequestParser::Handler {
+public:
+    struct Status {
+        bool transferring;
+        uint32_t filesReceived;
+        uint64_t bytesReceived;
+        char lastFile[64];
+        float lastMBps;         // last file, end to end
+        float lastSdMBps;       // same bytes over time spent in SD writes
+    };
+
+    static UploadHttpServer& getInstance();
+
+    // Start listening (WiFi must already be up) and create the task.
+    bool begin();
+
+    // Drop any connection and stop the task. Blocks until it has.
+    void end();
+
+    bool isRunning() const { return _task != nullptr; }
+
+    // From loop(): renders library JSON when a request is waiting.
+    void service();
+
+    Status status();
+
+    static const uint16_t PORT = 80;
+    static const uint32_t TIMEOUT_MS = 30000;
+    static const size_t JSON_BUFFER = 16384;
+
+private:
+    UploadHttpServer();
+    UploadHttpServer(const UploadHttpServer&) = delete;
+    UploadHttpServer& operator=(const UploadHttpServer&) = delete;
+
+    enum Route {
+        NotFound,
+        IndexPage,
+        Library,
+        PutFile,
+        PostFiles,
+        DeletePath
+    };
+
+    static void taskEntry(void* param);
+    void run();
+    void handleConnection();
+    void respond();
+
+    // HttpRequestParser::Handler
+    int onHeaders(const HttpRequestParser& request) override;
+    int onFileBegin(const char* name) override;
+    int onFileData(const uint8_t* data, size_t len) override;
+    int onFileEnd() override;
+
+    void sendHead(int code, const char* type, long length);
+    void sendJson(int code, const char* fmt, ...);
+    void sendError(int code, const char* message);
+    void sendLibrary();
+    int deletePath();
+
+    bool renderLibrary();       // on loop(); false = out of room this round
+
+    static bool cleanPath(const char* in, char* out, size_t size);
+    static bool makeParents(const char* path);
+
+    WiFiServer _server;
+    WiFiClient _client;
+    HttpRequestParser _parser;
+    UploadWriter _writer;
+    uint8_t* _readBuffer;
+
+    // Current request
+    Route _route;
+    char _target[256];          // card path: the file, or the folder for POST
+    char _filePath[256];        // file being written
+    const char* _error;
+    uint32_t _files;
+    uint64_t _bytes;
+    uint32_t _startUs;
+    uint32_t _sdUs;
+
+    // /api/library, between this task and loop()
+    char* _json;
+    size_t _jsonLen;
+    volatile bool _jsonWanted;
+    bool _jsonStarted;
+    bool _jsonDone;
+    int _jsonAlbum;             // position in name order
+    int _jsonTrack;             // in that album; -1 = album not opened yet
+    uint32_t _jsonGeneration;
+    uint32_t _jsonOrderVersion;
+    SemaphoreHandle_t _jsonReady;
+
+    Status _status;
+    SemaphoreHandle_t _mutex;
+
+    TaskHandle_t _task;
+    volatile bool _stopping;
+};
+
+#endif // UPLOAD_HTTP_SERVER_H
@@ -0,0 +1,253 @@
+// =====================================================================
+//  UploadWriter.cpp - Buffered, pre-allocated upload writes
+// =====================================================================
+
+#include "UploadWriter.h"
+#include "SPIBusLock.h"
+#include <esp_heap_caps.h>
+
+extern SdFs sd;
+
+char UploadWriter::_protectedPaths[2][256] = { "", "" };
+
+UploadWriter::UploadWriter()
+    : _open(false), _fill(0), _used(0), _bytes(0), _startUs(0),
+      _preAllocated(false), _task(nullptr), _work(nullptr), _idle(nullptr),
+      _pending(nullptr), _pendingLen(0), _sdUs(0), _failed(false)
+{
+    _path[0] = '\0';
+    _buffers[0] = nullptr;
+    _buffers[1] = nullptr;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+UploadWriter::~UploadWriter() {
+    if (_open) abort();
+    if (_task) vTaskDelete(_task);
+    if (_work) vSemaphoreDelete(_work);
+    if (_idle) vSemaphoreDelete(_idle);
+    for (int i = 0; i < 2; i++) {
+        if (_buffers[i]) heap_caps_free(_buffers[i]);
+    }
+}
+
+// Buffers and the writer task, on first use - they're kept after that
+bool UploadWriter::allocBuffers() {
+    if (_task) return true;
+
+    for (int i = 0; i < 2; i++) {
+        if (_buffers[i]) continue;
+        // PSRAM is fine here - SdFat's SPI driver copies through the SPI
+        // FIFO, and the bus, not the memory, is the limit at 25 MHz
+        _buffers[i] = (uint8_t*)heap_caps_malloc(BUFFER_SIZE, MALLOC_CAP_SPIRAM);
+        if (!_buffers[i]) _buffers[i] = (uint8_t*)heap_caps_malloc(BUFFER_SIZE, MALLOC_CAP_8BIT);
+        if (!_buffers[i]) {
+            Serial.println("Upload: ✗ No memory for write buffers");
+            return false;
+        }
+    }
+
+    if (!_work) _work = xSemaphoreCreateBinary();
+    if (!_idle) {
+        _idle = xSemaphoreCreateBinary();
+        if (_idle) xSemaphoreGive(_idle);
+    }
+    if (!_work || !_idle) return false;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        taskEntry,
+        "UploadWrite",
+        4096,
+        this,
+        0,
+        &_task,
+        0
+    );
+    if (ok != pdPASS) {
+        _task = nullptr;
+        Serial.println("Upload: ✗ Writer task create failed");
+        return false;
+    }
+    return true;
+}
+
+bool UploadWriter::open(const char* path, uint64_t expectedSize) {
+    if (_open) abort();
+    if (!allocBuffers()) return false;
+
+    strncpy(_path, path, sizeof(_path) - 1);
+    _path[sizeof(_path) - 1] = '\0';
+    _fill = 0;
+    _used = 0;
+    _bytes = 0;
+    _sdUs = 0;
+    _failed = false;
+    _startUs = micros();
+
+    SPIBusGuard guard;
+    if (!_file.open(_path, O_RDWR | O_CREAT | O_TRUNC)) {
+        Serial.printf("Upload: ✗ Can't create %s\n", _path);
+        return false;
+    }
+
+    // One contiguous run of clusters up front. Rounded up to whole
+    // buffers so the last write stays inside it.
+    uint64_t extent = expectedSize ? expectedSize : DEFAULT_EXTENT;
+    extent = (extent + BUFFER_SIZE - 1) / BUFFER_SIZE * BUFFER_SIZE;
+    _preAllocated = _file.preAllocate(extent);
+    if (!_preAllocated) {
+        Serial.printf("Upload: No contiguous %lu KB free, writing %s unallocated\n",
+                      (unsigned long)(extent / 1024), _path);
+    }
+    _open = true;
+    return true;
+}
+
+uint8_t* UploadWriter::space(size_t* room) {
+    *room = 0;
+    if (!_open || _failed) return nullptr;
+    if (_used == BUFFER_SIZE && !handOff()) return nullptr;
+    *room = BUFFER_SIZE - _used;
+    return _buffers[_fill] + _used;
+}
+
+bool UploadWriter::commit(size_t len) {
+    if (_used + len > BUFFER_SIZE) return false;
+    _used += len;
+    _bytes += len;
+    if (_used == BUFFER_SIZE) return handOff();
+    return !_failed;
+}
+
+bool UploadWriter::write(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t room;
+        uint8_t* dst = space(&room);
+        if (!dst) return false;
+        size_t n = len < room ? len : room;
+        memcpy(dst, data, n);
+        if (!commit(n)) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Waits for the writer to finish the other buffer, gives it this one,
+// and switches over. The buffer is always full - whole sectors - except
+// the last one, from close().
+bool UploadWriter::handOff() {
+    xSemaphoreTake(_idle, portMAX_DELAY);
+    if (_failed) {
+        xSemaphoreGive(_idle);
+        return false;
+    }
+    _pending = _buffers[_fill];
+    _pendingLen = _used;
+    xSemaphoreGive(_work);
+
+    _fill ^= 1;
+    _used = 0;
+    return true;
+}
+
+void UploadWriter::waitIdle() {
+    xSemaphoreTake(_idle, portMAX_DELAY);
+    xSemaphoreGive(_idle);
+}
+
+void UploadWriter::taskEntry(void* param) {
+    static_cast<UploadWriter*>(param)->writerLoop();
+}
+
+void UploadWriter::writerLoop() {
+    while (true) {
+        xSemaphoreTake(_work, portMAX_DELAY);
+        writeOut(_pending, _pendingLen);
+        xSemaphoreGive(_idle);
+    }
+}
+
+// One WRITE_SLICE per bus guard
+void UploadWriter::writeOut(const uint8_t* data, size_t len) {
+    size_t done = 0;
+    while (done < len && !_failed) {
+        size_t n = len - done < WRITE_SLICE ? len - done : WRITE_SLICE;
+        uint32_t t0 = micros();
+        {
+            SPIBusGuard guard;
+            if (_file.write(data + done, n) != n) _failed = true;
+        }
+        _sdUs += micros() - t0;
+        done += n;
+        taskYIELD();
+    }
+    if (_failed) Serial.printf("Upload: ✗ Write failed (%s)\n", _path);
+}
+
+bool UploadWriter::close() {
+    if (!_open) return false;
+    if (_used && !_failed) handOff();
+    waitIdle();
+
+    {
+        SPIBusGuard guard;
+        // truncate() at the current position drops the unused tail of
+        // the pre-allocation
+        if (!_failed && _preAllocated && !_file.truncate()) _failed = true;
+        if (!_file.close()) _failed = true;
+        // Same as abort() - a file with a hole in it, or a pre-allocated
+        // tail of whatever was on the card, mustn't be indexed as a track
+        if (_failed) {
+            sd.remove(_path);
+            Serial.printf("Upload: ✗ Removed %s\n", _path);
+        }
+    }
+    _open = false;
+
+    _stats.bytes = _bytes;
+    _stats.totalUs = micros() - _startUs;
+    _stats.sdUs = _sdUs;
+    _stats.preAllocated = _preAllocated;
+    _used = 0;
+    return !_failed;
+}
+
+void UploadWriter::abort() {
+    if (!_open) return;
+    waitIdle();
+    SPIBusGuard guard;
+    _file.close();
+    sd.remove(_path);
+    _open = false;
+    _used = 0;
+    Serial.printf("Upload: Aborted, removed %s\n", _path);
+}
+
+SemaphoreHandle_t UploadWriter::protectLock() {
+    static SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+    return lock;
+}
+
+void UploadWriter::setProtectedPaths(const char* current, const char* upcoming) {
+    const char* paths[2] = { current, upcoming };
+    xSemaphoreTake(protectLock(), portMAX_DELAY);
+    for (int i = 0; i < 2; i++) {
+        strncpy(_protectedPaths[i], paths[i] ? paths[i] : "", sizeof(_protectedPaths[i]) - 1);
+        _protectedPaths[i][sizeof(_protectedPaths[i]) - 1] = '\0';
+    }
+    xSemaphoreGive(protectLock());
+}
+
+bool UploadWriter::isProtected(const char* path) {
+    size_t len = strlen(path);
+    bool hit = false;
+    xSemaphoreTake(protectLock(), portMAX_DELAY);
+    for (int i = 0; i < 2 && !hit; i++) {
+        // The file itself, or any folder above it. FAT names are case-blind.
+        const char* p = _protectedPaths[i];
+        hit = p[0] && strncasecmp(p, path, len) == 0 && (p[len] == '\0' || p[len] == '/');
+    }
+    xSemaphoreGive(protectLock());
+    return hit;
+}
@@ -0,0 +1,124 @@
+// =====================================================================
+//  UploadWriter.h - Fast sequential file writes for uploads
+//
+//  Network uploads arrive in whatever pieces lwIP hands over - often a
+//  single 1460-byte segment - and writing those straight to an FsFile
+//  costs a partial-sector read-modify-write plus a FAT lookup each
+//  time. This collects them in BUFFER_SIZE buffers and writes each out
+//  in whole, sector-aligned WRITE_SLICE pieces, which SdFat sends as
+//  multi-sector writes.
+//
+//  Double-buffered: a full buffer goes to this writer's own task on
+//  Core 0 while the server task on Core 1 carries on receiving into the
+//  other, so the socket keeps draining (and the TCP window open) for
+//  the length of the SD write. The writer task runs at idle priority -
+//  the VS1053 feeder, also on Core 0, preempts it the moment it wakes.
+//
+//  The file is pre-allocated as one contiguous run of clusters first
+//  (FsFile::preAllocate) - the expected size when the uploader says,
+//  DEFAULT_EXTENT otherwise - so SdFat never has to look for a free
+//  cluster mid-upload. close() trims it back to what was written. If
+//  the card has no free run that long the file just grows normally.
+//
+//  Playback keeps going during uploads, so the SPI1 bus guard is taken
+//  per WRITE_SLICE rather than per buffer: the feeder only banks ~46ms
+//  of audio, and one slice is a few ms on the bus.
+//
+//  The player's tracks are off limits to every upload path - see
+//  setProtectedPaths(). Not thread-safe otherwise: one writer per server,
+//  used by that server's task.
+// =====================================================================
+
+#ifndef UPLOAD_WRITER_H
+#define UPLOAD_WRITER_H
+
+#include <Arduino.h>
+#include <SdFat.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+class UploadWriter {
+public:
+    struct Stats {
+        uint64_t bytes;
+        uint32_t totalUs;       // open() to close()
+        uint32_t sdUs;          // of which spent in SD writes
+        bool preAllocated;
+    };
+
+    UploadWriter();
+    ~UploadWriter();
+
+    // Create (or replace) path. expectedSize 0 = not known.
+    bool open(const char* path, uint64_t expectedSize = 0);
+
+    // Zero-copy: room in the buffer to receive into, then commit() what
+    // was actually put there.
+    uint8_t* space(size_t* room);
+    bool commit(size_t len);
+
+    bool write(const uint8_t* data, size_t len);
+
+    // Write out the rest, trim the pre-allocation and close. false = a
+    // write failed somewhere (card full, removed) and, as with abort(),
+    // the file has been deleted.
+    bool close();
+
+    // Close and delete - an interrupted upload shouldn't leave half a
+    // file in the library.
+    void abort();
+
+    bool isOpen() const { return _open; }
+    uint64_t bytesWritten() const { return _bytes; }
+    const Stats& lastStats() const { return _stats; }
+
+    static float mbPerSec(uint64_t bytes, uint32_t us) {
+        return us ? (float)bytes / (float)us : 0.0f;    // bytes/us = MB/s
+    }
+
+    // The track open in the player (playing or paused) and the one
+    // queued behind it for gapless, which no upload may overwrite,
+    // delete or rename (nor any folder they're in). nullptr/"" = none.
+    // Set from the UI, checked by the servers.
+    static void setProtectedPaths(const char* current, const char* upcoming);
+    static bool isProtected(const char* path);
+
+    static const size_t BUFFER_SIZE = 32768;
+    static const size_t WRITE_SLICE = 8192;
+    static const uint64_t DEFAULT_EXTENT = 32ULL * 1024 * 1024;
+
+private:
+    bool allocBuffers();
+    bool handOff();             // current buffer to the writer task, switch to the other
+    void waitIdle();
+    void writeOut(const uint8_t* data, size_t len);
+
+    static void taskEntry(void* param);
+    void writerLoop();
+
+    static SemaphoreHandle_t protectLock();
+    static char _protectedPaths[2][256];
+
+    FsFile _file;
+    char _path[256];
+    bool _open;
+    uint8_t* _buffers[2];
+    int _fill;                  // buffer being received into
+    size_t _used;
+    uint64_t _bytes;
+    uint32_t _startUs;
+    bool _preAllocated;
+    Stats _stats;
+
+    // Shared with the writer task
+    TaskHandle_t _task;
+    SemaphoreHandle_t _work;    // given: a buffer is waiting
+    SemaphoreHandle_t _idle;    // held from hand-off until it's written
+    const uint8_t* _pending;
+    size_t _pendingLen;
+    uint32_t _sdUs;
+    volatile bool _failed;
+};
+
+#endif // UPLOAD_WRITER_H
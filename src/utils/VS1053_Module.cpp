@@ -4,6 +4,8 @@
 
 #include "VS1053_Module.h"
 #include "SPIBusLock.h"
+#include "VS1053_Plugins.h"
+#include "PlaybackPosition.h"
 #include <SPI.h>
 
 // VS1053 Register definitions
@@ -34,26 +36,92 @@ VS1053_Module::VS1053_Module(uint8_t cs, uint8_t dcs, uint8_t dreq, uint8_t rst)
 {
 }
 
+// SCI_VOL attenuation in 0.5 dB units. The slider covers 0..-40 dB
+// (unchanged from the old map()); soft mute goes to 0xFE, total silence.
+// Ramping is done in attenuation units, i.e. in dB - which is the
+// logarithmic curve the ear hears as an even fade.
+#define VOL_ATTEN_FLOOR        0x50    // slider at 0
+#define VOL_ATTEN_MUTE         0xFE
+#define VOL_RAMP_STEP          3       // 1.5 dB per step
+#define VOL_RAMP_INTERVAL_US   1000    // full slider range in ~27 ms
+
+static uint8_t volumeToAtten(uint8_t volume) {
+    if (volume > 100) volume = 100;
+    return (uint8_t)map(volume, 0, 100, VOL_ATTEN_FLOOR, 0x00);
+}
+
 void VS1053_Module::setVolume(uint8_t volume) {
+    _targetAtten.store(volumeToAtten(volume));
+}
+
+void VS1053_Module::setSoftMute(bool muted) {
+    _softMuted.store(muted);
+}
+
+void VS1053_Module::setVolumeImmediate(uint8_t volume) {
     SPIBusGuard guard;
 
-    uint8_t vs1053_vol = map(volume, 0, 100, 0x50, 0x00);
-    uint16_t vol_stereo = (vs1053_vol << 8) | vs1053_vol;
+    uint8_t atten = volumeToAtten(volume);
+    _targetAtten.store(atten);
+    _currentAtten = _softMuted.load() ? VOL_ATTEN_MUTE : atten;
+    writeRegister(SCI_VOL, ((uint16_t)_currentAtten << 8) | _currentAtten);
 
-    writeRegister(SCI_VOL, vol_stereo);
-    
     Serial.printf("VS1053: Volume set to %d%%\n", volume);
-    delay(10);
-    SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-    digitalWrite(_cs, LOW);
-    SPI.transfer(0x03);
-    SPI.transfer(SCI_VOL);
-    uint16_t readBack = SPI.transfer(0x00) << 8;
-    readBack |= SPI.transfer(0x00);
-    digitalWrite(_cs, HIGH);
-    SPI.endTransaction();
-    
-    Serial.printf("VS1053: Volume readback = 0x%04X\n", readBack);
+}
+
+bool VS1053_Module::isVolumeSettled() const {
+    uint8_t target = _softMuted.load() ? VOL_ATTEN_MUTE : _targetAtten.load();
+    return _currentAtten == target;
+}
+
+bool VS1053_Module::stepVolume() {
+    uint8_t target = _softMuted.load() ? VOL_ATTEN_MUTE : _targetAtten.load();
+    if (_currentAtten == target) return false;
+
+    unsigned long now = micros();
+    if (now - _lastRampUs < VOL_RAMP_INTERVAL_US) return false;
+    _lastRampUs = now;
+
+    // Below the slider floor (-40 dB) nothing is audible, so the stretch
+    // between there and mute is a single jump rather than ~60 more steps.
+    uint8_t next;
+    if (target > _currentAtten) {           // getting quieter
+        uint8_t limit = target < VOL_ATTEN_FLOOR ? target : VOL_ATTEN_FLOOR;
+        if (_currentAtten >= VOL_ATTEN_FLOOR) {
+            next = target;
+        } else {
+            next = (limit - _currentAtten <= VOL_RAMP_STEP) ? limit : (uint8_t)(_currentAtten + VOL_RAMP_STEP);
+        }
+    } else {                                // getting louder
+        if (_currentAtten > VOL_ATTEN_FLOOR) {
+            next = target > VOL_ATTEN_FLOOR ? target : VOL_ATTEN_FLOOR;
+        } else {
+            next = (_currentAtten - target <= VOL_RAMP_STEP) ? target : (uint8_t)(_currentAtten - VOL_RAMP_STEP);
+        }
+    }
+
+    writeRegisterNoWait(SCI_VOL, ((uint16_t)next << 8) | next);
+    _currentAtten = next;
+    return true;
+}
+
+void VS1053_Module::serviceVolume() {
+    if (isVolumeSettled()) return;
+
+    SPIBusTryGuard guard;
+    if (!guard) return;             // SD/NFC has the bus - next tick
+    if (!digitalRead(_dreq)) return;
+    stepVolume();
+}
+
+bool VS1053_Module::fadeToTarget(unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (!isVolumeSettled()) {
+        if (millis() - start > timeoutMs) return false;
+        serviceVolume();
+        vTaskDelay(1);
+    }
+    return true;
 }
 
 void VS1053_Module::setSampleRate(uint16_t rate) {
@@ -256,6 +324,13 @@ void VS1053_Module::softReset() {
     delay(100);
 
     waitDREQ(200);
+
+    // Put back whatever level the ramp had reached, so a reset can't
+    // step the volume behind the ramp's back.
+    writeRegister(SCI_VOL, ((uint16_t)_currentAtten << 8) | _currentAtten);
+
+    _residentCount = 0;
+    applyPlugins();
 }
 
 void VS1053_Module::resetForNextTrack() {
@@ -269,6 +344,169 @@ void VS1053_Module::resetForNextTrack() {
 
     writeRegister(0x02, 0x0000);        // bass/treble back to neutral
     writeRegister(SCI_CLOCKF, 0x8800);  // restore 3.5x clock multiplier
+    writeRegister(SCI_VOL, ((uint16_t)_currentAtten << 8) | _currentAtten);
+
+    _residentCount = 0;
+    applyPlugins();
+}
+
+void VS1053_Module::applyPlugins() {
+    VS1053_Plugins& plugins = VS1053_Plugins::getInstance();
+    if (plugins.count() == 0) return;
+
+    SPIBusGuard guard;  // one bus hold for the whole upload
+    unsigned long t0 = millis();
+    int written = 0;
+
+    for (int i = 0; i < plugins.count(); i++) {
+        uint32_t crc = plugins.crc(i);
+        bool resident = false;
+        for (int r = 0; r < _residentCount; r++) {
+            if (_residentCrc[r] == crc) {
+                resident = true;
+                break;
+            }
+        }
+        if (resident) continue;
+
+        size_t count = 0;
+        const uint16_t* words = plugins.words(i, &count);
+        if (!writePluginImage(words, count)) {
+            Serial.printf("VS1053: ✗ Plugin %s failed to load\n", plugins.name(i));
+            continue;
+        }
+        if (_residentCount < MAX_RESIDENT) _residentCrc[_residentCount++] = crc;
+        written++;
+    }
+
+    if (written) {
+        Serial.printf("VS1053: %d plugin(s) loaded in %lu ms\n", written, millis() - t0);
+    }
+}
+
+bool VS1053_Module::writePluginImage(const uint16_t* words, size_t count) {
+    if (!words || count < 2) return false;
+
+    // One SPI transaction for the whole image instead of writeRegister()'s
+    // per-word beginTransaction + 250 kHz clock + delay(1)-granularity
+    // DREQ wait - a FLAC patch is thousands of words. 2 MHz (the data
+    // path's rate) stays under the CLKI/4 SCI write limit even before
+    // SCI_CLOCKF is raised. DREQ only dips for a few microseconds after
+    // each SCI write, so it's spun on rather than slept on.
+    SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
+
+    bool ok = true;
+    size_t i = 0;
+    while (ok && i + 1 < count) {
+        uint16_t addr = words[i++];
+        uint16_t n = words[i++];
+        bool repeat = (n & 0x8000) != 0;
+        n &= 0x7FFF;
+
+        if (repeat ? (i >= count) : (i + n > count)) {
+            Serial.println("VS1053: Plugin image truncated");
+            ok = false;
+            break;
+        }
+
+        uint16_t value = words[i];
+        for (uint16_t k = 0; k < n; k++) {
+            if (!repeat) value = words[i + k];
+
+            unsigned long spinStart = micros();
+            while (!digitalRead(_dreq)) {
+                if (micros() - spinStart > 10000) {
+                    Serial.println("VS1053: DREQ stuck during plugin load");
+                    ok = false;
+                    break;
+                }
+            }
+            if (!ok) break;
+
+            digitalWrite(_cs, LOW);
+            SPI.transfer(0x02);
+            SPI.transfer((uint8_t)addr);
+            SPI.transfer(value >> 8);
+            SPI.transfer(value & 0xFF);
+            digitalWrite(_cs, HIGH);
+        }
+        i += repeat ? 1 : n;
+    }
+
+    SPI.endTransaction();
+    return ok;
+}
+
+// Decoder's running average stream rate, bytes/s (parametric_x.byteRate).
+#define VS1053_BYTERATE_ADDR 0x1E05
+#define VS1053_ENDFILL_ADDR  0x1E06
+
+// Spectrum analyzer plugin's parameter block in X memory: band count at
+// +2, one word per band from +4 (bits 5:0 current level, 11:6 peak).
+#define SPECTRUM_BASE   0x1800
+#define SPECTRUM_BANDS  (SPECTRUM_BASE + 2)
+#define SPECTRUM_VALUES (SPECTRUM_BASE + 4)
+#define SPECTRUM_MAX_BANDS 23
+
+int VS1053_Module::readSpectrum(uint8_t* levels, int maxBands) {
+    SPIBusTryGuard guard;
+    if (!guard) return -1;
+
+    uint16_t bands = 0;
+    readWram(SPECTRUM_BANDS, &bands, 1);
+    if (bands == 0 || bands > SPECTRUM_MAX_BANDS) return 0;   // analyzer not loaded / not started
+
+    uint16_t raw[SPECTRUM_MAX_BANDS];
+    int n = (bands < maxBands) ? bands : maxBands;
+    readWram(SPECTRUM_VALUES, raw, n);
+
+    for (int i = 0; i < n; i++) {
+        levels[i] = raw[i] & 0x3F;
+    }
+    return n;
+}
+
+void VS1053_Module::readWram(uint16_t addr, uint16_t* out, int count) {
+    // No waitDREQ() here: during playback DREQ is low whenever the FIFO
+    // is full, which says nothing about SCI. The only SCI-busy window is
+    // the few CLKI cycles after the address write, covered by the short
+    // delay. 1 MHz stays under the CLKI/7 read limit even at 1x clock.
+    SPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
+
+    digitalWrite(_cs, LOW);
+    SPI.transfer(0x02);
+    SPI.transfer(SCI_WRAMADDR);
+    SPI.transfer(addr >> 8);
+    SPI.transfer(addr & 0xFF);
+    digitalWrite(_cs, HIGH);
+    delayMicroseconds(20);
+
+    for (int i = 0; i < count; i++) {
+        digitalWrite(_cs, LOW);
+        SPI.transfer(0x03);
+        SPI.transfer(SCI_WRAM);
+        uint16_t value = SPI.transfer(0x00) << 8;
+        value |= SPI.transfer(0x00);
+        digitalWrite(_cs, HIGH);
+        out[i] = value;
+    }
+
+    SPI.endTransaction();
+}
+
+bool VS1053_Module::canDecode(const char* fileName) const {
+    // What the VS1053b decodes from ROM; FLAC needs VLSI's patch package.
+    static const char* const ROM_FORMATS[] = {
+        ".mp3", ".wma", ".ogg", ".aac", ".m4a", ".wav", ".mid"
+    };
+
+    const char* dot = fileName ? strrchr(fileName, '.') : nullptr;
+    if (!dot) return false;
+
+    for (size_t i = 0; i < sizeof(ROM_FORMATS) / sizeof(ROM_FORMATS[0]); i++) {
+        if (strcasecmp(dot, ROM_FORMATS[i]) == 0) return true;
+    }
+    return strcasecmp(dot, ".flac") == 0 && VS1053_Plugins::getInstance().hasFlac();
 }
 
 bool VS1053_Module::isReadyForData() {
@@ -276,6 +514,44 @@ bool VS1053_Module::isReadyForData() {
     return digitalRead(_dreq) == HIGH;
 }
 
+void IRAM_ATTR VS1053_Module::dreqISR(void* arg) {
+    VS1053_Module* self = (VS1053_Module*)arg;
+    TaskHandle_t task = self->_dreqTask;
+    if (!task) return;
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void VS1053_Module::enableDREQInterrupt(TaskHandle_t task) {
+    _dreqTask = task;
+    attachInterruptArg(digitalPinToInterrupt(_dreq), dreqISR, this, RISING);
+    Serial.println("VS1053: DREQ interrupt routed to feeder task");
+}
+
+void VS1053_Module::waitForDREQ(unsigned long timeoutMs) {
+    unsigned long t0 = micros();
+
+    if (_dreqTask && _dreqTask == xTaskGetCurrentTaskHandle()) {
+        // An edge between the caller's digitalRead() and this point
+        // leaves a pending notification, so it can't be missed.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    } else {
+        vTaskDelay(1);
+    }
+
+    _sleptUs += micros() - t0;
+    _wakeups++;
+}
+
+void VS1053_Module::takeSleepStats(uint32_t* sleptUs, uint32_t* wakeups) {
+    *sleptUs = _sleptUs;
+    *wakeups = _wakeups;
+    _sleptUs = 0;
+    _wakeups = 0;
+}
+
 void VS1053_Module::sendMP3Data(uint8_t* data, size_t len) {
     // Locked for the WHOLE call (not per 32-byte packet) so a single
     // audio chunk send is atomic relative to SD access on the other core.
@@ -286,7 +562,7 @@ void VS1053_Module::sendMP3Data(uint8_t* data, size_t len) {
     while (sent < len) {
         unsigned long startWait = millis();
         while (!digitalRead(_dreq)) {
-            vTaskDelay(1);
+            waitForDREQ(5);
             
             if (millis() - startWait > 100) {
                 Serial.println("VS1053: DREQ timeout");
@@ -294,6 +570,11 @@ void VS1053_Module::sendMP3Data(uint8_t* data, size_t len) {
             }
         }
         
+        // DREQ is high here, so this is the one point between packets
+        // where an SCI write is safe without waiting. A pending volume
+        // ramp step costs one 4-byte register write.
+        stepVolume();
+
         size_t chunkSize = min((size_t)32, len - sent);
         
         SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
@@ -308,4 +589,82 @@ void VS1053_Module::sendMP3Data(uint8_t* data, size_t len) {
     }
 
     _sendCount++;
+
+    // Piggyback the position sample on this transaction's bus hold.
+    if (millis() - _lastPositionSampleMs >= PlaybackPosition::POSITION_SAMPLE_MS) {
+        _lastPositionSampleMs = millis();
+        _sampledDecodeSec = readRegisterNoWait(SCI_DECODE_TIME);
+        readWram(VS1053_BYTERATE_ADDR, &_sampledByteRate, 1);
+        _positionSampleReady = true;
+    }
+}
+
+void VS1053_Module::sendEndFill(size_t count) {
+    SPIBusGuard guard;
+
+    uint16_t endFill = 0;
+    readWram(VS1053_ENDFILL_ADDR, &endFill, 1);
+    uint8_t fill = endFill & 0xFF;
+
+    size_t sent = 0;
+    while (sent < count) {
+        if (!waitDREQ(100)) return;
+
+        size_t chunkSize = min((size_t)32, count - sent);
+
+        SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
+        digitalWrite(_dcs, LOW);
+        for (size_t i = 0; i < chunkSize; i++) {
+            SPI.transfer(fill);
+        }
+        digitalWrite(_dcs, HIGH);
+        SPI.endTransaction();
+
+        sent += chunkSize;
+    }
+}
+
+bool VS1053_Module::takePositionSample(uint16_t* decodeSec, uint16_t* byteRate) {
+    if (!_positionSampleReady) return false;
+    _positionSampleReady = false;
+    *decodeSec = _sampledDecodeSec;
+    *byteRate = _sampledByteRate;
+    return true;
+}
+
+void VS1053_Module::resetDecodeTime() {
+    SPIBusGuard guard;
+
+    // Written twice, as the datasheet recommends - a single write can be
+    // overwritten by the decoder's own update in flight.
+    writeRegister(SCI_DECODE_TIME, 0);
+    writeRegister(SCI_DECODE_TIME, 0);
+    _positionSampleReady = false;
+    _lastPositionSampleMs = 0;
+}
+
+uint16_t VS1053_Module::readRegisterNoWait(uint8_t reg) {
+    // Same as readRegister() minus the DREQ wait (DREQ is usually low
+    // right after a data burst - FIFO full, not SCI busy) and at the
+    // 1 MHz rate readWram() uses.
+    SPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(_cs, LOW);
+    SPI.transfer(0x03);
+    SPI.transfer(reg);
+    uint16_t value = SPI.transfer(0x00) << 8;
+    value |= SPI.transfer(0x00);
+    digitalWrite(_cs, HIGH);
+    SPI.endTransaction();
+    return value;
+}
+
+void VS1053_Module::writeRegisterNoWait(uint8_t reg, uint16_t value) {
+    SPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(_cs, LOW);
+    SPI.transfer(0x02);
+    SPI.transfer(reg);
+    SPI.transfer(value >> 8);
+    SPI.transfer(value & 0xFF);
+    digitalWrite(_cs, HIGH);
+    SPI.endTransaction();
 }
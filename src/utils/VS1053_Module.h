@@ -6,6 +6,9 @@
 #define VS1053_MODULE_H
 
 #include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 class VS1053_Module {
 public:
@@ -24,11 +27,75 @@ public:
     // MP3 playback
     void sendMP3Data(uint8_t* data, size_t len);
     bool isReadyForData();
+
+    // Route DREQ's rising edge to a task notification for `task` (the
+    // feeder). From then on that task's DREQ waits - in sendMP3Data()
+    // and waitForDREQ() - sleep until the chip actually asks for data
+    // instead of polling it every tick.
+    void enableDREQInterrupt(TaskHandle_t task);
+
+    // Feeder task only: sleep until DREQ rises, a task notification
+    // arrives for another reason, or timeoutMs passes. Falls back to a
+    // 1 ms delay if the interrupt isn't routed to the calling task.
+    void waitForDREQ(unsigned long timeoutMs);
+
+    // Time spent asleep in waitForDREQ() and the number of wakeups since
+    // the last call - MP3Player folds these into its duty-cycle figure.
+    void takeSleepStats(uint32_t* sleptUs, uint32_t* wakeups);
+
+    // Send `count` copies of the decoder's endFillByte (read from WRAM),
+    // so it finishes the frame it's on cleanly instead of underrunning
+    // on a half-received one. Used when pausing.
+    void sendEndFill(size_t count);
     void setSampleRate(uint16_t rate);
     
-    // Volume control (0-100, where 100 is loudest)
+    // Volume control (0-100, where 100 is loudest). Asynchronous: this
+    // only records the target and returns - callable from any core, as
+    // often as a slider likes (repeated calls just overwrite the target).
+    // The feeder task ramps SCI_VOL toward it in 1.5 dB steps, between
+    // data packets in sendMP3Data() or via serviceVolume() when idle.
     void setVolume(uint8_t volume);
 
+    // Blocking write, no ramp - for setup() before the feeder task runs.
+    void setVolumeImmediate(uint8_t volume);
+
+    // Ramp to silence (true) or back to the set volume (false). Same
+    // asynchronous contract as setVolume().
+    void setSoftMute(bool muted);
+
+    // Feeder task only. serviceVolume() takes one ramp step if one is
+    // due (never waits for SPI1 - skips if it's busy); fadeToTarget()
+    // steps until the ramp completes or timeoutMs runs out.
+    void serviceVolume();
+    bool fadeToTarget(unsigned long timeoutMs);
+    bool isVolumeSettled() const;
+
+    // Write every image cached in VS1053_Plugins into the chip, skipping
+    // ones already resident since the last reset. softReset() and
+    // resetForNextTrack() call this themselves (a reset wipes plugin
+    // RAM); call it directly once after VS1053_Plugins::loadFromSD().
+    void applyPlugins();
+
+    // Whether the decoder - with the plugins currently loaded - can play
+    // this file, by extension. Track lists use this instead of
+    // hard-coding ".mp3"/".wma".
+    bool canDecode(const char* fileName) const;
+
+    // Band levels from VLSI's spectrum analyzer plugin (0..31 each, ~3 dB
+    // per step). Returns the band count, 0 if the analyzer isn't running,
+    // or -1 if SPI1 was busy - this never waits for the bus, the caller
+    // just tries again next frame.
+    int readSpectrum(uint8_t* levels, int maxBands);
+
+    // Playback position, sampled by sendMP3Data() itself every
+    // PlaybackPosition::POSITION_SAMPLE_MS while it already holds SPI1 -
+    // no extra bus round-trips. Returns true (once) per fresh sample.
+    // Call only from the feeder task that calls sendMP3Data().
+    bool takePositionSample(uint16_t* decodeSec, uint16_t* byteRate);
+
+    // Zero SCI_DECODE_TIME at the start of a track.
+    void resetDecodeTime();
+
 private:
     uint8_t _cs, _dcs, _dreq, _rst;
     
@@ -36,6 +103,36 @@ private:
     uint16_t readRegister(uint8_t reg);
     void writeData(uint8_t data);
     bool waitDREQ(unsigned long timeoutMs);  // shared, timeout-protected DREQ wait
+    bool writePluginImage(const uint16_t* words, size_t count);
+    void readWram(uint16_t addr, uint16_t* out, int count);  // caller holds the bus
+    uint16_t readRegisterNoWait(uint8_t reg);                 // caller holds the bus
+    void writeRegisterNoWait(uint8_t reg, uint16_t value);    // caller holds the bus, DREQ high
+    bool stepVolume();                                        // caller holds the bus, DREQ high
+    static void dreqISR(void* arg);                           // IRAM, see .cpp
+
+    volatile TaskHandle_t _dreqTask = nullptr;
+    uint32_t _sleptUs = 0;      // feeder task only
+    uint32_t _wakeups = 0;
+
+    // Volume, as SCI_VOL attenuation (0.5 dB units, same value both
+    // channels). Targets are written by any core; _currentAtten is what
+    // the chip actually has and is only touched by the feeder task.
+    // Both start at the chip's reset value (0 = full volume).
+    std::atomic<uint8_t> _targetAtten{0};
+    std::atomic<bool> _softMuted{false};
+    uint8_t _currentAtten = 0;
+    unsigned long _lastRampUs = 0;
+
+    // Position sample taken inside sendMP3Data() - feeder task only.
+    unsigned long _lastPositionSampleMs = 0;
+    uint16_t _sampledDecodeSec = 0;
+    uint16_t _sampledByteRate = 0;
+    bool _positionSampleReady = false;
+
+    // CRCs of the plugin images written since the last reset.
+    static const int MAX_RESIDENT = 8;
+    uint32_t _residentCrc[MAX_RESIDENT];
+    int _residentCount = 0;
 
     // --- instrumentation only, no behavioral effect ---
     unsigned long _sendCount = 0;
@@ -0,0 +1,266 @@
+// =====================================================================
+//  VS1053_Plugins.cpp - VLSI patch/plugin image cache implementation
+// =====================================================================
+
+#include "VS1053_Plugins.h"
+#include "SPIBusLock.h"
+#include <SdFat.h>
+#include <esp_heap_caps.h>
+#include <esp_rom_crc.h>
+
+extern SdFs sd;
+
+static bool hasSuffix(const char* name, const char* suffix) {
+    size_t n = strlen(name), s = strlen(suffix);
+    return n >= s && strcasecmp(name + n - s, suffix) == 0;
+}
+
+VS1053_Plugins& VS1053_Plugins::getInstance() {
+    static VS1053_Plugins instance;
+    return instance;
+}
+
+VS1053_Plugins::VS1053_Plugins()
+    : pluginCount(0)
+{
+    memset(plugins, 0, sizeof(plugins));
+}
+
+const uint16_t* VS1053_Plugins::words(int index, size_t* wordCount) const {
+    if (index < 0 || index >= pluginCount) {
+        *wordCount = 0;
+        return nullptr;
+    }
+    *wordCount = plugins[index].wordCount;
+    return plugins[index].words;
+}
+
+uint32_t VS1053_Plugins::crc(int index) const {
+    return (index >= 0 && index < pluginCount) ? plugins[index].crc : 0;
+}
+
+const char* VS1053_Plugins::name(int index) const {
+    return (index >= 0 && index < pluginCount) ? plugins[index].name : "";
+}
+
+bool VS1053_Plugins::has(const char* nameFragment) const {
+    // nameFragment is expected in lower case.
+    for (int i = 0; i < pluginCount; i++) {
+        char lower[sizeof(plugins[0].name)];
+        size_t j = 0;
+        for (; plugins[i].name[j] && j < sizeof(lower) - 1; j++) {
+            lower[j] = (char)tolower((unsigned char)plugins[i].name[j]);
+        }
+        lower[j] = '\0';
+        if (strstr(lower, nameFragment)) return true;
+    }
+    return false;
+}
+
+int VS1053_Plugins::loadFromSD(const char* dirPath) {
+    // Collect candidate names first, then sort - openNext() order is
+    // directory order, and patch load order matters.
+    char names[MAX_PLUGINS][sizeof(plugins[0].name)];
+    int found = 0;
+
+    {
+        SPIBusGuard guard;
+        FsFile dir;
+        if (!dir.open(dirPath, O_RDONLY) || !dir.isDirectory()) {
+            Serial.printf("VS1053_Plugins: No %s folder, running ROM firmware only\n", dirPath);
+            return pluginCount;
+        }
+
+        FsFile file;
+        while (file.openNext(&dir, O_RDONLY)) {
+            char fileName[sizeof(names[0])];
+            file.getName(fileName, sizeof(fileName));
+            bool isDir = file.isDirectory();
+            file.close();
+
+            if (isDir || fileName[0] == '.') continue;
+            if (!hasSuffix(fileName, ".plg") && !hasSuffix(fileName, ".bin")) continue;
+            if (found >= MAX_PLUGINS) {
+                Serial.printf("VS1053_Plugins: More than %d plugins, ignoring %s\n", MAX_PLUGINS, fileName);
+                continue;
+            }
+            strncpy(names[found], fileName, sizeof(names[0]) - 1);
+            names[found][sizeof(names[0]) - 1] = '\0';
+            found++;
+        }
+        dir.close();
+    }
+
+    for (int i = 1; i < found; i++) {
+        for (int j = i; j > 0 && strcasecmp(names[j - 1], names[j]) > 0; j--) {
+            char tmp[sizeof(names[0])];
+            memcpy(tmp, names[j], sizeof(tmp));
+            memcpy(names[j], names[j - 1], sizeof(tmp));
+            memcpy(names[j - 1], tmp, sizeof(tmp));
+        }
+    }
+
+    Plugin next[MAX_PLUGINS];
+    int nextCount = 0;
+
+    for (int i = 0; i < found; i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s", dirPath, names[i]);
+
+        uint16_t* words = nullptr;
+        size_t wordCount = 0;
+        uint32_t fileCrc = 0;
+        if (!parseFile(path, hasSuffix(names[i], ".bin"), &words, &wordCount, &fileCrc)) {
+            Serial.printf("VS1053_Plugins: ✗ Could not parse %s\n", path);
+            continue;
+        }
+
+        // Unchanged since the last scan - keep the image we already have.
+        int existing = -1;
+        for (int k = 0; k < pluginCount; k++) {
+            if (plugins[k].words && plugins[k].crc == fileCrc && strcmp(plugins[k].name, names[i]) == 0) {
+                existing = k;
+                break;
+            }
+        }
+
+        Plugin& p = next[nextCount++];
+        if (existing >= 0) {
+            heap_caps_free(words);
+            p = plugins[existing];
+            plugins[existing].words = nullptr;   // ownership moved to next[]
+        } else {
+            strncpy(p.name, names[i], sizeof(p.name) - 1);
+            p.name[sizeof(p.name) - 1] = '\0';
+            p.crc = fileCrc;
+            p.words = words;
+            p.wordCount = wordCount;
+            Serial.printf("VS1053_Plugins: ✓ %s - %u words, CRC %08X\n",
+                          p.name, (unsigned)wordCount, (unsigned)fileCrc);
+        }
+    }
+
+    // Anything not carried over is gone from the card.
+    for (int k = 0; k < pluginCount; k++) {
+        if (plugins[k].words) heap_caps_free(plugins[k].words);
+    }
+    memset(plugins, 0, sizeof(plugins));
+    memcpy(plugins, next, sizeof(Plugin) * nextCount);
+    pluginCount = nextCount;
+
+    return pluginCount;
+}
+
+bool VS1053_Plugins::parseFile(const char* path, bool binary, uint16_t** outWords,
+                               size_t* outCount, uint32_t* outCrc) {
+    FsFile file;
+    size_t fileSize;
+    {
+        SPIBusGuard guard;
+        if (!file.open(path, O_RDONLY)) return false;
+        fileSize = file.fileSize();
+    }
+
+    // Upper bound on word count: binary is 2 bytes/word, and the shortest
+    // possible text token ("0,") is 2 bytes too.
+    size_t capacity = fileSize / 2 + 1;
+    uint16_t* words = (uint16_t*)heap_caps_malloc(capacity * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    if (!words) words = (uint16_t*)malloc(capacity * sizeof(uint16_t));
+    if (!words) {
+        SPIBusGuard guard;
+        file.close();
+        return false;
+    }
+
+    size_t count = 0;
+    uint32_t crc = 0;
+
+    // Text tokenizer state, carried across 512-byte reads.
+    bool inArray = binary;     // binary files are "all array"
+    bool inBlockComment = false, inLineComment = false;
+    bool inNumber = false, isHex = false;
+    uint32_t value = 0;
+    char prev = 0;
+    int pendingLow = -1;       // binary: low byte waiting for its high byte
+
+    uint8_t buf[512];
+    for (;;) {
+        int n;
+        {
+            SPIBusGuard guard;
+            n = file.read(buf, sizeof(buf));
+        }
+        if (n <= 0) break;
+        crc = esp_rom_crc32_le(crc, buf, n);
+
+        for (int i = 0; i < n; i++) {
+            char c = (char)buf[i];
+
+            if (binary) {
+                if (pendingLow < 0) {
+                    pendingLow = buf[i];
+                } else {
+                    if (count < capacity) words[count++] = (uint16_t)(pendingLow | (buf[i] << 8));
+                    pendingLow = -1;
+                }
+                continue;
+            }
+
+            if (inBlockComment) {
+                if (prev == '*' && c == '/') inBlockComment = false;
+                prev = c;
+                continue;
+            }
+            if (inLineComment) {
+                if (c == '\n') inLineComment = false;
+                prev = c;
+                continue;
+            }
+            if (prev == '/' && c == '*') { inBlockComment = true; prev = 0; continue; }
+            if (prev == '/' && c == '/') { inLineComment = true; prev = 0; continue; }
+
+            if (inNumber) {
+                if (isHex && isxdigit((unsigned char)c)) {
+                    value = value * 16 + (isdigit((unsigned char)c) ? c - '0' : (tolower(c) - 'a' + 10));
+                } else if (!isHex && isdigit((unsigned char)c)) {
+                    value = value * 10 + (c - '0');
+                } else if (value == 0 && (c == 'x' || c == 'X') && prev == '0') {
+                    isHex = true;
+                } else {
+                    if (inArray && count < capacity) words[count++] = (uint16_t)value;
+                    inNumber = false;
+                }
+            }
+            if (!inNumber) {
+                if (c == '{') inArray = true;
+                else if (c == '}') inArray = false;
+                else if (isdigit((unsigned char)c) && !isalnum((unsigned char)prev) && prev != '_') {
+                    // Digits inside identifiers (plugin[2093]) or array
+                    // sizes before '{' are skipped by the inArray check.
+                    inNumber = true;
+                    isHex = false;
+                    value = c - '0';
+                }
+            }
+            prev = c;
+        }
+    }
+    if (!binary && inNumber && inArray && count < capacity) {
+        words[count++] = (uint16_t)value;
+    }
+
+    {
+        SPIBusGuard guard;
+        file.close();
+    }
+
+    if (count < 2) {
+        heap_caps_free(words);
+        return false;
+    }
+
+    *outWords = words;
+    *outCount = count;
+    *outCrc = crc;
+    return true;
+}
@@ -0,0 +1,76 @@
+// =====================================================================
+//  VS1053_Plugins.h - VLSI patch/plugin images loaded from SD
+//
+//  VS1053_Module::begin() only configures clocks, so the chip runs with
+//  its ROM firmware: no FLAC, none of VLSI's bug-fix patches, no
+//  spectrum analyzer or loudness plugins. VLSI distributes all of those
+//  as "compressed plugin" images that get written into the decoder's
+//  instruction/data RAM through SCI_WRAMADDR/SCI_WRAM (and started via
+//  SCI_AIADDR) - and, being RAM, they're lost on every reset.
+//
+//  This class owns those images. loadFromSD() reads every plugin in
+//  /Plugins once, parses it into a word array in PSRAM and remembers it
+//  by CRC-32; VS1053_Module::applyPlugins() then writes the cached
+//  images into the chip after each reset without touching SD again.
+//
+//  Two file forms are accepted, applied in filename order (so prefix
+//  them "01-", "02-"... when load order matters - patches first):
+//    *.plg  VLSI's C-array text form ("const unsigned short plugin[] =
+//           { 0x0007, 0x0001, ... };") exactly as downloaded.
+//    *.bin  the same words as raw little-endian uint16.
+//
+//  Image format (VLSI application note "compressed plugin"): repeated
+//  records of  addr, n, data...  - if n & 0x8000 the single following
+//  word is written (n & 0x7FFF) times, otherwise n words follow. addr is
+//  an SCI register, almost always SCI_WRAMADDR / SCI_WRAM / SCI_AIADDR.
+// =====================================================================
+
+#ifndef VS1053_PLUGINS_H
+#define VS1053_PLUGINS_H
+
+#include <Arduino.h>
+
+class VS1053_Plugins {
+public:
+    static VS1053_Plugins& getInstance();
+
+    // (Re)scan dirPath. A file whose CRC matches an image already cached
+    // under the same name is kept as-is. Returns the number of images
+    // cached afterwards.
+    int loadFromSD(const char* dirPath = "/Plugins");
+
+    int count() const { return pluginCount; }
+    const uint16_t* words(int index, size_t* wordCount) const;
+    uint32_t crc(int index) const;
+    const char* name(int index) const;
+
+    // True if a cached plugin's file name contains nameFragment
+    // (case-insensitive), e.g. has("spectrum").
+    bool has(const char* nameFragment) const;
+
+    // True once a FLAC-capable patch package is cached (VLSI ships FLAC
+    // support as part of the "vs1053b-patches-flac" image).
+    bool hasFlac() const { return has("flac"); }
+
+    static const int MAX_PLUGINS = 8;
+
+private:
+    VS1053_Plugins();
+    VS1053_Plugins(const VS1053_Plugins&) = delete;
+    VS1053_Plugins& operator=(const VS1053_Plugins&) = delete;
+
+    struct Plugin {
+        char name[48];
+        uint32_t crc;       // CRC-32 of the file bytes
+        uint16_t* words;    // PSRAM
+        size_t wordCount;
+    };
+
+    bool parseFile(const char* path, bool binary, uint16_t** outWords,
+                   size_t* outCount, uint32_t* outCrc);
+
+    Plugin plugins[MAX_PLUGINS];
+    int pluginCount;
+};
+
+#endif // VS1053_PLUGINS_H
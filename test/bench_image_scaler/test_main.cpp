@@ -0,0 +1,79 @@
+// =====================================================================
+//  bench_image_scaler - ImageScaler throughput on the host
+//
+//  pio test -e native -f bench_image_scaler -v
+//
+//  The sizes are what AlbumArtCache actually asks for: tjpgd decodes to
+//  between one and two times the box (it only scales by powers of two),
+//  then fitCentered() area-averages that down - or, for small covers,
+//  bilinears it up. Swapped, as the cache uses it. Reports microseconds
+//  per image and output megapixels per second; nothing is asserted
+//  beyond the run completing, since host timings vary. The test build
+//  isn't the board's -Os either - compare runs with each other.
+// =====================================================================
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../src/utils/ImageScaler.h"
+
+void setUp() {}
+void tearDown() {}
+
+static volatile uint16_t sink;
+
+static void bench(const char* label, int srcW, int srcH, int dstW, int dstH, ImageScaler::Mode mode) {
+    uint16_t* src = (uint16_t*)malloc((size_t)srcW * srcH * sizeof(uint16_t));
+    uint16_t* dst = (uint16_t*)malloc((size_t)dstW * dstH * sizeof(uint16_t));
+    uint32_t seed = 12345;
+    for (int i = 0; i < srcW * srcH; i++) {
+        seed = seed * 1103515245 + 12345;
+        src[i] = (uint16_t)(seed >> 16);
+    }
+
+    // Enough rounds for ~100 ms, whatever the host
+    using Clock = std::chrono::steady_clock;
+    int rounds = 0;
+    Clock::time_point start = Clock::now();
+    double elapsedUs = 0;
+    while (elapsedUs < 100000) {
+        ImageScaler::scale(src, srcW, srcH, dst, dstW, dstH, dstW, mode, true);
+        sink = dst[rounds % (dstW * dstH)];
+        rounds++;
+        elapsedUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    double perImage = elapsedUs / rounds;
+    char line[128];
+    snprintf(line, sizeof(line), "%-28s %4dx%-4d -> %3dx%-3d %8.1f us  %7.1f Mpix/s",
+             label, srcW, srcH, dstW, dstH, perImage, (double)dstW * dstH / perImage);
+    TEST_MESSAGE(line);
+
+    free(dst);
+    free(src);
+    TEST_ASSERT_TRUE(rounds > 0);
+}
+
+static void test_bench_area_average() {
+    bench("AreaAverage 1.9x (list art)", 300, 300, 160, 160, ImageScaler::AreaAverage);
+    bench("AreaAverage 1.25x", 300, 300, 240, 240, ImageScaler::AreaAverage);
+    bench("AreaAverage 1.9x", 450, 450, 240, 240, ImageScaler::AreaAverage);
+}
+
+static void test_bench_bilinear() {
+    bench("Bilinear 2x (small cover)", 120, 120, 240, 240, ImageScaler::Bilinear);
+    bench("Bilinear 1.6x", 100, 100, 160, 160, ImageScaler::Bilinear);
+}
+
+static void test_bench_nearest() {
+    bench("Nearest 1.25x", 300, 300, 240, 240, ImageScaler::Nearest);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_area_average);
+    RUN_TEST(test_bench_bilinear);
+    RUN_TEST(test_bench_nearest);
+    return UNITY_END();
+}
@@ -0,0 +1,434 @@
+// =====================================================================
+//  test_http_parser - HttpRequestParser behind a real socket
+//
+//  Host only: pio test -e native
+//
+//  HostServer is the device's request loop minus the card: a POSIX
+//  socket on 127.0.0.1, one connection at a time, each read fed to the
+//  parser as it arrives, "100 Continue" when asked, and a JSON summary
+//  of what the Handler saw (file names, sizes, FNV-1a of the data) as
+//  the response. The tests talk to it with a raw socket - writes split
+//  at awkward places - and, when it's installed, with curl itself.
+//
+//  To point any other client at it (a browser, a script):
+//
+//    HTTP_PARSER_SERVE=8080 .pio/build/native/program
+//    curl -T song.mp3 http://127.0.0.1:8080/files/Music/A/song.mp3
+//
+//  serves until killed instead of running the tests.
+// =====================================================================
+
+#include <unity.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../src/utils/HttpRequestParser.h"
+
+void setUp() {}
+void tearDown() {}
+
+static uint32_t fnv1a(const void* data, size_t len, uint32_t h = 2166136261u) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+// --- Server ---------------------------------------------------------------
+
+struct ReceivedFile {
+    std::string name;
+    uint64_t bytes;
+    uint32_t hash;
+    bool ended;
+};
+
+struct ReceivedRequest {
+    int status;
+    std::string method;
+    std::string path;
+    bool chunked;
+    bool multipart;
+    std::vector<ReceivedFile> files;
+};
+
+class HostServer : private HttpRequestParser::Handler {
+public:
+    HostServer() : _parser(*this), _listen(-1), _port(0) {}
+
+    // port 0 = any free one
+    bool begin(uint16_t port) {
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(_listen, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(_listen, 4) != 0) {
+            close(_listen);
+            return false;
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(_listen, (sockaddr*)&addr, &len);
+        _port = ntohs(addr.sin_port);
+        return true;
+    }
+
+    uint16_t port() const { return _port; }
+
+    void run(bool verbose) {
+        while (true) {
+            int fd = accept(_listen, nullptr, nullptr);
+            if (fd < 0) return;
+            serve(fd);
+            close(fd);
+            if (verbose) {
+                printf("%s\n", summary(last()).c_str());
+                fflush(stdout);
+            }
+        }
+    }
+
+    ReceivedRequest last() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _last;
+    }
+
+    static std::string summary(const ReceivedRequest& r) {
+        char buf[160];
+        snprintf(buf, sizeof(buf), "{\"status\":%d,\"method\":\"%s\",\"path\":\"%s\",\"files\":[",
+                 r.status, r.method.c_str(), r.path.c_str());
+        std::string json = buf;
+        for (size_t i = 0; i < r.files.size(); i++) {
+            snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"bytes\":%llu,\"fnv\":\"%08x\"}",
+                     i ? "," : "", r.files[i].name.c_str(),
+                     (unsigned long long)r.files[i].bytes, r.files[i].hash);
+            json += buf;
+        }
+        return json + "]}";
+    }
+
+private:
+    void serve(int fd) {
+        _parser.reset();
+        _current = ReceivedRequest();
+        _current.status = 0;
+
+        // One TCP segment's worth per read, like WiFiClient on the board
+        uint8_t buffer[1460];
+        bool continued = false;
+        while (!_parser.isDone() && !_parser.failed()) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            _parser.feed(buffer, (size_t)n);
+            if (!continued && _parser.inBody() && _parser.expectsContinue()) {
+                sendAll(fd, "HTTP/1.1 100 Continue\r\n\r\n");
+                continued = true;
+            }
+        }
+
+        _current.status = _parser.isDone() ? 200 : (_parser.failed() ? _parser.errorStatus() : 0);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _last = _current;
+        }
+        if (!_current.status) return;      // client went away
+
+        std::string body = summary(_current);
+        char head[160];
+        snprintf(head, sizeof(head),
+                 "HTTP/1.1 %d X\r\nContent-Type: application/json\r\n"
+                 "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                 _current.status, body.size());
+        sendAll(fd, std::string(head) + body);
+    }
+
+    static void sendAll(int fd, const std::string& s) {
+        size_t done = 0;
+        while (done < s.size()) {
+            ssize_t n = send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+            if (n <= 0) return;
+            done += n;
+        }
+    }
+
+    int onHeaders(const HttpRequestParser& request) override {
+        static const char* const METHODS[] = { "GET", "PUT", "POST", "DELETE", "OTHER" };
+        _current.method = METHODS[request.method()];
+        _current.path = request.path();
+        _current.chunked = request.isChunked();
+        _current.multipart = request.isMultipart();
+        return 0;
+    }
+
+    int onFileBegin(const char* name) override {
+        _current.files.push_back({ name, 0, 2166136261u, false });
+        return 0;
+    }
+
+    int onFileData(const uint8_t* data, size_t len) override {
+        ReceivedFile& f = _current.files.back();
+        f.bytes += len;
+        f.hash = fnv1a(data, len, f.hash);
+        return 0;
+    }
+
+    int onFileEnd() override {
+        _current.files.back().ended = true;
+        return 0;
+    }
+
+    HttpRequestParser _parser;
+    int _listen;
+    uint16_t _port;
+    ReceivedRequest _current;
+    ReceivedRequest _last;
+    std::mutex _mutex;
+};
+
+static HostServer server;
+
+// --- Raw client -----------------------------------------------------------
+
+// Sends the pieces as separate writes (Nagle off, so they mostly arrive
+// as separate reads) and returns the whole response.
+static std::string exchange(const std::vector<std::string>& pieces) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server.port());
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return "";
+    }
+    for (const std::string& p : pieces) {
+        send(fd, p.data(), p.size(), MSG_NOSIGNAL);
+        usleep(2000);
+    }
+    shutdown(fd, SHUT_WR);
+
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) response.append(buf, n);
+    close(fd);
+    return response;
+}
+
+static std::string pattern(size_t len, uint32_t seed) {
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        s[i] = (char)(seed >> 16);
+    }
+    return s;
+}
+
+static void assertFile(const ReceivedFile& f, const char* name, const std::string& data) {
+    TEST_ASSERT_EQUAL_STRING(name, f.name.c_str());
+    TEST_ASSERT_EQUAL_UINT32(data.size(), (uint32_t)f.bytes);
+    TEST_ASSERT_EQUAL_HEX32(fnv1a(data.data(), data.size()), f.hash);
+    TEST_ASSERT_TRUE(f.ended);
+}
+
+// --- Raw socket tests -----------------------------------------------------
+
+static void test_put_content_length_split_reads() {
+    std::string data = pattern(5000, 1);
+    std::string head = "PUT /files/Music/My%20Album/01.mp3?x=1 HTTP/1.1\r\n"
+                       "Host: x\r\nContent-Length: 5000\r\n\r\n";
+    // Header split mid-line and mid-CRLF, body in odd sizes
+    std::string response = exchange({ head.substr(0, 9), head.substr(9, 31), head.substr(40),
+                                      data.substr(0, 1), data.substr(1, 1459), data.substr(1460) });
+
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200", response.substr(0, 12).c_str());
+    ReceivedRequest r = server.last();
+    TEST_ASSERT_EQUAL_STRING("PUT", r.method.c_str());
+    TEST_ASSERT_EQUAL_STRING("/files/Music/My Album/01.mp3", r.path.c_str());
+    TEST_ASSERT_EQUAL_INT(1, (int)r.files.size());
+    assertFile(r.files[0], "", data);
+}
+
+static void test_put_chunked() {
+    std::string data = pattern(3000, 2);
+    std::vector<std::string> pieces = {
+        "PUT /files/a.bin HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+        "7d0\r\n" + data.substr(0, 2000) + "\r\n",
+        "3E8;ext=1\r\n" + data.substr(2000, 500),
+        data.substr(2500) + "\r",
+        "\n0\r\nX-Trailer: y\r\n\r\n"
+    };
+    std::string response = exchange(pieces);
+
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200", response.substr(0, 12).c_str());
+    ReceivedRequest r = server.last();
+    TEST_ASSERT_TRUE(r.chunked);
+    assertFile(r.files[0], "", data);
+}
+
+static void test_multipart_boundary_split() {
+    std::string a = pattern(4000, 3), b = pattern(10, 4);
+    // Data holding a near-miss of the delimiter must come through intact
+    a.replace(100, 12, "\r\n--XyZboun");
+    std::string body =
+        "--XyZboundary\r\n"
+        "Content-Disposition: form-data; name=\"note\"\r\n\r\nskipped\r\n"
+        "--XyZboundary\r\n"
+        "Content-Disposition: form-data; name=\"f\"; filename=\"Album/01 One.mp3\"\r\n"
+        "Content-Type: audio/mpeg\r\n\r\n" + a + "\r\n"
+        "--XyZboundary\r\n"
+        "Content-Disposition: form-data; name=\"f\"; filename=\"Album/cover.jpg\"\r\n\r\n" + b +
+        "\r\n--XyZboundary--\r\n";
+    std::string head = "POST /files/Music HTTP/1.1\r\n"
+                       "Content-Type: multipart/form-data; boundary=XyZboundary\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+
+    // Cut inside the closing delimiter of the first file
+    size_t cut = body.find("\r\n--XyZboundary\r\nContent-Disposition: form-data; name=\"f\"; filename=\"Album/cover") + 7;
+    std::string response = exchange({ head, body.substr(0, cut), body.substr(cut) });
+
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200", response.substr(0, 12).c_str());
+    ReceivedRequest r = server.last();
+    TEST_ASSERT_TRUE(r.multipart);
+    TEST_ASSERT_EQUAL_INT(2, (int)r.files.size());
+    assertFile(r.files[0], "Album/01 One.mp3", a);
+    assertFile(r.files[1], "Album/cover.jpg", b);
+}
+
+static void test_expect_continue() {
+    std::string data = pattern(100, 5);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server.port());
+    TEST_ASSERT_EQUAL_INT(0, connect(fd, (sockaddr*)&addr, sizeof(addr)));
+
+    std::string head = "PUT /files/b.bin HTTP/1.1\r\nContent-Length: 100\r\nExpect: 100-continue\r\n\r\n";
+    send(fd, head.data(), head.size(), MSG_NOSIGNAL);
+
+    // Nothing more is sent until the server says so
+    char buf[256];
+    ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
+    TEST_ASSERT_TRUE(n > 0);
+    buf[n] = '\0';
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 100 Continue\r\n\r\n", buf);
+
+    send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    n = recv(fd, buf, sizeof(buf) - 1, 0);
+    close(fd);
+    TEST_ASSERT_TRUE(n >= 12);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(buf, "HTTP/1.1 200", 12));
+    assertFile(server.last().files[0], "", data);
+}
+
+static void test_errors() {
+    // No length, no chunking
+    std::string response = exchange({ "PUT /files/c HTTP/1.1\r\n\r\n" });
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 411", response.substr(0, 12).c_str());
+
+    // Bad chunk size
+    response = exchange({ "PUT /files/c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n" });
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 400", response.substr(0, 12).c_str());
+
+    // Multipart body that ends before its closing delimiter
+    response = exchange({ "POST /files HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=b\r\n"
+                          "Content-Length: 10\r\n\r\n--b\r\n\r\nabc" });
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 400", response.substr(0, 12).c_str());
+
+    // Request line longer than MAX_LINE
+    response = exchange({ "GET /" + std::string(HttpRequestParser::MAX_LINE, 'a') + " HTTP/1.1\r\n\r\n" });
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 414", response.substr(0, 12).c_str());
+}
+
+// --- A real client --------------------------------------------------------
+
+static std::string writeTemp(const char* name, const std::string& data) {
+    std::string path = std::string("/tmp/") + name;
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+    return path;
+}
+
+static int curl(const std::string& args, const char* path) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "curl -s -S -o /dev/null -w '%%{http_code}' %s http://127.0.0.1:%u%s",
+             args.c_str(), server.port(), path);
+    FILE* p = popen(cmd, "r");
+    int code = 0;
+    if (p) {
+        if (fscanf(p, "%d", &code) != 1) code = 0;
+        pclose(p);
+    }
+    return code;
+}
+
+static void test_curl() {
+    if (system("curl --version > /dev/null 2>&1") != 0) {
+        TEST_IGNORE_MESSAGE("curl not installed");
+    }
+
+    std::string big = pattern(3 * 1024 * 1024 + 17, 6);
+    std::string small = pattern(999, 7);
+    std::string bigPath = writeTemp("http_parser_big.bin", big);
+    std::string smallPath = writeTemp("http_parser_small.bin", small);
+
+    // PUT with Content-Length - curl sends Expect: 100-continue for this
+    TEST_ASSERT_EQUAL_INT(200, curl("-T " + bigPath, "/files/big.bin"));
+    assertFile(server.last().files[0], "", big);
+
+    // Piped, so chunked
+    TEST_ASSERT_EQUAL_INT(200, curl("-T - < " + bigPath, "/files/piped.bin"));
+    TEST_ASSERT_TRUE(server.last().chunked);
+    assertFile(server.last().files[0], "", big);
+
+    // Browser-style multipart, two files
+    TEST_ASSERT_EQUAL_INT(200, curl("-F 'a=@" + bigPath + ";filename=Album/big.bin' "
+                                    "-F 'b=@" + smallPath + ";filename=Album/small.bin'", "/files/Music"));
+    ReceivedRequest r = server.last();
+    TEST_ASSERT_EQUAL_INT(2, (int)r.files.size());
+    assertFile(r.files[0], "Album/big.bin", big);
+    assertFile(r.files[1], "Album/small.bin", small);
+
+    remove(bigPath.c_str());
+    remove(smallPath.c_str());
+}
+
+int main(int, char**) {
+    const char* serve = getenv("HTTP_PARSER_SERVE");
+    if (serve) {
+        if (!server.begin((uint16_t)atoi(serve))) {
+            fprintf(stderr, "Can't listen on port %s\n", serve);
+            return 1;
+        }
+        printf("Serving HttpRequestParser on http://127.0.0.1:%u\n", server.port());
+        server.run(true);
+        return 0;
+    }
+
+    if (!server.begin(0)) return 1;
+    std::thread([] { server.run(false); }).detach();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_put_content_length_split_reads);
+    RUN_TEST(test_put_chunked);
+    RUN_TEST(test_multipart_boundary_split);
+    RUN_TEST(test_expect_continue);
+    RUN_TEST(test_errors);
+    RUN_TEST(test_curl);
+    return UNITY_END();
+}
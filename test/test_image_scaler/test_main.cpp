@@ -0,0 +1,183 @@
+// =====================================================================
+//  test_image_scaler - ImageScaler golden-image tests
+//
+//  Host only: pio test -e native
+//
+//  Each case scales a fixed synthetic image (gradient plus xorshift
+//  noise) and compares an FNV-1a hash of the whole destination - stride
+//  padding included, so writes outside the rectangle show up too -
+//  against a recorded golden. The goldens were taken from the original
+//  per-pixel implementation; the restructured loops have to match it
+//  bit for bit. A handful of small cases are checked pixel by pixel so
+//  a failure is readable.
+// =====================================================================
+
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../src/utils/ImageScaler.h"
+
+void setUp() {}
+void tearDown() {}
+
+static uint16_t rgb(uint32_t r, uint32_t g, uint32_t b) {
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static uint16_t swap16(uint16_t v) {
+    return (uint16_t)((v >> 8) | (v << 8));
+}
+
+static uint32_t noiseState;
+
+static uint32_t noise() {
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return noiseState;
+}
+
+// Red across, green down, random blue
+static uint16_t* makeImage(int w, int h) {
+    uint16_t* img = (uint16_t*)malloc((size_t)w * h * sizeof(uint16_t));
+    noiseState = 0x9E3779B9 ^ (uint32_t)(w * 131 + h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint32_t r = x * 31 / (w > 1 ? w - 1 : 1);
+            uint32_t g = y * 63 / (h > 1 ? h - 1 : 1);
+            img[y * w + x] = rgb(r, g, noise() & 31);
+        }
+    }
+    return img;
+}
+
+static uint32_t fnv1a(const uint16_t* p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ (p[i] & 0xFF)) * 16777619u;
+        h = (h ^ (p[i] >> 8)) * 16777619u;
+    }
+    return h;
+}
+
+// --- Golden images --------------------------------------------------------
+
+struct GoldenCase {
+    int srcW, srcH, dstW, dstH;
+    // Nearest, Bilinear, AreaAverage - each unswapped, then swapped
+    uint32_t hash[6];
+};
+
+static const GoldenCase GOLDEN[] = {
+    {   1,   1,   7,   5, { 0x60840744, 0x60840744, 0x60840744, 0x60840744, 0x60840744, 0x60840744 } },
+    {   2,   2,   1,   1, { 0x6C923470, 0x6C923470, 0xD2406C14, 0x98ACCCDA, 0xD2406C14, 0x98ACCCDA } },
+    {   3,   5,   8,   8, { 0x32657D38, 0x32657D38, 0x498D59F6, 0xDD251408, 0x5D1F4C78, 0x9BADB178 } },
+    {  17,  13,   5,   4, { 0x36BF4640, 0x36BF4640, 0x1CA87BFD, 0x5DC1CB24, 0x64A5E720, 0xD330DA14 } },
+    {  64,  48, 240, 180, { 0xAD7F56EE, 0xAD7F56EE, 0xF26D9312, 0x6C7FAB9A, 0x9F2E804A, 0xD6AE6221 } },
+    { 300, 300, 240, 240, { 0x35406073, 0x35406073, 0x4B265D15, 0x838AD895, 0xC072B952, 0x67916C84 } },
+    { 320, 240, 160, 120, { 0xB43307A2, 0xB43307A2, 0x5242A510, 0xBBE27369, 0x5242A510, 0xBBE27369 } },
+    { 160, 160, 240, 240, { 0x2748E97C, 0x2748E97C, 0x33F403FC, 0xB32243B2, 0xB5802F83, 0xF73B8D27 } },
+    { 240, 240, 240, 240, { 0x6B15CB18, 0x6B15CB18, 0x6B15CB18, 0x6B15CB18, 0x6B15CB18, 0x6B15CB18 } },
+    { 511,   7,  33,  70, { 0xB957CDB9, 0xB957CDB9, 0x64619DA0, 0xF0335268, 0x5B17A911, 0xC4C54D19 } },
+    {   7, 511,  70,  33, { 0x73D2BDA5, 0x73D2BDA5, 0xD9017350, 0x6895F3E9, 0xCFD1DC41, 0x8702ADED } },
+    { 640, 480, 100, 100, { 0x2F176D26, 0x2F176D26, 0x755B0DDD, 0xDDB80E5A, 0x9F92DBDD, 0x742F18DF } },
+};
+
+static void test_golden_scale() {
+    char label[64];
+    for (const GoldenCase& c : GOLDEN) {
+        uint16_t* src = makeImage(c.srcW, c.srcH);
+        int stride = c.dstW + 3;
+        size_t count = (size_t)stride * c.dstH;
+        uint16_t* dst = (uint16_t*)malloc(count * sizeof(uint16_t));
+
+        for (int mode = 0; mode < 3; mode++) {
+            for (int swapped = 0; swapped < 2; swapped++) {
+                for (size_t i = 0; i < count; i++) dst[i] = 0xAAAA;
+                ImageScaler::scale(src, c.srcW, c.srcH, dst, c.dstW, c.dstH, stride,
+                                   (ImageScaler::Mode)mode, swapped != 0);
+                snprintf(label, sizeof(label), "%dx%d -> %dx%d mode %d%s",
+                         c.srcW, c.srcH, c.dstW, c.dstH, mode, swapped ? " swapped" : "");
+                TEST_ASSERT_EQUAL_HEX32_MESSAGE(c.hash[mode * 2 + swapped], fnv1a(dst, count), label);
+            }
+        }
+        free(dst);
+        free(src);
+    }
+}
+
+static void test_golden_fit_centered() {
+    // Letterboxed shrink, pillarboxed enlarge, and 1:1
+    static const struct { int srcW, srcH; uint32_t hash; } FITS[] = {
+        { 300, 200, 0x9FFF3BF8 },
+        { 120, 160, 0xCE6A56A6 },
+        { 240, 240, 0xBA8BA3B4 },
+    };
+    static uint16_t box[240 * 240];
+    for (const auto& f : FITS) {
+        uint16_t* src = makeImage(f.srcW, f.srcH);
+        ImageScaler::fitCentered(src, f.srcW, f.srcH, box, 240, 240, true);
+        TEST_ASSERT_EQUAL_HEX32(f.hash, fnv1a(box, 240 * 240));
+        free(src);
+    }
+}
+
+// --- Small exact cases ----------------------------------------------------
+
+static void test_area_average_of_four() {
+    uint16_t src[4] = { rgb(0, 0, 0), rgb(31, 0, 0), rgb(0, 63, 0), rgb(31, 63, 31) };
+    uint16_t out;
+    ImageScaler::scale(src, 2, 2, &out, 1, 1, 1, ImageScaler::AreaAverage, false);
+    // (0 + 31 + 0 + 31) / 4 = 15.5 -> 16, (0 + 0 + 63 + 63) / 4 = 31.5 -> 32,
+    // 31 / 4 = 7.75 -> 8
+    TEST_ASSERT_EQUAL_HEX16(rgb(16, 32, 8), out);
+}
+
+static void test_swapped_matches_unswapped() {
+    uint16_t* src = makeImage(37, 23);
+    uint16_t swappedSrc[37 * 23];
+    for (int i = 0; i < 37 * 23; i++) swappedSrc[i] = swap16(src[i]);
+
+    uint16_t plain[50 * 31], swapped[50 * 31];
+    for (int mode = 0; mode < 3; mode++) {
+        ImageScaler::scale(src, 37, 23, plain, 50, 31, 50, (ImageScaler::Mode)mode, false);
+        ImageScaler::scale(swappedSrc, 37, 23, swapped, 50, 31, 50, (ImageScaler::Mode)mode, true);
+        for (int i = 0; i < 50 * 31; i++) TEST_ASSERT_EQUAL_HEX16(plain[i], swap16(swapped[i]));
+    }
+    free(src);
+}
+
+static void test_flat_colour_stays_flat() {
+    uint16_t src[13 * 9];
+    for (int i = 0; i < 13 * 9; i++) src[i] = rgb(19, 44, 7);
+
+    uint16_t out[31 * 4];
+    for (int mode = 0; mode < 3; mode++) {
+        ImageScaler::scale(src, 13, 9, out, 31, 4, 31, (ImageScaler::Mode)mode, false);
+        for (int i = 0; i < 31 * 4; i++) TEST_ASSERT_EQUAL_HEX16(rgb(19, 44, 7), out[i]);
+    }
+}
+
+static void test_bilinear_edges_clamp() {
+    // 2x1 black-white stretched to 8: both ends hold the edge pixel
+    // (the clamped columns), the middle ramps
+    uint16_t src[2] = { rgb(0, 0, 0), rgb(31, 63, 31) };
+    uint16_t out[8];
+    ImageScaler::scale(src, 2, 1, out, 8, 1, 8, ImageScaler::Bilinear, false);
+    TEST_ASSERT_EQUAL_HEX16(src[0], out[0]);
+    TEST_ASSERT_EQUAL_HEX16(src[0], out[1]);
+    TEST_ASSERT_EQUAL_HEX16(src[1], out[6]);
+    TEST_ASSERT_EQUAL_HEX16(src[1], out[7]);
+    for (int x = 2; x < 6; x++) TEST_ASSERT_TRUE((out[x] >> 11) >= (out[x - 1] >> 11));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_scale);
+    RUN_TEST(test_golden_fit_centered);
+    RUN_TEST(test_area_average_of_four);
+    RUN_TEST(test_swapped_matches_unswapped);
+    RUN_TEST(test_flat_colour_stays_flat);
+    RUN_TEST(test_bilinear_edges_clamp);
+    return UNITY_END();
+}
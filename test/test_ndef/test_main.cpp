@@ -0,0 +1,255 @@
+// =====================================================================
+//  test_ndef - Ndef encoder/parser round trips and a fuzz loop
+//
+//  Host only: pio test -e native
+//
+//  The fuzz loop feeds the parser mutated and random tag images, each
+//  in a heap buffer of exactly its own size, and checks that every
+//  pointer it hands out stays inside that buffer and every decode is
+//  terminated. Build with -fsanitize=address to have overreads caught
+//  as they happen rather than only through the bounds checks.
+// =====================================================================
+
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../src/utils/Ndef.h"
+
+void setUp() {}
+void tearDown() {}
+
+// --- Round trips ----------------------------------------------------------
+
+static void test_text_round_trip() {
+    uint8_t tag[128];
+    NdefWriter writer(tag, sizeof(tag));
+    TEST_ASSERT_TRUE(writer.addText("Bluey - Soundtrack", "en"));
+    size_t len = writer.finish();
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_EQUAL_HEX8(0x03, tag[0]);           // NDEF Message TLV
+    TEST_ASSERT_EQUAL_HEX8(0xFE, tag[len - 1]);     // terminator
+
+    NdefParser parser;
+    NdefRecord record;
+    TEST_ASSERT_TRUE(parser.begin(tag, len));
+    TEST_ASSERT_TRUE(parser.next(record));
+    TEST_ASSERT_TRUE(record.is(NDEF_TNF_WELL_KNOWN, "T"));
+
+    char text[64], lang[8];
+    TEST_ASSERT_TRUE(record.decodeText(text, sizeof(text), lang, sizeof(lang)));
+    TEST_ASSERT_EQUAL_STRING("Bluey - Soundtrack", text);
+    TEST_ASSERT_EQUAL_STRING("en", lang);
+    TEST_ASSERT_FALSE(parser.next(record));
+    TEST_ASSERT_FALSE(parser.malformed());
+}
+
+static void test_utf8_kept_and_cut_on_a_character() {
+    // "Für Elise" then a 3-byte character right at the cut
+    const char* name = "F\xC3\xBCr Elise \xE2\x99\xAA";
+    uint8_t tag[64];
+    NdefWriter writer(tag, sizeof(tag));
+    TEST_ASSERT_TRUE(writer.addText(name));
+    size_t len = writer.finish();
+
+    NdefParser parser;
+    NdefRecord record;
+    TEST_ASSERT_TRUE(parser.begin(tag, len));
+    TEST_ASSERT_TRUE(parser.next(record));
+
+    char whole[32];
+    TEST_ASSERT_TRUE(record.decodeText(whole, sizeof(whole)));
+    TEST_ASSERT_EQUAL_STRING(name, whole);
+
+    char cut[13];       // room for 12 bytes: the note's first byte is the 12th
+    TEST_ASSERT_TRUE(record.decodeText(cut, sizeof(cut)));
+    TEST_ASSERT_EQUAL_STRING("F\xC3\xBCr Elise ", cut);
+}
+
+static void test_uri_prefix_round_trip() {
+    uint8_t tag[128];
+    NdefWriter writer(tag, sizeof(tag));
+    TEST_ASSERT_TRUE(writer.addUri("https://www.example.com/album"));
+    TEST_ASSERT_TRUE(writer.addUri("urn:epc:id:sgtin:1"));  // longest prefix wins
+    size_t len = writer.finish();
+
+    NdefParser parser;
+    NdefRecord record;
+    char uri[64];
+    TEST_ASSERT_TRUE(parser.begin(tag, len));
+
+    TEST_ASSERT_TRUE(parser.next(record));
+    TEST_ASSERT_EQUAL_HEX8(0x02, record.payload[0]);
+    TEST_ASSERT_TRUE(record.decodeUri(uri, sizeof(uri)));
+    TEST_ASSERT_EQUAL_STRING("https://www.example.com/album", uri);
+
+    TEST_ASSERT_TRUE(parser.next(record));
+    TEST_ASSERT_EQUAL_HEX8(0x1E, record.payload[0]);
+    TEST_ASSERT_TRUE(record.decodeUri(uri, sizeof(uri)));
+    TEST_ASSERT_EQUAL_STRING("urn:epc:id:sgtin:1", uri);
+    TEST_ASSERT_FALSE(parser.next(record));
+}
+
+static void test_long_record_and_long_tlv() {
+    // > 255 bytes of payload needs a long record and the 3-byte TLV length
+    static uint8_t payload[600];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)(i * 7);
+
+    static uint8_t tag[700];
+    NdefWriter writer(tag, sizeof(tag));
+    TEST_ASSERT_TRUE(writer.addText("first"));
+    TEST_ASSERT_TRUE(writer.addRecord(NDEF_TNF_EXTERNAL, "mp3player.local:album",
+                                      payload, sizeof(payload)));
+    size_t len = writer.finish();
+    TEST_ASSERT_EQUAL_HEX8(0x03, tag[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, tag[1]);
+
+    NdefParser parser;
+    NdefRecord record;
+    TEST_ASSERT_TRUE(parser.begin(tag, len));
+    TEST_ASSERT_TRUE(parser.next(record));
+    TEST_ASSERT_TRUE(parser.next(record));
+    TEST_ASSERT_TRUE(record.is(NDEF_TNF_EXTERNAL, "mp3player.local:album"));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(payload), record.payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY(payload, record.payload, sizeof(payload));
+    TEST_ASSERT_FALSE(parser.next(record));
+    TEST_ASSERT_FALSE(parser.malformed());
+}
+
+static void test_skips_null_and_control_tlvs() {
+    // NULL, Lock Control (01 03 ...), then the message
+    uint8_t tag[64] = { 0x00, 0x00, 0x01, 0x03, 0xA0, 0x10, 0x44 };
+    NdefWriter writer(tag + 7, sizeof(tag) - 7);
+    TEST_ASSERT_TRUE(writer.addText("x"));
+    size_t len = 7 + writer.finish();
+
+    NdefParser parser;
+    NdefRecord record;
+    char text[8];
+    TEST_ASSERT_TRUE(parser.begin(tag, len));
+    TEST_ASSERT_TRUE(parser.next(record));
+    TEST_ASSERT_TRUE(record.decodeText(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("x", text);
+}
+
+static void test_truncated_and_overflowing() {
+    uint8_t tag[64];
+    NdefWriter writer(tag, sizeof(tag));
+    TEST_ASSERT_TRUE(writer.addText("truncate me"));
+    size_t len = writer.finish();
+
+    // TLV length now runs past the data
+    NdefParser parser;
+    TEST_ASSERT_FALSE(parser.begin(tag, len - 4));
+
+    // Record length runs past the TLV
+    tag[1] -= 3;
+    NdefRecord record;
+    TEST_ASSERT_TRUE(parser.begin(tag, len));
+    TEST_ASSERT_FALSE(parser.next(record));
+    TEST_ASSERT_TRUE(parser.malformed());
+
+    // Writer: doesn't fit, or nothing after finish()
+    uint8_t small[12];
+    NdefWriter tight(small, sizeof(small));
+    TEST_ASSERT_FALSE(tight.addText("far too long for this"));
+    TEST_ASSERT_EQUAL_UINT32(0, tight.finish());
+
+    NdefWriter once(tag, sizeof(tag));
+    TEST_ASSERT_TRUE(once.addText("a"));
+    TEST_ASSERT_TRUE(once.finish() > 0);
+    TEST_ASSERT_FALSE(once.addText("b"));
+}
+
+// --- Fuzz -----------------------------------------------------------------
+
+static uint32_t fuzzState = 0x2545F491;
+
+static uint32_t fuzzRand() {
+    // xorshift32 - the same sequence on every run
+    fuzzState ^= fuzzState << 13;
+    fuzzState ^= fuzzState >> 17;
+    fuzzState ^= fuzzState << 5;
+    return fuzzState;
+}
+
+static bool inside(const uint8_t* p, size_t n, const uint8_t* buf, size_t len) {
+    return p >= buf && n <= len && (size_t)(p - buf) <= len - n;
+}
+
+static void parseAll(const uint8_t* seed, size_t seedLen) {
+    // Exactly seedLen on the heap, so a sanitizer sees any overread
+    uint8_t* buf = (uint8_t*)malloc(seedLen ? seedLen : 1);
+    memcpy(buf, seed, seedLen);
+
+    NdefParser parser;
+    NdefRecord record;
+    if (parser.begin(buf, seedLen)) {
+        int records = 0;
+        while (parser.next(record)) {
+            TEST_ASSERT_TRUE(inside(record.type, record.typeLength, buf, seedLen));
+            TEST_ASSERT_TRUE(inside(record.id, record.idLength, buf, seedLen));
+            TEST_ASSERT_TRUE(inside(record.payload, record.payloadLength, buf, seedLen));
+
+            char out[24], lang[4];
+            if (record.decodeText(out, sizeof(out), lang, sizeof(lang))) {
+                TEST_ASSERT_TRUE(strlen(out) < sizeof(out));
+                TEST_ASSERT_TRUE(strlen(lang) < sizeof(lang));
+            }
+            if (record.decodeUri(out, sizeof(out))) {
+                TEST_ASSERT_TRUE(strlen(out) < sizeof(out));
+            }
+            // Every record is at least 3 bytes, so this always ends
+            TEST_ASSERT_TRUE(++records <= (int)seedLen / 3);
+        }
+    }
+    free(buf);
+}
+
+static void test_fuzz() {
+    uint8_t valid[256];
+    NdefWriter writer(valid, sizeof(valid));
+    writer.addText("Gr\xC3\xBC\xC3\x9F" "e", "de");
+    writer.addUri("http://www.example.org/");
+    static const uint8_t blob[] = { 1, 2, 3, 4 };
+    writer.addRecord(NDEF_TNF_MIME, "application/x-album", blob, sizeof(blob));
+    size_t validLen = writer.finish();
+    TEST_ASSERT_TRUE(validLen > 0);
+
+    uint8_t image[300];
+    for (int round = 0; round < 200000; round++) {
+        size_t len;
+        if (round % 4 == 0) {
+            // Pure noise, often starting with an NDEF TLV
+            len = fuzzRand() % sizeof(image);
+            for (size_t i = 0; i < len; i++) image[i] = (uint8_t)fuzzRand();
+            if (len && (round & 8)) image[0] = 0x03;
+        } else {
+            // A valid message with a few bytes changed and maybe cut short
+            memcpy(image, valid, validLen);
+            len = validLen;
+            int edits = 1 + fuzzRand() % 4;
+            for (int e = 0; e < edits; e++) {
+                size_t at = fuzzRand() % len;
+                switch (fuzzRand() % 3) {
+                    case 0: image[at] = (uint8_t)fuzzRand(); break;
+                    case 1: image[at] ^= (uint8_t)(1u << (fuzzRand() % 8)); break;
+                    case 2: image[at] = (fuzzRand() & 1) ? 0xFF : 0x00; break;
+                }
+            }
+            if (fuzzRand() % 3 == 0) len = fuzzRand() % (len + 1);
+        }
+        parseAll(image, len);
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_text_round_trip);
+    RUN_TEST(test_utf8_kept_and_cut_on_a_character);
+    RUN_TEST(test_uri_prefix_round_trip);
+    RUN_TEST(test_long_record_and_long_tlv);
+    RUN_TEST(test_skips_null_and_control_tlvs);
+    RUN_TEST(test_truncated_and_overflowing);
+    RUN_TEST(test_fuzz);
+    return UNITY_END();
+}